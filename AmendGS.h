@@ -32,6 +32,7 @@
 #define REPO_MENU_ADD_FILE_ID MENUITEM_0000010A
 #define REPO_MENU_DISCARD_CHANGES_ID MENUITEM_0000010B
 #define REPO_MENU_APPLY_PATCH_ID MENUITEM_0000010C
+#define REPO_MENU_STATS_ID MENUITEM_00000113
 
 #define AMENDMENT_MENU_EDIT_ID MENUITEM_0000010D
 #define AMENDMENT_MENU_EXPORT_ID MENUITEM_00000110
@@ -149,6 +149,7 @@
 #define MENUITEM_00000110 272L
 #define MENUITEM_00000111 273L
 #define MENUITEM_00000112 274L
+#define MENUITEM_00000113 275L
 
 /*************************************************************************
    These are the defines that should be placed before your code
@@ -20,13 +20,15 @@
 #include <types.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <memory.h>
-#include <resources.h>
 #include <gsos.h>
 #include <orca.h>
-#include <appleshare.h>
 
 #include "bile.h"
+#include "bile_private.h"
+#include "lz.h"
+#include "stats.h"
 #include "util.h"
 
 segment "bile";
@@ -36,16 +38,32 @@ static word _bile_error = 0;
 
 static word _bile_open_ignore_primary_map = 0;
 
-struct bile_object*	bile_alloc(struct bile *bile, const unsigned long type,
-                               const unsigned long id, const size_t size);
-struct bile_object*	bile_object_in_map(struct bile *bile,
-                                       const unsigned long type, const unsigned long id);
-word bile_read_map(struct bile *bile,
-                       struct bile_object *map_ptr);
-word bile_write_map(struct bile *bile);
-size_t bile_xwriteat(struct bile *bile, const size_t pos,
-                         const void *data, const size_t len);
-void bile_check_sanity(struct bile *bile);
+#ifdef BILE_TRACE
+/* the open trace, if any, and records not yet written to it */
+static word _bile_trace_frefnum = 0;
+static word _bile_trace_nfiles = 0;
+static unsigned char _bile_trace_buf[BILE_TRACE_RECORD_SIZE * 64];
+static size_t _bile_trace_len = 0;
+
+#define TRACE_START()	(_bile_trace_frefnum ? stats_clock() : 0)
+#define TRACE(bile, op, pos, len, start) \
+    ((bile)->trace_file ? bile_trace((bile), (op), (pos), (len), (start)) : \
+     (void)0)
+#define TRACE_ATTACH(bile)	bile_trace_attach(bile)
+#else
+#define TRACE_START()	0
+#define TRACE(bile, op, pos, len, start)	((void)(len), (void)(start))
+#define TRACE_ATTACH(bile)
+#endif
+
+/*
+ * On disk every object header and map entry is four little-endian longs,
+ * which is exactly a struct bile_object with ORCA/C's 32-bit longs, so
+ * only hosts with wider longs need to convert them.
+ */
+#ifdef __ORCAC__
+#define BILE_NATIVE_OBJECTS
+#endif
 
 /* Public API */
 
@@ -60,6 +78,7 @@ word bile_error(struct bile *bile) {
 struct bile *bile_create(const StringPtr filename, const long creator,
                          const unsigned long type) {
     struct bile *bile = NULL;
+    unsigned char header[BILE_OBJECT_SIZE];
     size_t len;
     char *tmp;
     word frefnum;
@@ -79,6 +98,10 @@ struct bile *bile_create(const StringPtr filename, const long creator,
     bile = xmalloczero(sizeof(struct bile), "bile_create");
     memcpy(bile->magic, BILE_MAGIC, BILE_MAGIC_LEN);
     bile->frefnum = frefnum;
+    bile->cache_nblocks = BILE_CACHE_BLOCKS;
+    bile->grow_percent = BILE_GROW_PERCENT;
+    bile->grow_max = BILE_GROW_MAX;
+    bile->lz_bits = LZ_WINDOW_BITS;
     bile->map_ptr.type = BILE_TYPE_MAPPTR;
     memcpy(&bile->filename, filename, sizeof(bile->filename));
 
@@ -93,14 +116,16 @@ struct bile *bile_create(const StringPtr filename, const long creator,
     }
 
     /* write header pointing to blank map */
-    len = sizeof(bile->map_ptr);
-    _bile_error = FWrite(frefnum, &bile->map_ptr, &len);
+    len = BILE_OBJECT_SIZE;
+    bile_pack_object(&bile->map_ptr, header);
+    _bile_error = FWrite(frefnum, header, &len);
     if (_bile_error) {
         goto create_bail;
     }
 
-    len = sizeof(bile->old_map_ptr);
-    _bile_error = FWrite(frefnum, &bile->old_map_ptr, &len);
+    len = BILE_OBJECT_SIZE;
+    bile_pack_object(&bile->old_map_ptr, header);
+    _bile_error = FWrite(frefnum, header, &len);
     if (_bile_error) {
         goto create_bail;
     }
@@ -123,6 +148,8 @@ struct bile *bile_create(const StringPtr filename, const long creator,
               bile->file_size, (long)BILE_HEADER_LEN);
     }
 
+    bile_map_view(bile);
+
     return bile;
 
 create_bail:
@@ -139,6 +166,7 @@ struct bile *bile_open(const StringPtr filename) {
     char magic[BILE_MAGIC_LEN + 1];
     size_t file_size, size;
     word frefnum;
+    unsigned long start = TRACE_START();
 
     _bile_error = 0;
 
@@ -151,8 +179,13 @@ struct bile *bile_open(const StringPtr filename) {
     bile = xmalloczero(sizeof(struct bile), "bile_open");
     memcpy(bile->magic, BILE_MAGIC, sizeof(bile->magic));
     bile->frefnum = frefnum;
+    bile->cache_nblocks = BILE_CACHE_BLOCKS;
+    bile->grow_percent = BILE_GROW_PERCENT;
+    bile->grow_max = BILE_GROW_MAX;
+    bile->lz_bits = LZ_WINDOW_BITS;
     memcpy(&bile->filename, filename, sizeof(bile->filename));
     bile->file_size = file_size;
+    TRACE_ATTACH(bile);
 
     /* verify magic */
     size = BILE_MAGIC_LEN;
@@ -167,16 +200,17 @@ struct bile *bile_open(const StringPtr filename) {
         goto open_bail;
     }
 
+    /* everything from here on can be read through the view, if any */
+    bile_map_view(bile);
+
     /* load map pointer */
-    size = sizeof(bile->map_ptr);
-    _bile_error = FRead(frefnum, &bile->map_ptr, &size); 
+    _bile_error = bile_read_objects(frefnum, &bile->map_ptr, 1);
     if (_bile_error) {
         goto open_bail;
     }
 
     /* old map pointer */
-    size = sizeof(bile->old_map_ptr);
-    _bile_error = FRead(frefnum, &bile->old_map_ptr, &size); 
+    _bile_error = bile_read_objects(frefnum, &bile->old_map_ptr, 1);
     if (_bile_error) {
         goto open_bail;
     }
@@ -193,9 +227,12 @@ struct bile *bile_open(const StringPtr filename) {
         }
     }
 
+    TRACE(bile, BILE_TRACE_OPEN, 0, file_size, start);
     return bile;
 
 open_bail:
+    bile_unmap_view(bile);
+    bile_cache_free(bile);
     FClose(frefnum);
     bile->frefnum = -1;
     if (bile != NULL) {
@@ -232,26 +269,61 @@ struct bile *bile_open_recover_map(const StringPtr filename) {
 
 word bile_flush(struct bile *bile, word and_vol) {
     word ret;
+    unsigned long start = TRACE_START();
 
     bile_check_sanity(bile);
 
+    STAT_COUNT(STAT_BILE_FLUSHES);
     ret = FFlush(bile->frefnum);
+    TRACE(bile, BILE_TRACE_FLUSH, 0, 0, start);
 
     return ret;
 }
 
 void bile_close(struct bile *bile) {
+    unsigned long start = TRACE_START();
+
     bile_check_sanity(bile);
 
     _bile_error = 0;
 
+    bile_unmap_view(bile);
+    bile_cache_free(bile);
+    bile_trim(bile);
     _bile_error = FClose(bile->frefnum);
     bile->frefnum = -1;
+    TRACE(bile, BILE_TRACE_CLOSE, 0, bile->file_size, start);
     if (bile->map != NULL) {
         xfree(&bile->map);
     }
 }
 
+/* use nblocks of BILE_CACHE_BLOCK for reads, or none */
+void bile_set_cache(struct bile *bile, word nblocks) {
+    bile_check_sanity(bile);
+
+    bile_cache_free(bile);
+    bile->cache_nblocks = nblocks;
+}
+
+/* grow by percent of the file size but no more than max, 0 for minimal */
+void bile_set_growth(struct bile *bile, word percent, size_t max) {
+    bile_check_sanity(bile);
+
+    bile->grow_percent = percent;
+    bile->grow_max = max;
+}
+
+/* window size bile_write_compressed uses, see lz.h */
+void bile_set_lz_bits(struct bile *bile, word bits) {
+    bile_check_sanity(bile);
+
+    if (bits < LZ_MIN_WINDOW_BITS || bits > LZ_MAX_WINDOW_BITS) {
+        panic("bile_set_lz_bits: bad window bits %d", bits);
+    }
+    bile->lz_bits = bits;
+}
+
 struct bile_object *bile_find(struct bile *bile, const unsigned long 
                               type, const unsigned long id) {
     struct bile_object *o, *ocopy;
@@ -266,8 +338,8 @@ struct bile_object *bile_find(struct bile *bile, const unsigned long
 
     snprintf(note, sizeof(note), "bile_find %s %lu", OSTypeToString(type),
              id);
-    ocopy = xmalloc(BILE_OBJECT_SIZE, note);
-    memcpy(ocopy, o, BILE_OBJECT_SIZE);
+    ocopy = xmalloc(sizeof(struct bile_object), note);
+    memcpy(ocopy, o, sizeof(struct bile_object));
 
     return ocopy;
 }
@@ -291,7 +363,7 @@ size_t bile_count_by_type(struct bile *bile, const unsigned long type) {
 size_t bile_sorted_ids_by_type(struct bile *bile, const unsigned long type,
                         unsigned long **ret) {
     struct bile_object *o;
-    size_t count, size = 0, n, j, t;
+    size_t count, size = 0, n;
     unsigned long *ids = NULL;
 
     count = 0;
@@ -310,14 +382,8 @@ size_t bile_sorted_ids_by_type(struct bile *bile, const unsigned long type,
         ids[count++] = o->id;
     }
 
-    for (n = 0; n < count; n++) {
-        for (j = 0; j < count - n - 1; j++) {
-            if (ids[j] > ids[j + 1]) {
-                t = ids[j];
-                ids[j] = ids[j + 1];
-                ids[j + 1] = t;
-            }
-        }
+    if (count > 1) {
+        qsort(ids, count, sizeof(unsigned long), bile_id_cmp);
     }
 
     *ret = ids;
@@ -344,8 +410,8 @@ struct bile_object *bile_get_nth_of_type(struct bile *bile,
         if (count == index) {
             snprintf(note, sizeof(note), "bile_get_nth %s %lu",
                      OSTypeToString(type), index);
-            ocopy = xmalloc(BILE_OBJECT_SIZE, note);
-            memcpy(ocopy, o, BILE_OBJECT_SIZE);
+            ocopy = xmalloc(sizeof(struct bile_object), note);
+            memcpy(ocopy, o, sizeof(struct bile_object));
             return ocopy;
         }
         count++;
@@ -354,11 +420,43 @@ struct bile_object *bile_get_nth_of_type(struct bile *bile,
     return NULL;
 }
 
+/*
+ * Copy out every object of a type in one pass over the map, rather than
+ * calling bile_get_nth_of_type for each of them
+ */
+size_t bile_objects_by_type(struct bile *bile, const unsigned long type,
+                            struct bile_object **ret) {
+    struct bile_object *o;
+    size_t n, count;
+    char note[MALLOC_NOTE_SIZE];
+
+    *ret = NULL;
+
+    count = bile_count_by_type(bile, type);
+    if (count == 0) {
+        return 0;
+    }
+
+    snprintf(note, sizeof(note), "bile_objects_by_type %s",
+             OSTypeToString(type));
+    *ret = xcalloc(count, sizeof(struct bile_object), note);
+
+    count = 0;
+    for (n = 0; n < bile->nobjects; n++) {
+        o = &bile->map[n];
+        if (o->type == type) {
+            (*ret)[count++] = *o;
+        }
+    }
+
+    return count;
+}
+
 unsigned long bile_next_id(struct bile *bile, const unsigned long type) {
     struct bile_object *o;
     size_t n;
     unsigned long id = 1;
-    unsigned long highest;
+    unsigned char highest[4];
 
     bile_check_sanity(bile);
 
@@ -369,22 +467,67 @@ unsigned long bile_next_id(struct bile *bile, const unsigned long type) {
         if (o->type == type && o->id >= id) id = o->id + 1;
     }
 
-    if (bile_read(bile, BILE_TYPE_HIGHESTID, type, &highest,
-                  sizeof(unsigned long)) == sizeof(unsigned long)) {
-        if (highest > id) {
-            id = highest + 1;
+    if (bile_read(bile, BILE_TYPE_HIGHESTID, type, highest,
+                  sizeof(highest)) == sizeof(highest)) {
+        if (bile_get_long(highest) > id) {
+            id = bile_get_long(highest) + 1;
         }
     }
 
     return id;
 }
 
+/* the length of o's data, which for compressed data is stored with it */
+size_t bile_object_size(struct bile *bile, const struct bile_object *o) {
+    unsigned char len[4];
+    const unsigned char *view;
+    size_t size;
+
+    bile_check_sanity(bile);
+
+    _bile_error = bile->last_error = 0;
+
+    if (!(o->size & BILE_OBJECT_COMPRESSED)) {
+        return o->size;
+    }
+
+    if (BILE_OBJECT_LEN(o) < BILE_LZ_HEADER_LEN ||
+        !bile_object_fits(bile, o->pos, BILE_OBJECT_LEN(o))) {
+        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        return 0;
+    }
+
+    view = bile_view_at(bile, o->pos + BILE_OBJECT_SIZE, sizeof(len));
+    if (view != NULL) {
+        size = bile_get_long(view);
+    } else {
+        _bile_error = bile->last_error =
+            bile_cache_read(bile, o->pos + BILE_OBJECT_SIZE, len,
+                            sizeof(len));
+        if (_bile_error) {
+            return 0;
+        }
+        size = bile_get_long(len);
+    }
+
+    /* no more than lz_decompress could make of it, or it'd be allocated */
+    if (size / LZ_MAX_MATCH(LZ_MIN_WINDOW_BITS) >
+        BILE_OBJECT_LEN(o) - BILE_LZ_HEADER_LEN) {
+        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        return 0;
+    }
+
+    return size;
+}
+
 word bile_delete(struct bile *bile, const unsigned long type, 
                  const unsigned long id) {
     static char zero[128] = { 0 };
     struct bile_object *o;
-    size_t pos, size, wsize, n;
+    size_t pos, size, wsize, n, len;
     unsigned long highest;
+    unsigned char highest_data[4];
+    unsigned long start = TRACE_START();
 
     bile_check_sanity(bile);
 
@@ -398,22 +541,25 @@ word bile_delete(struct bile *bile, const unsigned long type,
 
     o->type = BILE_TYPE_PURGE;
     pos = o->pos;
-    size = o->size + BILE_OBJECT_SIZE;
+    size = BILE_OBJECT_LEN(o) + BILE_OBJECT_SIZE;
+    bile_cache_update(bile, pos, NULL, size);
 
-    _bile_error = bile->last_error = FSeek(bile->frefnum, pos); 
+    _bile_error = bile->last_error = bile_seek(bile, pos);
     if (_bile_error) {
         return -1;
     }
 
+    len = size;
     while (size > 0) {
         wsize = MIN(128, size);
         size -= wsize;
 
-        _bile_error = bile->last_error = FWrite(bile->frefnum, zero, &size);
+        _bile_error = bile->last_error = FWrite(bile->frefnum, zero, &wsize);
         if (_bile_error) {
             return -1;
         }
     }
+    TRACE(bile, BILE_TRACE_WRITE, pos, len, start);
 
     /*
      * If this is the highest id of this type, store it so it won't get
@@ -430,8 +576,9 @@ word bile_delete(struct bile *bile, const unsigned long type,
 
     if (highest == id) {
         /* store the type as the id, and the highest id as the data */
-        bile_write(bile, BILE_TYPE_HIGHESTID, type, &highest,
-                   sizeof(unsigned long));
+        bile_put_long(highest_data, highest);
+        bile_write(bile, BILE_TYPE_HIGHESTID, type, highest_data,
+                   sizeof(highest_data));
 
         /* bile_write wrote a new map for us */
     } else {
@@ -444,16 +591,31 @@ word bile_delete(struct bile *bile, const unsigned long type,
     return 0;
 }
 
+/* read up to len bytes of o's data, decompressing it if need be */
 size_t bile_read_object(struct bile *bile, const struct bile_object *o,
                         void *data, const size_t len) {
-    struct bile_object verify;
-    size_t rsize, wantlen;
+    unsigned long start = TRACE_START();
+    size_t ret;
 
-    bile_check_sanity(bile);
+    ret = bile_load_object(bile, o, data, len);
+    /* what was read off the disk, which for compressed data isn't ret */
+    TRACE(bile, BILE_TRACE_READ, o->pos,
+          (ret && (o->size & BILE_OBJECT_COMPRESSED)) ? BILE_OBJECT_LEN(o) :
+          ret, start);
 
-    if (o == NULL) {
-        panic("bile_read_object: NULL object passed");
+    return ret;
+}
+
+size_t bile_load_object(struct bile *bile, const struct bile_object *o,
+                        void *data, const size_t len) {
+    const unsigned char *stored;
+    char *copy;
+    size_t wantlen;
+
+    if (o == NULL || !(o->size & BILE_OBJECT_COMPRESSED)) {
+        return bile_read_stored(bile, o, data, len);
     }
+
     if (data == NULL) {
         panic("bile_read_object: NULL data pointer passed");
     }
@@ -461,71 +623,32 @@ size_t bile_read_object(struct bile *bile, const struct bile_object *o,
         panic("bile_read_object: zero len");
     }
 
-    _bile_error = bile->last_error = 0;
-
-    if (o->pos + BILE_OBJECT_SIZE + o->size > bile->file_size) {
-        warn("bile_read_object: object %s:%ld pos %ld size %ld > "
-             "file size %ld", OSTypeToString(o->type), o->id, o->pos,
-             o->size, bile->file_size);
-        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+    stored = bile_stored_data(bile, o, &copy);
+    if (stored == NULL) {
         return 0;
     }
 
-    _bile_error = bile->last_error = FSeek(bile->frefnum, o->pos);
-    if (_bile_error) {
-        warn("bile_read_object: object %s:%lu points to bogus position "
-             "%lu", OSTypeToString(o->type), o->id, o->pos);
-        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
-        return 0;
-    }
-
-    rsize = BILE_OBJECT_SIZE;
-    _bile_error = bile->last_error = FRead(bile->frefnum,  &verify, &rsize);
-    if (_bile_error) {
-        return 0;
-    }
-
-    if (verify.id != o->id) {
-        warn("bile_read_object: object %s:%ld pos %ld wrong id %ld, "
-             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
-             verify.id, o->id);
-        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
-        return 0;
-    }
-    if (verify.type != o->type) {
-        warn("bile_read_object: object %s:%ld pos %ld wrong type %ld, "
-             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
-             verify.type, o->type);
-        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
-        return 0;
-    }
-    if (verify.size != o->size) {
-        warn("bile_read_object: object %s:%ld pos %ld wrong size %ld, "
-             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
-             verify.size, o->size);
-        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
-        return 0;
-    }
-
-    wantlen = len;
-    if (wantlen > o->size) {
-        wantlen = o->size;
+    wantlen = 0;
+    if (BILE_OBJECT_LEN(o) >= BILE_LZ_HEADER_LEN) {
+        wantlen = MIN(len, bile_get_long(stored));
+        if (wantlen == 0 ||
+            lz_decompress(stored + BILE_LZ_HEADER_LEN,
+                          BILE_OBJECT_LEN(o) - BILE_LZ_HEADER_LEN, data,
+                          wantlen, stored[4]) != wantlen) {
+            wantlen = 0;
+        }
     }
-
-    rsize = wantlen;
-    _bile_error = bile->last_error = FRead(bile->frefnum, data, &rsize); 
-    if (_bile_error) {
-        return 0;
+    if (copy != NULL) {
+        xfree(&copy);
     }
 
-    if (rsize != wantlen) {
-        warn("bile_read_object: %s:%lu: needed to read %ld, read %ld",
-             OSTypeToString(o->type), o->id, wantlen, rsize);
+    if (wantlen == 0) {
+        warn("bile_read_object: %s:%lu: bad compressed data",
+             OSTypeToString(o->type), o->id);
         _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
-        return 0;
     }
 
-    return rsize;
+    return wantlen;
 }
 
 size_t bile_read(struct bile *bile, const unsigned long type, 
@@ -550,7 +673,7 @@ size_t bile_read(struct bile *bile, const unsigned long type,
 size_t bile_read_alloc(struct bile *bile, const unsigned long type,
                        const unsigned long id, void *data_ptr) {
     struct bile_object *o;
-    size_t ret;
+    size_t ret, size;
     char **data;
     char note[MALLOC_NOTE_SIZE];
 
@@ -570,53 +693,100 @@ size_t bile_read_alloc(struct bile *bile, const unsigned long type,
         return 0;
     }
 
+    size = bile_object_size(bile, o);
+    if (size == 0) {
+        *data = NULL;
+        return 0;
+    }
+
     snprintf(note, sizeof(note), "bile_read_alloc %s %ld",
              OSTypeToString(type), id);
-    *data = xmalloczero(o->size, note);
-    ret = bile_read_object(bile, o, *data, o->size);
+    *data = xmalloczero(size, note);
+    ret = bile_read_object(bile, o, *data, size);
+    if (ret == 0) {
+        /* callers take 0 to mean there's nothing to free */
+        xfree(data);
+    }
 
     return ret;
 }
 
-size_t bile_write(struct bile *bile, const unsigned long type, 
-                  const unsigned long id, const void *data, const size_t len) {
-    struct bile_object *old, *new_obj;
-    size_t wrote;
+/*
+ * Return o's data without copying it when the file is mapped and the
+ * object isn't compressed, or else read into a new buffer that is
+ * returned in copy for the caller to xfree.  A view into the map is only
+ * good until the next write.
+ */
+const void *bile_object_data(struct bile *bile, const struct bile_object *o,
+                             char **copy) {
+    const unsigned char *stored;
+    size_t size;
+    unsigned long start = TRACE_START();
 
     bile_check_sanity(bile);
 
-    if (len == 0) {
-        panic("bile_write: zero len passed");
+    if (!(o->size & BILE_OBJECT_COMPRESSED)) {
+        stored = bile_stored_data(bile, o, copy);
+        TRACE(bile, BILE_TRACE_READ, o->pos,
+              stored != NULL ? BILE_OBJECT_LEN(o) : 0, start);
+        return stored;
     }
-    if (data == NULL) {
-        panic("bile_write: NULL data pointer passed");
+
+    /* compressed data always has to be copied out */
+    *copy = NULL;
+    size = bile_object_size(bile, o);
+    if (size == 0) {
+        return NULL;
+    }
+    *copy = xmalloc(size, "bile_object_data");
+    if (bile_read_object(bile, o, *copy, size) != size) {
+        xfree(copy);
+        return NULL;
     }
 
-    _bile_error = bile->last_error = 0;
+    return *copy;
+}
 
-    if ((old = bile_object_in_map(bile, type, id)) != NULL) {
-        old->type = BILE_TYPE_PURGE;
-    }
+size_t bile_write(struct bile *bile, const unsigned long type, 
+                  const unsigned long id, const void *data, const size_t len) {
+    bile_check_sanity(bile);
 
-    new_obj = bile_alloc(bile, type, id, len);
+    return bile_write_stored(bile, type, id, data, len, 0);
+}
 
-    wrote = bile_xwriteat(bile, new_obj->pos, new_obj, BILE_OBJECT_SIZE);
-    if (wrote != BILE_OBJECT_SIZE || bile->last_error) {
-        return 0;
+/*
+ * Like bile_write but store the data compressed, unless that doesn't
+ * make it any smaller.  Returns len when it's all written.
+ */
+size_t bile_write_compressed(struct bile *bile, unsigned long type,
+                             const unsigned long id, const void *data,
+                             const size_t len) {
+    unsigned char *packed;
+    size_t plen, wrote;
+
+    bile_check_sanity(bile);
+
+    if (len <= BILE_LZ_HEADER_LEN) {
+        return bile_write(bile, type, id, data, len);
     }
-    wrote = bile_xwriteat(bile, new_obj->pos + BILE_OBJECT_SIZE, data, len);
-    if (wrote != len || bile->last_error) {
-        return 0;
+
+    packed = xmalloc(len, "bile_write_compressed");
+    plen = lz_compress(data, len, packed + BILE_LZ_HEADER_LEN,
+                       len - BILE_LZ_HEADER_LEN - 1, bile->lz_bits);
+    if (plen == 0) {
+        xfree(&packed);
+        return bile_write(bile, type, id, data, len);
     }
 
-    FGetEOF(bile->frefnum, &bile->file_size);
+    bile_put_long(packed, len);
+    packed[4] = bile->lz_bits;
+    plen += BILE_LZ_HEADER_LEN;
 
-    bile_write_map(bile);
-    if (bile->last_error) {
-        return 0;
-    }
+    wrote = bile_write_stored(bile, type, id, packed, plen,
+                              BILE_OBJECT_COMPRESSED);
+    xfree(&packed);
 
-    return wrote;
+    return (wrote == plen ? len : 0);
 }
 
 word bile_marshall_object(struct bile *bile,
@@ -624,7 +794,7 @@ word bile_marshall_object(struct bile *bile,
                           const size_t nfields, void *object, void *ret_ptr, 
                           size_t *ret_size, char *note) {
     char **ret;
-    char *data, *ptr;
+    char *data = NULL, *ptr;
     size_t size = 0, fsize = 0, n;
     bool write = false;
 
@@ -690,6 +860,12 @@ iterate_fields:
     return 0;
 }
 
+/*
+ * Fill in object from data made by bile_marshall_object.  The lengths of
+ * dynamically-sized fields come from data, so a field that would run
+ * past data_size makes it BILE_ERR_BOGUS_OBJECT, with anything deep
+ * already allocated freed again.
+ */
 word bile_unmarshall_object(struct bile *bile,
                        const struct bile_object_field *fields, const size_t nfields,
                        const void *data, const size_t data_size, void *object,
@@ -699,23 +875,29 @@ word bile_unmarshall_object(struct bile *bile,
 
     bile_check_sanity(bile);
 
+    _bile_error = bile->last_error = 0;
+
     for (off = 0, n = 0; n < nfields; n++) {
         if (fields[n].size < 0) {
             /* dynamically-sized field, read length */
+            if (sizeof(fsize) > data_size - off) {
+                goto bogus;
+            }
             memcpy(&fsize, (char *)data + off, sizeof(fsize));
             off += sizeof(fsize);
         } else fsize = fields[n].size;
 
-        if (off + fsize > data_size) {
-            panic("bile_unmarshall_object: overflow at field %lu of %lu!",
-                                           n + 1, nfields);
+        if (fsize > data_size - off) {
+            goto bogus;
         }
 
         ptr = (char *)object + fields[n].struct_off;
 
         if (fields[n].size < 0 && deep) {
             if (fsize == 0) {
-                memset(ptr, 0, sizeof(dptr));
+                /* ptr is the field holding the pointer, clear that */
+                dptr = NULL;
+                memcpy(ptr, &dptr, sizeof(dptr));
                 continue;
             }
             dptr = xmalloc(fsize, note);
@@ -723,8 +905,10 @@ word bile_unmarshall_object(struct bile *bile,
             ptr = dptr;
         }
 
-        if (fields[n].size < 0 && !deep) memset(ptr, 0, sizeof(dptr));
-        else {
+        if (fields[n].size < 0 && !deep) {
+            dptr = NULL;
+            memcpy(ptr, &dptr, sizeof(dptr));
+        } else {
             if (fields[n].size > 0 &&
                 fields[n].struct_off + fsize > object_size) panic("bile_unmarshall_object: overflow writing to object "
                                                                   "at field %lu! (%lu > %lu)", n + 1,
@@ -736,6 +920,24 @@ word bile_unmarshall_object(struct bile *bile,
     }
 
     return 0;
+
+bogus:
+    warn("bile_unmarshall_object: field %lu of %lu runs past the end of "
+         "%lu bytes", n + 1, nfields, data_size);
+    while (deep && n-- > 0) {
+        if (fields[n].size >= 0) {
+            continue;
+        }
+        ptr = (char *)object + fields[n].struct_off;
+        memcpy(&dptr, ptr, sizeof(dptr));
+        if (dptr != NULL) {
+            /* and NULLs it */
+            xfree(&dptr);
+            memcpy(ptr, &dptr, sizeof(dptr));
+        }
+    }
+    _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+    return BILE_ERR_BOGUS_OBJECT;
 }
 
 word bile_verify(struct bile *bile) {
@@ -747,7 +949,7 @@ word bile_verify(struct bile *bile) {
     _bile_error = bile->last_error = 0;
 
     for (n = 0, pos = 0; n < bile->nobjects; n++) {
-        size = bile_read_object(bile, &bile->map[n], &data, 1);
+        size = bile_read_stored(bile, &bile->map[n], &data, 1);
         if (bile_error(bile)) {
             return bile_error(bile);
         } else if (size == 0) {
@@ -757,7 +959,7 @@ word bile_verify(struct bile *bile) {
         if (bile->map[n].pos <= pos) {
             return -1;
         }
-        pos = bile->map[n].pos + bile->map[n].size;
+        pos = bile->map[n].pos + BILE_OBJECT_LEN(&bile->map[n]);
     }
 
     return 0;
@@ -765,6 +967,169 @@ word bile_verify(struct bile *bile) {
 
 /* Private API */
 
+/* read up to len bytes of o as it is on disk */
+size_t bile_read_stored(struct bile *bile, const struct bile_object *o,
+                        void *data, const size_t len) {
+    struct bile_object verify;
+    unsigned char header[BILE_OBJECT_SIZE];
+    const unsigned char *view;
+    size_t wantlen;
+
+    bile_check_sanity(bile);
+
+    if (o == NULL) {
+        panic("bile_read_object: NULL object passed");
+    }
+    if (data == NULL) {
+        panic("bile_read_object: NULL data pointer passed");
+    }
+    if (len == 0) {
+        panic("bile_read_object: zero len");
+    }
+
+    _bile_error = bile->last_error = 0;
+
+    if (!bile_object_fits(bile, o->pos, BILE_OBJECT_LEN(o))) {
+        warn("bile_read_object: object %s:%ld pos %ld size %ld > "
+             "file size %ld", OSTypeToString(o->type), o->id, o->pos,
+             BILE_OBJECT_LEN(o), bile->file_size);
+        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        return 0;
+    }
+
+    /* a mapped file is checked and copied in place, no seeks or reads */
+    view = bile_view_at(bile, o->pos, BILE_OBJECT_SIZE + BILE_OBJECT_LEN(o));
+    if (view != NULL) {
+        bile_unpack_objects(view, &verify, 1);
+    } else {
+        _bile_error = bile->last_error = bile_cache_read(bile, o->pos,
+                                                         header,
+                                                         BILE_OBJECT_SIZE);
+        if (_bile_error) {
+            warn("bile_read_object: object %s:%lu points to bogus position "
+                 "%lu", OSTypeToString(o->type), o->id, o->pos);
+            _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+            return 0;
+        }
+        bile_unpack_objects(header, &verify, 1);
+    }
+
+    _bile_error = bile->last_error = bile_check_header(o, &verify);
+    if (_bile_error) {
+        return 0;
+    }
+
+    wantlen = len;
+    if (wantlen > BILE_OBJECT_LEN(o)) {
+        wantlen = BILE_OBJECT_LEN(o);
+    }
+
+    if (view != NULL) {
+        memcpy(data, view + BILE_OBJECT_SIZE, wantlen);
+        STAT_COUNT(STAT_BILE_READS);
+        STAT_ADD(STAT_BILE_READ_BYTES, wantlen);
+        return wantlen;
+    }
+
+    _bile_error = bile->last_error = bile_cache_read(bile,
+                                                     o->pos + BILE_OBJECT_SIZE,
+                                                     data, wantlen);
+    if (_bile_error == eofEncountered) {
+        warn("bile_read_object: %s:%lu: needed to read %ld, hit end of file",
+             OSTypeToString(o->type), o->id, wantlen);
+        _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+    }
+    if (_bile_error) {
+        return 0;
+    }
+
+    STAT_COUNT(STAT_BILE_READS);
+    STAT_ADD(STAT_BILE_READ_BYTES, wantlen);
+    return wantlen;
+}
+
+size_t bile_write_stored(struct bile *bile, const unsigned long type,
+                         const unsigned long id, const void *data,
+                         const size_t len, const unsigned long flags) {
+    struct bile_object *old, *new_obj;
+    size_t wrote;
+
+    if (len == 0) {
+        panic("bile_write: zero len passed");
+    }
+    if (data == NULL) {
+        panic("bile_write: NULL data pointer passed");
+    }
+
+    _bile_error = bile->last_error = 0;
+
+    if ((old = bile_object_in_map(bile, type, id)) != NULL) {
+        old->type = BILE_TYPE_PURGE;
+    }
+
+    new_obj = bile_alloc(bile, type, id, len);
+    new_obj->size |= flags;
+
+    wrote = bile_write_objects(bile, new_obj->pos, new_obj, 1);
+    if (wrote != BILE_OBJECT_SIZE || bile->last_error) {
+        return 0;
+    }
+    wrote = bile_xwriteat(bile, new_obj->pos + BILE_OBJECT_SIZE, data, len);
+    if (wrote != len || bile->last_error) {
+        return 0;
+    }
+
+    FGetEOF(bile->frefnum, &bile->file_size);
+
+    bile_write_map(bile);
+    if (bile->last_error) {
+        return 0;
+    }
+
+    STAT_COUNT(STAT_BILE_WRITES);
+    STAT_ADD(STAT_BILE_WRITE_BYTES, wrote);
+    return wrote;
+}
+
+/* o's data as it is on disk, like bile_object_data */
+const unsigned char *bile_stored_data(struct bile *bile,
+                                      const struct bile_object *o,
+                                      char **copy) {
+    struct bile_object verify;
+    const unsigned char *view;
+    size_t size;
+
+    size = BILE_OBJECT_LEN(o);
+    *copy = NULL;
+    _bile_error = bile->last_error = 0;
+
+    if (size > 0 && bile_object_fits(bile, o->pos, size)) {
+        view = bile_view_at(bile, o->pos, BILE_OBJECT_SIZE + size);
+        if (view != NULL) {
+            bile_unpack_objects(view, &verify, 1);
+            _bile_error = bile->last_error = bile_check_header(o, &verify);
+            if (_bile_error) {
+                return NULL;
+            }
+            STAT_COUNT(STAT_BILE_READS);
+            STAT_ADD(STAT_BILE_READ_BYTES, size);
+            return view + BILE_OBJECT_SIZE;
+        }
+    }
+
+    /* bile_read_stored will say what's wrong with it */
+    *copy = xmalloc(size ? size : 1, "bile_stored_data");
+    if (size == 0 || bile_read_stored(bile, o, *copy, size) != size) {
+        xfree(copy);
+        if (size == 0) {
+            _bile_error = bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        }
+        return NULL;
+    }
+
+    return (const unsigned char *)*copy;
+}
+
 struct bile_object *bile_object_in_map(struct bile *bile, 
                                        const unsigned long type,
                                        const unsigned long id) {
@@ -802,7 +1167,8 @@ struct bile_object *bile_alloc(struct bile *bile,
         if (bile->map[n].pos - last_pos >= (size + BILE_OBJECT_SIZE)) {
             break;
         }
-        last_pos = bile->map[n].pos + BILE_OBJECT_SIZE + bile->map[n].size;
+        last_pos = bile->map[n].pos + BILE_OBJECT_SIZE +
+            BILE_OBJECT_LEN(&bile->map[n]);
     }
 
     /*
@@ -825,7 +1191,11 @@ struct bile_object *bile_alloc(struct bile *bile,
     }
 
     bile->nobjects++;
-    bile->map = xreallocarray(bile->map, bile->nobjects, BILE_OBJECT_SIZE);
+    if (bile->nobjects > bile->map_cap) {
+        bile->map_cap = grow_capacity(bile->map_cap, bile->nobjects, 16);
+        bile->map = xreallocarray(bile->map, bile->map_cap,
+                                  sizeof(struct bile_object));
+    }
 
     if (map_pos + 1 < bile->nobjects) {
         /* shift remaining objects up */
@@ -841,60 +1211,103 @@ struct bile_object *bile_alloc(struct bile *bile,
     return &bile->map[map_pos];
 }
 
+/*
+ * Load the map map_ptr points to.  Everything in it comes off the disk,
+ * so the map and every object it lists have to lie within the file, in
+ * order and without overlapping, or the whole thing is
+ * BILE_ERR_BOGUS_OBJECT.
+ */
 word bile_read_map(struct bile *bile, struct bile_object *map_ptr) {
-    size_t size;
+    size_t size, n, end;
     struct bile_object map_obj, *map;
-    word error; 
+    const unsigned char *view;
 
     bile_check_sanity(bile);
 
-    if (map_ptr->pos + map_ptr->size > bile->file_size) {
+    if (map_ptr->pos < BILE_HEADER_LEN ||
+        !bile_object_fits(bile, map_ptr->pos, map_ptr->size)) {
         warn("bile_read_map: map points to %lu + %lu, but file is only %lu",
              map_ptr->pos, map_ptr->size, bile->file_size);
-        return -1;
+        _bile_error = BILE_ERR_BOGUS_OBJECT;
+        return _bile_error;
     }
 
     if (map_ptr->size % BILE_OBJECT_SIZE != 0) {
         warn("bile_read_map: map pointer size is not a multiple of object "
              "size (%lu): %lu", BILE_OBJECT_SIZE, map_ptr->size);
-        return -1;
+        _bile_error = BILE_ERR_BOGUS_OBJECT;
+        return _bile_error;
     }
 
     /* read and verify map object header map_ptr points to */
-    error = _bile_error = FSeek(bile->frefnum, map_ptr->pos);
-    if (_bile_error) {
-        return -1;
-    }
+    view = bile_view_at(bile, map_ptr->pos,
+                        BILE_OBJECT_SIZE + map_ptr->size);
+    if (view != NULL) {
+        bile_unpack_objects(view, &map_obj, 1);
+    } else {
+        _bile_error = bile_seek(bile, map_ptr->pos);
+        if (_bile_error) {
+            return -1;
+        }
 
-    size = sizeof(struct bile_object);
-    _bile_error = FRead(bile->frefnum, &map_obj, &size);
-    if (_bile_error) {
-        return -1;
+        _bile_error = bile_read_objects(bile->frefnum, &map_obj, 1);
+        if (_bile_error) {
+            return -1;
+        }
     }
 
     if (map_obj.pos != map_ptr->pos) {
         warn("bile_read_map: map pointer points to %lu but object "
              "there has position %lu", map_ptr->pos, map_obj.pos);
-        return -1;
+        _bile_error = BILE_ERR_BOGUS_OBJECT;
+        return _bile_error;
     }
 
     if (map_obj.size != map_ptr->size) {
         warn("bile_read_map: map is supposed to have size %lu but "
              "object pointed to has size %lu", map_ptr->size, map_obj.size);
-        return -1;
+        _bile_error = BILE_ERR_BOGUS_OBJECT;
+        return _bile_error;
     }
 
     /* read entire map */
-    size = map_obj.size;
-    map = xmalloczero(size, "bile_read_map");
-    _bile_error = FRead(bile->frefnum, map, &size);
-    if (_bile_error) {
-        xfree(&map);
-        return -1;
+    size = map_obj.size / BILE_OBJECT_SIZE;
+    map = xcalloc(size, sizeof(struct bile_object), "bile_read_map");
+    if (view != NULL) {
+        bile_unpack_objects(view + BILE_OBJECT_SIZE, map, size);
+    } else {
+        _bile_error = bile_read_objects(bile->frefnum, map, size);
+        if (_bile_error) {
+            xfree(&map);
+            return -1;
+        }
+    }
+
+    /* in order and apart too, bile_alloc finds its gaps assuming so */
+    for (n = 0, end = BILE_HEADER_LEN; n < size; n++) {
+        if (!bile_object_fits(bile, map[n].pos, BILE_OBJECT_LEN(&map[n]))) {
+            warn("bile_read_map: object %s:%lu at %lu + %lu is past the "
+                 "end of the file at %lu", OSTypeToString(map[n].type),
+                 map[n].id, map[n].pos, BILE_OBJECT_LEN(&map[n]),
+                 bile->file_size);
+            xfree(&map);
+            _bile_error = BILE_ERR_BOGUS_OBJECT;
+            return _bile_error;
+        }
+        if (map[n].pos < end) {
+            warn("bile_read_map: object %s:%lu at %lu overlaps what comes "
+                 "before it, up to %lu", OSTypeToString(map[n].type),
+                 map[n].id, map[n].pos, end);
+            xfree(&map);
+            _bile_error = BILE_ERR_BOGUS_OBJECT;
+            return _bile_error;
+        }
+        end = map[n].pos + BILE_OBJECT_SIZE + BILE_OBJECT_LEN(&map[n]);
     }
 
     bile->map = map;
-    bile->nobjects = map_obj.size / BILE_OBJECT_SIZE;
+    bile->nobjects = size;
+    bile->map_cap = size;
 
     return 0;
 }
@@ -902,42 +1315,54 @@ word bile_read_map(struct bile *bile, struct bile_object *map_ptr) {
 word bile_write_map(struct bile *bile) {
     struct bile_object *obj, *new_map_obj, *new_map,
     *new_map_obj_in_new_map = NULL;
-    size_t new_map_size, new_nobjects, new_map_id;
+    size_t new_map_size, new_nobjects, new_map_id, new_map_cap;
     size_t n;
     word ret;
+    unsigned long start = TRACE_START();
 
     bile_check_sanity(bile);
 
     _bile_error = bile->last_error = 0;
 
-    /* allocate a new map slightly larger than we need */
-    new_nobjects = bile->nobjects;
-    if (bile->map_ptr.pos) new_map_id = bile->map_ptr.id + 1;
-    else {
-        /* new file, map never written, allocate another object for map */
+    /* failures leave it started, so only good writes are timed */
+    STAT_START(STAT_TIME_BILE_MAP_WRITE);
+
+    /*
+     * the new map lists everything but purged objects and the old map,
+     * counted first so a map that doesn't list itself can't overrun it
+     */
+    for (n = 0, new_nobjects = 0; n < bile->nobjects; n++) {
+        obj = &bile->map[n];
+        if (obj->type == BILE_TYPE_PURGE ||
+            (obj->type == BILE_TYPE_MAP && obj->pos == bile->map_ptr.pos)) {
+            continue;
+        }
         new_nobjects++;
-        new_map_id = 1;
     }
+    /* and itself */
+    new_nobjects++;
+    new_map_id = bile->map_ptr.pos ? bile->map_ptr.id + 1 : 1;
+
     new_map_size = BILE_OBJECT_SIZE * new_nobjects;
     new_map_obj = bile_alloc(bile, BILE_TYPE_MAP, new_map_id,
                              new_map_size);
-    new_map = xcalloc(BILE_OBJECT_SIZE, new_nobjects, "bile_write_map");
+    new_map_cap = new_nobjects;
+    new_map = xcalloc(sizeof(struct bile_object), new_map_cap,
+                      "bile_write_map");
 
     for (n = 0, new_nobjects = 0; n < bile->nobjects; n++) {
         obj = &bile->map[n];
 
-        if (obj->type == BILE_TYPE_MAP && obj->pos == bile->map_ptr.pos) {
+        if (obj == new_map_obj) {
+            new_map_obj_in_new_map = &new_map[new_nobjects];
+        } else if (obj->type == BILE_TYPE_MAP &&
+                   obj->pos == bile->map_ptr.pos) {
             /* don't include old map in new one */
             continue;
-        }
-        if (obj->type == BILE_TYPE_PURGE) {
+        } else if (obj->type == BILE_TYPE_PURGE) {
             continue;
         }
 
-        if (obj->type == BILE_TYPE_MAP && obj->pos == new_map_obj->pos) {
-            new_map_obj_in_new_map = &new_map[new_nobjects];
-        }
-
         new_map[new_nobjects++] = *obj;
     }
 
@@ -947,14 +1372,14 @@ word bile_write_map(struct bile *bile) {
     new_map_obj_in_new_map->size = new_map_size;
 
     /* write object header */
-    bile_xwriteat(bile, new_map_obj->pos, new_map_obj, BILE_OBJECT_SIZE);
+    bile_write_objects(bile, new_map_obj->pos, new_map_obj, 1);
     if (bile->last_error) {
         return -1;
     }
 
     /* and then the map contents */
-    bile_xwriteat(bile, new_map_obj->pos + BILE_OBJECT_SIZE, new_map,
-                  new_map_size);
+    bile_write_objects(bile, new_map_obj->pos + BILE_OBJECT_SIZE, new_map,
+                       new_nobjects);
     if (bile->last_error) {
         return -1;
     }
@@ -966,25 +1391,28 @@ word bile_write_map(struct bile *bile) {
         return -1;
     }
 
-    /* successfully wrote new map, switch over */
+    /*
+     * successfully wrote new map, switch over; new_map_obj points into the
+     * old map, so take the new pointer from our copy of it
+     */
+    bile->map_cap = new_map_cap;
     xfree(&bile->map);
     bile->nobjects = new_nobjects;
     bile->map = new_map;
     bile->old_map_ptr.pos = bile->map_ptr.pos;
     bile->old_map_ptr.size = bile->map_ptr.size;
     bile->old_map_ptr.id = bile->map_ptr.id;
-    bile->map_ptr.pos = new_map_obj->pos;
-    bile->map_ptr.size = new_map_obj->size;
-    bile->map_ptr.id = new_map_obj->id;
+    bile->map_ptr.pos = new_map_obj_in_new_map->pos;
+    bile->map_ptr.size = new_map_obj_in_new_map->size;
+    bile->map_ptr.id = new_map_obj_in_new_map->id;
 
     /* write new pointer to point at new map object */
-    bile_xwriteat(bile, BILE_MAGIC_LEN, &bile->map_ptr,
-                  sizeof(bile->map_ptr));
+    bile_write_objects(bile, BILE_MAGIC_LEN, &bile->map_ptr, 1);
     if (bile->last_error) {
         return -1;
     }
-    bile_xwriteat(bile, BILE_MAGIC_LEN + sizeof(bile->map_ptr),
-                  &bile->old_map_ptr, sizeof(bile->old_map_ptr));
+    bile_write_objects(bile, BILE_MAGIC_LEN + BILE_OBJECT_SIZE,
+                       &bile->old_map_ptr, 1);
     if (bile->last_error) {
         return -1;
     }
@@ -994,40 +1422,53 @@ word bile_write_map(struct bile *bile) {
         return -1;
     }
 
+    STAT_COUNT(STAT_BILE_MAP_WRITES);
+    STAT_STOP(STAT_TIME_BILE_MAP_WRITE);
+    TRACE(bile, BILE_TRACE_MAP, bile->map_ptr.pos, bile->map_ptr.size, start);
     return 0;
 }
 
 size_t bile_xwriteat(struct bile *bile, const size_t pos, 
                      const void *data, const size_t len) {
-    size_t wsize, tsize;
+    size_t wsize, tsize, grow;
+    unsigned long start = TRACE_START();
 
     bile_check_sanity(bile);
 
     _bile_error = bile->last_error = 0;
 
     if (pos + len > bile->file_size) {
-        /* add new space aligning to BILE_ALLOCATE_SIZE */
+        /*
+         * Reserve a share of the file's size so a growing file isn't
+         * extended on every write, aligned to BILE_ALLOCATE_SIZE.  It
+         * doesn't need its own flush, bile_write_map flushes once the
+         * object and map are written.
+         */
         tsize = pos + len;
-        tsize += BILE_ALLOCATE_SIZE - (tsize % BILE_ALLOCATE_SIZE);
-        FSetEOF(bile->frefnum, tsize);
-
-        _bile_error = bile->last_error = toolerror();
-        if (_bile_error) {
-            return 0;
+        grow = (bile->file_size / 100) * bile->grow_percent;
+        if (grow > bile->grow_max) {
+            grow = bile->grow_max;
+        }
+        if (tsize < bile->file_size + grow) {
+            tsize = bile->file_size + grow;
         }
-        _bile_error = bile->last_error = bile_flush(bile, true);
+        tsize += BILE_ALLOCATE_SIZE - (tsize % BILE_ALLOCATE_SIZE);
+        _bile_error = bile->last_error = FSetEOF(bile->frefnum, tsize);
         if (_bile_error) {
             return 0;
         }
+        bile->grown = true;
+        STAT_COUNT(STAT_BILE_GROWS);
     }
 
-    _bile_error = bile->last_error = FSeek(bile->frefnum, pos); 
+    _bile_error = bile->last_error = bile_seek(bile, pos);
     if (_bile_error) {
         return 0;
     }
 
     wsize = len;
-    _bile_error = bile->last_error = FWrite(bile->frefnum, data, &len);
+    _bile_error = bile->last_error = FWrite(bile->frefnum, (void *)data,
+                                            &wsize);
     if (_bile_error) {
         return 0;
     }
@@ -1035,10 +1476,469 @@ size_t bile_xwriteat(struct bile *bile, const size_t pos,
         panic("bile_xwriteat: word write of %lu at %lu to %s: %lu",
                                                len, pos, bile->filename.text, wsize);
     }
+    bile_cache_update(bile, pos, data, len);
+    STAT_COUNT(STAT_BILE_FILE_WRITES);
+    STAT_ADD(STAT_BILE_FILE_WRITE_BYTES, wsize);
 
     FGetEOF(bile->frefnum, &bile->file_size);
+    TRACE(bile, BILE_TRACE_WRITE, pos, wsize, start);
     return wsize;
 }
 
+/* whether an object header at pos and len bytes of data fit in the file */
+bool bile_object_fits(struct bile *bile, const size_t pos, const size_t len) {
+    return (pos <= bile->file_size &&
+            BILE_OBJECT_SIZE <= bile->file_size - pos &&
+            len <= bile->file_size - pos - BILE_OBJECT_SIZE);
+}
+
+word bile_seek(struct bile *bile, const size_t pos) {
+    unsigned long start = TRACE_START();
+    word error;
+
+    error = FSeek(bile->frefnum, pos);
+    TRACE(bile, BILE_TRACE_SEEK, pos, 0, start);
+
+    return error;
+}
+
+int bile_id_cmp(const void *a, const void *b) {
+    unsigned long ida = *(const unsigned long *)a;
+    unsigned long idb = *(const unsigned long *)b;
+
+    if (ida < idb) {
+        return -1;
+    }
+    return (ida > idb);
+}
+
+unsigned long bile_get_long(const unsigned char *buf) {
+    return (unsigned long)buf[0] | ((unsigned long)buf[1] << 8) |
+        ((unsigned long)buf[2] << 16) | ((unsigned long)buf[3] << 24);
+}
+
+void bile_put_long(unsigned char *buf, unsigned long l) {
+    buf[0] = l & 0xff;
+    buf[1] = (l >> 8) & 0xff;
+    buf[2] = (l >> 16) & 0xff;
+    buf[3] = (l >> 24) & 0xff;
+}
+
+void bile_pack_object(const struct bile_object *o, unsigned char *buf) {
+    bile_put_long(buf, o->pos);
+    bile_put_long(buf + 4, o->size);
+    bile_put_long(buf + 8, o->type);
+    bile_put_long(buf + 12, o->id);
+}
+
+void bile_unpack_objects(const unsigned char *buf,
+                         struct bile_object *objects, size_t count) {
+    size_t n;
+
+    for (n = 0; n < count; n++) {
+        objects[n].pos = bile_get_long(buf);
+        objects[n].size = bile_get_long(buf + 4);
+        objects[n].type = bile_get_long(buf + 8);
+        objects[n].id = bile_get_long(buf + 12);
+        buf += BILE_OBJECT_SIZE;
+    }
+}
+
+/* read count object headers or map entries at the current mark */
+word bile_read_objects(word frefnum, struct bile_object *objects,
+                       size_t count) {
+    size_t size;
+    word error;
+#ifndef BILE_NATIVE_OBJECTS
+    unsigned char *buf;
+    struct bile_object o;
+#endif
+
+    size = count * BILE_OBJECT_SIZE;
+    error = FRead(frefnum, objects, &size);
+    if (error) {
+        return error;
+    }
+    if (size != count * BILE_OBJECT_SIZE) {
+        return eofEncountered;
+    }
+
+#ifndef BILE_NATIVE_OBJECTS
+    /*
+     * The packed entries fill the front of the array, unpack from the end
+     * so no entry is overwritten before it has been read
+     */
+    buf = (unsigned char *)objects;
+    while (count-- > 0) {
+        bile_unpack_objects(buf + (count * BILE_OBJECT_SIZE), &o, 1);
+        objects[count] = o;
+    }
+#endif
+
+    return 0;
+}
+
+/* returns the number of bytes written, like bile_xwriteat */
+size_t bile_write_objects(struct bile *bile, const size_t pos,
+                          const struct bile_object *objects, size_t count) {
+#ifdef BILE_NATIVE_OBJECTS
+    return bile_xwriteat(bile, pos, objects, count * BILE_OBJECT_SIZE);
+#else
+    unsigned char *buf;
+    size_t n, wrote;
+
+    buf = xmalloc(count * BILE_OBJECT_SIZE, "bile_write_objects");
+    for (n = 0; n < count; n++) {
+        bile_pack_object(&objects[n], buf + (n * BILE_OBJECT_SIZE));
+    }
+    wrote = bile_xwriteat(bile, pos, buf, count * BILE_OBJECT_SIZE);
+    xfree(&buf);
+
+    return wrote;
+#endif
+}
+
+/* what's at o->pos has to be o, or the map is pointing at junk */
+word bile_check_header(const struct bile_object *o,
+                       const struct bile_object *verify) {
+    if (verify->id != o->id) {
+        warn("bile_read_object: object %s:%ld pos %ld wrong id %ld, "
+             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
+             verify->id, o->id);
+        return BILE_ERR_BOGUS_OBJECT;
+    }
+    if (verify->type != o->type) {
+        warn("bile_read_object: object %s:%ld pos %ld wrong type %ld, "
+             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
+             verify->type, o->type);
+        return BILE_ERR_BOGUS_OBJECT;
+    }
+    if (verify->size != o->size) {
+        warn("bile_read_object: object %s:%ld pos %ld wrong size %ld, "
+             "expected %ld", OSTypeToString(o->type), o->id, o->pos,
+             verify->size, o->size);
+        return BILE_ERR_BOGUS_OBJECT;
+    }
+
+    return 0;
+}
+
+/*
+ * Map the whole file where the platform can (FMap fails on GS/OS), so
+ * reads come straight out of memory.  Writes show through the map, and
+ * bile_view_at maps again when the file has grown past it.
+ */
+void bile_map_view(struct bile *bile) {
+    bile_unmap_view(bile);
+
+    if (bile->file_size == 0) {
+        return;
+    }
+    if (FMap(bile->frefnum, bile->file_size,
+             (const void **)&bile->view) != 0) {
+        bile->view = NULL;
+        return;
+    }
+    bile->view_size = bile->file_size;
+}
+
+void bile_unmap_view(struct bile *bile) {
+    if (bile->view != NULL) {
+        FUnmap(bile->view, bile->view_size);
+    }
+    bile->view = NULL;
+    bile->view_size = 0;
+}
+
+/* len bytes of the file at pos in the map, or NULL to read them instead */
+const unsigned char *bile_view_at(struct bile *bile, const size_t pos,
+                                  const size_t len) {
+    if (bile->view == NULL) {
+        return NULL;
+    }
+    if (pos + len > bile->view_size) {
+        if (pos + len > bile->file_size) {
+            return NULL;
+        }
+        bile_map_view(bile);
+        if (bile->view == NULL) {
+            return NULL;
+        }
+    }
+
+    return bile->view + pos;
+}
+
+/*
+ * Read len bytes at pos, through the block cache when they fit in one
+ * block's worth so that headers and small objects read one after another
+ * (bile_verify, the repo FILE records, HIGHESTID) share one FRead.
+ * Returns eofEncountered if the file ends first.
+ */
+word bile_cache_read(struct bile *bile, const size_t pos, void *data,
+                     const size_t len) {
+    struct bile_cache_block *block;
+    size_t block_pos, off, chunk, done;
+    longword rsize;
+    word error;
+
+    if (bile->cache_nblocks == 0 || len > BILE_CACHE_BLOCK) {
+        error = bile_seek(bile, pos);
+        if (error) {
+            return error;
+        }
+        rsize = len;
+        error = FRead(bile->frefnum, data, &rsize);
+        if (error) {
+            return error;
+        }
+        STAT_COUNT(STAT_BILE_FILE_READS);
+        STAT_ADD(STAT_BILE_FILE_READ_BYTES, rsize);
+        return (rsize == len ? 0 : eofEncountered);
+    }
+
+    for (done = 0; done < len; done += chunk) {
+        block_pos = (pos + done) - ((pos + done) % BILE_CACHE_BLOCK);
+        off = (pos + done) - block_pos;
+        chunk = MIN(BILE_CACHE_BLOCK - off, len - done);
+
+        block = bile_cache_fill(bile, block_pos);
+        if (block == NULL) {
+            return bile->last_error;
+        }
+        if (off + chunk > block->len) {
+            return eofEncountered;
+        }
+        memcpy((char *)data + done, block->data + off, chunk);
+    }
 
+    return 0;
+}
 
+/* the cached block starting at block_pos, reading it in over the LRU one */
+struct bile_cache_block *bile_cache_fill(struct bile *bile,
+                                         const size_t block_pos) {
+    struct bile_cache_block *block, *lru;
+    longword rsize;
+    word n;
+
+    if (bile->cache == NULL) {
+        bile->cache = xcalloc(bile->cache_nblocks,
+                              sizeof(struct bile_cache_block), "bile cache");
+    }
+
+    lru = NULL;
+    for (n = 0; n < bile->cache_nblocks; n++) {
+        block = &bile->cache[n];
+        if (block->data != NULL && block->len > 0 && block->pos == block_pos) {
+            /* a short block may be stale if the file has grown since */
+            if (block->len == BILE_CACHE_BLOCK ||
+                block_pos + block->len >= bile->file_size) {
+                block->used = ++bile->cache_tick;
+                STAT_COUNT(STAT_BILE_CACHE_HITS);
+                return block;
+            }
+            lru = block;
+            break;
+        }
+        if (lru == NULL || block->used < lru->used) {
+            lru = block;
+        }
+    }
+
+    if (lru->data == NULL) {
+        lru->data = xmalloc(BILE_CACHE_BLOCK, "bile cache block");
+    }
+    lru->len = 0;
+
+    bile->last_error = bile_seek(bile, block_pos);
+    if (bile->last_error) {
+        return NULL;
+    }
+    rsize = BILE_CACHE_BLOCK;
+    bile->last_error = FRead(bile->frefnum, lru->data, &rsize);
+    if (bile->last_error && bile->last_error != eofEncountered) {
+        return NULL;
+    }
+    bile->last_error = 0;
+    STAT_COUNT(STAT_BILE_CACHE_MISSES);
+    STAT_COUNT(STAT_BILE_FILE_READS);
+    STAT_ADD(STAT_BILE_FILE_READ_BYTES, rsize);
+
+    lru->pos = block_pos;
+    lru->len = rsize;
+    lru->used = ++bile->cache_tick;
+
+    return lru;
+}
+
+/*
+ * Written bytes go through to any block holding them, or with no data
+ * (bile_delete zeroing an object) the blocks are dropped
+ */
+void bile_cache_update(struct bile *bile, const size_t pos,
+                       const void *data, const size_t len) {
+    struct bile_cache_block *block;
+    size_t start, end;
+    word n;
+
+    if (bile->cache == NULL) {
+        return;
+    }
+
+    for (n = 0; n < bile->cache_nblocks; n++) {
+        block = &bile->cache[n];
+        if (block->len == 0 || pos >= block->pos + BILE_CACHE_BLOCK ||
+            pos + len <= block->pos) {
+            continue;
+        }
+
+        start = MAX(pos, block->pos);
+        end = MIN(pos + len, block->pos + BILE_CACHE_BLOCK);
+        if (data == NULL || end > block->pos + block->len) {
+            block->len = 0;
+            continue;
+        }
+        memcpy(block->data + (start - block->pos),
+               (const char *)data + (start - pos), end - start);
+    }
+}
+
+void bile_cache_free(struct bile *bile) {
+    word n;
+
+    if (bile->cache == NULL) {
+        return;
+    }
+
+    for (n = 0; n < bile->cache_nblocks; n++) {
+        if (bile->cache[n].data != NULL) {
+            xfree(&bile->cache[n].data);
+        }
+    }
+    xfree(&bile->cache);
+}
+
+/*
+ * Give back whatever bile_xwriteat reserved past the last object.  The
+ * old map stays, bile_open_recover_map may still need it.
+ */
+void bile_trim(struct bile *bile) {
+    size_t end, n;
+
+    if (!bile->grown) {
+        return;
+    }
+
+    end = BILE_HEADER_LEN;
+    for (n = 0; n < bile->nobjects; n++) {
+        end = MAX(end, bile->map[n].pos + BILE_OBJECT_SIZE +
+                  BILE_OBJECT_LEN(&bile->map[n]));
+    }
+    if (bile->old_map_ptr.size) {
+        end = MAX(end, bile->old_map_ptr.pos + BILE_OBJECT_SIZE +
+                  bile->old_map_ptr.size);
+    }
+
+    if (end < bile->file_size &&
+        FSetEOF(bile->frefnum, end) == noError) {
+        bile->file_size = end;
+    }
+    bile->grown = false;
+}
+
+/*
+ * Trace every bile opened from here on into filename, replacing it, see
+ * bile.h for the format.  Only a BILE_TRACE build records anything.
+ */
+word bile_trace_open(const StringPtr filename) {
+#ifdef BILE_TRACE
+    word error;
+
+    bile_trace_close();
+
+    FDelete(filename);
+    /* BIN */
+    error = FCreate(0, filename, 0x06, 0, 0);
+    if (error) {
+        return error;
+    }
+    error = FOpen(0, filename, writeEnable, &_bile_trace_frefnum, NULL);
+    if (error) {
+        _bile_trace_frefnum = 0;
+        return error;
+    }
+
+    memcpy(_bile_trace_buf, BILE_TRACE_MAGIC, BILE_TRACE_MAGIC_LEN);
+    bile_put_long(_bile_trace_buf + BILE_TRACE_MAGIC_LEN, STATS_CLOCK_HZ);
+    _bile_trace_len = BILE_TRACE_HEADER_LEN;
+    _bile_trace_nfiles = 0;
+
+    return 0;
+#else
+    warn("bile_trace_open: built without BILE_TRACE");
+    return -1;
+#endif
+}
+
+void bile_trace_close(void) {
+#ifdef BILE_TRACE
+    if (_bile_trace_frefnum == 0) {
+        return;
+    }
+
+    bile_trace_write();
+    FClose(_bile_trace_frefnum);
+    _bile_trace_frefnum = 0;
+#endif
+}
+
+#ifdef BILE_TRACE
+void bile_trace_attach(struct bile *bile) {
+    if (_bile_trace_frefnum != 0 &&
+        _bile_trace_nfiles < BILE_TRACE_MAX_FILES) {
+        bile->trace_file = ++_bile_trace_nfiles;
+    }
+}
+
+void bile_trace(struct bile *bile, const word op, const size_t pos,
+                const size_t len, const unsigned long start) {
+    unsigned char *record;
+
+    /* the trace may have been closed with the bile still open */
+    if (_bile_trace_frefnum == 0) {
+        return;
+    }
+
+    if (_bile_trace_len + BILE_TRACE_RECORD_SIZE > sizeof(_bile_trace_buf)) {
+        bile_trace_write();
+    }
+
+    record = _bile_trace_buf + _bile_trace_len;
+    record[0] = op;
+    record[1] = bile->trace_file;
+    bile_put_long(record + 2, pos);
+    bile_put_long(record + 6, len);
+    bile_put_long(record + 10, stats_clock() - start);
+    _bile_trace_len += BILE_TRACE_RECORD_SIZE;
+}
+
+void bile_trace_write(void) {
+    longword len;
+    word error;
+
+    len = _bile_trace_len;
+    _bile_trace_len = 0;
+    if (len == 0) {
+        return;
+    }
+
+    error = FWrite(_bile_trace_frefnum, _bile_trace_buf, &len);
+    if (error) {
+        /* don't let a full disk take the repo down with it */
+        warn("bile_trace: write failed: %d, tracing stopped", error);
+        FClose(_bile_trace_frefnum);
+        _bile_trace_frefnum = 0;
+    }
+}
+#endif
@@ -68,11 +68,28 @@ struct bile_object {
 	unsigned long type;
 	unsigned long id;
 };
-#define BILE_OBJECT_SIZE	(sizeof(struct bile_object))
+/* on disk, which is smaller than the struct where longs are 64 bits */
+#define BILE_OBJECT_SIZE	16L
+
+/*
+ * The top bit of an object's size marks its data as lz.c-compressed, the
+ * rest is the length stored on disk.  Compressed data starts with the
+ * uncompressed length (long) and window bits (byte).
+ */
+#define BILE_OBJECT_COMPRESSED	0x80000000UL
+#define BILE_OBJECT_LEN(o)	((o)->size & ~BILE_OBJECT_COMPRESSED)
+#define BILE_LZ_HEADER_LEN	5
 #define BILE_HEADER_LEN		256
 
 /* allocate filesystem space in chunks of this */
 #define BILE_ALLOCATE_SIZE	8192
+/* growing the file reserves this share of its size, up to a cap */
+#define BILE_GROW_PERCENT	25
+#define BILE_GROW_MAX		(64L * 1024)
+
+/* reads not served by a map go through an LRU cache of blocks this big */
+#define BILE_CACHE_BLOCK	4096
+#define BILE_CACHE_BLOCKS	8
 
 #ifndef BILE1_MAGIC
 #define BILE1_MAGIC			"BILE1"
@@ -83,14 +100,58 @@ struct bile_object {
 
 #define BILE_AUX_TYPE 'AMND'
 
-#define BILE_ERR_NEED_UPGRADE_1	-4000
-#define BILE_ERR_BOGUS_OBJECT	-4001
+#define BILE_ERR_NEED_UPGRADE_1	((word)-4000)
+#define BILE_ERR_BOGUS_OBJECT	((word)-4001)
+
+/*
+ * Trace format, written by a BILE_TRACE build between bile_trace_open and
+ * bile_trace_close:
+ * [ BILE_TRACE_MAGIC - BILE_TRACE_MAGIC_LEN ]
+ * [ clock ticks per second - long ]
+ * [ record[0] - BILE_TRACE_RECORD_SIZE ]
+ *   [ op - byte ]
+ *   [ file, numbered from 1 in the order biles were opened - byte ]
+ *   [ position - long ]
+ *   [ length - long ]
+ *   [ duration in clock ticks - long ]
+ * [ record[1] ]
+ *   [ .. ]
+ *
+ * Longs are little-endian like everything else in a bile.  An OPEN's
+ * length is the file's size, a READ's is the object data it read without
+ * the header and a SEEK's is 0.  READs, WRITEs and FLUSHes are what a
+ * replay does again, MAP spans the WRITEs and FLUSHes of a map rewrite
+ * and SEEKs come from the reads and writes around them.  Biles made with
+ * bile_create aren't traced.
+ */
+#define BILE_TRACE_MAGIC		"BTRC1"
+#define BILE_TRACE_MAGIC_LEN	5
+#define BILE_TRACE_HEADER_LEN	(BILE_TRACE_MAGIC_LEN + 4)
+#define BILE_TRACE_RECORD_SIZE	14
+#define BILE_TRACE_MAX_FILES	255
+
+enum {
+	BILE_TRACE_OPEN = 1,
+	BILE_TRACE_CLOSE,
+	BILE_TRACE_READ,
+	BILE_TRACE_WRITE,
+	BILE_TRACE_SEEK,
+	BILE_TRACE_FLUSH,
+	BILE_TRACE_MAP
+};
 
 struct bile_highest_id {
 	long type;
 	unsigned long highest_id;
 };
 
+struct bile_cache_block {
+	unsigned long pos;
+	unsigned long used;
+	size_t len;
+	unsigned char *data;
+};
+
 struct bile {
 	struct bile_object map_ptr;
 	struct bile_object old_map_ptr;
@@ -99,12 +160,29 @@ struct bile {
 	size_t file_size;
 	struct bile_object *map; /* array of bile_objects */
 	size_t nobjects;
+	size_t map_cap; /* entries allocated in map */
 	char magic[5];
+	/* read-only map of the file where FMap can make one, or NULL */
+	const unsigned char *view;
+	size_t view_size;
+	/* allocated on first read, cache_nblocks of 0 reads straight through */
+	struct bile_cache_block *cache;
+	word cache_nblocks;
+	unsigned long cache_tick;
+	/* preallocation, trimmed back off at close if we grew the file */
+	word grow_percent;
+	size_t grow_max;
+	bool grown;
+	/* window for bile_write_compressed */
+	word lz_bits;
+	/* its number in the trace, 0 if it isn't being traced */
+	word trace_file;
 };
 
 struct bile_object_field {
 	size_t struct_off;
-	size_t size;
+	/* negative for a dynamically-sized field, see bile_marshall_object */
+	long size;
 	size_t object_len_off;
 };
 
@@ -116,6 +194,10 @@ struct bile *			bile_open(const StringPtr filename);
 struct bile *			bile_open_recover_map(const StringPtr filename);
 word					bile_flush(struct bile *bile, word and_vol);
 void					bile_close(struct bile *bile);
+void					bile_set_cache(struct bile *bile, word nblocks);
+void					bile_set_growth(struct bile *bile, word percent,
+						  size_t max);
+void					bile_set_lz_bits(struct bile *bile, word bits);
 
 struct bile_object *	bile_find(struct bile *bile, const unsigned long type,
 						  const unsigned long id);
@@ -125,7 +207,11 @@ size_t					bile_sorted_ids_by_type(struct bile *bile,
 						  const unsigned long type, unsigned long **ret);
 struct bile_object *	bile_get_nth_of_type(struct bile *bile,
 						  const unsigned long index, const unsigned long type);
+size_t					bile_objects_by_type(struct bile *bile,
+						  const unsigned long type, struct bile_object **ret);
 unsigned long			bile_next_id(struct bile *bile, const unsigned long type);
+size_t					bile_object_size(struct bile *bile,
+						  const struct bile_object *o);
 word					bile_delete(struct bile *bile, const unsigned long type,
 						  const unsigned long id);
 size_t					bile_read_object(struct bile *bile,
@@ -137,11 +223,19 @@ size_t					bile_read(struct bile *bile, const unsigned long type,
 size_t					bile_read_alloc(struct bile *bile,
 						  const unsigned long type, const unsigned long id,
 						  void *data_ptr);
+const void *			bile_object_data(struct bile *bile,
+						  const struct bile_object *o, char **copy);
 size_t					bile_write(struct bile *bile, unsigned long type,
 						  const unsigned long id, const void *data,
 						  const size_t len);
+size_t					bile_write_compressed(struct bile *bile,
+						  unsigned long type, const unsigned long id,
+						  const void *data, const size_t len);
 word					bile_verify(struct bile *bile);
 
+word					bile_trace_open(const StringPtr filename);
+void					bile_trace_close(void);
+
 word					bile_marshall_object(struct bile *bile,
 						  const struct bile_object_field *fields,
 						  const size_t nfields, void *object,
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __BILE_PRIVATE_H__
+#define __BILE_PRIVATE_H__
+
+/*
+ * bile.c's internals, for it and for the host tools that replay and fuzz
+ * its I/O; nothing else in AmendGS should need these.
+ */
+
+#include "bile.h"
+
+struct bile_object*	bile_alloc(struct bile *bile, const unsigned long type,
+                               const unsigned long id, const size_t size);
+struct bile_object*	bile_object_in_map(struct bile *bile,
+                                       const unsigned long type, const unsigned long id);
+word bile_read_map(struct bile *bile,
+                       struct bile_object *map_ptr);
+word bile_write_map(struct bile *bile);
+size_t bile_xwriteat(struct bile *bile, const size_t pos,
+                         const void *data, const size_t len);
+void bile_check_sanity(struct bile *bile);
+int bile_id_cmp(const void *a, const void *b);
+unsigned long bile_get_long(const unsigned char *buf);
+void bile_put_long(unsigned char *buf, unsigned long l);
+word bile_read_objects(word frefnum, struct bile_object *objects,
+                       size_t count);
+size_t bile_write_objects(struct bile *bile, const size_t pos,
+                          const struct bile_object *objects, size_t count);
+void bile_pack_object(const struct bile_object *o, unsigned char *buf);
+void bile_unpack_objects(const unsigned char *buf,
+                         struct bile_object *objects, size_t count);
+word bile_check_header(const struct bile_object *o,
+                       const struct bile_object *verify);
+void bile_map_view(struct bile *bile);
+void bile_unmap_view(struct bile *bile);
+const unsigned char *bile_view_at(struct bile *bile, const size_t pos,
+                                  const size_t len);
+word bile_cache_read(struct bile *bile, const size_t pos, void *data,
+                     const size_t len);
+struct bile_cache_block *bile_cache_fill(struct bile *bile,
+                                         const size_t block_pos);
+void bile_cache_update(struct bile *bile, const size_t pos,
+                       const void *data, const size_t len);
+void bile_cache_free(struct bile *bile);
+void bile_trim(struct bile *bile);
+bool bile_object_fits(struct bile *bile, const size_t pos, const size_t len);
+word bile_seek(struct bile *bile, const size_t pos);
+size_t bile_load_object(struct bile *bile, const struct bile_object *o,
+                        void *data, const size_t len);
+void bile_trace_attach(struct bile *bile);
+void bile_trace(struct bile *bile, const word op, const size_t pos,
+                const size_t len, const unsigned long start);
+void bile_trace_write(void);
+size_t bile_read_stored(struct bile *bile, const struct bile_object *o,
+                        void *data, const size_t len);
+const unsigned char *bile_stored_data(struct bile *bile,
+                                      const struct bile_object *o,
+                                      char **copy);
+size_t bile_write_stored(struct bile *bile, const unsigned long type,
+                         const unsigned long id, const void *data,
+                         const size_t len, const unsigned long flags);
+
+#endif
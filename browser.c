@@ -134,6 +134,10 @@ void browser_idle(struct focusable *focusable, EventRecord *event) {
         browser_visualize_amendment(browser);
         browser->state = BROWSER_STATE_IDLE;
         break;
+    case BROWSER_STATE_SHOW_STATS:
+        browser_show_stats(browser);
+        browser->state = BROWSER_STATE_IDLE;
+        break;
     }
 }
 
@@ -306,9 +310,8 @@ word browser_selected_file_ids(struct browser *browser, word **selected_files) {
 }
 
 void browser_filter_amendments(struct browser *browser) {
-    struct repo_amendment *amendment;
-    word i, j, k;
-    bool add;
+    struct repo_amendment **amendments;
+    word i;
     word *selected_files = NULL;
     word nselected_files = 0;
     word aIdx = 0;
@@ -326,29 +329,19 @@ void browser_filter_amendments(struct browser *browser) {
     if (nselected_files) {
         amendListHndl = (MemRecHndl)NewHandle(browser->repo->namendments * sizeof(MemRec),
                                                   programID, attrFixed + attrLocked, NULL);
-        for (i = 0; i < browser->repo->namendments; i++) {
-            add = false;
-            amendment = browser->repo->amendments[i];
-            for (j = 0; j < amendment->nfiles; j++) {
-                for (k = 0; k < nselected_files; k++) {
-                    if (selected_files[k] == amendment->file_ids[j]) {
-                        add = true;
-                        break;
-                    }
-                }
-                if (add) {
-                    break;
-                }
-            }
-
-            if (add) {
-                (*amendListHndl)[aIdx].memPtr = (Pointer) browser->repo->amendments[i];
-                (*amendListHndl)[aIdx].memFlag = 0;
-
-                aIdx++;
+        if (browser->repo->namendments) {
+            amendments = xcalloc(browser->repo->namendments, sizeof(Ptr),
+                                 "browser_filter_amendments");
+            aIdx = repo_amendments_for_files(browser->repo, selected_files,
+                                             nselected_files, amendments);
+            for (i = 0; i < aIdx; i++) {
+                (*amendListHndl)[i].memPtr = (Pointer) amendments[i];
+                (*amendListHndl)[i].memFlag = 0;
             }
+            xfree(&amendments);
         }
 
+        amendment_list_set_repo(browser->repo);
         NewList2((Pointer)&amendment_list_draw_cell, -1, (Ref)amendListHndl, refIsHandle, aIdx, (Handle)browser->amendment_list);
         xfree(&selected_files);
     }
@@ -403,55 +396,23 @@ void browser_discard_changes(struct browser *browser) {
 void
 browser_export_patch(struct browser *browser) {
     struct repo_amendment *amendment;
-    word *selected_files = NULL;
-    word nselected = 0;
-    word match=0,i,j,k;
-    word listid = 1;
-    word selected = 0;
+    word selected;
+    SFReplyRec reply;
+    extern MemRecHndl amendListHndl;
 
-    nselected = browser_selected_file_ids(browser, &selected_files);
-    if (nselected == 0) {
+    selected = NextMember2(0, (handle) browser->amendment_list);
+    if (selected == 0 || amendListHndl == NULL) {
         /* can't select nothing, do nothing*/
         return;
-    } else {
-        browser_show_amendment(browser, NULL);
-        while (selected = NextMember2(selected, (handle) browser->amendment_list)) {
-            for (i = 0; i < browser->repo->namendments; i++) {
-                match = 0;
-                amendment = browser->repo->amendments[i];
-                for (j = 0; j < amendment->nfiles; j++) {
-                    for (k = 0; k < nselected; k++) {
-                        if (selected_files[k] == amendment->file_ids[j]) {
-                            if (selected == listid) {
-                                match = 1;
-                                break;
-                            } else {
-                                listid++;
-                            }
-                        }
-                    }
-                    if (match) {
-                        break;
-                    }
-                }
-                if (match) {
-                    break;
-                }
-            }
-        }
-        if (selected_files) {
-            xfree(&selected_files);
-        }
     }
-    if (match) {
-        SFReplyRec reply;
+    browser_show_amendment(browser, NULL);
+    amendment = (struct repo_amendment *)(*amendListHndl)[selected-1].memPtr;
 
-        SFPutFile(0x15, 0x15, (Pointer) &"\pSave patch as:", NULL, 254, &reply);
-        if (!reply.good) {
-            return;
-        }
-        repo_export_patch(browser->repo, amendment, (StringPtr) reply.fullPathname);
+    SFPutFile(0x15, 0x15, (Pointer) &"\pSave patch as:", NULL, 254, &reply);
+    if (!reply.good) {
+        return;
     }
+    repo_export_patch(browser->repo, amendment, (StringPtr) reply.fullPathname);
 }
 
 void browser_apply_patch(struct browser *browser) {
@@ -466,48 +427,35 @@ void browser_apply_patch(struct browser *browser) {
     patch_process(browser->repo, (StringPtr) &reply.fullPathname);
 }
 
+/* the repo's sizes and what's been counted so far, in the diff pane */
+void browser_show_stats(struct browser *browser) {
+    TERecordHndl teRec = (TERecordHndl)browser->diff_te;
+    char *text;
+    size_t len;
+
+    browser_show_amendment(browser, NULL);
+
+    len = repo_stats(browser->repo, NULL, 0) + 1;
+    text = xmalloc(len, "browser_show_stats");
+    len = repo_stats(browser->repo, text, len);
+
+    (*teRec)->textFlags &= ~fReadOnly;
+    TEInsert(0x0005, (Ref)text, len, 0, 0, browser->diff_te);
+    (*teRec)->textFlags |= fReadOnly;
+    xfree(&text);
+}
+
 void browser_edit_amendment(struct browser *browser) {
-    struct repo_amendment *amendment;
-    word *selected_files = NULL;
-    word nselected = 0;
-    word match,i,j,k;
-    word listid = 1;
     word selected = 0;
+    extern MemRecHndl amendListHndl;
 
-    nselected = browser_selected_file_ids(browser, &selected_files);
-    if (nselected == 0) {
-        /* can't select nothing, do nothing*/
+    if (amendListHndl == NULL) {
         return;
-    } else {
-        browser_show_amendment(browser, NULL);
-        while (selected = NextMember2(selected, (handle) browser->amendment_list)) {
-            for (i = 0; i < browser->repo->namendments; i++) {
-                match = 0;
-                amendment = browser->repo->amendments[i];
-                for (j = 0; j < amendment->nfiles; j++) {
-                    for (k = 0; k < nselected; k++) {
-                        if (selected_files[k] == amendment->file_ids[j]) {
-                            if (selected == listid) {
-                                editor_init(browser, amendment);
-                                match = 1;
-                                break;
-                            } else {
-                                listid++;
-                            }
-                        }
-                    }
-                    if (match) {
-                        break;
-                    }
-                }
-                if (match) {
-                    break;
-                }
-            }
-        }
-        if (selected_files) {
-            xfree(&selected_files);
-        }
+    }
+    browser_show_amendment(browser, NULL);
+    while (selected = NextMember2(selected, (handle) browser->amendment_list)) {
+        editor_init(browser,
+                    (struct repo_amendment *)(*amendListHndl)[selected-1].memPtr);
     }
 }
 
@@ -584,6 +532,7 @@ void browser_update_menu(struct browser *browser) {
         EnableMItem(REPO_MENU_ADD_FILE_ID);
         EnableMItem(REPO_MENU_DISCARD_CHANGES_ID);
         EnableMItem(REPO_MENU_APPLY_PATCH_ID);
+        EnableMItem(REPO_MENU_STATS_ID);
     }
 
     if (NextMember2(0, (Handle) browser->amendment_list)) {
@@ -617,13 +566,11 @@ void browser_update(struct focusable *focusable, EventRecord *event) {
 void browser_mouse_down(struct focusable *focusable, EventRecord *event) {
     CtlRecHndl control;
     struct browser *browser = (struct browser *)focusable->cookie;
-    word i = 0, j, k;
-    struct repo_amendment *amendment = NULL;
     word *selected_files = NULL;
     word nselected = 0;
-    word part, match;
-    word listid = 1;
+    word part;
     word selected = 0;
+    extern MemRecHndl amendListHndl;
 
     part = FindControl(&control, event->where.h, event->where.v, browser->win);
     if ((part) && (control == ((CtlRecHndl) browser->diff_button))) {
@@ -643,30 +590,10 @@ void browser_mouse_down(struct focusable *focusable, EventRecord *event) {
         } else {
             WaitCursor();
             browser_show_amendment(browser, NULL);
-            while (selected = NextMember2(selected, (handle) browser->amendment_list)) {
-                for (i = 0; i < browser->repo->namendments; i++) {
-                    match = 0;
-                    amendment = browser->repo->amendments[i];
-                    for (j = 0; j < amendment->nfiles; j++) {
-                        for (k = 0; k < nselected; k++) {
-                            if (selected_files[k] == amendment->file_ids[j]) {
-                                if (selected == listid) {
-                                    browser_show_amendment(browser, amendment);
-                                    match = 1;
-                                    break;
-                                } else {
-                                    listid++;
-                                }
-                            }
-                        }
-                        if (match) {
-                            break;
-                        }
-                    }
-                    if (match) {
-                        break;
-                    }
-                }
+            while (amendListHndl &&
+              (selected = NextMember2(selected, (handle) browser->amendment_list))) {
+                browser_show_amendment(browser,
+                  (struct repo_amendment *)(*amendListHndl)[selected-1].memPtr);
             }
             InitCursor();
         }
@@ -702,6 +629,9 @@ bool browser_handle_menu(struct focusable *focusable, word menu, word item) {
         case REPO_MENU_APPLY_PATCH_ID:
             browser->state = BROWSER_STATE_APPLY_PATCH;
             return true;
+        case REPO_MENU_STATS_ID:
+            browser->state = BROWSER_STATE_SHOW_STATS;
+            return true;
         }
         break;
     case AMENDMENT_MENU_ID:
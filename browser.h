@@ -35,7 +35,8 @@ enum {
 	BROWSER_STATE_EXPORT_PATCH,
 	BROWSER_STATE_APPLY_PATCH,
 	BROWSER_STATE_EDIT_AMENDMENT,
-    BROWSER_STATE_VISUALIZE_PATCH
+    BROWSER_STATE_VISUALIZE_PATCH,
+    BROWSER_STATE_SHOW_STATS
 };
 
 struct browser {
@@ -56,6 +57,7 @@ void browser_show_amendment(struct browser *browser,
   struct repo_amendment *amendment);
 void browser_close_committer(struct browser *browser);
 void browser_export_patch(struct browser *browser);
+void browser_show_stats(struct browser *browser);
 word browser_is_all_files_selected(struct browser *browser);
 word browser_selected_file_ids(struct browser *browser,
   word **selected_files);
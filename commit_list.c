@@ -34,6 +34,13 @@
 
 segment "browser";
 
+/* list draw callbacks only get the member, logs are loaded through this */
+static struct repo *amendment_list_repo = NULL;
+
+void amendment_list_set_repo(struct repo *repo) {
+    amendment_list_repo = repo;
+}
+
 #pragma toolparms 1
 #pragma databank 1
 pascal void amendment_list_draw_cell(RectPtr theRect, MemRecPtr MemberPtr,
@@ -51,6 +58,7 @@ pascal void amendment_list_draw_cell(RectPtr theRect, MemRecPtr MemberPtr,
 
     MoveTo(theRect->h1 + 4, theRect->v1 + 8);
 
+    repo_amendment_log(amendment_list_repo, amendment);
     HLock(amendment->log);
     //draw the text up until the first newline
     for (len = 1; len < amendment->log_len; len++) {
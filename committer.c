@@ -131,6 +131,7 @@ void committer_init(struct browser *browser) {
 
 bool committer_close(struct focusable *focusable) {
     struct committer *committer = (struct committer *)focusable->cookie;
+    word i;
 
     committer->browser->committer = NULL;
 
@@ -140,6 +141,11 @@ bool committer_close(struct focusable *focusable) {
     }
 
     if (committer->diffed_files != NULL) {
+        for (i = 0; i < committer->ndiffed_files; i++) {
+            if (committer->diffed_files[i].hunks != NULL) {
+                xfree(&committer->diffed_files[i].hunks);
+            }
+        }
         xfree(&committer->diffed_files);
     }
 
@@ -265,6 +271,7 @@ void committer_update_menu(struct committer *committer) {
     DisableMItem(REPO_MENU_ADD_FILE_ID);
     DisableMItem(REPO_MENU_DISCARD_CHANGES_ID);
     DisableMItem(REPO_MENU_APPLY_PATCH_ID);
+    DisableMItem(REPO_MENU_STATS_ID);
 
     DisableMItem(AMENDMENT_MENU_EDIT_ID);
     DisableMItem(AMENDMENT_MENU_EXPORT_ID);
@@ -288,6 +295,7 @@ void committer_generate_diff(struct committer *committer) {
     word i, all_files;
     word *selected_files = NULL;
     word nselected_files = 0;
+    word *changed_files;
     WaitCursor();
     static Str255 buf;
 
@@ -308,6 +316,17 @@ void committer_generate_diff(struct committer *committer) {
     HLock((Handle)committer->diff_te);
 
     all_files = browser_is_all_files_selected(committer->browser);
+    if (all_files && nselected_files) {
+        /* only diff what the status scan says changed */
+        progress("Checking for changes...");
+        changed_files = xcalloc(nselected_files, sizeof(word),
+                                "committer changed_files");
+        nselected_files = repo_status(committer->browser->repo,
+                                      selected_files, nselected_files,
+                                      changed_files);
+        xfree(&selected_files);
+        selected_files = changed_files;
+    }
 
     committer_diffing = committer;
     for (i = 0; i < nselected_files; i++) {
@@ -319,9 +338,13 @@ void committer_generate_diff(struct committer *committer) {
             continue;
         }
 
-        if (all_files && !repo_file_changed(committer->browser->repo,
-                                            file)) {
-            progress("Skipping unchanged %s...", file->filename);
+        /*
+         * same contents under new dates, no need to run the diff;
+         * repo_status has already left those out and updated them
+         */
+        if (!all_files &&
+            repo_file_touched(committer->browser->repo, file)) {
+            progress("Skipping touched %s...", file->filename.text);
             continue;
         }
 
@@ -344,6 +367,7 @@ void committer_generate_diff(struct committer *committer) {
     }
 
     committer_diffing = NULL;
+    diff_arena_release();
 
     HUnlock((Handle)committer->diff_te);
 
@@ -486,6 +510,38 @@ size_t diff_output(const char *format, ...) {
     return len;
 }
 
+/* called by diffreg just before the -/+ lines of each change are output */
+void diff_hunk(char op, long a, long b, long c, long d) {
+    struct diffed_file *file;
+    struct diff_hunk *hunk;
+
+    if (committer_diffing == NULL) panic("diff_hunk without committer_diffing");
+
+    file = &committer_diffing->diffed_files[committer_diffing->ndiffed_files];
+    if (file->nhunks == file->hunks_size) {
+        file->hunks_size = grow_capacity(file->hunks_size,
+                                         file->nhunks + 1, 16);
+        file->hunks = xreallocarray(file->hunks, file->hunks_size,
+                                    sizeof(struct diff_hunk));
+    }
+
+    hunk = &file->hunks[file->nhunks++];
+    hunk->op = op;
+    hunk->old_line = a;
+    hunk->old_len = (a > b) ? 0 : b - a + 1;
+    hunk->new_line = c;
+    hunk->new_len = (c > d) ? 0 : d - c + 1;
+
+    /* whatever is already in the TE, the pending chunk and the line buffer */
+    hunk->diff_pos = committer_diffing->diff_te_len;
+    if (committer_diffing->diff_chunk != NULL) {
+        hunk->diff_pos += committer_diffing->diff_chunk_pos;
+    }
+    if (committer_diffing->diff_line != NULL) {
+        hunk->diff_pos += committer_diffing->diff_line_pos;
+    }
+}
+
 void diff_append_line(char *str, size_t len, bool flush) {
 
     if (committer_diffing == NULL) {
@@ -56,6 +56,7 @@ struct committer {
 
 void committer_init(struct browser *browser);
 void committer_generate_diff(struct committer *committer);
+void amendment_list_set_repo(struct repo *repo);
 pascal void amendment_list_draw_cell(RectPtr theRect, MemRecPtr MemberPtr,
                          CtlRecHndl listHandle);
 
@@ -32,6 +32,7 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*
  * Output format options
@@ -82,6 +83,25 @@ extern struct stat stb1, stb2;
 
 char	*splice(char *, char *);
 long	diffreg(StringPtr , StringPtr, long);
+void	diff_arena_release(void);
+size_t	diff_arena_high_water(void);
 void	diffdir(char *, char *, int);
 
-size_t	diff_output(const char *, ...);
\ No newline at end of file
+/*
+ * One change found by the diff engine.  Lines are 1 based, a pure add
+ * has old_len 0 and starts after old_line - 1, a pure delete has
+ * new_len 0.  diff_pos is where the change's first -/+ line starts in
+ * the unified diff text.
+ */
+struct diff_hunk {
+	char op;		/* 'a'dd, 'd'elete or 'c'hange */
+	char pad[3];	/* HUNK objects store these as-is, keep them aligned */
+	uint32_t old_line;
+	uint32_t old_len;
+	uint32_t new_line;
+	uint32_t new_len;
+	uint32_t diff_pos;
+};
+
+size_t	diff_output(const char *, ...);
+void	diff_hunk(char, long, long, long, long);
\ No newline at end of file
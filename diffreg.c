@@ -68,19 +68,17 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include <errno.h>
-#include <fcntl.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <memory.h>
-#include <resources.h>
-#include <appleshare.h>
 #include <orca.h>
 
 //#include <unix.h>
 
 #include "diff.h"
+#include "stats.h"
 #include "util.h"
 
 #define MINIMUM(a, b)	(((a) < (b)) ? (a) : (b))
@@ -228,6 +226,25 @@ static char lastbuf[FUNCTION_CONTEXT_SIZE];
 static long lastline;
 static long lastmatchline;
 
+/*
+ * Everything a diff allocates comes from here and is reset at the end of
+ * diffreg, so diffing file after file in a commit reuses the same chunks
+ * instead of churning the heap.
+ */
+#define DIFF_ARENA_CHUNK	16384L
+static struct arena diff_arena;
+static size_t max_context;
+
+/*
+ * Marks the end of each step of diffreg with its stats timer, which is
+ * nothing unless built with AMEND_STATS.  host/diff_bench defines its
+ * own before including this file.
+ */
+#ifndef DIFF_PHASE
+#define DIFF_PHASE_START()	STAT_MARK()
+#define DIFF_PHASE(timer)	STAT_LAP(timer)
+#endif
+
 
 /*
  * chrtran polongs to one of 2 translation tables: cup2low if folding upper to
@@ -295,11 +312,11 @@ diffreg(StringPtr file1, StringPtr file2, long flags) {
     Str255 filename1, filename2;
     char *pos;
 
-    pos = strrchr(file1->text, ':');
+    pos = strrchr(file1->text, PATH_SEP);
     if (pos) {
         strcpy(filename1.text, pos + 1);
     }
-    pos = strrchr(file2->text, ':');
+    pos = strrchr(file2->text, PATH_SEP);
     if (pos) {
         strcpy(filename2.text, pos + 1);
     }
@@ -307,11 +324,20 @@ diffreg(StringPtr file1, StringPtr file2, long flags) {
     filename2.textLength = strlen(filename2.text);
 
 
+    if (diff_arena.chunk_size == 0) {
+        arena_init(&diff_arena, DIFF_ARENA_CHUNK, "diff arena");
+    }
+
+    STAT_COUNT(STAT_DIFFS);
+    DIFF_PHASE_START();
+
     f1 = f2 = 0;
     rval = D_SAME;
     anychange = 0;
     lastline = 0;
     lastmatchline = 0;
+    max_context = 64;
+    context_vec_start = context_vec_end = NULL;
     context_vec_ptr = context_vec_start - 1;
     if (flags & D_IGNORECASE) {
         chrtran = cup2low;
@@ -349,38 +375,50 @@ diffreg(StringPtr file1, StringPtr file2, long flags) {
         status |= 1;
         goto closem;
     }
+    DIFF_PHASE(STAT_TIME_DIFF_OPEN);
+
     prepare(0, f1,  stb1.st_size, flags);
     prepare(1, f2, stb2.st_size, flags);
+    STAT_ADD(STAT_DIFF_LINES, len[0] + len[1]);
+    DIFF_PHASE(STAT_TIME_DIFF_PREPARE);
 
     prune();
+    DIFF_PHASE(STAT_TIME_DIFF_PRUNE);
+
     sort(sfile[0], slen[0]);
     sort(sfile[1], slen[1]);
+    DIFF_PHASE(STAT_TIME_DIFF_SORT);
 
     member = (long *)file[1];
     equiv(sfile[0], slen[0], sfile[1], slen[1], member);
-    member = xreallocarray(member, slen[1] + 2, sizeof(*member));
+    member = arena_reallocarray(&diff_arena, member, slen[1] + 2,
+                                sizeof(*member));
+    DIFF_PHASE(STAT_TIME_DIFF_EQUIV);
 
     class = (long *)file[0];
     unsort(sfile[0], slen[0], class);
-    class = xreallocarray(class, slen[0] + 2, sizeof(*class));
+    class = arena_reallocarray(&diff_arena, class, slen[0] + 2,
+                               sizeof(*class));
+    DIFF_PHASE(STAT_TIME_DIFF_UNSORT);
 
-    klist = xcalloc(slen[0] + 2, sizeof(*klist), "diffreg klist");
+    klist = arena_calloc(&diff_arena, slen[0] + 2, sizeof(*klist));
     clen = 0;
     clistlen = 100;
-    clist = xcalloc(clistlen, sizeof(*clist), "diffreg clist");
+    clist = arena_calloc(&diff_arena, clistlen, sizeof(*clist));
     i = stone(class, slen[0], member, klist, flags);
-    xfree(&member);
-    xfree(&class);
+    DIFF_PHASE(STAT_TIME_DIFF_STONE);
 
-    J = xreallocarray(J, len[0] + 2, sizeof(*J));
+    J = arena_calloc(&diff_arena, len[0] + 2, sizeof(*J));
     unravel(klist[i]);
-    xfree(&clist);
-    xfree(&klist);
+    DIFF_PHASE(STAT_TIME_DIFF_UNRAVEL);
 
-    ixold = xreallocarray(ixold, len[0] + 2, sizeof(*ixold));
-    ixnew = xreallocarray(ixnew, len[1] + 2, sizeof(*ixnew));
+    ixold = arena_calloc(&diff_arena, len[0] + 2, sizeof(*ixold));
+    ixnew = arena_calloc(&diff_arena, len[1] + 2, sizeof(*ixnew));
     check(f1, f2, flags);
+    DIFF_PHASE(STAT_TIME_DIFF_CHECK);
+
     output(&filename1, f1, &filename2, f2, flags);
+    DIFF_PHASE(STAT_TIME_DIFF_OUTPUT);
 closem:
     if (anychange) {
         status |= 1;
@@ -395,9 +433,26 @@ closem:
         FClose(f2);
     }
 
+    arena_reset(&diff_arena);
+    file[0] = file[1] = NULL;
+    member = class = klist = J = ixold = ixnew = NULL;
+    clist = NULL;
+    context_vec_start = context_vec_end = NULL;
+
     return (rval);
 }
 
+/* give back the memory diffreg keeps for the next diff */
+void diff_arena_release(void) {
+    arena_free(&diff_arena);
+    diff_arena.high = 0;
+}
+
+/* the most diffreg has needed at once since the last release */
+size_t diff_arena_high_water(void) {
+    return diff_arena.high;
+}
+
 /*
  * Check to see if the given files differ.
  * Returns 0 if they are the same, 1 if different, and -1 on error.
@@ -444,11 +499,11 @@ static void prepare(long i, word fd, off_t filesize, long flags) {
     sz = (filesize <= SIZE_MAX ? filesize : SIZE_MAX) / 25;
     if (sz < 100) sz = 100;
 
-    p = xcalloc(sz + 3, sizeof(*p), "diff prepare");
+    p = arena_calloc(&diff_arena, sz + 3, sizeof(*p));
     for (j = 0; (h = readhash(fd, flags));) {
         if (j == sz) {
             sz = sz * 3 / 2;
-            p = xreallocarray(p, sz + 3, sizeof(*p));
+            p = arena_reallocarray(&diff_arena, p, sz + 3, sizeof(*p));
         }
         p[++j].value = h;
     }
@@ -573,7 +628,8 @@ static long newcand(long x, long y, long pred) {
 
     if (clen == clistlen) {
         clistlen = clistlen * 11 / 10;
-        clist = xreallocarray(clist, clistlen, sizeof(*clist));
+        clist = arena_reallocarray(&diff_arena, clist, clistlen,
+                                   sizeof(*clist));
     }
     q = clist + clen;
     q->x = x;
@@ -652,10 +708,10 @@ static void check(word f1, word f2, long flags) {
                  * in one file for -b or -w.
                  */
                 if (flags & (D_FOLDBLANKS | D_IGNOREBLANKS)) {
-                    if (c == EOF && d == '\r') {
+                    if (c == EOF && d == EOL_CHAR) {
                         ctnew++;
                         break;
-                    } else if (c == '\r' && d == EOF) {
+                    } else if (c == EOL_CHAR && d == EOF) {
                         ctold++;
                         break;
                     }
@@ -665,19 +721,19 @@ static void check(word f1, word f2, long flags) {
                 if ((flags & D_FOLDBLANKS) && isspace(c) &&
                     isspace(d)) {
                     do {
-                        if (c == '\r') break;
+                        if (c == EOL_CHAR) break;
                         ctold++;
                     } while (isspace(c = FGetc(f1)));
                     do {
-                        if (d == '\r') break;
+                        if (d == EOL_CHAR) break;
                         ctnew++;
                     } while (isspace(d = FGetc(f2)));
                 } else if ((flags & D_IGNOREBLANKS)) {
-                    while (isspace(c) && c != '\r') {
+                    while (isspace(c) && c != EOL_CHAR) {
                         c = FGetc(f1);
                         ctold++;
                     }
-                    while (isspace(d) && d != '\r') {
+                    while (isspace(d) && d != EOL_CHAR) {
                         d = FGetc(f2);
                         ctnew++;
                     }
@@ -685,11 +741,11 @@ static void check(word f1, word f2, long flags) {
                 if (chrtran[c] != chrtran[d]) {
                     jackpot++;
                     J[i] = 0;
-                    if (c != '\r' && c != EOF) ctold += skipline(f1);
-                    if (d != '\r' && c != EOF) ctnew += skipline(f2);
+                    if (c != EOL_CHAR && c != EOF) ctold += skipline(f1);
+                    if (d != EOL_CHAR && c != EOF) ctnew += skipline(f2);
                     break;
                 }
-                if (c == '\r' || c == EOF) {
+                if (c == EOL_CHAR || c == EOF) {
                     break;
                 }
             }
@@ -700,15 +756,15 @@ static void check(word f1, word f2, long flags) {
                 if ((c = FGetc(f1)) != (d = FGetc(f2))) {
                     /* jackpot++; */
                     J[i] = 0;
-                    if (c != '\r' && c != EOF) {
+                    if (c != EOL_CHAR && c != EOF) {
                         ctold += skipline(f1);
                     }
-                    if (d != '\r' && c != EOF) {
+                    if (d != EOL_CHAR && c != EOF) {
                         ctnew += skipline(f2);
                     }
                     break;
                 }
-                if (c == '\r' || c == EOF) {
+                if (c == EOL_CHAR || c == EOF) {
                     break;
                 }
             }
@@ -762,20 +818,19 @@ static void sort(struct line *a, long n) {
 static void unsort(struct line *f, long l, long *b) {
     long *a, i;
 
-    a = xcalloc(l + 1, sizeof(*a), "diff unsort");
+    a = arena_calloc(&diff_arena, l + 1, sizeof(*a));
     for (i = 1; i <= l; i++) {
         a[f[i].serial] = f[i].value;
     }
     for (i = 1; i <= l; i++) {
         b[i] = a[i];
     }
-    xfree(&a);
 }
 
 static long skipline(word f) {
     long i, c;
 
-    for (i = 1; (c = FGetc(f)) != '\r' && c != EOF; i++) {
+    for (i = 1; (c = FGetc(f)) != EOL_CHAR && c != EOF; i++) {
         continue;
     }
     return (i);
@@ -874,7 +929,7 @@ static char *preadline(word fd, size_t rlen, off_t off) {
     }
 
     FSeek(fd, pos);
-    if (nr > 0 && line[nr - 1] == '\r') {
+    if (nr > 0 && line[nr - 1] == EOL_CHAR) {
         nr--;
     }
     line[nr] = '\0';
@@ -901,7 +956,6 @@ static long ignoreline(char *line) {
  */
 static void change(StringPtr file1, word f1, StringPtr file2, word f2, long a, long b, long c, long d,
        long *pflags) {
-    static size_t max_context = 64;
     long i;
 
 restart:
@@ -937,7 +991,7 @@ restart:
     }
 proceed:
     if (*pflags & D_HEADER) {
-        diff_output("%s %s\r", file1->text, file2->text);
+        diff_output("%s %s" EOL_STR, file1->text, file2->text);
         *pflags &= ~D_HEADER;
     }
     if (diff_format == D_CONTEXT || diff_format == D_UNIFIED) {
@@ -947,8 +1001,10 @@ proceed:
         if (context_vec_ptr == context_vec_end - 1) {
             ptrdiff_t offset = context_vec_ptr - context_vec_start;
             max_context <<= 1;
-            context_vec_start = xreallocarray(context_vec_start,
-                                              max_context, sizeof(*context_vec_start));
+            context_vec_start = arena_reallocarray(&diff_arena,
+                                                   context_vec_start,
+                                                   max_context,
+                                                   sizeof(*context_vec_start));
             context_vec_end = context_vec_start + max_context;
             context_vec_ptr = context_vec_start + offset;
         }
@@ -990,28 +1046,28 @@ proceed:
         if (diff_format == D_NORMAL) {
             range(c, d, ",");
         }
-        diff_output("\r");
+        diff_output(EOL_STR);
         break;
     case D_REVERSE:
         diff_output("%c", (int) (a > b ? 'a' : c > d ? 'd' : 'c'));
         range(a, b, " ");
-        diff_output("\r");
+        diff_output(EOL_STR);
         break;
     case D_NREVERSE:
         if (a > b) {
-            diff_output("a%ld %ld\r", b, d - c + 1);
+            diff_output("a%ld %ld" EOL_STR, b, d - c + 1);
         } else {
-            diff_output("d%ld %ld\r", a, b - a + 1);
+            diff_output("d%ld %ld" EOL_STR, a, b - a + 1);
             if (!(c > d))
                 /* add changed lines */
-                diff_output("a%ld %ld\r", b, d - c + 1);
+                diff_output("a%ld %ld" EOL_STR, b, d - c + 1);
         }
         break;
     }
     if (diff_format == D_NORMAL || diff_format == D_IFDEF) {
         fetch(ixold, a, b, f1, '<', 1, *pflags);
         if (a <= b && c <= d && diff_format == D_NORMAL) {
-            diff_output("---\r");
+            diff_output("---" EOL_STR);
         }
     }
     i = fetch(ixnew, c, d, f2, diff_format == D_NORMAL ? '>' : '\0', 0, *pflags);
@@ -1023,18 +1079,18 @@ proceed:
          * it.  We have to add a substitute command to change this
          * back and restart where we left off.
          */
-        diff_output(".\r");
-        diff_output("%ls/.//\r", a + i - 1);
+        diff_output("." EOL_STR);
+        diff_output("%ls/.//" EOL_STR, a + i - 1);
         b = a + i - 1;
         a = b + 1;
         c += i;
         goto restart;
     }
     if ((diff_format == D_EDIT || diff_format == D_REVERSE) && c <= d) {
-        diff_output(".\r");
+        diff_output("." EOL_STR);
     }
     if (inifdef) {
-        diff_output("#endif /* %s */\r", ifdefname);
+        diff_output("#endif /* %s */" EOL_STR, ifdefname);
         inifdef = 0;
     }
 }
@@ -1060,13 +1116,13 @@ static long fetch(long *f, long a, long b, word lb, long ch, long oldfile, long
     }
     if (diff_format == D_IFDEF) {
         if (inifdef) {
-            diff_output("#else /* %s%s */\r",
+            diff_output("#else /* %s%s */" EOL_STR,
                         oldfile == 1 ? "!" : "", ifdefname);
         } else {
             if (oldfile) {
-                diff_output("#ifndef %s\r", ifdefname);
+                diff_output("#ifndef %s" EOL_STR, ifdefname);
             } else {
-                diff_output("#ifdef %s\r", ifdefname);
+                diff_output("#ifdef %s" EOL_STR, ifdefname);
             }
         }
         inifdef = 1 + oldfile;
@@ -1087,7 +1143,7 @@ static long fetch(long *f, long a, long b, word lb, long ch, long oldfile, long
                     diff_format == D_NREVERSE) {
                     warnx("No newline at end of file");
                 } else {
-                    diff_output("\r");
+                    diff_output(EOL_STR);
                 }
                 return (0);
             }
@@ -1099,7 +1155,7 @@ static long fetch(long *f, long a, long b, word lb, long ch, long oldfile, long
                     diff_output(" ");
                 } while (++col & 7);
             } else {
-                if (diff_format == D_EDIT && j == 1 && c == '\r'
+                if (diff_format == D_EDIT && j == 1 && c == EOL_CHAR
                     && lastc == '.') {
                     /*
                      * Don't prlong a bare "." line
@@ -1108,7 +1164,7 @@ static long fetch(long *f, long a, long b, word lb, long ch, long oldfile, long
                      * giving the caller an offset
                      * from which to restart.
                      */
-                    diff_output(".\r");
+                    diff_output("." EOL_STR);
                     return (i - a + 1);
                 }
                 diff_output("%c", (int) c);
@@ -1130,7 +1186,7 @@ static long readhash(word f, long flags) {
     space = 0;
     if ((flags & (D_FOLDBLANKS | D_IGNOREBLANKS)) == 0) {
         if (flags & D_IGNORECASE) {
-            for (i = 0; (t = FGetc(f)) != '\r'; i++) {
+            for (i = 0; (t = FGetc(f)) != EOL_CHAR; i++) {
                 if (t == EOF) {
                     if (i == 0) {
                         return (0);
@@ -1140,7 +1196,7 @@ static long readhash(word f, long flags) {
                 sum = sum * 127 + chrtran[t];
             }
         } else {
-            for (i = 0; (t = FGetc(f)) != '\r'; i++) {
+            for (i = 0; (t = FGetc(f)) != EOL_CHAR; i++) {
                 if (t == EOF) {
                     if (i == 0) {
                         return (0);
@@ -1152,8 +1208,13 @@ static long readhash(word f, long flags) {
         } 
     } else {
         for (i = 0;;) {
-            switch (t = FGetc(f)) {
+            t = FGetc(f);
+            if (t == EOL_CHAR) {
+                break;
+            }
+            switch (t) {
             case '\t':
+            case '\r':
             case '\n':
             case '\v':
             case '\f':
@@ -1172,8 +1233,6 @@ static long readhash(word f, long flags) {
                 if (i == 0) {
                     return (0);
                 }
-                /* FALLTHROUGH */
-            case '\r':
                 break;
             }
             break;
@@ -1218,7 +1277,7 @@ static char *match_function(const long *f, long pos, word fp) {
         FRead(fp, buf, &nc);
         if (nc > 0) {
             buf[nc] = '\0';
-            buf[strcspn((const char *)buf, "\r")] = '\0';
+            buf[strcspn((const char *)buf, EOL_STR)] = '\0';
             if (isalpha(buf[0]) || buf[0] == '_' || buf[0] == '$') {
                 if (begins_with((const char *)buf, "private:")) {
                     if (!state) {
@@ -1233,8 +1292,8 @@ static char *match_function(const long *f, long pos, word fp) {
                         state = " (public)";
                     }
                 } else {
-                    strncpy(lastbuf, (const char *)buf, sizeof lastbuf);
-                    if (state) strncat(lastbuf, (const char *)state, sizeof lastbuf);
+                    strlcpy(lastbuf, (const char *)buf, sizeof lastbuf);
+                    if (state) strlcat(lastbuf, (const char *)state, sizeof lastbuf);
                     lastmatchline = pos;
                     return lastbuf;
                 }
@@ -1269,9 +1328,9 @@ static void dump_context_vec(word f1, word f2, long flags) {
             diff_output(" %s", f);
         }
     }
-    diff_output("\r*** ");
+    diff_output(EOL_STR "*** ");
     range(lowa, upb, ",");
-    diff_output(" ****\r");
+    diff_output(" ****" EOL_STR);
 
     /*
      * Output changes to the "old" file.  The first loop suppresses
@@ -1314,7 +1373,7 @@ static void dump_context_vec(word f1, word f2, long flags) {
     /* output changes to the "new" file */
     diff_output("--- ");
     range(lowc, upd, ",");
-    diff_output(" ----\r");
+    diff_output(" ----" EOL_STR);
 
     do_output = 0;
     for (cvp = context_vec_start; cvp <= context_vec_ptr; cvp++) {
@@ -1362,6 +1421,8 @@ static void dump_unified_vec(word f1, word f2, long flags) {
     if (context_vec_start > context_vec_ptr) {
         return;
     }
+    /* called from within output, which gets the time up to here */
+    DIFF_PHASE(STAT_TIME_DIFF_OUTPUT);
 
     d = 0;      /* gcc */
     lowa = MAXIMUM(1, cvp->a - diff_context);
@@ -1380,7 +1441,7 @@ static void dump_unified_vec(word f1, word f2, long flags) {
             diff_output(" %s", f);
         }
     }
-    diff_output("\r");
+    diff_output(EOL_STR);
 
     /*
      * Output changes in "unified" diff format--the old and new lines
@@ -1406,15 +1467,18 @@ static void dump_unified_vec(word f1, word f2, long flags) {
         switch (ch) {
         case 'c':
             fetch(ixold, lowa, a - 1, f1, ' ', 0, flags);
+            diff_hunk(ch, a, b, c, d);
             fetch(ixold, a, b, f1, '-', 0, flags);
             fetch(ixnew, c, d, f2, '+', 0, flags);
             break;
         case 'd':
             fetch(ixold, lowa, a - 1, f1, ' ', 0, flags);
+            diff_hunk(ch, a, b, c, d);
             fetch(ixold, a, b, f1, '-', 0, flags);
             break;
         case 'a':
             fetch(ixnew, lowc, c - 1, f2, ' ', 0, flags);
+            diff_hunk(ch, a, b, c, d);
             fetch(ixnew, c, d, f2, '+', 0, flags);
             break;
         }
@@ -1424,18 +1488,19 @@ static void dump_unified_vec(word f1, word f2, long flags) {
     fetch(ixnew, d + 1, upd, f2, ' ', 0, flags);
 
     context_vec_ptr = context_vec_start - 1;
+    DIFF_PHASE(STAT_TIME_DIFF_DUMP);
 }
 
 static void print_header(const StringPtr file1, const StringPtr file2) {
     if (label[0] != NULL) {
-        diff_output("%s %s\r", diff_format == D_CONTEXT ? "***" : "---",
+        diff_output("%s %s" EOL_STR, diff_format == D_CONTEXT ? "***" : "---",
                                       label[0]);
     } else {
         diff_output("%s %s\t%sblah ", diff_format == D_CONTEXT ? "***" : "---",
                      file1->text, ctime(&stb1.st_mtime));
     }
     if (label[1] != NULL) {
-        diff_output("%s %s\r", diff_format == D_CONTEXT ? "---" : "+++",
+        diff_output("%s %s" EOL_STR, diff_format == D_CONTEXT ? "---" : "+++",
                                       label[1]);
     } else {
         diff_output("%s %s\t%s", diff_format == D_CONTEXT ? "---" : "+++",
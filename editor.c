@@ -64,6 +64,7 @@ void editor_init(struct browser *browser, struct repo_amendment *amendment) {
     struct editor *editor;
     struct focusable *focusable;
     char date[32];
+    char author[REPO_AUTHOR_SIZE];
     TimeRec ttm;
 
     editor = xmalloczero(sizeof(struct editor), "editor");
@@ -90,8 +91,9 @@ void editor_init(struct browser *browser, struct repo_amendment *amendment) {
     editor->save_button = GetCtlHandleFromID(editor->win, EDITOR_SAVE_BUTTON_ID);
 
     
-    /* author */
-    SetLETextByID(editor->win, EDITOR_AUTHOR_LE_ID, (StringPtr) c2pstr(amendment->author));
+    /* author, interned so convert a copy */
+    strlcpy(author, amendment->author, sizeof(author));
+    SetLETextByID(editor->win, EDITOR_AUTHOR_LE_ID, (StringPtr) c2pstr(author));
 
     /* date */
     ConvSeconds(secs2TimeRec, amendment->date, (Pointer) &ttm);
@@ -102,6 +104,7 @@ void editor_init(struct browser *browser, struct repo_amendment *amendment) {
     SetLETextByID(editor->win, EDITOR_DATE_LE_ID, (StringPtr) c2pstr(date));
 
     /* log message */
+    repo_amendment_log(browser->repo, amendment);
     HLock(amendment->log);
     TEInsert(0x0005, (Ref)*(amendment->log), amendment->log_len, 0, 0, (Handle) editor->log_te);
     HUnlock(amendment->log);
@@ -199,6 +202,7 @@ void editor_update_menu(struct editor *editor) {
     DisableMItem(REPO_MENU_ADD_FILE_ID);
     DisableMItem(REPO_MENU_DISCARD_CHANGES_ID);
     DisableMItem(REPO_MENU_APPLY_PATCH_ID);
+    DisableMItem(REPO_MENU_STATS_ID);
 
     DisableMItem(AMENDMENT_MENU_EDIT_ID);
     DisableMItem(AMENDMENT_MENU_EXPORT_ID);
@@ -283,13 +287,13 @@ void editor_save(struct editor *editor) {
 
     editor->amendment->date = ts;
 
-    len = sizeof(editor->amendment->author) - 1;
+    len = REPO_AUTHOR_SIZE - 1;
     if (author.textLength < len) {
         len = author.textLength;
     }
-    memcpy(editor->amendment->author, author.text,
-           len);
-    editor->amendment->author[len] = '\0';
+    author.text[len] = '\0';
+    editor->amendment->author = repo_intern_author(editor->browser->repo,
+                                                   author.text);
 
     editor->amendment->log_len = infoRec.charCount;
     if (editor->amendment->log) {
@@ -308,6 +312,7 @@ void editor_save(struct editor *editor) {
         panic("Failed storing amendment in repo file: %d",
               bile_error(editor->browser->repo->bile));
     }
+    repo_write_summary(editor->browser->repo, editor->amendment->id);
 
     editor->browser->need_refresh = true;
     focusable_close(focusable_find(editor->win));
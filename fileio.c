@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ * Copyright (c) 2020-2022 joshua stein <jcs@jcs.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * GS/OS backend of the file layer in fileio.h, the only place bile.c,
+ * repo.c, diffreg.c and patch.c reach the filesystem through.
+ */
+
+#include <types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <gsos.h>
+#include <orca.h>
+
+#include "AmendGS.h"
+#include "fileio.h"
+#include "stats.h"
+#include "util.h"
+
+segment "util";
+
+word getpath(word vRefNum, StringPtr fileName, GSString255Ptr ret, bool include_file) {
+    ResultBuf255 prefix = { 255, { 0 }};
+    RefInfoRecGS refRec = { 3, vRefNum, 0, &prefix };
+    char *pos;
+    word error;
+
+    memset(ret, 0, sizeof(GSString255));
+    GetRefInfoGS(&refRec);
+    error = toolerror();
+    if (!error) {
+        pos = strrchr(prefix.bufString.text, ':');
+        if (pos) {
+            pos++;
+            *pos = 0;
+            prefix.bufString.length = strlen(prefix.bufString.text);
+        }
+        memcpy(ret, &prefix.bufString, prefix.bufString.length + sizeof(word));
+        if (include_file) {
+            strncat(ret->text, fileName->text, fileName->textLength);
+            ret->length = strlen(ret->text);
+        }
+    }
+    
+    return error;
+}
+
+word FSDelete(GSString255Ptr path) {
+    NameRecGS destroyRec = { 1, path };
+    DestroyGS(&destroyRec);
+    return toolerror();
+}
+
+word FDelete(StringPtr path) {
+    GSString255 gpath;
+    s2gstr(gpath, (*path));
+    return FSDelete(&gpath);
+}
+
+word FRename(GSString255Ptr source, GSString255Ptr dest) {
+    ChangePathRecGS changeRec = { 2, source, dest };
+    ChangePathGS(&changeRec);
+
+    return toolerror();
+}
+
+word FStat(GSString255Ptr path, FileInfoRecPtrGS sb) {
+    static ResultBuf255 optionList = { 255, { 0 } };
+
+    sb->pCount = 11;
+    sb->pathname = path;
+    sb->optionList = &optionList;
+    GetFileInfoGS(sb);
+    
+    return toolerror();
+}
+
+/* write back dates and such from an FStat, pCount picks how much */
+word FSetInfo(FileInfoRecPtrGS sb) {
+    SetFileInfoGS(sb);
+
+    return toolerror();
+}
+
+word FMkdir(GSString255Ptr path) {
+    CreateRecGS createRec = { 5, path, 0x00E3, 0x000F, 0, 0x000D };
+
+    CreateGS(&createRec);
+
+    return toolerror();
+}
+
+word copy_file(GSString255Ptr source, GSString255Ptr dest, bool overwrite) {
+    word error, source_ref, dest_ref;
+    FileInfoRecGS infoRec;
+    CreateRecGS createRec = {7, dest, 0};
+    OpenRecGS sOpenRec = { 4, 0, source, readEnable, dataForkNum };
+    OpenRecGS dOpenRec = { 4, 0, dest, writeEnable, dataForkNum };
+    RefNumRecGS closeRec = { 1 };
+
+	/* copy data fork */
+    error = FStat(source, &infoRec);
+    if (error) {
+		return error;
+    }
+	
+    createRec.access = infoRec.access;
+    createRec.fileType = infoRec.fileType;
+    createRec.auxType = infoRec.auxType;
+    createRec.storageType = infoRec.storageType;
+    createRec.eof = infoRec.eof;
+    createRec.resourceEOF = infoRec.resourceEOF;
+    CreateGS(&createRec);
+    error = toolerror();
+	if (error == dupPathname && overwrite) {
+        error = FSDelete(dest);
+        if (error) {
+			return error;
+        }
+        CreateGS(&createRec);
+        error = toolerror();
+	}
+    if (error) {
+		return error;
+    }
+	
+    OpenGS(&sOpenRec);
+    error = toolerror();
+    if (error) {
+		return error;
+    }
+    source_ref = sOpenRec.refNum;
+	
+    OpenGS(&dOpenRec);
+    error = toolerror();
+	if (error) {
+        closeRec.refNum = source_ref;
+        CloseGS(&closeRec);
+		return error;
+	}
+    dest_ref = dOpenRec.refNum;
+
+	error = copy_file_contents(source_ref, dest_ref);
+	
+    closeRec.refNum = source_ref;
+    CloseGS(&closeRec);
+    closeRec.refNum = dest_ref;
+    CloseGS(&closeRec);
+	
+    if (error) {
+		return error;
+    }
+	
+	/*
+	 * Copy resource fork, open source as shared read/write in case it's
+	 * an open resource file.
+	 */
+    if (infoRec.resourceEOF) {
+    }
+    sOpenRec.resourceNumber =  resourceForkNum;
+    OpenGS(&sOpenRec);
+    error = toolerror();
+	if (error) {
+		/* no resource fork */
+		return 0;
+	}
+    source_ref = sOpenRec.refNum;
+	
+    dOpenRec.resourceNumber = resourceForkNum;
+    OpenGS(&dOpenRec);
+    error = toolerror();
+
+	if (error) {
+        closeRec.refNum = source_ref;
+        CloseGS(&closeRec);
+		return error;
+	}
+	
+	error = copy_file_contents(source_ref, dest_ref);
+	
+    closeRec.refNum = source_ref;
+    CloseGS(&closeRec);
+    closeRec.refNum = dest_ref;
+    CloseGS(&closeRec);
+	
+    return error;
+}
+
+word FSeek(word vRefNum, long displacement) {
+    SetPositionRecGS posRec = { 3, vRefNum, startPlus, displacement };
+    SetMarkGS(&posRec);
+
+    return toolerror();
+}
+
+word FCreate(word vRefNum, StringPtr filename, word fileType, long auxType, longword preAlloc) {
+    GSString255 path;
+    CreateRecGS createRec = { 6, &path, 0x00E3, fileType, auxType, 1, preAlloc};
+    if (vRefNum) {
+        getpath(vRefNum, filename, &path, true);
+    } else {
+        strncpy(path.text, filename->text, filename->textLength);
+        path.length = filename->textLength;
+    }
+
+    CreateGS(&createRec);
+
+    return toolerror();
+}
+
+word FOpen(word vRefNum, StringPtr filename, word access, word *frefnum, longword *eof) {
+    GSString255 path;
+    OpenRecGS openRec = { 12, 0, &path, access, dataForkNum };
+
+    if (vRefNum) {
+        getpath(vRefNum, filename, &path, true);
+    } else {
+        strncpy(path.text, filename->text, filename->textLength);
+        path.length = filename->textLength;
+    }
+
+    OpenGS(&openRec);
+
+    if (toolerror() == 0) {
+        if (frefnum) {
+            *frefnum = openRec.refNum;
+        }
+        if (eof) {
+            *eof = openRec.eof;
+        }
+    }
+    return toolerror();
+}
+
+word FWrite(word fRefNum, void *buf, longword *count) {
+    IORecGS writeRec = { 4, fRefNum, (Pointer) buf, *count, 0 };
+
+    WriteGS(&writeRec);
+    *count = writeRec.transferCount;
+
+    return toolerror();
+}
+
+word FRead(word fRefNum, void *buf, longword *count) {
+    IORecGS readRec = { 4, fRefNum, (Pointer) buf, *count, 0 };
+
+    ReadGS(&readRec);
+    *count = readRec.transferCount;
+
+    return toolerror();
+}
+
+word FClose(word fRefNum) {
+    RefNumRecGS closeRec = { 1, fRefNum };
+
+    CloseGS(&closeRec);
+
+    return toolerror();
+}
+
+word FSetEOF(word fRefNum, longword displacement) {
+    SetPositionRecGS eofRec = { 3, fRefNum, 0, displacement };
+
+    SetEOFGS(&eofRec);
+
+    return toolerror();
+}
+
+word FGetEOF(word fRefNum, longword *eof) {
+    EOFRecGS eofRec = { 2, fRefNum, 0 };
+
+    GetEOFGS(&eofRec);
+    if (eof) {
+        *eof = eofRec.eof;
+    }
+
+    return toolerror();
+}
+
+word FFlush(word fRefNum) {
+    RefNumRecGS flushRec = { 1, fRefNum };
+
+    FlushGS(&flushRec);
+
+    return toolerror();
+}
+
+word FRewind(word fRefNum) {
+    return FSeek(fRefNum, 0);
+}
+
+int FGetc(word fRefNum) {
+    char c = 0;
+    IORecGS readRec = { 4, fRefNum, &c, 1, 0 };
+
+    STAT_COUNT(STAT_FGETC);
+    ReadGS(&readRec);
+    if (toolerror()) {
+        return -1;
+    }
+    return c;
+}
+
+long FGetMark(word fRefNum) {
+    PositionRecGS markRec = { 2, fRefNum, 0 };
+
+    GetMarkGS(&markRec);
+
+    return markRec.position;
+}
+
+word copy_file_contents(word source_ref, word dest_ref)
+{
+	char *buf;
+	word error;
+    long count, source_size;
+    EOFRecGS eofRec = { 2, source_ref };
+    IORecGS ioRec = { 4, 0, 0, 0, 0 };
+
+    GetEOFGS(&eofRec);
+    source_size = eofRec.eof;
+
+    error = FSeek(source_ref, 0);
+    if (error) {
+		return error;
+    }
+    eofRec.refNum = dest_ref;
+    error = FSeek(dest_ref, 0);
+    if (error) {
+		return error;
+    }
+		
+	buf = xmalloc(1024, "copy_file_contents");
+	
+	while (source_size > 0) {
+		count = 1024;
+        if (count > source_size) {
+			count = source_size;
+        }
+        ioRec.refNum = source_ref;
+        ioRec.dataBuffer = buf;
+        ioRec.requestCount = count;
+        ReadGS(&ioRec);
+        error = toolerror();
+        if (error && error != eofEncountered) {
+			break;
+        }
+		source_size -= count;
+        ioRec.refNum = dest_ref;
+        WriteGS(&ioRec);
+        error = toolerror();
+		if (error && error != eofEncountered)
+			break;
+	}
+	
+	xfree(&buf);
+	
+    if (error && error != eofEncountered) {
+		return error;
+    }
+	
+	return 0;
+}
+
+/* read a line ending in EOL_CHAR, or the final non-line bytes of a file */
+size_t FSReadLine(word frefnum, char *buf, size_t buflen)
+{
+    size_t pos, fsize, total_read = 0;
+	char tbuf = 0;
+	word error;
+    EOFRecGS eofRec = { 2, frefnum };
+    PositionRecGS markRec = { 2, frefnum, 0 };
+    IORecGS ioRec = { 4, frefnum, &tbuf, 1, 0 };
+
+    GetMarkGS(&markRec);
+    pos = markRec.position;
+    GetEOFGS(&eofRec);
+    fsize = eofRec.eof;
+	
+	
+	for (; pos <= fsize; pos++) {
+        if (total_read > buflen) {
+			return -1;
+        }
+        ReadGS(&ioRec);
+        error = toolerror();
+        if (error) {
+			return -1;
+        }
+		
+        if (tbuf == EOL_CHAR) {
+			return total_read;
+        }
+
+		buf[total_read++] = tbuf;
+	}
+	
+	/* nothing found until the end of the file */
+	return total_read;
+}
+
+word FGetFSTId(word refNum) {
+    ResultBuf255 volume = { 255, { 0 }};
+    RefInfoRecGS refRec = { 3, refNum, 0, &volume };
+    char *pos;
+    int sysID = 0;
+    VolumeRecGS volumeRec = {0};
+    DInfoRecGS dInfoRec;
+    ResultBuf32 devName = { 32, { 0 }};
+    ResultBuf255 volName = { 255, { 0 }};
+    word devCount = 0;
+
+    GetRefInfoGS(&refRec);
+    pos = strchr(volume.bufString.text, ':');
+    if (!pos) {
+        return 0;
+    }
+
+    *pos = 0;
+    do {
+        dInfoRec.pCount = 2;
+        dInfoRec.devNum = devCount++;
+        dInfoRec.devName = &devName;
+        DInfoGS(&dInfoRec);
+        if (toolerror() == 0) {
+            memset(&volName, 0, sizeof(ResultBuf255));
+            volumeRec.pCount = 5;
+            volumeRec.devName = &(devName.bufString);
+            volumeRec.volName = &volName;
+            VolumeGS(&volumeRec);
+            if (toolerror() == 0 &&
+                strcmp(volume.bufString.text, volName.bufString.text) == 0) {
+                sysID = volumeRec.fileSysID;
+                break;
+            }
+        } else {
+            break;
+        }
+    } while (toolerror() != paramRangeErr);
+
+    return sysID;
+}
+
+/* GS/OS can't map files, callers fall back to FRead */
+word FMap(word fRefNum, longword len, const void **ret) {
+    *ret = NULL;
+    return badSystemCall;
+}
+
+word FUnmap(const void *addr, longword len) {
+    return badSystemCall;
+}
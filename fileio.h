@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ * Copyright (c) 2020-2022 joshua stein <jcs@jcs.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __FILEIO_H__
+#define __FILEIO_H__
+
+#include <types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <gsos.h>
+
+/*
+ * Platform file layer.  Everything under the UI (bile, repo, diffreg,
+ * patch) goes through these, fileio.c implements them with GS/OS calls
+ * and fileio_posix.c with POSIX ones for a host build (AMEND_HOST), the
+ * makefile picks which.  Refnums, paths and error codes are GS/OS ones
+ * on every platform, so a backend has to hand back fileNotFound,
+ * dupPathname, eofEncountered and friends itself.
+ */
+
+#ifdef AMEND_HOST
+#define EOL_CHAR		'\n'
+#define EOL_STR			"\n"
+#define PATH_SEP		'/'
+#define PATH_SEP_STR	"/"
+#else
+#define EOL_CHAR		'\r'
+#define EOL_STR			"\r"
+#define PATH_SEP		':'
+#define PATH_SEP_STR	":"
+#endif
+
+word getpath(word vRefNum, StringPtr fileName, GSString255Ptr ret, bool include_file);
+word FSDelete(GSString255Ptr path);
+word FDelete(StringPtr path);
+word FRename(GSString255Ptr source, GSString255Ptr dest);
+word FStat(GSString255Ptr path, FileInfoRecPtrGS sb);
+word FSetInfo(FileInfoRecPtrGS sb);
+word FMkdir(GSString255Ptr path);
+word FSeek(word vRefNum, long displacement);
+word FCreate(word vRefNum, StringPtr filename, word fileType, long auxType, longword prealloc);
+word FOpen(word vRefNum, StringPtr filename, word access, word *frefnum, longword *eof);
+word FClose(word fRefNum);
+word FWrite(word fRefNum, void *buf, longword *count);
+word FRead(word fRefNum, void *buf, longword *count);
+word FSetEOF(word fRefNum, longword displacement);
+word FGetEOF(word fRefNum, longword *eof);
+word FFlush(word fRefNum);
+word FRewind(word fRefNum);
+int FGetc(word fRefNum);
+long FGetMark(word fRefNum);
+word copy_file(GSString255Ptr source, GSString255Ptr dest, bool overwrite);
+word copy_file_contents(word source_ref, word dest_ref);
+size_t FSReadLine(word frefnum, char *buf, size_t buflen);
+word FGetFSTId(word refNum);
+word FMap(word fRefNum, longword len, const void **ret);
+word FUnmap(const void *addr, longword len);
+
+#endif
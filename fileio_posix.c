@@ -0,0 +1,808 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * POSIX backend of the file layer in fileio.h, built instead of fileio.c
+ * for a host (AMEND_HOST).  Refnums index a table of open descriptors,
+ * each with its own mark like a GS/OS refnum, and reads and writes go
+ * through pread and pwrite at that mark.  errno values come back as the
+ * GS/OS error the same failure would give on the IIgs.
+ *
+ * Files have no type, aux type or creation date here, so FStat reports
+ * everything as TXT and uses the modification time for both dates.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <types.h>
+#include <gsos.h>
+
+#include "fileio.h"
+#include "stats.h"
+
+/* what FGetc and FSReadLine read ahead into */
+#define FILEIO_RBUF_SIZE    4096
+
+#define FILEIO_TXT_TYPE     0x04
+#define FILEIO_DIR_TYPE     0x0F
+
+struct fileio_ref {
+    int fd;
+    char *path;
+    off_t mark;
+    char *rbuf;
+    off_t rbuf_pos;
+    size_t rbuf_len;
+};
+
+static struct fileio_ref *fileio_refs = NULL;
+static word fileio_nrefs = 0;
+
+static word fileio_error(int e);
+static struct fileio_ref *fileio_ref(word refnum);
+static bool fileio_path(GSString255Ptr gpath, char *path);
+static void fileio_pstr_path(word vRefNum, StringPtr filename, char *path);
+static void fileio_timerec(time_t t, TimeRec *tr);
+static time_t fileio_time(TimeRec *tr);
+static int fileio_fill(struct fileio_ref *ref);
+
+word getpath(word vRefNum, StringPtr fileName, GSString255Ptr ret, bool include_file) {
+    struct fileio_ref *ref;
+    char *pos;
+    size_t len = 0;
+
+    memset(ret, 0, sizeof(GSString255));
+
+    ref = fileio_ref(vRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+
+    /* the directory of the open file, with its trailing separator */
+    pos = strrchr(ref->path, PATH_SEP);
+    if (pos) {
+        len = pos - ref->path + 1;
+        if (len > sizeof(ret->text) - 1) {
+            return badPathSyntax;
+        }
+        memcpy(ret->text, ref->path, len);
+    }
+
+    if (include_file) {
+        if (len + fileName->textLength > sizeof(ret->text) - 1) {
+            return badPathSyntax;
+        }
+        memcpy(ret->text + len, fileName->text, fileName->textLength);
+        len += fileName->textLength;
+    }
+    ret->length = len;
+
+    return 0;
+}
+
+word FSDelete(GSString255Ptr path) {
+    char cpath[256];
+
+    if (!fileio_path(path, cpath)) {
+        return badPathSyntax;
+    }
+
+    if (unlink(cpath) == 0) {
+        return 0;
+    }
+    /* DestroyGS takes empty directories too */
+    if ((errno == EISDIR || errno == EPERM) && rmdir(cpath) == 0) {
+        return 0;
+    }
+
+    return fileio_error(errno);
+}
+
+word FDelete(StringPtr path) {
+    GSString255 gpath;
+
+    gpath.length = path->textLength;
+    memcpy(gpath.text, path->text, path->textLength);
+
+    return FSDelete(&gpath);
+}
+
+/* like ChangePathGS, and unlike rename, never replace an existing dest */
+word FRename(GSString255Ptr source, GSString255Ptr dest) {
+    char csource[256], cdest[256];
+    struct stat sb;
+
+    if (!fileio_path(source, csource) || !fileio_path(dest, cdest)) {
+        return badPathSyntax;
+    }
+
+    if (lstat(cdest, &sb) == 0) {
+        return dupPathname;
+    }
+
+    if (rename(csource, cdest) != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+word FStat(GSString255Ptr path, FileInfoRecPtrGS sb) {
+    char cpath[256];
+    struct stat st;
+
+    sb->pathname = path;
+
+    if (!fileio_path(path, cpath)) {
+        return badPathSyntax;
+    }
+
+    if (stat(cpath, &st) != 0) {
+        return fileio_error(errno);
+    }
+
+    sb->access = 0x00E3;
+    if (S_ISDIR(st.st_mode)) {
+        sb->fileType = FILEIO_DIR_TYPE;
+        sb->storageType = 0x0D;
+    } else {
+        sb->fileType = FILEIO_TXT_TYPE;
+        sb->storageType = 1;
+    }
+    sb->auxType = 0;
+    fileio_timerec(st.st_mtime, &sb->createDateTime);
+    fileio_timerec(st.st_mtime, &sb->modDateTime);
+    sb->eof = st.st_size;
+    sb->blocksUsed = (st.st_size + 511) / 512;
+    sb->resourceEOF = 0;
+    sb->resourceBlocks = 0;
+
+    return 0;
+}
+
+/* only the modification date can be set back */
+word FSetInfo(FileInfoRecPtrGS sb) {
+    char cpath[256];
+    struct timespec times[2];
+
+    if (!fileio_path(sb->pathname, cpath)) {
+        return badPathSyntax;
+    }
+
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = fileio_time(&sb->modDateTime);
+    times[1].tv_nsec = 0;
+    if (utimensat(AT_FDCWD, cpath, times, 0) != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+word FMkdir(GSString255Ptr path) {
+    char cpath[256];
+
+    if (!fileio_path(path, cpath)) {
+        return badPathSyntax;
+    }
+
+    if (mkdir(cpath, 0777) != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+/* there's no resource fork to carry over, just the data */
+word copy_file(GSString255Ptr source, GSString255Ptr dest, bool overwrite) {
+    Str255 name;
+    word error, source_ref, dest_ref;
+
+    if (source->length > sizeof(name.text) - 1 ||
+        dest->length > sizeof(name.text) - 1) {
+        return badPathSyntax;
+    }
+
+    name.textLength = dest->length;
+    memcpy(name.text, dest->text, dest->length);
+    error = FCreate(0, &name, FILEIO_TXT_TYPE, 0, 0);
+    if (error == dupPathname && overwrite) {
+        error = FSDelete(dest);
+        if (error) {
+            return error;
+        }
+        error = FCreate(0, &name, FILEIO_TXT_TYPE, 0, 0);
+    }
+    if (error) {
+        return error;
+    }
+
+    error = FOpen(0, &name, writeEnable, &dest_ref, NULL);
+    if (error) {
+        return error;
+    }
+
+    name.textLength = source->length;
+    memcpy(name.text, source->text, source->length);
+    error = FOpen(0, &name, readEnable, &source_ref, NULL);
+    if (error) {
+        FClose(dest_ref);
+        return error;
+    }
+
+    error = copy_file_contents(source_ref, dest_ref);
+
+    FClose(source_ref);
+    FClose(dest_ref);
+
+    return error;
+}
+
+/* SetMarkGS can't go past the EOF either */
+word FSeek(word vRefNum, long displacement) {
+    struct fileio_ref *ref;
+    struct stat st;
+
+    ref = fileio_ref(vRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+
+    if (fstat(ref->fd, &st) != 0) {
+        return fileio_error(errno);
+    }
+    if (displacement < 0 || displacement > st.st_size) {
+        return outOfRange;
+    }
+
+    ref->mark = displacement;
+
+    return 0;
+}
+
+/* preallocation is left to the filesystem */
+word FCreate(word vRefNum, StringPtr filename, word fileType, long auxType, longword prealloc) {
+    char path[256];
+    int fd;
+
+    fileio_pstr_path(vRefNum, filename, path);
+
+    fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd == -1) {
+        return fileio_error(errno);
+    }
+    close(fd);
+
+    return 0;
+}
+
+word FOpen(word vRefNum, StringPtr filename, word access, word *frefnum, longword *eof) {
+    struct fileio_ref *ref;
+    char path[256];
+    struct stat st;
+    word n;
+    int fd, flags;
+
+    fileio_pstr_path(vRefNum, filename, path);
+
+    switch (access & readWriteEnable) {
+    case readEnable:
+        flags = O_RDONLY;
+        break;
+    case writeEnable:
+        flags = O_WRONLY;
+        break;
+    default:
+        flags = O_RDWR;
+        break;
+    }
+
+    fd = open(path, flags);
+    if (fd == -1) {
+        return fileio_error(errno);
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return fileio_error(errno);
+    }
+
+    for (n = 0; n < fileio_nrefs; n++) {
+        if (fileio_refs[n].path == NULL) {
+            break;
+        }
+    }
+    if (n == fileio_nrefs) {
+        if (fileio_nrefs == 0xFFFE) {
+            close(fd);
+            return tooManyFilesOpen;
+        }
+        ref = realloc(fileio_refs,
+                      (fileio_nrefs + 8) * sizeof(struct fileio_ref));
+        if (ref == NULL) {
+            close(fd);
+            return outOfMem;
+        }
+        fileio_refs = ref;
+        memset(fileio_refs + fileio_nrefs, 0, 8 * sizeof(struct fileio_ref));
+        fileio_nrefs += 8;
+    }
+
+    ref = &fileio_refs[n];
+    ref->path = strdup(path);
+    if (ref->path == NULL) {
+        close(fd);
+        return outOfMem;
+    }
+    ref->fd = fd;
+    ref->mark = 0;
+    ref->rbuf_len = 0;
+
+    /* refnum 0 means "none" to callers */
+    if (frefnum) {
+        *frefnum = n + 1;
+    }
+    if (eof) {
+        *eof = st.st_size;
+    }
+
+    return 0;
+}
+
+word FWrite(word fRefNum, void *buf, longword *count) {
+    struct fileio_ref *ref;
+    longword done = 0;
+    ssize_t n;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        *count = 0;
+        return invalidRefNum;
+    }
+    ref->rbuf_len = 0;
+
+    while (done < *count) {
+        n = pwrite(ref->fd, (char *)buf + done, *count - done,
+                   ref->mark + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *count = done;
+            ref->mark += done;
+            return fileio_error(errno);
+        }
+        done += n;
+    }
+    ref->mark += done;
+
+    return 0;
+}
+
+/* a short read is fine, only reading nothing at all is an error */
+word FRead(word fRefNum, void *buf, longword *count) {
+    struct fileio_ref *ref;
+    longword done = 0;
+    ssize_t n;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        *count = 0;
+        return invalidRefNum;
+    }
+
+    while (done < *count) {
+        n = pread(ref->fd, (char *)buf + done, *count - done,
+                  ref->mark + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            *count = done;
+            ref->mark += done;
+            return fileio_error(errno);
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    ref->mark += done;
+
+    if (done == 0 && *count > 0) {
+        *count = 0;
+        return eofEncountered;
+    }
+    *count = done;
+
+    return 0;
+}
+
+word FClose(word fRefNum) {
+    struct fileio_ref *ref;
+    int ret;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+
+    ret = close(ref->fd);
+    free(ref->path);
+    free(ref->rbuf);
+    memset(ref, 0, sizeof(struct fileio_ref));
+
+    if (ret != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+word FSetEOF(word fRefNum, longword displacement) {
+    struct fileio_ref *ref;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+    ref->rbuf_len = 0;
+
+    if (ftruncate(ref->fd, displacement) != 0) {
+        return fileio_error(errno);
+    }
+    if (ref->mark > displacement) {
+        ref->mark = displacement;
+    }
+
+    return 0;
+}
+
+word FGetEOF(word fRefNum, longword *eof) {
+    struct fileio_ref *ref;
+    struct stat st;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+
+    if (fstat(ref->fd, &st) != 0) {
+        return fileio_error(errno);
+    }
+    if (eof) {
+        *eof = st.st_size;
+    }
+
+    return 0;
+}
+
+word FFlush(word fRefNum) {
+    struct fileio_ref *ref;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+
+    if (fsync(ref->fd) != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+word FRewind(word fRefNum) {
+    return FSeek(fRefNum, 0);
+}
+
+int FGetc(word fRefNum) {
+    struct fileio_ref *ref;
+    unsigned char c;
+
+    STAT_COUNT(STAT_FGETC);
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return -1;
+    }
+
+    if (fileio_fill(ref) <= 0) {
+        return -1;
+    }
+    c = ref->rbuf[ref->mark - ref->rbuf_pos];
+    ref->mark++;
+
+    return c;
+}
+
+long FGetMark(word fRefNum) {
+    struct fileio_ref *ref;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return 0;
+    }
+
+    return ref->mark;
+}
+
+word copy_file_contents(word source_ref, word dest_ref) {
+    char *buf;
+    longword count;
+    word error;
+
+    error = FSeek(source_ref, 0);
+    if (error) {
+        return error;
+    }
+    error = FSeek(dest_ref, 0);
+    if (error) {
+        return error;
+    }
+
+    buf = malloc(FILEIO_RBUF_SIZE * 16);
+    if (buf == NULL) {
+        return outOfMem;
+    }
+
+    for (;;) {
+        count = FILEIO_RBUF_SIZE * 16;
+        error = FRead(source_ref, buf, &count);
+        if (error) {
+            break;
+        }
+        error = FWrite(dest_ref, buf, &count);
+        if (error) {
+            break;
+        }
+    }
+
+    free(buf);
+
+    if (error && error != eofEncountered) {
+        return error;
+    }
+
+    return FSetEOF(dest_ref, FGetMark(dest_ref));
+}
+
+/* read a line ending in EOL_CHAR, or the final non-line bytes of a file */
+size_t FSReadLine(word frefnum, char *buf, size_t buflen) {
+    struct fileio_ref *ref;
+    size_t total_read = 0, avail, i;
+    char *line;
+
+    ref = fileio_ref(frefnum);
+    if (ref == NULL) {
+        return -1;
+    }
+
+    for (;;) {
+        if (fileio_fill(ref) <= 0) {
+            /* nothing found until the end of the file */
+            return total_read ? total_read : (size_t)-1;
+        }
+
+        line = ref->rbuf + (ref->mark - ref->rbuf_pos);
+        avail = ref->rbuf_len - (ref->mark - ref->rbuf_pos);
+        for (i = 0; i < avail; i++) {
+            if (line[i] == EOL_CHAR) {
+                break;
+            }
+        }
+
+        if (total_read + i > buflen) {
+            return -1;
+        }
+        memcpy(buf + total_read, line, i);
+        total_read += i;
+
+        if (i < avail) {
+            ref->mark += i + 1;
+            return total_read;
+        }
+        ref->mark += i;
+    }
+}
+
+/* no foreign file systems to tell apart */
+word FGetFSTId(word refNum) {
+    return 0;
+}
+
+/*
+ * Map the first len bytes of the file read-only.  The map is shared, so
+ * later FWrites within it show through on systems with a unified buffer
+ * cache, but it doesn't grow with the file and must be unmapped before
+ * the file is truncated below len.
+ */
+word FMap(word fRefNum, longword len, const void **ret) {
+    struct fileio_ref *ref;
+    void *addr;
+
+    *ret = NULL;
+
+    ref = fileio_ref(fRefNum);
+    if (ref == NULL) {
+        return invalidRefNum;
+    }
+    if (len == 0) {
+        return paramRangeErr;
+    }
+
+    addr = mmap(NULL, len, PROT_READ, MAP_SHARED, ref->fd, 0);
+    if (addr == MAP_FAILED) {
+        return fileio_error(errno);
+    }
+    *ret = addr;
+
+    return 0;
+}
+
+word FUnmap(const void *addr, longword len) {
+    if (munmap((void *)addr, len) != 0) {
+        return fileio_error(errno);
+    }
+
+    return 0;
+}
+
+/* Private API */
+
+static word fileio_error(int e) {
+    switch (e) {
+    case 0:
+        return 0;
+    case ENOENT:
+        return fileNotFound;
+    case ENOTDIR:
+        return pathNotFound;
+    case EEXIST:
+    case ENOTEMPTY:
+        return dupPathname;
+    case EACCES:
+    case EPERM:
+    case EISDIR:
+        return invalidAccess;
+    case EROFS:
+        return drvrWrtProt;
+    case ENOSPC:
+    case EDQUOT:
+    case EFBIG:
+        return volumeFull;
+    case EMFILE:
+    case ENFILE:
+        return tooManyFilesOpen;
+    case EBADF:
+        return invalidRefNum;
+    case EBUSY:
+    case ETXTBSY:
+        return fileBusy;
+    case ENAMETOOLONG:
+    case EINVAL:
+        return badPathSyntax;
+    case ENOMEM:
+        return outOfMem;
+    default:
+        return drvrIOError;
+    }
+}
+
+static struct fileio_ref *fileio_ref(word refnum) {
+    if (refnum == 0 || refnum > fileio_nrefs ||
+        fileio_refs[refnum - 1].path == NULL) {
+        return NULL;
+    }
+
+    return &fileio_refs[refnum - 1];
+}
+
+static bool fileio_path(GSString255Ptr gpath, char *path) {
+    if (gpath->length > sizeof(gpath->text) - 1) {
+        return false;
+    }
+    memcpy(path, gpath->text, gpath->length);
+    path[gpath->length] = '\0';
+
+    return (gpath->length > 0);
+}
+
+/* FCreate and FOpen names are relative to vRefNum's directory if given */
+static void fileio_pstr_path(word vRefNum, StringPtr filename, char *path) {
+    GSString255 gpath;
+
+    if (vRefNum && getpath(vRefNum, filename, &gpath, true) == 0) {
+        memcpy(path, gpath.text, gpath.length);
+        path[gpath.length] = '\0';
+    } else {
+        memcpy(path, filename->text, filename->textLength);
+        path[filename->textLength] = '\0';
+    }
+}
+
+/* dates are local wall clock time, like the IIgs clock */
+static void fileio_timerec(time_t t, TimeRec *tr) {
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+    tr->second = tm.tm_sec;
+    tr->minute = tm.tm_min;
+    tr->hour = tm.tm_hour;
+    tr->year = tm.tm_year;
+    tr->day = tm.tm_mday - 1;
+    tr->month = tm.tm_mon;
+    tr->extra = 0;
+    tr->weekDay = tm.tm_wday + 1;
+}
+
+static time_t fileio_time(TimeRec *tr) {
+    struct tm tm;
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_sec = tr->second;
+    tm.tm_min = tr->minute;
+    tm.tm_hour = tr->hour;
+    tm.tm_year = tr->year;
+    tm.tm_mday = tr->day + 1;
+    tm.tm_mon = tr->month;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
+
+/*
+ * Make sure the read-ahead buffer holds the byte at the mark, returning
+ * how many bytes it has from there or 0 at the end of the file.
+ */
+static int fileio_fill(struct fileio_ref *ref) {
+    ssize_t n;
+
+    if (ref->rbuf_len > 0 && ref->mark >= ref->rbuf_pos &&
+        ref->mark < ref->rbuf_pos + (off_t)ref->rbuf_len) {
+        return ref->rbuf_pos + ref->rbuf_len - ref->mark;
+    }
+
+    if (ref->rbuf == NULL) {
+        ref->rbuf = malloc(FILEIO_RBUF_SIZE);
+        if (ref->rbuf == NULL) {
+            return -1;
+        }
+    }
+
+    do {
+        n = pread(ref->fd, ref->rbuf, FILEIO_RBUF_SIZE, ref->mark);
+    } while (n == -1 && errno == EINTR);
+    if (n <= 0) {
+        ref->rbuf_len = 0;
+        return n;
+    }
+    ref->rbuf_pos = ref->mark;
+    ref->rbuf_len = n;
+
+    return n;
+}
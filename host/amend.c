@@ -0,0 +1,744 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Command line front end over the repo core, for scripting a repo from a
+ * build machine:
+ *
+ *   amend [-Svy] [-R repo] [-T trace] command [args]
+ *
+ * The repo defaults to $AMEND_REPO, or amend.repo in the current
+ * directory.  Tracked files are named relative to the repo's directory,
+ * as they are on the IIgs.  -S prints repo_stats on stderr once the
+ * command is done, which says more in a build with AMEND_STATS, and -T
+ * records the repo's I/O for bile_replay.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <types.h>
+#include <memory.h>
+#include <gsos.h>
+
+#include "../bile.h"
+#include "../diff.h"
+#include "../patch.h"
+#include "../repo.h"
+#include "../util.h"
+#include "console.h"
+
+#define AMEND_DEFAULT_REPO	"amend.repo"
+
+/* needed by diffreg */
+struct stat stb1, stb2;
+long diff_format, diff_context, status = 0;
+char *ifdefname, *diffargs, *label[2], *ignore_pats;
+
+/*
+ * Where diff_output goes: straight to stdout, or for a commit, into
+ * diff_text with the hunks of diff_file recorded as it goes.
+ */
+static struct diffed_file *diff_file = NULL;
+static Handle diff_text = NULL;
+static unsigned long diff_len = 0;
+
+struct command {
+	const char *name;
+	const char *args;
+	bool needs_repo;
+	int (*func)(struct repo *repo, int argc, char *argv[]);
+};
+
+static int cmd_init(struct repo *, int, char *[]);
+static int cmd_add(struct repo *, int, char *[]);
+static int cmd_status(struct repo *, int, char *[]);
+static int cmd_diff(struct repo *, int, char *[]);
+static int cmd_commit(struct repo *, int, char *[]);
+static int cmd_log(struct repo *, int, char *[]);
+static int cmd_show(struct repo *, int, char *[]);
+static int cmd_checkout(struct repo *, int, char *[]);
+static int cmd_export_patch(struct repo *, int, char *[]);
+static int cmd_apply(struct repo *, int, char *[]);
+static int cmd_fsck(struct repo *, int, char *[]);
+static int cmd_stats(struct repo *, int, char *[]);
+
+static const struct command commands[] = {
+	{ "init",		"",				false,	cmd_init },
+	{ "add",		"file ...",		true,	cmd_add },
+	{ "status",		"[file ...]",	true,	cmd_status },
+	{ "diff",		"[file ...]",	true,	cmd_diff },
+	{ "commit",		"-a author -m message [file ...]", true, cmd_commit },
+	{ "log",		"",				true,	cmd_log },
+	{ "show",		"amendment",	true,	cmd_show },
+	{ "checkout",	"file ...",		true,	cmd_checkout },
+	{ "export-patch", "amendment patchfile", true, cmd_export_patch },
+	{ "apply",		"patchfile",	true,	cmd_apply },
+	{ "fsck",		"",				true,	cmd_fsck },
+	{ "stats",		"",				true,	cmd_stats },
+};
+
+#define NCOMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+static char *repo_path = NULL;
+static char *trace_path = NULL;
+static bool show_stats = false;
+
+static void
+usage(void)
+{
+	size_t i;
+
+	fprintf(stderr, "usage: amend [-Svy] [-R repo] [-T trace] command "
+	    "[args]\n");
+	for (i = 0; i < NCOMMANDS; i++)
+		fprintf(stderr, "       amend %s %s\n", commands[i].name,
+		    commands[i].args);
+	exit(2);
+}
+
+static struct repo_file *
+file_named(struct repo *repo, const char *name)
+{
+	word i;
+
+	for (i = 0; i < repo->nfiles; i++) {
+		if (strcmp(repo->files[i]->filename.text, name) == 0)
+			return repo->files[i];
+	}
+
+	warnx("%s: not in repo", name);
+	return NULL;
+}
+
+static struct repo_amendment *
+amendment_with_id(struct repo *repo, const char *str)
+{
+	unsigned long id;
+	char *end;
+	word i;
+
+	id = strtoul(str, &end, 10);
+	if (*str != '\0' && *end == '\0') {
+		for (i = 0; i < repo->namendments; i++) {
+			if (repo->amendments[i]->id == id)
+				return repo->amendments[i];
+		}
+	}
+
+	warnx("%s: no such amendment", str);
+	return NULL;
+}
+
+/*
+ * Fill ids with the named files, or every file if there are no names,
+ * returning how many or -1 if any name isn't in the repo.
+ */
+static int
+select_files(struct repo *repo, int argc, char *argv[], word **ids)
+{
+	struct repo_file *file;
+	int i;
+
+	if (argc == 0) {
+		*ids = xcalloc(repo->nfiles ? repo->nfiles : 1, sizeof(word),
+		    "select_files");
+		for (i = 0; i < repo->nfiles; i++)
+			(*ids)[i] = repo->files[i]->id;
+		return repo->nfiles;
+	}
+
+	*ids = xcalloc(argc, sizeof(word), "select_files");
+	for (i = 0; i < argc; i++) {
+		if ((file = file_named(repo, argv[i])) == NULL) {
+			xfree(ids);
+			return -1;
+		}
+		(*ids)[i] = file->id;
+	}
+	return argc;
+}
+
+/* the selected files that differ from their stored TEXT */
+static int
+changed_files(struct repo *repo, int argc, char *argv[], word **changed)
+{
+	word *ids;
+	int n;
+
+	if ((n = select_files(repo, argc, argv, &ids)) < 0)
+		return -1;
+
+	*changed = xcalloc(n ? n : 1, sizeof(word), "changed_files");
+	n = repo_status(repo, ids, n, *changed);
+	xfree(&ids);
+
+	return n;
+}
+
+size_t
+diff_output(const char *format, ...)
+{
+	char buf[1024], *line = buf;
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	if (format[0] == '%' && format[1] == 'c' && format[2] == '\0') {
+		/* avoid having to vsnprintf just to append 1 character */
+		buf[0] = va_arg(ap, int);
+		len = 1;
+	} else
+		len = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if (len < 0)
+		panic("diff_output: bad format %s", format);
+
+	if (len >= sizeof(buf)) {
+		line = xmalloc(len + 1, "diff_output");
+		va_start(ap, format);
+		vsnprintf(line, len + 1, format, ap);
+		va_end(ap);
+	}
+
+	if (diff_text == NULL) {
+		fwrite(line, 1, len, stdout);
+	} else {
+		if (diff_len + len > GetHandleSize(diff_text))
+			xSetHandleSize(diff_text, (diff_len + len) * 2);
+		memcpy(*diff_text + diff_len, line, len);
+		diff_len += len;
+	}
+
+	if (line != buf)
+		xfree(&line);
+
+	return len;
+}
+
+/* done diffing for this command, let go of diffreg's arena */
+static void
+diff_release(void)
+{
+	progress("diff arena high water %lu bytes",
+	    (unsigned long)diff_arena_high_water());
+	diff_arena_release();
+}
+
+/* called by diffreg just before the -/+ lines of each change are output */
+void
+diff_hunk(char op, long a, long b, long c, long d)
+{
+	struct diff_hunk *hunk;
+
+	if (diff_file == NULL)
+		return;
+
+	if (diff_file->nhunks == diff_file->hunks_size) {
+		diff_file->hunks_size = grow_capacity(diff_file->hunks_size,
+		    diff_file->nhunks + 1, 16);
+		diff_file->hunks = xreallocarray(diff_file->hunks,
+		    diff_file->hunks_size, sizeof(struct diff_hunk));
+	}
+
+	hunk = &diff_file->hunks[diff_file->nhunks++];
+	memset(hunk, 0, sizeof(struct diff_hunk));
+	hunk->op = op;
+	hunk->old_line = a;
+	hunk->old_len = (a > b) ? 0 : b - a + 1;
+	hunk->new_line = c;
+	hunk->new_len = (c > d) ? 0 : d - c + 1;
+	hunk->diff_pos = diff_len;
+}
+
+static int
+cmd_init(struct repo *repo, int argc, char *argv[])
+{
+	FileInfoRecGS fiRec;
+	GSString255 gpath;
+	Str255 path;
+
+	if (argc != 0)
+		usage();
+	if (!console_pstr(&path, repo_path))
+		return 1;
+
+	/* repo_create_path replaces what's there, the Save dialog would ask */
+	gpath.length = path.textLength;
+	memcpy(gpath.text, path.text, path.textLength);
+	if (FStat(&gpath, &fiRec) != fileNotFound) {
+		warnx("%s already exists", repo_path);
+		return 1;
+	}
+
+	repo = repo_create_path(&path);
+	if (repo == NULL)
+		return 1;
+	repo_close(repo);
+
+	return 0;
+}
+
+static int
+cmd_add(struct repo *repo, int argc, char *argv[])
+{
+	Str255 name;
+	int i, ret = 0;
+
+	if (argc == 0)
+		usage();
+
+	for (i = 0; i < argc; i++) {
+		if (strchr(argv[i], PATH_SEP) != NULL) {
+			warnx("%s: files must be in the repo's directory",
+			    argv[i]);
+			ret = 1;
+			continue;
+		}
+		if (!console_pstr(&name, argv[i]) ||
+		    repo_add_file_named(repo, &name) == NULL)
+			ret = 1;
+	}
+
+	return ret;
+}
+
+static int
+cmd_status(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_file *file;
+	word *changed;
+	int i, n;
+
+	if ((n = changed_files(repo, argc, argv, &changed)) < 0)
+		return 1;
+
+	for (i = 0; i < n; i++) {
+		file = repo_file_with_id(repo, changed[i]);
+		if (file != NULL)
+			printf("M\t%s\n", file->filename.text);
+	}
+	xfree(&changed);
+
+	return 0;
+}
+
+static int
+cmd_diff(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_file *file;
+	word *changed;
+	int i, n;
+
+	if ((n = changed_files(repo, argc, argv, &changed)) < 0)
+		return 1;
+
+	for (i = 0; i < n; i++) {
+		file = repo_file_with_id(repo, changed[i]);
+		if (file != NULL)
+			repo_diff_file(repo, file);
+	}
+	xfree(&changed);
+	diff_release();
+
+	return 0;
+}
+
+static int
+cmd_commit(struct repo *repo, int argc, char *argv[])
+{
+	struct diffed_file *diffed_files;
+	struct repo_file *file;
+	char *author = NULL, *message = NULL;
+	Handle log;
+	unsigned long i;
+	word *changed, ndiffed = 0, adds = 0, subs = 0;
+	bool any_text = false, bol;
+	int n;
+
+	while (argc >= 2 && argv[0][0] == '-') {
+		if (strcmp(argv[0], "-a") == 0)
+			author = argv[1];
+		else if (strcmp(argv[0], "-m") == 0)
+			message = argv[1];
+		else
+			usage();
+		argc -= 2;
+		argv += 2;
+	}
+	if (author == NULL || message == NULL || message[0] == '\0')
+		usage();
+	if (strlen(author) >= REPO_AUTHOR_SIZE) {
+		warnx("author must be under %d characters", REPO_AUTHOR_SIZE);
+		return 1;
+	}
+
+	if ((n = changed_files(repo, argc, argv, &changed)) < 0)
+		return 1;
+
+	diffed_files = xcalloc(n ? n : 1, sizeof(struct diffed_file),
+	    "cmd_commit diffed_files");
+	diff_text = xNewHandle(1024);
+	diff_len = 0;
+
+	for (i = 0; i < n; i++) {
+		file = repo_file_with_id(repo, changed[i]);
+		if (file == NULL)
+			continue;
+
+		diff_file = &diffed_files[ndiffed++];
+		diff_file->file = file;
+		diff_file->flags = DIFFED_FILE_METADATA;
+
+		progress("Diffing %s...", file->filename.text);
+		if (repo_diff_file(repo, file)) {
+			diff_file->flags |= DIFFED_FILE_TEXT;
+			any_text = true;
+		}
+	}
+	diff_file = NULL;
+	xfree(&changed);
+	diff_release();
+
+	if (!any_text) {
+		warnx("No changes detected");
+		goto done;
+	}
+
+	/* count the same way the committer window does */
+	for (i = 0, bol = true; i < diff_len; i++) {
+		if (bol && i + 1 < diff_len) {
+			if ((*diff_text)[i] == '-' && (*diff_text)[i + 1] != '-')
+				subs++;
+			else if ((*diff_text)[i] == '+' &&
+			    (*diff_text)[i + 1] != '+')
+				adds++;
+		}
+		bol = ((*diff_text)[i] == EOL_CHAR);
+	}
+
+	log = xNewHandle(strlen(message));
+	memcpy(*log, message, strlen(message));
+
+	repo_amend(repo, diffed_files, ndiffed, adds, subs, author, log,
+	    strlen(message), diff_text, diff_len);
+	DisposeHandle(log);
+
+	printf("amendment %u: %u file%s, +%u -%u\n",
+	    repo->next_amendment_id - 1, repo->amendments[0]->nfiles,
+	    repo->amendments[0]->nfiles == 1 ? "" : "s", adds, subs);
+
+done:
+	for (i = 0; i < ndiffed; i++) {
+		if (diffed_files[i].hunks != NULL)
+			xfree(&diffed_files[i].hunks);
+	}
+	xfree(&diffed_files);
+	DisposeHandle(diff_text);
+	diff_text = NULL;
+
+	return any_text ? 0 : 1;
+}
+
+static int
+cmd_log(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_amendment *amendment;
+	char *buf;
+	size_t len;
+	word i;
+
+	if (argc != 0)
+		usage();
+
+	for (i = 0; i < repo->namendments; i++) {
+		amendment = repo->amendments[i];
+		printf("amendment %u (%u file%s, +%u -%u)\n", amendment->id,
+		    amendment->nfiles, amendment->nfiles == 1 ? "" : "s",
+		    amendment->adds, amendment->subs);
+		len = repo_diff_header(repo, amendment, &buf);
+		fwrite(buf, 1, len, stdout);
+		xfree(&buf);
+	}
+
+	return 0;
+}
+
+static int
+cmd_show(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_amendment *amendment;
+	char *buf;
+	size_t len;
+
+	if (argc != 1)
+		usage();
+	if ((amendment = amendment_with_id(repo, argv[0])) == NULL)
+		return 1;
+
+	len = repo_diff_header(repo, amendment, &buf);
+	fwrite(buf, 1, len, stdout);
+	xfree(&buf);
+
+	len = bile_read_alloc(repo->bile, REPO_DIFF_RTYPE, amendment->id,
+	    &buf);
+	if (len == 0) {
+		warnx("No diff stored for amendment %u", amendment->id);
+		return 1;
+	}
+	fwrite(buf, 1, len, stdout);
+	xfree(&buf);
+
+	return 0;
+}
+
+/* the working copy is kept as file.orig, like the Save dialog would */
+static int
+cmd_checkout(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_file *file;
+	GSString255 path;
+	Str255 name;
+	int i, ret = 0;
+
+	if (argc == 0)
+		usage();
+
+	for (i = 0; i < argc; i++) {
+		if ((file = file_named(repo, argv[i])) == NULL) {
+			ret = 1;
+			continue;
+		}
+		if (file->filename.textLength + 5 > sizeof(name.text) - 1) {
+			warnx("%s: name too long", argv[i]);
+			ret = 1;
+			continue;
+		}
+		memcpy(name.text, file->filename.text,
+		    file->filename.textLength);
+		strcpy(name.text + file->filename.textLength, ".orig");
+		name.textLength = file->filename.textLength + 5;
+		if (getpath(repo->bile->frefnum, &name, &path, true) != 0 ||
+		    path.length > sizeof(name.text) - 1) {
+			warnx("%s: can't find the repo's directory", argv[i]);
+			ret = 1;
+			continue;
+		}
+		memcpy(name.text, path.text, path.length);
+		name.text[path.length] = '\0';
+		name.textLength = path.length;
+
+		if (repo_checkout_file(repo, file, &name) != 0)
+			ret = 1;
+	}
+
+	return ret;
+}
+
+static int
+cmd_export_patch(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_amendment *amendment;
+	Str255 path;
+
+	if (argc != 2)
+		usage();
+	if ((amendment = amendment_with_id(repo, argv[0])) == NULL)
+		return 1;
+	if (!console_pstr(&path, argv[1]))
+		return 1;
+
+	repo_export_patch(repo, amendment, &path);
+
+	return 0;
+}
+
+static int
+cmd_apply(struct repo *repo, int argc, char *argv[])
+{
+	Str255 path;
+
+	if (argc != 1)
+		usage();
+	if (!console_pstr(&path, argv[0]))
+		return 1;
+
+	return patch_process(repo, &path) != 0;
+}
+
+/*
+ * Beyond bile_verify's walk of the map, every amendment needs its AMND
+ * and DIFF and may only name files the repo knows about.
+ */
+static int
+cmd_fsck(struct repo *repo, int argc, char *argv[])
+{
+	struct repo_amendment *amendment;
+	struct bile_object *bob;
+	word i, j, error;
+	int problems = 0;
+
+	if (argc != 0)
+		usage();
+
+	if ((error = bile_verify(repo->bile)) != 0) {
+		warnx("bile_verify failed: %d", error);
+		problems++;
+	}
+
+	for (i = 0; i < repo->namendments; i++) {
+		amendment = repo->amendments[i];
+
+		if ((bob = bile_find(repo->bile, REPO_AMENDMENT_RTYPE,
+		    amendment->id)) == NULL) {
+			warnx("amendment %u: no AMND object", amendment->id);
+			problems++;
+		} else
+			xfree(&bob);
+
+		if ((bob = bile_find(repo->bile, REPO_DIFF_RTYPE,
+		    amendment->id)) == NULL) {
+			warnx("amendment %u: no DIFF object", amendment->id);
+			problems++;
+		} else
+			xfree(&bob);
+
+		for (j = 0; j < amendment->nfiles; j++) {
+			if (repo_file_with_id(repo,
+			    amendment->file_ids[j]) == NULL) {
+				warnx("amendment %u: unknown file id %u",
+				    amendment->id, amendment->file_ids[j]);
+				problems++;
+			}
+		}
+	}
+
+	printf("%u file%s, %u amendment%s, %lu object%s, %d problem%s\n",
+	    repo->nfiles, repo->nfiles == 1 ? "" : "s",
+	    repo->namendments, repo->namendments == 1 ? "" : "s",
+	    (unsigned long)repo->bile->nobjects,
+	    repo->bile->nobjects == 1 ? "" : "s",
+	    problems, problems == 1 ? "" : "s");
+
+	return problems != 0;
+}
+
+static void
+print_stats(struct repo *repo, FILE *fp)
+{
+	char *buf;
+	size_t len;
+
+	len = repo_stats(repo, NULL, 0) + 1;
+	buf = xmalloc(len, "print_stats");
+	repo_stats(repo, buf, len);
+	fputs(buf, fp);
+	xfree(&buf);
+}
+
+static int
+cmd_stats(struct repo *repo, int argc, char *argv[])
+{
+	if (argc != 0)
+		usage();
+
+	print_stats(repo, stdout);
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const struct command *cmd = NULL;
+	struct repo *repo = NULL;
+	Str255 path;
+	size_t i;
+	int ret;
+
+	repo_path = getenv("AMEND_REPO");
+	if (repo_path == NULL || repo_path[0] == '\0')
+		repo_path = AMEND_DEFAULT_REPO;
+
+	for (argc--, argv++; argc > 0 && argv[0][0] == '-'; argc--, argv++) {
+		if (strcmp(argv[0], "-R") == 0 && argc > 1) {
+			repo_path = argv[1];
+			argc--;
+			argv++;
+		} else if (strcmp(argv[0], "-T") == 0 && argc > 1) {
+			trace_path = argv[1];
+			argc--;
+			argv++;
+		} else if (strcmp(argv[0], "-S") == 0)
+			show_stats = true;
+		else if (strcmp(argv[0], "-v") == 0)
+			console_verbose = true;
+		else if (strcmp(argv[0], "-y") == 0)
+			console_assume_yes = true;
+		else
+			usage();
+	}
+	if (argc == 0)
+		usage();
+
+	for (i = 0; i < NCOMMANDS; i++) {
+		if (strcmp(argv[0], commands[i].name) == 0) {
+			cmd = &commands[i];
+			break;
+		}
+	}
+	if (cmd == NULL)
+		usage();
+
+	/* the same unified diffs the committer window makes */
+	diff_format = D_UNIFIED;
+	diff_context = 3;
+
+	if (trace_path != NULL) {
+		if (!console_pstr(&path, trace_path))
+			return 1;
+		if (bile_trace_open(&path) != 0) {
+			warnx("can't write trace %s", trace_path);
+			return 1;
+		}
+	}
+
+	if (cmd->needs_repo) {
+		if (!console_pstr(&path, repo_path))
+			return 1;
+		if ((repo = repo_open_path(&path)) == NULL)
+			return 1;
+	}
+
+	ret = cmd->func(repo, argc - 1, argv + 1);
+
+	if (repo != NULL) {
+		if (show_stats)
+			print_stats(repo, stderr);
+		repo_close(repo);
+	}
+	bile_trace_close();
+
+	/* only say anything in a MALLOC_DEBUG build */
+	if (console_verbose)
+		xmalloc_report();
+	xfree_verify();
+
+	return ret;
+}
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Replay one file's worth of a bile trace (amend -T, or AmendGS.trace
+ * from a BILE_TRACE build on the IIgs) against a copy of the repo it
+ * was taken from, going through bile's own read and write paths so the
+ * view, the block cache and growth all behave as they did:
+ *
+ *   bile_replay [-r rounds] [-f file] trace repo
+ *
+ * The repo should be as it was when the trace started.  Each round works
+ * on a fresh copy of it, repo.replay, and writes zeros where the trace
+ * wrote data, so the copy is garbage afterwards and is removed.  Reads
+ * skip the header check and decompression, which aren't I/O.
+ *
+ * Each result is a line of JSON, one per op with how long it took when
+ * traced and when replayed, and then the totals.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <types.h>
+#include <memory.h>
+#include <gsos.h>
+
+#include "../bile.h"
+#include "../bile_private.h"
+#include "../util.h"
+#include "console.h"
+
+#define REPLAY_SUFFIX	".replay"
+
+struct record {
+	unsigned char op;
+	unsigned char file;
+	unsigned long pos;
+	unsigned long len;
+	unsigned long ticks;
+};
+
+struct op_total {
+	const char *name;
+	unsigned long count;
+	unsigned long bytes;
+	double traced;
+	double replayed;
+};
+
+static struct op_total totals[] = {
+	{ "none" },
+	{ "open" },
+	{ "close" },
+	{ "read" },
+	{ "write" },
+	{ "seek" },
+	{ "flush" },
+	{ "map" },
+};
+
+static struct record *records;
+static size_t nrecords;
+static unsigned long hz;
+static unsigned char *scratch;
+
+static void
+load_trace(const char *path, int file)
+{
+	unsigned char header[BILE_TRACE_HEADER_LEN];
+	unsigned char buf[BILE_TRACE_RECORD_SIZE];
+	struct record *record;
+	size_t cap = 0, max = 0;
+	FILE *fp;
+
+	if ((fp = fopen(path, "rb")) == NULL)
+		panic("can't read %s", path);
+	if (fread(header, sizeof(header), 1, fp) != 1 ||
+	    memcmp(header, BILE_TRACE_MAGIC, BILE_TRACE_MAGIC_LEN) != 0)
+		panic("%s: not a bile trace", path);
+	hz = bile_get_long(header + BILE_TRACE_MAGIC_LEN);
+	if (hz == 0)
+		panic("%s: bogus clock rate", path);
+
+	while (fread(buf, sizeof(buf), 1, fp) == 1) {
+		if (buf[0] == 0 || buf[0] >= nitems(totals))
+			panic("%s: bad op %d in record %lu", path, buf[0],
+			    (unsigned long)nrecords);
+		if (buf[1] != file)
+			continue;
+		if (nrecords == cap) {
+			cap = grow_capacity(cap, nrecords + 1, 256);
+			records = xreallocarray(records, cap,
+			    sizeof(struct record));
+		}
+		record = &records[nrecords++];
+		record->op = buf[0];
+		record->file = buf[1];
+		record->pos = bile_get_long(buf + 2);
+		record->len = bile_get_long(buf + 6);
+		record->ticks = bile_get_long(buf + 10);
+		if (record->op != BILE_TRACE_OPEN &&
+		    record->op != BILE_TRACE_CLOSE && record->len > max)
+			max = record->len;
+	}
+	fclose(fp);
+
+	if (nrecords == 0)
+		panic("%s: nothing traced for file %d", path, file);
+
+	scratch = xmalloczero(BILE_OBJECT_SIZE + max + 1, "bile_replay");
+}
+
+static void
+copy_repo(const char *from, const char *to)
+{
+	char buf[BUFSIZ];
+	FILE *in, *out;
+	size_t len;
+
+	if ((in = fopen(from, "rb")) == NULL)
+		panic("can't read %s", from);
+	if ((out = fopen(to, "wb")) == NULL)
+		panic("can't write %s", to);
+	while ((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+		if (fwrite(buf, 1, len, out) != len)
+			panic("short write to %s", to);
+	}
+	fclose(in);
+	fclose(out);
+}
+
+/* the I/O of bile_read_stored, without checking what it read */
+static word
+replay_read(struct bile *bile, const struct record *record)
+{
+	const unsigned char *view;
+	word error;
+
+	view = bile_view_at(bile, record->pos,
+	    BILE_OBJECT_SIZE + record->len);
+	if (view != NULL) {
+		memcpy(scratch, view + BILE_OBJECT_SIZE, record->len);
+		return 0;
+	}
+
+	error = bile_cache_read(bile, record->pos, scratch, BILE_OBJECT_SIZE);
+	if (error || record->len == 0)
+		return error;
+	return bile_cache_read(bile, record->pos + BILE_OBJECT_SIZE, scratch,
+	    record->len);
+}
+
+static int
+replay(const char *copy, int round)
+{
+	struct record *record;
+	struct bile *bile = NULL;
+	Str255 path;
+	double start;
+	size_t n;
+	int errors = 0;
+	word error;
+
+	if (!console_pstr(&path, copy))
+		exit(1);
+	for (n = 0; n < nrecords; n++) {
+		record = &records[n];
+		error = 0;
+
+		/* whatever came before the trace saw it opened */
+		if (bile == NULL && record->op != BILE_TRACE_OPEN)
+			continue;
+
+		start = console_now();
+		switch (record->op) {
+		case BILE_TRACE_OPEN:
+			if (bile != NULL)
+				panic("record %lu: opened twice",
+				    (unsigned long)n);
+			if ((bile = bile_open(&path)) == NULL) {
+				error = bile_error(NULL);
+				break;
+			}
+			if (round == 0 && bile->file_size != record->len)
+				warnx("%s is %lu bytes, traced file was %lu",
+				    copy, (unsigned long)bile->file_size,
+				    record->len);
+			break;
+		case BILE_TRACE_CLOSE:
+			bile_close(bile);
+			xfree(&bile);
+			break;
+		case BILE_TRACE_READ:
+			error = replay_read(bile, record);
+			break;
+		case BILE_TRACE_WRITE:
+			if (bile_xwriteat(bile, record->pos, scratch,
+			    record->len) != record->len)
+				error = bile_error(bile);
+			break;
+		case BILE_TRACE_FLUSH:
+			error = bile_flush(bile, false);
+			break;
+		default:
+			/* seeks and map rewrites come again with the rest */
+			break;
+		}
+		totals[record->op].replayed += console_now() - start;
+
+		if (error) {
+			if (round == 0)
+				warnx("record %lu: %s at %lu: error %d",
+				    (unsigned long)n, totals[record->op].name,
+				    record->pos, error);
+			errors++;
+		}
+	}
+	if (bile != NULL) {
+		bile_close(bile);
+		xfree(&bile);
+	}
+
+	return errors;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: bile_replay [-r rounds] [-f file] trace "
+	    "repo\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char copy[256];
+	struct op_total *total;
+	struct record *record;
+	double traced = 0, replayed = 0;
+	size_t n;
+	int rounds = 5, file = 1, errors = 0, r;
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	while (argc > 0 && argv[0][0] == '-') {
+		if (argc < 2)
+			usage();
+		if (strcmp(argv[0], "-r") == 0)
+			rounds = atoi(argv[1]);
+		else if (strcmp(argv[0], "-f") == 0)
+			file = atoi(argv[1]);
+		else
+			usage();
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc != 2)
+		usage();
+	if (rounds < 1)
+		rounds = 1;
+	if (file < 1 || file > BILE_TRACE_MAX_FILES)
+		usage();
+
+	load_trace(argv[0], file);
+	snprintf(copy, sizeof(copy), "%s" REPLAY_SUFFIX, argv[1]);
+
+	printf("{\"params\": {\"trace\": \"%s\", \"repo\": \"%s\", "
+	    "\"file\": %d, \"records\": %lu, \"clock_hz\": %lu, "
+	    "\"rounds\": %d}}\n", argv[0], argv[1], file,
+	    (unsigned long)nrecords, hz, rounds);
+
+	for (n = 0; n < nrecords; n++) {
+		record = &records[n];
+		total = &totals[record->op];
+		total->count++;
+		if (record->op != BILE_TRACE_OPEN &&
+		    record->op != BILE_TRACE_CLOSE)
+			total->bytes += record->len;
+		total->traced += (double)record->ticks / hz;
+	}
+
+	for (r = 0; r < rounds; r++) {
+		copy_repo(argv[1], copy);
+		errors += replay(copy, r);
+	}
+	remove(copy);
+
+	for (n = 1; n < nitems(totals); n++) {
+		total = &totals[n];
+		if (total->count == 0)
+			continue;
+		printf("{\"op\": \"%s\", \"count\": %lu, \"bytes\": %lu, "
+		    "\"traced_secs\": %.6f, \"replay_secs\": %.6f, "
+		    "\"replay_usecs_per_op\": %.2f}\n", total->name,
+		    total->count, total->bytes, total->traced,
+		    total->replayed / rounds,
+		    total->replayed * 1e6 / rounds / total->count);
+		/* map spans its own writes and flushes, seeks are inside */
+		if (n != BILE_TRACE_MAP && n != BILE_TRACE_SEEK) {
+			traced += total->traced;
+			replayed += total->replayed / rounds;
+		}
+	}
+	printf("{\"op\": \"total\", \"traced_secs\": %.6f, "
+	    "\"replay_secs\": %.6f, \"errors\": %d}\n", traced, replayed,
+	    errors);
+
+	return (errors != 0);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Console versions of the alert and progress functions util.c gives the
+ * IIgs, for host programs linking the repo core.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <types.h>
+
+#include "../util.h"
+#include "console.h"
+
+bool console_verbose = false;
+bool console_assume_yes = false;
+bool console_quiet = false;
+
+void
+vwarn(word alert_func, const char *format, va_list ap)
+{
+	if (console_quiet && alert_func != STOP_ALERT)
+		return;
+
+	switch (alert_func) {
+	case STOP_ALERT:
+		fputs("error: ", stderr);
+		break;
+	case CAUTION_ALERT:
+		fputs("warning: ", stderr);
+		break;
+	}
+	vfprintf(stderr, format, ap);
+	fputc('\n', stderr);
+}
+
+void
+ExitToShell(void)
+{
+	exit(1);
+}
+
+word
+ask(const char *format, ...)
+{
+	char answer[16];
+	va_list ap;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+
+	if (console_assume_yes) {
+		fputs(" [y/N] y\n", stderr);
+		return 1;
+	}
+
+	fputs(" [y/N] ", stderr);
+	fflush(stderr);
+	if (fgets(answer, sizeof(answer), stdin) == NULL)
+		return 0;
+
+	return (answer[0] == 'y' || answer[0] == 'Y');
+}
+
+void
+progress(char *format, ...)
+{
+	va_list ap;
+
+	if (format == NULL || !console_verbose)
+		return;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+}
+
+bool
+console_pstr(Str255 *ret, const char *str)
+{
+	size_t len = strlen(str);
+
+	if (len > sizeof(ret->text) - 1) {
+		warnx("%s: name too long", str);
+		return false;
+	}
+	memcpy(ret->text, str, len + 1);
+	ret->textLength = len;
+	return true;
+}
+
+double
+console_now(void)
+{
+	struct timespec ts;
+
+	timespec_get(&ts, TIME_UTC);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
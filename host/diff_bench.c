@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Run diffreg over the file pairs in diff_corpus, case.old against
+ * case.new, timing each of its steps through the DIFF_PHASE marks (named
+ * for their stats timers) and noting how much of the diff arena is in use
+ * at the end of each:
+ *
+ *   small_edit   a dozen scattered changes to a source file
+ *   rewrite      most blocks replaced, the rest shuffled
+ *   repeated     a handful of distinct lines, thousands of times
+ *   long_lines   lines of a few thousand bytes, a few edited
+ *   crlf_mix     CR/LF lines against half of them turned into LF
+ *
+ *   diff_bench [-r rounds] [-c corpus] [case ...]
+ *
+ * Each result is a line of JSON, one per case and step and then one for
+ * the whole diffreg with the arena's high water mark.  Steps that
+ * don't run for a case, like dump_unified_vec when nothing differs,
+ * are left out.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void diff_phase(int);
+#define DIFF_PHASE_START()	diff_phase(-1)
+#define DIFF_PHASE(timer)	diff_phase(timer)
+
+#include "../diffreg.c"
+#include "console.h"
+
+#define CORPUS_DIR	"diff_corpus"
+
+/* needed by diffreg */
+struct stat stb1, stb2;
+long diff_format = D_UNIFIED, diff_context = 3, status = 0;
+char *ifdefname, *diffargs, *label[2], *ignore_pats;
+
+/* indexed by the step's stats timer */
+struct phase {
+	unsigned long calls;
+	double secs;
+	size_t arena;
+};
+
+static struct phase phases[STAT_NTIMERS];
+static double mark;
+static unsigned long diff_len;
+
+static const char *default_cases[] = { "small_edit", "rewrite", "repeated",
+    "long_lines", "crlf_mix" };
+
+/* charge the time since the last mark to timer, -1 just marks */
+static void
+diff_phase(int timer)
+{
+	struct phase *phase;
+	double t;
+
+	t = console_now();
+	if (timer >= 0) {
+		phase = &phases[timer];
+		phase->calls++;
+		phase->secs += t - mark;
+		if (diff_arena.used > phase->arena)
+			phase->arena = diff_arena.used;
+	}
+	mark = t;
+}
+
+/* counted, not kept */
+size_t
+diff_output(const char *format, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(NULL, 0, format, ap);
+	va_end(ap);
+	if (len < 0)
+		panic("diff_output: bad format %s", format);
+	diff_len += len;
+	return len;
+}
+
+void
+diff_hunk(char op, long a, long b, long c, long d)
+{
+}
+
+static long
+file_size(const char *path)
+{
+	FILE *fp;
+	long size;
+
+	if ((fp = fopen(path, "rb")) == NULL)
+		return -1;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fclose(fp);
+	return size;
+}
+
+static int
+run(const char *corpus, const char *name, int rounds)
+{
+	Str255 old_path, new_path;
+	char buf[256];
+	unsigned long bytes;
+	long old_size, new_size;
+	double secs = 0, start;
+	int r, n, bad = 0;
+
+	snprintf(buf, sizeof(buf), "%s" PATH_SEP_STR "%s.old", corpus, name);
+	if (!console_pstr(&old_path, buf))
+		exit(1);
+	if ((old_size = file_size(buf)) < 0) {
+		warnx("can't read %s", buf);
+		return 1;
+	}
+	snprintf(buf, sizeof(buf), "%s" PATH_SEP_STR "%s.new", corpus, name);
+	if (!console_pstr(&new_path, buf))
+		exit(1);
+	if ((new_size = file_size(buf)) < 0) {
+		warnx("can't read %s", buf);
+		return 1;
+	}
+	bytes = old_size + new_size;
+
+	memset(phases, 0, sizeof(phases));
+	diff_arena_release();
+	for (r = 0; r < rounds; r++) {
+		diff_len = 0;
+		start = console_now();
+		if (diffreg(&old_path, &new_path, D_PROTOTYPE) != D_DIFFER)
+			bad++;
+		secs += console_now() - start;
+	}
+
+	for (n = STAT_TIME_DIFF_OPEN; n <= STAT_TIME_DIFF_DUMP; n++) {
+		if (phases[n].calls == 0)
+			continue;
+		printf("{\"case\": \"%s\", \"phase\": \"%s\", \"secs\": %.6f, "
+		    "\"usecs_per_diff\": %.1f, \"share\": %.3f, "
+		    "\"arena_bytes\": %lu}\n", name, stats_timer_name(n),
+		    phases[n].secs, phases[n].secs * 1e6 / rounds,
+		    secs > 0 ? phases[n].secs / secs : 0,
+		    (unsigned long)phases[n].arena);
+	}
+	printf("{\"case\": \"%s\", \"phase\": \"diffreg\", \"ops\": %d, "
+	    "\"bytes\": %lu, \"secs\": %.6f, \"ops_per_sec\": %.1f, "
+	    "\"bytes_per_sec\": %.1f, \"diff_bytes\": %lu, "
+	    "\"arena_high\": %lu, \"errors\": %d}\n", name, rounds,
+	    bytes * rounds, secs, secs > 0 ? rounds / secs : 0,
+	    secs > 0 ? bytes * rounds / secs : 0, diff_len,
+	    (unsigned long)diff_arena_high_water(), bad);
+	fflush(stdout);
+	diff_arena_release();
+
+	return bad;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: diff_bench [-r rounds] [-c corpus] "
+	    "[case ...]\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *corpus = CORPUS_DIR;
+	int rounds = 20, bad = 0, n;
+
+	/* labels keep print_header from calling ctime on the empty stbs */
+	label[0] = "old";
+	label[1] = "new";
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	while (argc > 0 && argv[0][0] == '-') {
+		if (argc < 2)
+			usage();
+		if (strcmp(argv[0], "-r") == 0)
+			rounds = atoi(argv[1]);
+		else if (strcmp(argv[0], "-c") == 0)
+			corpus = argv[1];
+		else
+			usage();
+		argc -= 2;
+		argv += 2;
+	}
+	if (rounds < 1)
+		rounds = 1;
+
+	printf("{\"params\": {\"corpus\": \"%s\", \"rounds\": %d}}\n", corpus,
+	    rounds);
+
+	if (argc > 0) {
+		for (n = 0; n < argc; n++)
+			bad += run(corpus, argv[n], rounds);
+	} else {
+		for (n = 0; n < (int)nitems(default_cases); n++)
+			bad += run(corpus, default_cases[n], rounds);
+	}
+
+	return (bad != 0);
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * What the fuzz targets share.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../bile_private.h"
+#include "../util.h"
+#include "../diff.h"
+#include "console.h"
+#include "fuzz.h"
+
+/* needed by diffreg, which comes along with repo.c but never runs */
+struct stat stb1, stb2;
+long diff_format, diff_context, status = 0;
+char *ifdefname, *diffargs, *label[2], *ignore_pats;
+
+static char fuzz_path[256];
+
+static void
+fuzz_cleanup(void)
+{
+	if (fuzz_path[0] != '\0')
+		remove(fuzz_path);
+}
+
+void
+fuzz_init(void)
+{
+	const char *tmpdir;
+
+	if (fuzz_path[0] != '\0')
+		return;
+
+	console_quiet = true;
+
+	/* libFuzzer's -jobs run side by side, each wants its own file */
+	if ((tmpdir = getenv("TMPDIR")) == NULL || tmpdir[0] == '\0')
+		tmpdir = "/tmp";
+	snprintf(fuzz_path, sizeof(fuzz_path), "%s/fuzz.%ld.bile", tmpdir,
+	    (long)getpid());
+	atexit(fuzz_cleanup);
+}
+
+size_t
+diff_output(const char *format, ...)
+{
+	return 0;
+}
+
+void
+diff_hunk(char op, long a, long b, long c, long d)
+{
+}
+
+struct bile *
+fuzz_bile_open(const uint8_t *data, size_t size, bool recover_map)
+{
+	Str255 path;
+	FILE *fp;
+
+	fuzz_init();
+
+	if ((fp = fopen(fuzz_path, "wb")) == NULL)
+		panic("can't write %s", fuzz_path);
+	if (size > 0 && fwrite(data, size, 1, fp) != 1)
+		panic("short write to %s", fuzz_path);
+	fclose(fp);
+
+	if (!console_pstr(&path, fuzz_path))
+		panic("%s: name too long", fuzz_path);
+
+	if (recover_map)
+		return bile_open_recover_map(&path);
+	return bile_open(&path);
+}
+
+struct repo *
+fuzz_repo_new(void)
+{
+	struct bile *bile;
+
+	fuzz_init();
+
+	bile = xmalloczero(sizeof(struct bile), "fuzz bile");
+	memcpy(bile->magic, BILE_MAGIC, sizeof(bile->magic));
+
+	return repo_alloc(bile);
+}
+
+struct repo *
+fuzz_repo_holding(unsigned long type, unsigned long id, const uint8_t *data,
+    size_t size)
+{
+	struct bile *bile;
+	Str255 path;
+	size_t len, wrote;
+
+	fuzz_init();
+
+	if (!console_pstr(&path, fuzz_path))
+		panic("%s: name too long", fuzz_path);
+	remove(fuzz_path);
+	if ((bile = bile_create(&path, AMEND_CREATOR, REPO_TYPE)) == NULL)
+		panic("can't create %s: %d", fuzz_path, bile_error(NULL));
+
+	if (size < 2)
+		return repo_alloc(bile);
+
+	len = size - 1;
+	switch (data[0]) {
+	case FUZZ_STORE_COMPRESSED:
+		wrote = bile_write_compressed(bile, type, id, data + 1, len);
+		break;
+	case FUZZ_STORE_RAW_COMPRESSED:
+		wrote = bile_write_stored(bile, type, id, data + 1, len,
+		    BILE_OBJECT_COMPRESSED);
+		break;
+	default:
+		wrote = bile_write(bile, type, id, data + 1, len);
+		break;
+	}
+	if (wrote != len)
+		panic("can't write to %s: %d", fuzz_path, bile_error(bile));
+
+	return repo_alloc(bile);
+}
+
+/* repo_close without the bile, which was never opened */
+void
+fuzz_repo_free(struct repo *repo)
+{
+	repo_free_records(repo);
+	xfree(&repo->bile);
+	xfree(&repo);
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __FUZZ_H__
+#define __FUZZ_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <types.h>
+
+#include "../bile.h"
+#include "../repo.h"
+
+/*
+ * Each fuzz_*.c is one target, built either against libFuzzer (make fuzz
+ * CC=clang) or against fuzz_main.c, which runs it over files and
+ * directories the way libFuzzer runs a corpus.  Every input has to come
+ * back without a panic, a crash or a leak.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* quiet the warnings junk input sets off, once per process */
+void fuzz_init(void);
+
+/*
+ * write the input out to a scratch file and bile_open that, or
+ * bile_open_recover_map
+ */
+struct bile *fuzz_bile_open(const uint8_t *data, size_t size,
+    bool recover_map);
+
+/* a repo with just enough to it for the parsers, no file behind it */
+struct repo *fuzz_repo_new(void);
+void fuzz_repo_free(struct repo *repo);
+
+/*
+ * a repo on a fresh scratch file holding the rest of the input as
+ * type:id, stored as its first byte says, for the loaders that read
+ * through the bile; nothing is written for less than two bytes, and it
+ * goes with repo_close
+ */
+#define FUZZ_STORE_PLAIN		0
+#define FUZZ_STORE_COMPRESSED		1
+/* the rest is taken as lz output, header and all */
+#define FUZZ_STORE_RAW_COMPRESSED	2
+struct repo *fuzz_repo_holding(unsigned long type, unsigned long id,
+    const uint8_t *data, size_t size);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * bile_open over arbitrary files, which gets as far as bile_read_map when
+ * the magic is right, and again through the old map pointer.  Whatever
+ * map is loaded has to have every object within the file.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+static void
+check_map(struct bile *bile)
+{
+	struct bile_object *o;
+	size_t n;
+
+	for (n = 0; n < bile->nobjects; n++) {
+		o = &bile->map[n];
+		if (o->pos < BILE_HEADER_LEN || o->pos > bile->file_size ||
+		    BILE_OBJECT_SIZE + BILE_OBJECT_LEN(o) >
+		    bile->file_size - o->pos)
+			abort();
+	}
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct bile *bile;
+	int recover;
+
+	for (recover = 0; recover <= 1; recover++) {
+		if ((bile = fuzz_bile_open(data, size, recover)) == NULL)
+			continue;
+		check_map(bile);
+		bile_close(bile);
+		xfree(&bile);
+	}
+
+	return 0;
+}
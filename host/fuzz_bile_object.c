@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Every object of whatever bile_open makes of the input, read through
+ * bile_object_size and bile_read_object as bile_read_alloc would, then
+ * through bile_object_data, and the whole file through bile_verify.
+ * Compressed objects go through lz_decompress.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct bile *bile;
+	struct bile_object *o;
+	const void *stored;
+	char *buf, *copy;
+	size_t n, len;
+
+	if ((bile = fuzz_bile_open(data, size, false)) == NULL)
+		return 0;
+
+	for (n = 0; n < bile->nobjects; n++) {
+		o = &bile->map[n];
+
+		len = bile_object_size(bile, o);
+		if (len != 0) {
+			buf = xmalloczero(len, "fuzz_bile_object");
+			bile_read_object(bile, o, buf, len);
+			xfree(&buf);
+		}
+
+		if (BILE_OBJECT_LEN(o) == 0)
+			continue;
+		stored = bile_object_data(bile, o, &copy);
+		if (stored != NULL && copy != NULL && stored != copy)
+			abort();
+		if (copy != NULL)
+			xfree(&copy);
+	}
+
+	bile_verify(bile);
+
+	bile_close(bile);
+	xfree(&bile);
+
+	return 0;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * A stand-in for libFuzzer's driver, for compilers without it:
+ *
+ *   fuzz_<target> [-m mutants] [-s seed] [-o crash] file|dir ...
+ *
+ * Each file, or each file in a directory, is run through the target as
+ * it is and then as mutants more of itself, each with a few bytes
+ * flipped, set to edge values, dropped or repeated, or cut short.  It
+ * isn't coverage-guided, but from a corpus of real repos it gets well
+ * past the magic and into the maps and objects.
+ *
+ * If an input takes the process down, through a panic, a crash or a
+ * failed check in the target, it is saved to the crash file (crash-input
+ * by default) to be fed back in on its own.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+ * Not fuzz.h, util.h's stand-ins for struct stat and the u_int types
+ * clash with the system's; this is all of it that's needed
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+void fuzz_init(void);
+
+#define nitems(what)	(sizeof((what)) / sizeof((what)[0]))
+
+/* how big a mutant may grow past its input */
+#define FUZZ_GROW	64
+
+static const char *crash_path = "crash-input";
+static unsigned long rng = 1;
+static const uint8_t *running;
+static size_t running_size;
+static unsigned long inputs, mutants;
+
+static void
+fail(const char *format, ...)
+{
+	va_list ap;
+
+	fputs("fuzz: ", stderr);
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	exit(1);
+}
+
+static unsigned long
+fuzz_random(void)
+{
+	rng ^= rng << 13;
+	rng ^= (rng & 0xffffffffUL) >> 17;
+	rng ^= rng << 5;
+	rng &= 0xffffffffUL;
+	return rng;
+}
+
+static void
+save_crash(void)
+{
+	FILE *fp;
+
+	if (running == NULL)
+		return;
+	if ((fp = fopen(crash_path, "wb")) == NULL)
+		return;
+	fwrite(running, 1, running_size, fp);
+	fclose(fp);
+	fprintf(stderr, "fuzz: %lu byte input saved to %s\n",
+	    (unsigned long)running_size, crash_path);
+	running = NULL;
+}
+
+static void
+crashed(int sig)
+{
+	/* and if saving it falls over too, just go */
+	signal(SIGSEGV, SIG_DFL);
+	signal(SIGABRT, SIG_DFL);
+	signal(SIGFPE, SIG_DFL);
+	signal(SIGILL, SIG_DFL);
+	save_crash();
+	raise(sig);
+}
+
+/* in a buffer of exactly size, so reading past it shows up under ASan */
+static void
+run(const uint8_t *data, size_t size)
+{
+	uint8_t *input;
+
+	if ((input = malloc(size ? size : 1)) == NULL)
+		fail("out of memory");
+	memcpy(input, data, size);
+	running = input;
+	running_size = size;
+	LLVMFuzzerTestOneInput(input, size);
+	running = NULL;
+	free(input);
+}
+
+static size_t
+mutate(uint8_t *buf, size_t size, size_t cap)
+{
+	static const uint8_t edges[] = { 0x00, 0x01, 0x7f, 0x80, 0xfe, 0xff };
+	size_t pos, n, count;
+
+	count = 1 + fuzz_random() % 8;
+	for (n = 0; n < count; n++) {
+		if (size == 0) {
+			buf[size++] = fuzz_random();
+			continue;
+		}
+		pos = fuzz_random() % size;
+		switch (fuzz_random() % 6) {
+		case 0:
+			buf[pos] ^= 1 << (fuzz_random() % 8);
+			break;
+		case 1:
+			buf[pos] = edges[fuzz_random() % nitems(edges)];
+			break;
+		case 2:
+			buf[pos] = fuzz_random();
+			break;
+		case 3:
+			/* drop a byte */
+			memmove(buf + pos, buf + pos + 1, size - pos - 1);
+			size--;
+			break;
+		case 4:
+			/* repeat one */
+			if (size < cap) {
+				memmove(buf + pos + 1, buf + pos, size - pos);
+				size++;
+			}
+			break;
+		case 5:
+			/* cut it short, rarely, or little else gets tested */
+			if (fuzz_random() % 4 == 0)
+				size = pos;
+			break;
+		}
+	}
+
+	return size;
+}
+
+static void
+run_file(const char *path, unsigned long nmutants)
+{
+	uint8_t *data, *buf;
+	unsigned long n;
+	size_t size, cap;
+	long len;
+	FILE *fp;
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		fprintf(stderr, "fuzz: can't read %s\n", path);
+		return;
+	}
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if (len < 0)
+		fail("%s: can't size it", path);
+	size = len;
+	cap = size + FUZZ_GROW;
+
+	if ((data = malloc(size ? size : 1)) == NULL ||
+	    (buf = malloc(cap)) == NULL)
+		fail("out of memory");
+	if (size > 0 && fread(data, size, 1, fp) != 1)
+		fail("%s: short read", path);
+	fclose(fp);
+
+	run(data, size);
+	inputs++;
+
+	for (n = 0; n < nmutants; n++) {
+		memcpy(buf, data, size);
+		len = mutate(buf, size, cap);
+		run(buf, len);
+		mutants++;
+	}
+
+	free(buf);
+	free(data);
+}
+
+static void
+run_path(const char *path, unsigned long nmutants)
+{
+	char file[1024];
+	struct dirent *ent;
+	struct stat sb;
+	DIR *dir;
+
+	if (stat(path, &sb) != 0) {
+		fprintf(stderr, "fuzz: can't find %s\n", path);
+		return;
+	}
+	if (!S_ISDIR(sb.st_mode)) {
+		run_file(path, nmutants);
+		return;
+	}
+
+	/* a corpus directory, flat as libFuzzer keeps them */
+	if ((dir = opendir(path)) == NULL) {
+		fprintf(stderr, "fuzz: can't read %s\n", path);
+		return;
+	}
+	while ((ent = readdir(dir)) != NULL) {
+		if (ent->d_name[0] == '.')
+			continue;
+		snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+		if (stat(file, &sb) == 0 && S_ISREG(sb.st_mode))
+			run_file(file, nmutants);
+	}
+	closedir(dir);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: fuzz_target [-m mutants] [-s seed] "
+	    "[-o crash] file|dir ...\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned long nmutants = 0;
+	int n;
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	while (argc > 0 && argv[0][0] == '-') {
+		if (argc < 2)
+			usage();
+		if (strcmp(argv[0], "-m") == 0)
+			nmutants = strtoul(argv[1], NULL, 10);
+		else if (strcmp(argv[0], "-s") == 0)
+			rng = strtoul(argv[1], NULL, 10);
+		else if (strcmp(argv[0], "-o") == 0)
+			crash_path = argv[1];
+		else
+			usage();
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc < 1)
+		usage();
+	if ((rng &= 0xffffffffUL) == 0)
+		rng = 1;
+
+	fuzz_init();
+
+	/* panic exits, anything worse is a signal */
+	atexit(save_crash);
+	signal(SIGSEGV, crashed);
+	signal(SIGABRT, crashed);
+	signal(SIGFPE, crashed);
+	signal(SIGILL, crashed);
+
+	for (n = 0; n < argc; n++)
+		run_path(argv[n], nmutants);
+
+	fprintf(stderr, "fuzz: %lu inputs, %lu mutants, no crashes\n",
+	    inputs, mutants);
+
+	return 0;
+}
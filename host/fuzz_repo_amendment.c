@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_parse_amendment over arbitrary AMND object data, along with the
+ * repo_log_offset that repo_amendment_log reads the log through.  An
+ * amendment it accepts has to have its file ids and log within the data.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+/* repo.c keeps it to itself */
+size_t repo_log_offset(const unsigned char *data, size_t size);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct repo_amendment *amendment;
+	size_t pos;
+
+	repo = fuzz_repo_new();
+
+	pos = repo_log_offset(data, size);
+	if (pos != 0 && pos + 2 > size)
+		abort();
+
+	amendment = repo_parse_amendment(repo, 1, data, size);
+	if (amendment == NULL) {
+		if (repo->bile->last_error != BILE_ERR_BOGUS_OBJECT)
+			abort();
+	} else if (pos == 0 ||
+	    4 + 1 + data[4] + 2 + amendment->nfiles * 2 + 2 + 2 != pos ||
+	    amendment->log_len > size - pos - 2 ||
+	    strlen(amendment->author) > REPO_AUTHOR_SIZE - 1)
+		abort();
+
+	fuzz_repo_free(repo);
+
+	return 0;
+}
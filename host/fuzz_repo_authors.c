@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_load_authors over an arbitrary AUTH object.  Whatever it takes in
+ * has to fit an author, and when it says it loaded them all there have
+ * to be as many as the object counts.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+/* repo.c keeps it to itself */
+bool repo_load_authors(struct repo *repo);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	word count, i;
+
+	repo = fuzz_repo_holding(REPO_AUTHORS_RTYPE, 1, data, size);
+
+	/* only a plain store leaves the count where it can be seen */
+	if (repo_load_authors(repo) && data[0] == FUZZ_STORE_PLAIN) {
+		memcpy(&count, data + 1, sizeof(word));
+		if (repo->nauthors != count)
+			abort();
+	}
+	for (i = 0; i < repo->nauthors; i++) {
+		if (strlen(repo->authors[i]) > REPO_AUTHOR_SIZE - 1)
+			abort();
+	}
+
+	repo_close(repo);
+
+	return 0;
+}
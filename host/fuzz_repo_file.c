@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_parse_file over arbitrary FILE object data.  What it accepts has
+ * to be a filename that fits, and anything it refuses has to say so in
+ * the bile's error.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct repo_file *file;
+
+	repo = fuzz_repo_new();
+
+	file = repo_parse_file(repo, 1, data, size);
+	if (file == NULL) {
+		if (repo->bile->last_error != BILE_ERR_BOGUS_OBJECT)
+			abort();
+	} else if (file->filename.textLength >= sizeof(file->filename.text) ||
+	    strlen(file->filename.text) > file->filename.textLength ||
+	    file->sort_key == NULL)
+		abort();
+
+	fuzz_repo_free(repo);
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_file_hunks over an arbitrary HUNK object, for the first few file
+ * ids.  What it hands back has to be there, and there has to be some of
+ * it when it says there is.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+#define FUZZ_HUNK_FILES	4
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct diff_hunk *hunks;
+	word nhunks, file_id;
+
+	repo = fuzz_repo_holding(REPO_HUNK_RTYPE, 1, data, size);
+
+	for (file_id = 0; file_id < FUZZ_HUNK_FILES; file_id++) {
+		if (repo_file_hunks(repo, 1, file_id, &hunks, &nhunks)) {
+			if (hunks == NULL || nhunks == 0)
+				abort();
+			xfree(&hunks);
+		} else if (hunks != NULL || nhunks != 0)
+			abort();
+	}
+
+	repo_close(repo);
+
+	return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_file_postings over an arbitrary POST object for file 1 of a repo
+ * whose amendments 3 and 1 touch it.  Whatever it loads, or rebuilds
+ * when it won't take the object, has to be newest first and below
+ * next_amendment_id.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+#define FUZZ_POSTINGS_NEXT_ID	64
+
+static word touched[] = { 1 };
+static word untouched[] = { 2 };
+
+static void
+add_amendment(struct repo *repo, word id, word *file_ids)
+{
+	struct repo_amendment *amendment;
+
+	amendment = pool_alloc(&repo->amendment_pool);
+	amendment->id = id;
+	amendment->author = "";
+	amendment->nfiles = 1;
+	amendment->file_ids = file_ids;
+	repo->amendments[repo->namendments++] = amendment;
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct repo_file *file;
+	word count, i;
+
+	repo = fuzz_repo_holding(REPO_POSTING_RTYPE, 1, data, size);
+	repo->next_amendment_id = FUZZ_POSTINGS_NEXT_ID;
+
+	file = pool_alloc(&repo->file_pool);
+	file->id = 1;
+	repo->files = xcalloc(1, sizeof(struct repo_file *), "fuzz files");
+	repo->files[repo->nfiles++] = file;
+
+	/* newest first, as repo_load_summary leaves them */
+	repo->amendments = xcalloc(3, sizeof(Ptr), "fuzz amendments");
+	add_amendment(repo, 3, touched);
+	add_amendment(repo, 2, untouched);
+	add_amendment(repo, 1, touched);
+
+	count = repo_file_postings(repo, file);
+	if (count != file->npostings || !file->postings_loaded ||
+	    (count != 0 && file->postings == NULL))
+		abort();
+	for (i = 0; i < count; i++) {
+		if (file->postings[i] >= repo->next_amendment_id ||
+		    (i > 0 && file->postings[i] >= file->postings[i - 1]))
+			abort();
+	}
+
+	repo_close(repo);
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_load_stats over an arbitrary STAT object, then repo_find_stat
+ * through whatever it loaded, which needn't be sorted.  It has to take
+ * all of the object or none of it.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+/* repo.c keeps these to itself */
+void repo_load_stats(struct repo *repo);
+struct repo_stat *repo_find_stat(struct repo *repo, word file_id,
+    bool create);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct repo_stat *stat;
+	word i;
+
+	repo = fuzz_repo_holding(REPO_STAT_RTYPE, 1, data, size);
+
+	repo_load_stats(repo);
+	if ((repo->nstats == 0) != (repo->stats == NULL))
+		abort();
+
+	for (i = 0; i < repo->nstats; i++) {
+		stat = repo_find_stat(repo, repo->stats[i].file_id, false);
+		if (stat != NULL && stat->file_id != repo->stats[i].file_id)
+			abort();
+	}
+
+	repo_close(repo);
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * repo_load_summary over an arbitrary SUMM page.  The first byte of the
+ * input is how many AMND objects the repo has, which a summary has to
+ * account for, and the repo has an AUTH of FUZZ_SUMMARY_AUTHORS for its
+ * records to point into.  A summary it takes has to have given every
+ * amendment an author, and one it refuses has to leave nothing behind.
+ */
+
+#include <stdlib.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+#define FUZZ_SUMMARY_AUTHORS	4
+#define FUZZ_SUMMARY_AMENDMENTS	32
+
+/* repo.c keeps these to itself */
+bool repo_load_summary(struct repo *repo);
+void repo_write_authors(struct repo *repo);
+
+static const char *authors[FUZZ_SUMMARY_AUTHORS] = {
+	"jcs", "chris", "someone", "someone else",
+};
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct repo *repo;
+	struct repo_amendment *amendment;
+	word namendments, i;
+
+	if (size < 1)
+		return 0;
+	namendments = data[0] % (FUZZ_SUMMARY_AMENDMENTS + 1);
+
+	repo = fuzz_repo_holding(REPO_SUMMARY_RTYPE, 1, data + 1, size - 1);
+	for (i = 0; i < FUZZ_SUMMARY_AUTHORS; i++)
+		repo_intern_author(repo, authors[i]);
+	repo_write_authors(repo);
+	/* never read, only counted */
+	for (i = 1; i <= namendments; i++) {
+		if (bile_write(repo->bile, REPO_AMENDMENT_RTYPE, i, "", 1) != 1)
+			panic("can't write amendment %d: %d", i,
+			    bile_error(repo->bile));
+	}
+
+	if (repo_load_summary(repo)) {
+		if (repo->namendments != namendments)
+			abort();
+		for (i = 0; i < repo->namendments; i++) {
+			amendment = repo->amendments[i];
+			if (amendment->author == NULL ||
+			    (amendment->nfiles != 0 &&
+			    amendment->file_ids == NULL))
+				abort();
+		}
+	} else if (repo->namendments != 0 || repo->amendments != NULL)
+		abort();
+
+	repo_close(repo);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * bile_unmarshall_object over arbitrary data, with a struct that has
+ * fixed fields on either side of two dynamically-sized ones, read both
+ * deep and shallow.  Nothing in the struct past what the fields cover
+ * may be touched.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../util.h"
+#include "fuzz.h"
+
+#define FUZZ_CANARY	0xA5
+
+struct fuzz_object {
+	unsigned long id;
+	char name[16];
+	size_t note_len;
+	char *note;
+	size_t nvalues;
+	long *values;
+	word flags;
+	unsigned char canary[8];
+};
+
+/* a fixed field, its offset and size */
+#define FUZZ_FIELD(f)	offsetof(struct fuzz_object, f), \
+	sizeof(((struct fuzz_object *)0)->f)
+
+static const struct bile_object_field fuzz_fields[] = {
+	{ FUZZ_FIELD(id), 0 },
+	{ FUZZ_FIELD(name), 0 },
+	{ FUZZ_FIELD(note_len), 0 },
+	{ offsetof(struct fuzz_object, note), -1,
+	    offsetof(struct fuzz_object, note_len) },
+	{ FUZZ_FIELD(nvalues), 0 },
+	{ offsetof(struct fuzz_object, values), -(long)sizeof(long),
+	    offsetof(struct fuzz_object, nvalues) },
+	{ FUZZ_FIELD(flags), 0 },
+};
+
+static struct bile fuzz_bile;
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct fuzz_object object;
+	size_t n;
+	int deep;
+
+	fuzz_init();
+	memcpy(fuzz_bile.magic, BILE_MAGIC, sizeof(fuzz_bile.magic));
+
+	for (deep = 0; deep <= 1; deep++) {
+		memset(&object, FUZZ_CANARY, sizeof(object));
+		object.note = NULL;
+		object.values = NULL;
+
+		if (bile_unmarshall_object(&fuzz_bile, fuzz_fields,
+		    nitems(fuzz_fields), data, size, &object,
+		    offsetof(struct fuzz_object, canary), deep,
+		    "fuzz_unmarshall") != 0) {
+			/* refused, so whatever it allocated is gone again */
+			if (object.note != NULL || object.values != NULL)
+				abort();
+		}
+
+		for (n = 0; n < sizeof(object.canary); n++) {
+			if (object.canary[n] != FUZZ_CANARY)
+				abort();
+		}
+
+		if (object.note != NULL)
+			xfree(&object.note);
+		if (object.values != NULL)
+			xfree(&object.values);
+	}
+
+	return 0;
+}
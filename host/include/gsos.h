@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+/* host stand-in for the GS/OS types and error codes, see types.h */
+
+#ifndef __GSOS__
+#define __GSOS__
+
+#include <types.h>
+
+typedef struct {
+	word length;
+	char text[255];
+} GSString255, *GSString255Ptr;
+
+typedef struct {
+	word bufSize;
+	GSString255 bufString;
+} ResultBuf255, *ResultBuf255Ptr, **ResultBuf255Hndl;
+
+typedef struct {
+	word pCount;
+	GSString255Ptr pathname;
+	word access;
+	word fileType;
+	longword auxType;
+	word storageType;
+	TimeRec createDateTime;
+	TimeRec modDateTime;
+	ResultBuf255Ptr optionList;
+	longword eof;
+	longword blocksUsed;
+	longword resourceEOF;
+	longword resourceBlocks;
+} FileInfoRecGS, *FileInfoRecPtrGS;
+
+/* FOpen access */
+#define readEnable				0x0001
+#define writeEnable				0x0002
+#define readWriteEnable			0x0003
+#define readEnableAllowWrite	0x0003
+
+/* errors, with the same values GS/OS returns */
+#define noError				0x0000
+#define drvrIOError			0x0027
+#define drvrWrtProt			0x002B
+#define badPathSyntax		0x0040
+#define tooManyFilesOpen	0x0042
+#define invalidRefNum		0x0043
+#define pathNotFound		0x0044
+#define volNotFound			0x0045
+#define fileNotFound		0x0046
+#define dupPathname			0x0047
+#define volumeFull			0x0048
+#define eofEncountered		0x004C
+#define outOfRange			0x004D
+#define invalidAccess		0x004E
+#define fileBusy			0x0050
+#define paramRangeErr		0x0053
+#define outOfMem			0x0054
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* host stand-in for the Memory Manager, see types.h */
+
+#ifndef __MEMORY__
+#define __MEMORY__
+
+#include <string.h>
+#include <types.h>
+
+Handle NewHandle(longword size, word userID, word attributes, Pointer loc);
+void DisposeHandle(Handle h);
+longword GetHandleSize(Handle h);
+void SetHandleSize(longword size, Handle h);
+void HLock(Handle h);
+void HUnlock(Handle h);
+void SetPurge(word purgeLevel, Handle h);
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Host stand-ins for the ORCA/C Toolbox headers, declaring only what the
+ * repo core (bile, repo, diffreg, patch, util) uses.  toolbox.c implements
+ * them.  word is 16 bits as on the IIgs, but longword is as wide as
+ * size_t so the F* calls can keep taking size_t counts.
+ */
+
+#ifndef __TYPES__
+#define __TYPES__
+
+/* ORCA/C's load segment directive, segment "name"; */
+#define segment static const char amend_segment[] __attribute__((unused)) =
+
+typedef unsigned char byte;
+typedef unsigned short word;
+typedef unsigned long longword;
+
+typedef word Boolean;
+typedef char *Ptr;
+typedef unsigned char *Pointer;
+typedef Ptr *Handle;
+typedef long Ref;
+
+typedef struct {
+	unsigned char textLength;
+	char text[255];
+} Str255, *StringPtr;
+
+typedef struct TimeRec {
+	byte second;
+	byte minute;
+	byte hour;
+	byte year;		/* since 1900 */
+	byte day;		/* 0 based */
+	byte month;		/* 0 based */
+	byte extra;
+	byte weekDay;	/* 1 is sunday */
+} TimeRec, *TimeRecPtr;
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Write a corpus into a bile file and read it back, storing it raw and
+ * then compressed with each window size, the way repo_amend stores TEXT
+ * and DIFF objects.  With no files a synthetic source-like corpus is
+ * generated.
+ *
+ *   lz_bench [-r rounds] [file ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <types.h>
+#include <gsos.h>
+
+#include "../bile.h"
+#include "../lz.h"
+#include "../util.h"
+
+#define BENCH_FILE	"lz_bench.bile"
+#define BENCH_RTYPE	0x54584554L
+
+struct sample {
+	char *data;
+	size_t len;
+};
+
+static const char *words[] = { "if", "(", ")", "{", "}", "return", "size",
+    "len", "data", "bile", "repo", "->", "=", "==", "NULL", "0", "1", ";",
+    "char", "word", "struct", "for", "while", "xfree(&", "panic(\"",
+    "warn(\"", "\");", "n++", "+", "*", "error", "file", "amendment" };
+
+static double
+elapsed(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+synthesize(struct sample *s, size_t len)
+{
+	size_t pos = 0, w;
+	int indent = 0, i;
+
+	s->data = malloc(len);
+	while (pos < len) {
+		for (i = 0; i < indent * 4 && pos < len; i++)
+			s->data[pos++] = ' ';
+		for (i = 0; i < 3 + rand() % 8 && pos < len; i++) {
+			w = rand() % (sizeof(words) / sizeof(words[0]));
+			if (pos + strlen(words[w]) + 1 > len)
+				break;
+			memcpy(s->data + pos, words[w], strlen(words[w]));
+			pos += strlen(words[w]);
+			s->data[pos++] = ' ';
+		}
+		if (pos < len)
+			s->data[pos++] = '\n';
+		indent = (indent + (rand() % 3) - 1 + 4) % 4;
+	}
+	s->len = len;
+}
+
+static int
+load(struct sample *s, const char *path)
+{
+	FILE *fp;
+	long len;
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		perror(path);
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	rewind(fp);
+	s->len = len;
+	s->data = malloc(len ? len : 1);
+	if (fread(s->data, 1, len, fp) != (size_t)len) {
+		perror(path);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+/* bits 0 stores raw */
+static int
+run(struct sample *samples, size_t nsamples, size_t total, int bits,
+    int rounds)
+{
+	struct bile *bile;
+	Str255 name;
+	size_t n, len;
+	char *data;
+	double t_write, t_read;
+	clock_t start;
+	long stored = 0;
+	int r, bad = 0;
+	FILE *fp;
+
+	strcpy(name.text, BENCH_FILE);
+	name.textLength = strlen(BENCH_FILE);
+
+	t_write = t_read = 0;
+	for (r = 0; r < rounds; r++) {
+		remove(BENCH_FILE);
+		if ((bile = bile_create(&name, 'AMND', 0)) == NULL) {
+			fprintf(stderr, "bile_create failed: %d\n",
+			    bile_error(NULL));
+			return -1;
+		}
+		if (bits)
+			bile_set_lz_bits(bile, bits);
+
+		start = clock();
+		for (n = 0; n < nsamples; n++) {
+			if (samples[n].len == 0)
+				continue;
+			if (bits)
+				len = bile_write_compressed(bile, BENCH_RTYPE,
+				    n + 1, samples[n].data, samples[n].len);
+			else
+				len = bile_write(bile, BENCH_RTYPE, n + 1,
+				    samples[n].data, samples[n].len);
+			if (len != samples[n].len)
+				bad++;
+		}
+		bile_close(bile);
+		xfree(&bile);
+		t_write += elapsed(start);
+
+		start = clock();
+		if ((bile = bile_open(&name)) == NULL) {
+			fprintf(stderr, "bile_open failed: %d\n",
+			    bile_error(NULL));
+			return -1;
+		}
+		for (n = 0; n < nsamples; n++) {
+			if (samples[n].len == 0)
+				continue;
+			len = bile_read_alloc(bile, BENCH_RTYPE, n + 1, &data);
+			if (len != samples[n].len ||
+			    memcmp(data, samples[n].data, len) != 0)
+				bad++;
+			if (data != NULL)
+				xfree(&data);
+		}
+		bile_close(bile);
+		xfree(&bile);
+		t_read += elapsed(start);
+	}
+
+	if ((fp = fopen(BENCH_FILE, "rb")) != NULL) {
+		fseek(fp, 0, SEEK_END);
+		stored = ftell(fp);
+		fclose(fp);
+	}
+	remove(BENCH_FILE);
+
+	if (bits)
+		printf("lz %2d-bit window", bits);
+	else
+		printf("raw            ");
+	printf("  %9ld bytes  %5.2fx  write %8.2f MB/s  read %8.2f MB/s%s\n",
+	    stored, stored ? (double)total / stored : 0,
+	    t_write > 0 ? total * rounds / t_write / (1024 * 1024) : 0,
+	    t_read > 0 ? total * rounds / t_read / (1024 * 1024) : 0,
+	    bad ? "  MISMATCH" : "");
+
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sample *samples;
+	size_t nsamples, total, n;
+	int rounds = 5, bits, bad = 0;
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	if (argc > 0 && strcmp(argv[0], "-r") == 0) {
+		if (argc < 2) {
+			fprintf(stderr, "usage: lz_bench [-r rounds] [file ...]\n");
+			return 1;
+		}
+		rounds = atoi(argv[1]);
+		argc -= 2;
+		argv += 2;
+	}
+	if (rounds < 1)
+		rounds = 1;
+
+	srand(1);
+	if (argc > 0) {
+		nsamples = argc;
+		samples = calloc(nsamples, sizeof(struct sample));
+		for (n = 0; n < nsamples; n++)
+			if (load(&samples[n], argv[n]) != 0)
+				return 1;
+	} else {
+		nsamples = 64;
+		samples = calloc(nsamples, sizeof(struct sample));
+		for (n = 0; n < nsamples; n++)
+			synthesize(&samples[n], 2048 + rand() % 65536);
+	}
+
+	for (total = 0, n = 0; n < nsamples; n++)
+		total += samples[n].len;
+	printf("%lu objects, %lu bytes, %d rounds\n", (unsigned long)nsamples,
+	    (unsigned long)total, rounds);
+
+	bad += run(samples, nsamples, total, 0, rounds);
+	for (bits = LZ_MIN_WINDOW_BITS; bits <= LZ_MAX_WINDOW_BITS; bits++)
+		bad += run(samples, nsamples, total, bits, rounds);
+
+	for (n = 0; n < nsamples; n++)
+		free(samples[n].data);
+	free(samples);
+
+	return (bad != 0);
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Time the parsers that take what comes off the disk, over made-up
+ * objects like the ones a repo has, to see what checking them costs:
+ *
+ *   repo_parse_file        FILE objects, a dozen different name lengths
+ *   repo_parse_amendment   AMND objects, 1 to 8 files and a log each
+ *   unmarshall             bile_unmarshall_object, fixed fields only
+ *   bile_open              opening a bile of that many objects, which is
+ *                          reading its map
+ *
+ *   parse_bench [-r rounds] [-n objects] [-d dir]
+ *
+ * Each result is a line of JSON, the first one the parameters.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <types.h>
+#include <memory.h>
+#include <gsos.h>
+
+#include "../bile.h"
+#include "../fileio.h"
+#include "../repo.h"
+#include "../util.h"
+#include "console.h"
+
+#define BENCH_DIR	"."
+#define BENCH_BILE	"parse_bench.bile"
+#define BENCH_FILE_SIZE	(1 + 31 + 4 + 4 + 4 + 4 + 1)
+#define BENCH_AMND_SIZE	96
+
+/* needed by diffreg */
+struct stat stb1, stb2;
+long diff_format, diff_context, status = 0;
+char *ifdefname, *diffargs, *label[2], *ignore_pats;
+
+size_t
+diff_output(const char *format, ...)
+{
+	return 0;
+}
+
+void
+diff_hunk(char op, long a, long b, long c, long d)
+{
+}
+
+struct record {
+	unsigned long id;
+	unsigned long date;
+	char name[48];
+	word flags;
+	word adds;
+	word subs;
+};
+
+static const struct bile_object_field record_fields[] = {
+	{ offsetof(struct record, id), sizeof(((struct record *)0)->id), 0 },
+	{ offsetof(struct record, date), sizeof(((struct record *)0)->date),
+	    0 },
+	{ offsetof(struct record, name), sizeof(((struct record *)0)->name),
+	    0 },
+	{ offsetof(struct record, flags), sizeof(((struct record *)0)->flags),
+	    0 },
+	{ offsetof(struct record, adds), sizeof(((struct record *)0)->adds),
+	    0 },
+	{ offsetof(struct record, subs), sizeof(((struct record *)0)->subs),
+	    0 },
+};
+
+/* little-endian, as repo_file_update stores dates */
+static void
+put_long(unsigned char *buf, unsigned long l)
+{
+	buf[0] = l & 0xff;
+	buf[1] = (l >> 8) & 0xff;
+	buf[2] = (l >> 16) & 0xff;
+	buf[3] = (l >> 24) & 0xff;
+}
+
+static void
+report(const char *name, unsigned long objects, int rounds, double secs,
+    int bad)
+{
+	printf("{\"case\": \"%s\", \"objects\": %lu, \"rounds\": %d, "
+	    "\"secs\": %.6f, \"ns_per_object\": %.1f, \"errors\": %d}\n",
+	    name, objects, rounds, secs,
+	    secs * 1e9 / ((double)objects * rounds), bad);
+	fflush(stdout);
+}
+
+/* a repo for the parsers, over a bile that's never opened */
+static struct repo *
+bench_repo(void)
+{
+	struct bile *bile;
+
+	bile = xmalloczero(sizeof(struct bile), "parse_bench bile");
+	memcpy(bile->magic, BILE_MAGIC, sizeof(bile->magic));
+
+	return repo_alloc(bile);
+}
+
+static void
+bench_repo_free(struct repo *repo)
+{
+	repo_free_records(repo);
+	xfree(&repo->bile);
+	xfree(&repo);
+}
+
+/* n FILE objects one after another, each BENCH_FILE_SIZE long at most */
+static size_t
+make_files(unsigned char *buf, unsigned long n, size_t *sizes)
+{
+	unsigned char *p = buf;
+	char name[48];
+	unsigned long i;
+	size_t len;
+
+	for (i = 0; i < n; i++) {
+		len = 4 + (i % 12) * 2;
+		snprintf(name, sizeof(name), "SRC/FILE%06lu.C.BACKUP.OLD", i);
+		p[0] = len;
+		memcpy(p + 1, name, len);
+		p += 1 + len;
+		memcpy(p, "TXT", 4);
+		memcpy(p + 4, "\0\0\0\0", 4);
+		put_long(p + 8, 0x12345678UL + i);
+		put_long(p + 12, 0x12348000UL + i);
+		p[16] = i & 1;
+		p += 17;
+		sizes[i] = 1 + len + 17;
+	}
+
+	return p - buf;
+}
+
+/* and AMND objects, BENCH_AMND_SIZE at most */
+static size_t
+make_amendments(unsigned char *buf, unsigned long n, size_t *sizes)
+{
+	static const char *authors[] = { "jcs", "chris", "a contributor" };
+	unsigned char *p = buf, *start;
+	unsigned long i;
+	size_t len;
+	word nfiles, f;
+
+	for (i = 0; i < n; i++) {
+		start = p;
+		p[0] = (i >> 24) & 0xff;
+		p[1] = (i >> 16) & 0xff;
+		p[2] = (i >> 8) & 0xff;
+		p[3] = i & 0xff;
+		p += 4;
+		len = strlen(authors[i % nitems(authors)]);
+		*p++ = len;
+		memcpy(p, authors[i % nitems(authors)], len);
+		p += len;
+		nfiles = 1 + i % 8;
+		*p++ = nfiles >> 8;
+		*p++ = nfiles & 0xff;
+		for (f = 0; f < nfiles; f++) {
+			*p++ = 0;
+			*p++ = f + 1;
+		}
+		*p++ = 0;
+		*p++ = i % 100;
+		*p++ = 0;
+		*p++ = i % 50;
+		len = BENCH_AMND_SIZE - (p - start) - 2;
+		*p++ = len >> 8;
+		*p++ = len & 0xff;
+		memset(p, 'x', len);
+		p += len;
+		sizes[i] = p - start;
+	}
+
+	return p - buf;
+}
+
+static int
+bench_files(unsigned long n, int rounds)
+{
+	struct repo *repo;
+	unsigned char *buf, *p;
+	size_t *sizes;
+	unsigned long i;
+	double secs = 0, start;
+	int r, bad = 0;
+
+	buf = xmalloc(n * BENCH_FILE_SIZE, "parse_bench");
+	sizes = xcalloc(n, sizeof(size_t), "parse_bench");
+	make_files(buf, n, sizes);
+
+	repo = bench_repo();
+	for (r = 0; r < rounds; r++) {
+		start = console_now();
+		for (i = 0, p = buf; i < n; p += sizes[i], i++) {
+			if (repo_parse_file(repo, i + 1, p, sizes[i]) == NULL)
+				bad++;
+		}
+		secs += console_now() - start;
+		pool_reset(&repo->file_pool);
+		arena_reset(&repo->arena);
+	}
+	bench_repo_free(repo);
+	xfree(&sizes);
+	xfree(&buf);
+
+	report("repo_parse_file", n, rounds, secs, bad);
+	return bad;
+}
+
+static int
+bench_amendments(unsigned long n, int rounds)
+{
+	struct repo *repo;
+	unsigned char *buf, *p;
+	size_t *sizes;
+	unsigned long i;
+	double secs = 0, start;
+	int r, bad = 0;
+
+	buf = xmalloc(n * BENCH_AMND_SIZE, "parse_bench");
+	sizes = xcalloc(n, sizeof(size_t), "parse_bench");
+	make_amendments(buf, n, sizes);
+
+	repo = bench_repo();
+	for (r = 0; r < rounds; r++) {
+		start = console_now();
+		for (i = 0, p = buf; i < n; p += sizes[i], i++) {
+			if (repo_parse_amendment(repo, i + 1, p,
+			    sizes[i]) == NULL)
+				bad++;
+		}
+		secs += console_now() - start;
+		pool_reset(&repo->amendment_pool);
+		arena_reset(&repo->arena);
+	}
+	bench_repo_free(repo);
+	xfree(&sizes);
+	xfree(&buf);
+
+	report("repo_parse_amendment", n, rounds, secs, bad);
+	return bad;
+}
+
+static int
+bench_unmarshall(unsigned long n, int rounds)
+{
+	struct bile bile;
+	struct record record;
+	unsigned char *buf;
+	size_t size;
+	unsigned long i;
+	double secs = 0, start;
+	int r, bad = 0;
+
+	memset(&bile, 0, sizeof(bile));
+	memcpy(bile.magic, BILE_MAGIC, sizeof(bile.magic));
+
+	size = sizeof(record.id) + sizeof(record.date) + sizeof(record.name) +
+	    sizeof(record.flags) + sizeof(record.adds) + sizeof(record.subs);
+	buf = xmalloc(n * size, "parse_bench");
+	for (i = 0; i < n * size; i++)
+		buf[i] = i * 31;
+
+	for (r = 0; r < rounds; r++) {
+		start = console_now();
+		for (i = 0; i < n; i++) {
+			if (bile_unmarshall_object(&bile, record_fields,
+			    nitems(record_fields), buf + i * size, size,
+			    &record, sizeof(record), false,
+			    "parse_bench") != 0)
+				bad++;
+		}
+		secs += console_now() - start;
+	}
+	xfree(&buf);
+
+	report("unmarshall", n, rounds, secs, bad);
+	return bad;
+}
+
+static int
+bench_open(const char *dir, unsigned long n, int rounds)
+{
+	struct bile *bile;
+	Str255 path;
+	char buf[256], data[32];
+	unsigned long i;
+	double secs = 0, start;
+	int r, bad = 0;
+
+	snprintf(buf, sizeof(buf), "%s" PATH_SEP_STR BENCH_BILE, dir);
+	if (!console_pstr(&path, buf))
+		exit(1);
+	FDelete(&path);
+	if ((bile = bile_create(&path, AMEND_CREATOR, REPO_TYPE)) == NULL)
+		panic("can't create %s: %d", buf, bile_error(NULL));
+	memset(data, 'x', sizeof(data));
+	for (i = 0; i < n; i++) {
+		if (bile_write(bile, REPO_FILE_RTYPE, i + 1, data,
+		    1 + i % sizeof(data)) != 1 + i % sizeof(data))
+			panic("can't write %s: %d", buf, bile_error(bile));
+	}
+	bile_close(bile);
+	xfree(&bile);
+
+	for (r = 0; r < rounds; r++) {
+		start = console_now();
+		if ((bile = bile_open(&path)) == NULL) {
+			bad++;
+			continue;
+		}
+		if (bile->nobjects < n)
+			bad++;
+		bile_close(bile);
+		secs += console_now() - start;
+		xfree(&bile);
+	}
+	FDelete(&path);
+
+	report("bile_open", n, rounds, secs, bad);
+	return bad;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: parse_bench [-r rounds] [-n objects] "
+	    "[-d dir]\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *dir = BENCH_DIR;
+	unsigned long n = 5000;
+	int rounds = 200, bad = 0;
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	while (argc > 0 && argv[0][0] == '-') {
+		if (argc < 2)
+			usage();
+		if (strcmp(argv[0], "-r") == 0)
+			rounds = atoi(argv[1]);
+		else if (strcmp(argv[0], "-n") == 0)
+			n = strtoul(argv[1], NULL, 10);
+		else if (strcmp(argv[0], "-d") == 0)
+			dir = argv[1];
+		else
+			usage();
+		argc -= 2;
+		argv += 2;
+	}
+	if (argc != 0)
+		usage();
+	if (rounds < 1)
+		rounds = 1;
+	if (n < 1)
+		n = 1;
+
+	printf("{\"params\": {\"objects\": %lu, \"rounds\": %d}}\n", n,
+	    rounds);
+
+	bad += bench_files(n, rounds);
+	bad += bench_amendments(n, rounds);
+	bad += bench_unmarshall(n, rounds);
+	bad += bench_open(dir, n, rounds);
+
+	return (bad != 0);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Append n longs to an array one at a time, the way bile_alloc grows its
+ * map and bile_sorted_ids_by_type its id list, growing it by a fixed step
+ * or with grow_capacity, through the old copy-everything xrealloc or the
+ * current one.  Bytes copied are only known for the old one; the current
+ * one leaves that to realloc.
+ *
+ *   realloc_bench [-r rounds] [count ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <types.h>
+
+#include "../util.h"
+
+#define FIXED_STEP	(10 * sizeof(long))
+
+static unsigned long copied;
+
+static double
+elapsed(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* what xrealloc did before: always move, copying size bytes */
+static void *
+copy_realloc(void *src, size_t old_size, size_t size)
+{
+	void *ptr;
+
+	ptr = xmalloc(size, "copy_realloc");
+	if (src != NULL) {
+		memcpy(ptr, src, MIN(old_size, size));
+		copied += MIN(old_size, size);
+		xfree(&src);
+	}
+	return ptr;
+}
+
+static int
+run(const char *label, unsigned long count, int rounds, bool geometric,
+    bool copying)
+{
+	long *ids;
+	size_t size, old_size, used, n;
+	unsigned long reallocs;
+	clock_t start;
+	double t;
+	int r, bad = 0;
+
+	copied = reallocs = 0;
+	start = clock();
+	for (r = 0; r < rounds; r++) {
+		ids = NULL;
+		size = 0;
+		for (n = 0; n < count; n++) {
+			used = n * sizeof(long);
+			if (used + sizeof(long) >= size) {
+				old_size = size;
+				if (geometric)
+					size = grow_capacity(size,
+					    used + sizeof(long) + 1, FIXED_STEP);
+				else
+					while (used + sizeof(long) >= size)
+						size += FIXED_STEP;
+				if (copying)
+					ids = copy_realloc(ids, old_size, size);
+				else
+					ids = xrealloc(ids, size);
+				reallocs++;
+			}
+			ids[n] = n;
+		}
+		for (n = 0; n < count; n++)
+			if (ids[n] != (long)n)
+				bad++;
+		xfree(&ids);
+	}
+	t = elapsed(start);
+
+	printf("%-28s %8lu reallocs  ", label, reallocs / rounds);
+	if (copying)
+		printf("%12lu bytes copied", copied / rounds);
+	else
+		printf("%12s bytes copied", "?");
+	printf("  %8.3f ms\n", t * 1000 / rounds);
+	return bad;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static unsigned long default_counts[] = { 1000, 10000, 50000 };
+	unsigned long *counts;
+	size_t ncounts, n;
+	int rounds = 5, bad = 0;
+
+	/* no getopt under -std=c11 */
+	argc--;
+	argv++;
+	if (argc > 0 && strcmp(argv[0], "-r") == 0) {
+		if (argc < 2) {
+			fprintf(stderr,
+			    "usage: realloc_bench [-r rounds] [count ...]\n");
+			return 1;
+		}
+		rounds = atoi(argv[1]);
+		argc -= 2;
+		argv += 2;
+	}
+	if (rounds < 1)
+		rounds = 1;
+
+	if (argc > 0) {
+		ncounts = argc;
+		counts = calloc(ncounts, sizeof(unsigned long));
+		for (n = 0; n < ncounts; n++)
+			counts[n] = strtoul(argv[n], NULL, 10);
+	} else {
+		ncounts = nitems(default_counts);
+		counts = default_counts;
+	}
+
+	for (n = 0; n < ncounts; n++) {
+		printf("%lu appends, %d rounds\n", counts[n], rounds);
+		bad += run("copying xrealloc, fixed", counts[n], rounds, false,
+		    true);
+		bad += run("copying xrealloc, geometric", counts[n], rounds,
+		    true, true);
+		bad += run("xrealloc, fixed", counts[n], rounds, false, false);
+		bad += run("xrealloc, geometric", counts[n], rounds, true,
+		    false);
+	}
+
+	if (counts != default_counts)
+		free(counts);
+
+	return (bad != 0);
+}
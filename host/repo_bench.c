@@ -0,0 +1,868 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Build a synthetic repo in a scratch directory, the files and
+ * amendments made up from the options, then time the paths that matter
+ * as it grows: opening it, bile reads and writes, diffing every file
+ * like the committer, replaying each file's amendments like
+ * visualize_rollback, exporting patches and applying one.
+ *
+ *   repo_bench [-s seed] [-f files] [-a amendments] [-l lines]
+ *       [-t files per amendment] [-e edits per file] [-m change:insert:delete]
+ *       [-r rounds] [-d dir]
+ *
+ * Each result is a line of JSON, the first one the parameters, so runs
+ * can be saved and compared.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <types.h>
+#include <memory.h>
+#include <gsos.h>
+
+#include "../bile.h"
+#include "../diff.h"
+#include "../patch.h"
+#include "../repo.h"
+#include "../util.h"
+#include "console.h"
+
+#define BENCH_DIR		"repo_bench.d"
+#define BENCH_REPO		"bench.repo"
+#define BENCH_SCRATCH	"scratch.bile"
+#define BENCH_PATCH		"bench.patch"
+#define BENCH_FINDS		20000L
+
+/* needed by diffreg */
+struct stat stb1, stb2;
+long diff_format, diff_context, status = 0;
+char *ifdefname, *diffargs, *label[2], *ignore_pats;
+
+static struct diffed_file *diff_file = NULL;
+static Handle diff_text = NULL;
+static unsigned long diff_len = 0;
+
+/* a working file, one malloc'd string per line without its EOL */
+struct text {
+	char **lines;
+	size_t nlines;
+	size_t size;
+};
+
+struct params {
+	unsigned long seed;
+	int files;
+	int amendments;
+	int lines;
+	int touch;
+	int edits;
+	int mix[3];
+	int rounds;
+	const char *dir;
+};
+
+static struct params params = { 1, 50, 200, 400, 3, 4, { 6, 3, 1 }, 3,
+    BENCH_DIR };
+static struct text *texts;
+/* the last amendment's files as they were before it, for patch_process */
+static struct text *before;
+
+static const char *words[] = { "if", "(", ")", "{", "}", "return", "size",
+    "len", "data", "bile", "repo", "->", "=", "==", "NULL", "0", "1", ";",
+    "char", "word", "struct", "for", "while", "xfree(&", "panic(\"",
+    "warn(\"", "\");", "n++", "+", "*", "error", "file", "amendment" };
+
+static void
+report(const char *bench, unsigned long ops, unsigned long bytes,
+    double secs, unsigned long errors)
+{
+	printf("{\"bench\": \"%s\", \"ops\": %lu, \"bytes\": %lu, "
+	    "\"secs\": %.6f, \"ops_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+	    "\"errors\": %lu}\n", bench, ops, bytes, secs,
+	    secs > 0 ? ops / secs : 0, secs > 0 ? bytes / secs : 0, errors);
+	fflush(stdout);
+}
+
+static void
+bench_path(char *buf, size_t size, const char *name)
+{
+	snprintf(buf, size, "%s" PATH_SEP_STR "%s", params.dir, name);
+}
+
+static char *
+random_line(int file)
+{
+	char buf[128];
+	const char *w;
+	size_t pos;
+	int i, n;
+
+	pos = snprintf(buf, sizeof(buf), "%*s", (rand() % 4) * 4, "");
+	n = 2 + rand() % 8;
+	for (i = 0; i < n; i++) {
+		w = words[rand() % nitems(words)];
+		if (pos + strlen(w) + 1 >= sizeof(buf) - 24)
+			break;
+		pos += snprintf(buf + pos, sizeof(buf) - pos, "%s ", w);
+	}
+	snprintf(buf + pos, sizeof(buf) - pos, "/* %d.%d */", file, rand());
+	return xstrdup(buf, "random_line");
+}
+
+static void
+text_insert(struct text *text, size_t at, char *line)
+{
+	text->lines = xreallocarray(text->lines, text->nlines + 1,
+	    sizeof(char *));
+	memmove(text->lines + at + 1, text->lines + at,
+	    (text->nlines - at) * sizeof(char *));
+	text->lines[at] = line;
+	text->nlines++;
+	text->size += strlen(line) + 1;
+}
+
+static void
+text_delete(struct text *text, size_t at)
+{
+	text->size -= strlen(text->lines[at]) + 1;
+	xfree(&text->lines[at]);
+	memmove(text->lines + at, text->lines + at + 1,
+	    (text->nlines - at - 1) * sizeof(char *));
+	text->nlines--;
+}
+
+static void
+text_copy(struct text *dst, struct text *src)
+{
+	size_t n;
+
+	memset(dst, 0, sizeof(struct text));
+	for (n = 0; n < src->nlines; n++)
+		text_insert(dst, n, xstrdup(src->lines[n], "text_copy"));
+}
+
+static void
+text_free(struct text *text)
+{
+	while (text->nlines > 0)
+		text_delete(text, text->nlines - 1);
+	if (text->lines != NULL)
+		xfree(&text->lines);
+}
+
+static void
+text_write(struct text *text, int file)
+{
+	char name[32], path[256];
+	FILE *fp;
+	size_t n;
+
+	snprintf(name, sizeof(name), "file%d.c", file);
+	bench_path(path, sizeof(path), name);
+	if ((fp = fopen(path, "wb")) == NULL)
+		panic("can't write %s", path);
+	for (n = 0; n < text->nlines; n++) {
+		fputs(text->lines[n], fp);
+		fputc(EOL_CHAR, fp);
+	}
+	fclose(fp);
+}
+
+/* whether the file on disk holds text */
+static bool
+text_on_disk(struct text *text, int file)
+{
+	char name[32], path[256], *line;
+	FILE *fp;
+	size_t n, len;
+	bool same = true;
+
+	snprintf(name, sizeof(name), "file%d.c", file);
+	bench_path(path, sizeof(path), name);
+	if ((fp = fopen(path, "rb")) == NULL)
+		return false;
+	for (n = 0; n < text->nlines && same; n++) {
+		line = text->lines[n];
+		for (len = 0; line[len] != '\0' && same; len++)
+			same = (fgetc(fp) == (unsigned char)line[len]);
+		same = same && fgetc(fp) == EOL_CHAR;
+	}
+	same = same && fgetc(fp) == EOF;
+	fclose(fp);
+	return same;
+}
+
+/* one change, insert or delete, picked by params.mix */
+static void
+text_edit(struct text *text, int file)
+{
+	size_t at;
+	int pick;
+
+	pick = rand() % (params.mix[0] + params.mix[1] + params.mix[2]);
+	if (text->nlines == 0 || pick >= params.mix[0] + params.mix[2]) {
+		text_insert(text, text->nlines ? rand() % (text->nlines + 1) : 0,
+		    random_line(file));
+		return;
+	}
+	at = rand() % text->nlines;
+	text_delete(text, at);
+	if (pick < params.mix[0])
+		text_insert(text, at, random_line(file));
+}
+
+size_t
+diff_output(const char *format, ...)
+{
+	char buf[1024], *line = buf;
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	if (format[0] == '%' && format[1] == 'c' && format[2] == '\0') {
+		buf[0] = va_arg(ap, int);
+		len = 1;
+	} else
+		len = vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	if (len < 0)
+		panic("diff_output: bad format %s", format);
+
+	if (len >= sizeof(buf)) {
+		line = xmalloc(len + 1, "diff_output");
+		va_start(ap, format);
+		vsnprintf(line, len + 1, format, ap);
+		va_end(ap);
+	}
+
+	if (diff_text != NULL) {
+		if (diff_len + len > GetHandleSize(diff_text))
+			xSetHandleSize(diff_text, (diff_len + len) * 2);
+		memcpy(*diff_text + diff_len, line, len);
+		diff_len += len;
+	}
+
+	if (line != buf)
+		xfree(&line);
+
+	return len;
+}
+
+void
+diff_hunk(char op, long a, long b, long c, long d)
+{
+	struct diff_hunk *hunk;
+
+	if (diff_file == NULL)
+		return;
+
+	if (diff_file->nhunks == diff_file->hunks_size) {
+		diff_file->hunks_size = grow_capacity(diff_file->hunks_size,
+		    diff_file->nhunks + 1, 16);
+		diff_file->hunks = xreallocarray(diff_file->hunks,
+		    diff_file->hunks_size, sizeof(struct diff_hunk));
+	}
+
+	hunk = &diff_file->hunks[diff_file->nhunks++];
+	memset(hunk, 0, sizeof(struct diff_hunk));
+	hunk->op = op;
+	hunk->old_line = a;
+	hunk->old_len = (a > b) ? 0 : b - a + 1;
+	hunk->new_line = c;
+	hunk->new_len = (c > d) ? 0 : d - c + 1;
+	hunk->diff_pos = diff_len;
+}
+
+static struct repo_file *
+file_numbered(struct repo *repo, int file)
+{
+	char name[32];
+	word i;
+
+	snprintf(name, sizeof(name), "file%d.c", file);
+	for (i = 0; i < repo->nfiles; i++) {
+		if (strcmp(repo->files[i]->filename.text, name) == 0)
+			return repo->files[i];
+	}
+	panic("%s not in repo", name);
+	return NULL;
+}
+
+/* diff and amend the files flagged in touched, like amend commit */
+static void
+commit(struct repo *repo, const char *touched, double *diff_secs,
+    unsigned long *diff_bytes, unsigned long *diffs, double *amend_secs)
+{
+	struct diffed_file *diffed;
+	Handle log;
+	word ndiffed = 0, i;
+	double start;
+	char msg[32];
+	int f;
+
+	diffed = xcalloc(params.files, sizeof(struct diffed_file),
+	    "bench diffed");
+	diff_text = xNewHandle(1024);
+	diff_len = 0;
+
+	start = console_now();
+	for (f = 0; f < params.files; f++) {
+		if (!touched[f])
+			continue;
+		diff_file = &diffed[ndiffed++];
+		diff_file->file = file_numbered(repo, f);
+		diff_file->flags = DIFFED_FILE_METADATA;
+		if (repo_diff_file(repo, diff_file->file))
+			diff_file->flags |= DIFFED_FILE_TEXT;
+		*diff_bytes += texts[f].size;
+		(*diffs)++;
+	}
+	diff_file = NULL;
+	diff_arena_release();
+	*diff_secs += console_now() - start;
+
+	snprintf(msg, sizeof(msg), "amendment %u", repo->next_amendment_id);
+	log = xNewHandle(strlen(msg));
+	memcpy(*log, msg, strlen(msg));
+
+	start = console_now();
+	repo_amend(repo, diffed, ndiffed, 0, 0, "bench", log, strlen(msg),
+	    diff_text, diff_len);
+	*amend_secs += console_now() - start;
+
+	DisposeHandle(log);
+	for (i = 0; i < ndiffed; i++) {
+		if (diffed[i].hunks != NULL)
+			xfree(&diffed[i].hunks);
+	}
+	xfree(&diffed);
+	DisposeHandle(diff_text);
+	diff_text = NULL;
+}
+
+static void
+generate(void)
+{
+	struct repo *repo;
+	Str255 path;
+	char cmd[300], buf[256], name[32], *touched;
+	unsigned long diff_bytes = 0, diffs = 0;
+	double diff_secs = 0, amend_secs = 0, start;
+	int f, a, n, e, nedits;
+
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s' && mkdir -p '%s'", params.dir,
+	    params.dir);
+	if (system(cmd) != 0)
+		panic("can't make %s", params.dir);
+
+	start = console_now();
+	texts = xcalloc(params.files, sizeof(struct text), "bench texts");
+	before = xcalloc(params.files, sizeof(struct text), "bench before");
+	touched = xcalloc(params.files, 1, "bench touched");
+	for (f = 0; f < params.files; f++) {
+		n = params.lines / 2 + rand() % (params.lines + 1);
+		while (texts[f].nlines < n)
+			text_insert(&texts[f], texts[f].nlines, random_line(f));
+		text_write(&texts[f], f);
+	}
+
+	bench_path(buf, sizeof(buf), BENCH_REPO);
+	if (!console_pstr(&path, buf))
+		exit(1);
+	if ((repo = repo_create_path(&path)) == NULL)
+		panic("can't create %s", buf);
+	for (f = 0; f < params.files; f++) {
+		snprintf(name, sizeof(name), "file%d.c", f);
+		if (!console_pstr(&path, name))
+			exit(1);
+		if (repo_add_file_named(repo, &path) == NULL)
+			panic("can't add %s", name);
+		touched[f] = 1;
+	}
+	commit(repo, touched, &diff_secs, &diff_bytes, &diffs, &amend_secs);
+
+	for (a = 1; a < params.amendments; a++) {
+		memset(touched, 0, params.files);
+		for (n = 0; n < params.touch; n++) {
+			f = rand() % params.files;
+			if (touched[f])
+				continue;
+			touched[f] = 1;
+			if (a == params.amendments - 1)
+				text_copy(&before[f], &texts[f]);
+			nedits = 1 + rand() % (params.edits * 2 - 1);
+			for (e = 0; e < nedits; e++)
+				text_edit(&texts[f], f);
+			text_write(&texts[f], f);
+		}
+		commit(repo, touched, &diff_secs, &diff_bytes, &diffs,
+		    &amend_secs);
+	}
+	xfree(&touched);
+	repo_close(repo);
+
+	report("generate", params.amendments, 0, console_now() - start, 0);
+	report("commit_diff", diffs, diff_bytes, diff_secs, 0);
+	report("repo_amend", params.amendments, 0, amend_secs, 0);
+}
+
+static unsigned long
+file_size(const char *path)
+{
+	FILE *fp;
+	long size;
+
+	if ((fp = fopen(path, "rb")) == NULL)
+		return 0;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fclose(fp);
+	return size;
+}
+
+static struct repo *
+open_repo(void)
+{
+	struct repo *repo;
+	Str255 path;
+	char buf[256];
+
+	bench_path(buf, sizeof(buf), BENCH_REPO);
+	if (!console_pstr(&path, buf))
+		exit(1);
+	if ((repo = repo_open_path(&path)) == NULL)
+		panic("can't open %s", buf);
+	return repo;
+}
+
+static void
+bench_open(void)
+{
+	struct bile *bile;
+	Str255 path;
+	char buf[256];
+	unsigned long size;
+	double start;
+	int r;
+
+	bench_path(buf, sizeof(buf), BENCH_REPO);
+	size = file_size(buf);
+
+	/* repo_open_path runs bile_verify too */
+	start = console_now();
+	for (r = 0; r < params.rounds; r++)
+		repo_close(open_repo());
+	report("repo_open", params.rounds, size * params.rounds,
+	    console_now() - start, 0);
+
+	if (!console_pstr(&path, buf))
+		exit(1);
+	start = console_now();
+	for (r = 0; r < params.rounds; r++) {
+		if ((bile = bile_open(&path)) == NULL)
+			panic("can't open %s", buf);
+		bile_verify(bile);
+		bile_close(bile);
+		xfree(&bile);
+	}
+	report("bile_verify", params.rounds, size * params.rounds,
+	    console_now() - start, 0);
+}
+
+static void
+bench_find(struct repo *repo)
+{
+	struct bile *bile = repo->bile;
+	struct bile_object *o, *found;
+	unsigned long misses = 0, n;
+	double start;
+
+	start = console_now();
+	for (n = 0; n < BENCH_FINDS; n++) {
+		o = &bile->map[rand() % bile->nobjects];
+		found = bile_find(bile, o->type, o->id);
+		if (found == NULL)
+			misses++;
+		else
+			xfree(&found);
+	}
+	report("bile_find", BENCH_FINDS, 0, console_now() - start, misses);
+}
+
+static void
+bench_write(bool compressed)
+{
+	struct bile *bile;
+	Str255 path;
+	char buf[256], *data;
+	unsigned long bytes = 0, bad = 0;
+	double start;
+	size_t len;
+	int r, f;
+
+	bench_path(buf, sizeof(buf), BENCH_SCRATCH);
+	if (!console_pstr(&path, buf))
+		exit(1);
+
+	start = console_now();
+	for (r = 0; r < params.rounds; r++) {
+		remove(buf);
+		if ((bile = bile_create(&path, AMEND_CREATOR, 0)) == NULL)
+			panic("can't create %s", buf);
+		for (f = 0; f < params.files; f++) {
+			len = texts[f].size ? texts[f].size : 1;
+			data = xmalloc(len, "bench_write");
+			memset(data, 'x', len);
+			if (texts[f].nlines > 0)
+				memcpy(data, texts[f].lines[0],
+				    MIN(len, strlen(texts[f].lines[0])));
+			if ((compressed ? bile_write_compressed(bile,
+			    REPO_TEXT_RTYPE, f + 1, data, len) :
+			    bile_write(bile, REPO_TEXT_RTYPE, f + 1, data, len)) !=
+			    len)
+				bad++;
+			bytes += len;
+			xfree(&data);
+		}
+		bile_close(bile);
+		xfree(&bile);
+	}
+	remove(buf);
+	report(compressed ? "bile_write_compressed" : "bile_write",
+	    (unsigned long)params.files * params.rounds, bytes,
+	    console_now() - start, bad);
+}
+
+/* every file diffed against its stored TEXT after one more round of edits */
+static void
+bench_diff(struct repo *repo)
+{
+	struct repo_file *file;
+	unsigned long bytes = 0;
+	double start;
+	int r, f, e;
+
+	for (f = 0; f < params.files; f++) {
+		for (e = 0; e < params.edits; e++)
+			text_edit(&texts[f], f);
+		text_write(&texts[f], f);
+	}
+
+	diff_text = xNewHandle(1024);
+	start = console_now();
+	for (r = 0; r < params.rounds; r++) {
+		for (f = 0; f < params.files; f++) {
+			file = file_numbered(repo, f);
+			diff_len = 0;
+			repo_diff_file(repo, file);
+			bytes += texts[f].size;
+		}
+		diff_arena_release();
+	}
+	report("diff", (unsigned long)params.files * params.rounds, bytes,
+	    console_now() - start, 0);
+	DisposeHandle(diff_text);
+	diff_text = NULL;
+}
+
+/*
+ * Like visualize_applyHunks: the text between hunks comes from old, the
+ * + lines of each hunk from the diff.  Returns -1 if they don't line up.
+ */
+static long
+apply_hunks(char *old, size_t old_len, struct diff_hunk *hunks,
+    word nhunks, char *diff, size_t diff_len, char *out)
+{
+	size_t o = 0, pos, next, len, line = 1, k;
+	long size = 0;
+	word h;
+
+	for (h = 0; h <= nhunks; h++) {
+		/* copy up to the hunk's first line */
+		while (h == nhunks ? o < old_len : line < hunks[h].old_line) {
+			if (o >= old_len)
+				return -1;
+			for (len = 0; o + len < old_len && old[o + len] != EOL_CHAR;
+			    len++)
+				;
+			if (o + len < old_len)
+				len++;
+			if (out != NULL)
+				memcpy(out + size, old + o, len);
+			size += len;
+			o += len;
+			line++;
+		}
+		if (h == nhunks)
+			break;
+
+		pos = hunks[h].diff_pos;
+		for (k = 0; k < hunks[h].old_len; k++) {
+			if (pos >= diff_len || diff[pos] != '-' || o >= old_len)
+				return -1;
+			while (pos < diff_len && diff[pos++] != EOL_CHAR)
+				;
+			while (o < old_len && old[o++] != EOL_CHAR)
+				;
+			line++;
+		}
+		for (k = 0; k < hunks[h].new_len; k++) {
+			if (pos >= diff_len || diff[pos] != '+')
+				return -1;
+			for (next = pos; next < diff_len && diff[next] != EOL_CHAR;
+			    next++)
+				;
+			if (next < diff_len)
+				next++;
+			len = next - pos - 1;
+			if (out != NULL)
+				memcpy(out + size, diff + pos + 1, len);
+			size += len;
+			pos = next;
+		}
+	}
+
+	return size;
+}
+
+/* rebuild every file from nothing through its amendments, check vs TEXT */
+static void
+bench_rollback(struct repo *repo)
+{
+	struct repo_amendment *amendment;
+	struct diff_hunk *hunks;
+	struct repo_file *file;
+	char *text, *next, *diff, *stored;
+	unsigned long replays = 0, bytes = 0, bad = 0;
+	size_t text_len, diff_len, stored_len;
+	double start;
+	long size;
+	word nhunks, i;
+	int f;
+
+	start = console_now();
+	for (f = 0; f < params.files; f++) {
+		file = file_numbered(repo, f);
+		text = NULL;
+		text_len = 0;
+		/* amendments are newest first */
+		for (i = repo->namendments; i-- > 0; ) {
+			amendment = repo->amendments[i];
+			if (!repo_file_hunks(repo, amendment->id, file->id, &hunks,
+			    &nhunks))
+				continue;
+			diff_len = bile_read_alloc(repo->bile, REPO_DIFF_RTYPE,
+			    amendment->id, &diff);
+			size = apply_hunks(text, text_len, hunks, nhunks, diff,
+			    diff_len, NULL);
+			next = NULL;
+			if (size > 0) {
+				next = xmalloc(size, "bench_rollback");
+				apply_hunks(text, text_len, hunks, nhunks, diff,
+				    diff_len, next);
+			} else if (size < 0)
+				bad++;
+			if (text != NULL)
+				xfree(&text);
+			text = next;
+			text_len = size > 0 ? size : 0;
+			bytes += text_len;
+			replays++;
+			if (diff != NULL)
+				xfree(&diff);
+			xfree(&hunks);
+		}
+
+		stored_len = bile_read_alloc(repo->bile, REPO_TEXT_RTYPE, file->id,
+		    &stored);
+		if (stored_len != text_len ||
+		    (text_len && memcmp(stored, text, text_len) != 0))
+			bad++;
+		if (stored != NULL)
+			xfree(&stored);
+		if (text != NULL)
+			xfree(&text);
+	}
+	report("rollback", replays, bytes, console_now() - start, bad);
+}
+
+static void
+bench_export(struct repo *repo)
+{
+	Str255 path;
+	char buf[256];
+	unsigned long bytes = 0;
+	double start;
+	word i;
+
+	bench_path(buf, sizeof(buf), BENCH_PATCH);
+	if (!console_pstr(&path, buf))
+		exit(1);
+
+	start = console_now();
+	for (i = 0; i < repo->namendments; i++) {
+		repo_export_patch(repo, repo->amendments[i], &path);
+		bytes += file_size(buf);
+	}
+	report("export_patch", repo->namendments, bytes, console_now() - start,
+	    0);
+}
+
+/* put the newest amendment's files back the way they were and re-apply it */
+static void
+bench_patch(struct repo *repo)
+{
+	Str255 path;
+	char buf[256], cmd[300];
+	unsigned long bytes, bad = 0;
+	double secs = 0, start;
+	int r, f;
+
+	/*
+	 * backups go to a directory named for the second, and renaming into
+	 * it fails once it holds a file of the same name
+	 */
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'/bck* '%s'/tmp.*", params.dir,
+	    params.dir);
+
+	bench_path(buf, sizeof(buf), BENCH_PATCH);
+	if (!console_pstr(&path, buf))
+		exit(1);
+	repo_export_patch(repo, repo->amendments[0], &path);
+	bytes = file_size(buf);
+
+	for (r = 0; r < params.rounds; r++) {
+		for (f = 0; f < params.files; f++) {
+			if (before[f].lines != NULL)
+				text_write(&before[f], f);
+		}
+		start = console_now();
+		if (patch_process(repo, &path) != 0)
+			bad++;
+		secs += console_now() - start;
+		for (f = 0; f < params.files; f++) {
+			if (before[f].lines != NULL && !text_on_disk(&texts[f], f))
+				bad++;
+		}
+		if (system(cmd) != 0)
+			panic("can't clean up %s", params.dir);
+	}
+	report("patch_process", params.rounds, bytes * params.rounds, secs,
+	    bad);
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: repo_bench [-s seed] [-f files] "
+	    "[-a amendments] [-l lines]\n"
+	    "                  [-t files per amendment] [-e edits per file]\n"
+	    "                  [-m change:insert:delete] [-r rounds] "
+	    "[-d dir]\n");
+	exit(1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct repo *repo;
+	int f;
+
+	/* no getopt under -std=c11 */
+	for (argc--, argv++; argc > 0; argc -= 2, argv += 2) {
+		if (argc < 2 || argv[0][0] != '-' || argv[0][2] != '\0')
+			usage();
+		switch (argv[0][1]) {
+		case 's':
+			params.seed = strtoul(argv[1], NULL, 10);
+			break;
+		case 'f':
+			params.files = atoi(argv[1]);
+			break;
+		case 'a':
+			params.amendments = atoi(argv[1]);
+			break;
+		case 'l':
+			params.lines = atoi(argv[1]);
+			break;
+		case 't':
+			params.touch = atoi(argv[1]);
+			break;
+		case 'e':
+			params.edits = atoi(argv[1]);
+			break;
+		case 'm':
+			if (sscanf(argv[1], "%d:%d:%d", &params.mix[0],
+			    &params.mix[1], &params.mix[2]) != 3 ||
+			    params.mix[0] < 0 || params.mix[1] < 0 ||
+			    params.mix[2] < 0 ||
+			    params.mix[0] + params.mix[1] + params.mix[2] == 0)
+				usage();
+			break;
+		case 'r':
+			params.rounds = atoi(argv[1]);
+			break;
+		case 'd':
+			params.dir = argv[1];
+			break;
+		default:
+			usage();
+		}
+	}
+	if (params.files < 1 || params.amendments < 1 || params.lines < 1 ||
+	    params.touch < 1 || params.edits < 1 || params.rounds < 1)
+		usage();
+
+	/* the same unified diffs the committer window makes */
+	diff_format = D_UNIFIED;
+	diff_context = 3;
+	console_assume_yes = true;
+
+	printf("{\"params\": {\"seed\": %lu, \"files\": %d, "
+	    "\"amendments\": %d, \"lines\": %d, \"touch\": %d, \"edits\": %d, "
+	    "\"mix\": [%d, %d, %d], \"rounds\": %d}}\n", params.seed,
+	    params.files, params.amendments, params.lines, params.touch,
+	    params.edits, params.mix[0], params.mix[1], params.mix[2],
+	    params.rounds);
+	srand(params.seed);
+
+	generate();
+	bench_open();
+
+	repo = open_repo();
+	bench_find(repo);
+	bench_write(false);
+	bench_write(true);
+	bench_rollback(repo);
+	bench_export(repo);
+	bench_patch(repo);
+	bench_diff(repo);
+	repo_close(repo);
+
+	for (f = 0; f < params.files; f++) {
+		text_free(&texts[f]);
+		text_free(&before[f]);
+	}
+	xfree(&texts);
+	xfree(&before);
+
+	return 0;
+}
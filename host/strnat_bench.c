@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compare sorting filenames with strnatcmp against sorting precomputed
+ * strnat_key keys, the way repo_sort_files does.
+ *
+ *   strnat_bench [nfiles [rounds]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../strnatcmp.h"
+
+struct name {
+	char *text;
+	unsigned char *key;
+	size_t key_len;
+};
+
+static unsigned long ncompares;
+
+static int
+name_strnatcmp(const void *a, const void *b)
+{
+	ncompares++;
+	return strnatcmp(((const struct name *)a)->text,
+	    ((const struct name *)b)->text);
+}
+
+static int
+name_keycmp(const void *a, const void *b)
+{
+	const struct name *na = a, *nb = b;
+
+	ncompares++;
+	return strnat_keycmp(na->key, na->key_len, nb->key, nb->key_len);
+}
+
+static void
+shuffle(struct name *names, size_t n)
+{
+	struct name t;
+	size_t i, j;
+
+	for (i = n - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		t = names[i];
+		names[i] = names[j];
+		names[j] = t;
+	}
+}
+
+static double
+elapsed(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const char *stems[] = { "file", "chapter ", "part", "v",
+	    "img_", "Track 0", "x" };
+	struct name *names;
+	size_t nnames = 5000, rounds = 20, n, r, bad = 0, len;
+	char buf[64];
+	clock_t start;
+	double t_cmp, t_key, t_keygen;
+	unsigned long c_cmp, c_key;
+
+	if (argc > 1)
+		nnames = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		rounds = strtoul(argv[2], NULL, 10);
+	if (nnames < 2 || rounds < 1) {
+		fprintf(stderr, "usage: %s [nfiles [rounds]]\n", argv[0]);
+		return 1;
+	}
+
+	srand(1);
+	names = calloc(nnames, sizeof(struct name));
+	for (n = 0; n < nnames; n++) {
+		snprintf(buf, sizeof(buf), "%s%u.%u%s",
+		    stems[rand() % (sizeof(stems) / sizeof(stems[0]))],
+		    (unsigned)(rand() % 2000), (unsigned)(rand() % 20),
+		    (rand() % 2) ? ".c" : ".h");
+		names[n].text = strdup(buf);
+	}
+
+	start = clock();
+	for (n = 0; n < nnames; n++) {
+		len = strlen(names[n].text);
+		names[n].key = malloc(STRNAT_KEY_SIZE(len));
+		names[n].key_len = strnat_key(names[n].text, len, names[n].key,
+		    STRNAT_KEY_SIZE(len));
+	}
+	t_keygen = elapsed(start);
+
+	ncompares = 0;
+	t_cmp = 0;
+	for (r = 0; r < rounds; r++) {
+		shuffle(names, nnames);
+		start = clock();
+		qsort(names, nnames, sizeof(struct name), name_strnatcmp);
+		t_cmp += elapsed(start);
+	}
+	c_cmp = ncompares;
+
+	ncompares = 0;
+	t_key = 0;
+	for (r = 0; r < rounds; r++) {
+		shuffle(names, nnames);
+		start = clock();
+		qsort(names, nnames, sizeof(struct name), name_keycmp);
+		t_key += elapsed(start);
+	}
+	c_key = ncompares;
+
+	/* key order must never contradict strnatcmp */
+	for (n = 1; n < nnames; n++) {
+		if (strnatcmp(names[n - 1].text, names[n].text) > 0)
+			bad++;
+	}
+
+	printf("%lu names, %lu rounds\n", (unsigned long)nnames,
+	    (unsigned long)rounds);
+	printf("strnatcmp:     %8.3f s  %10lu compares  %8.0f compares/s\n",
+	    t_cmp, c_cmp, t_cmp > 0 ? c_cmp / t_cmp : 0);
+	printf("strnat_keycmp: %8.3f s  %10lu compares  %8.0f compares/s\n",
+	    t_key, c_key, t_key > 0 ? c_key / t_key : 0);
+	printf("key build:     %8.3f s\n", t_keygen);
+	printf("order mismatches: %lu\n", (unsigned long)bad);
+
+	for (n = 0; n < nnames; n++) {
+		free(names[n].text);
+		free(names[n].key);
+	}
+	free(names);
+
+	return (bad != 0);
+}
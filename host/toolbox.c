@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Host implementations of the Toolbox calls declared in include/, just
+ * enough for the repo core.  Handles are never purged or moved, a locked
+ * and an unlocked handle are the same thing here.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <types.h>
+#include <memory.h>
+#include <misctool.h>
+#include <orca.h>
+#include <gsos.h>
+
+/* the Memory Manager's memErr */
+#define HOST_MEM_ERR	0x0201
+
+/* seconds from 1904-01-01, the IIgs epoch, to 1970-01-01 */
+#define HOST_EPOCH_1904	2082844800L
+
+struct host_handle {
+	Ptr ptr;	/* first, so a Handle is a pointer to the struct */
+	longword size;
+};
+
+word programID = 0x1000;
+
+static word host_toolerror = 0;
+
+word
+toolerror(void)
+{
+	return host_toolerror;
+}
+
+Handle
+NewHandle(longword size, word userID, word attributes, Pointer loc)
+{
+	struct host_handle *hh;
+
+	host_toolerror = 0;
+
+	hh = malloc(sizeof(struct host_handle));
+	if (hh == NULL) {
+		host_toolerror = HOST_MEM_ERR;
+		return NULL;
+	}
+	hh->ptr = malloc(size ? size : 1);
+	if (hh->ptr == NULL) {
+		free(hh);
+		host_toolerror = HOST_MEM_ERR;
+		return NULL;
+	}
+	hh->size = size;
+
+	return &hh->ptr;
+}
+
+void
+DisposeHandle(Handle h)
+{
+	struct host_handle *hh = (struct host_handle *)h;
+
+	if (hh == NULL)
+		return;
+	free(hh->ptr);
+	free(hh);
+}
+
+longword
+GetHandleSize(Handle h)
+{
+	return ((struct host_handle *)h)->size;
+}
+
+void
+SetHandleSize(longword size, Handle h)
+{
+	struct host_handle *hh = (struct host_handle *)h;
+	Ptr p;
+
+	host_toolerror = 0;
+
+	p = realloc(hh->ptr, size ? size : 1);
+	if (p == NULL) {
+		host_toolerror = HOST_MEM_ERR;
+		return;
+	}
+	hh->ptr = p;
+	hh->size = size;
+}
+
+void
+HLock(Handle h)
+{
+}
+
+void
+HUnlock(Handle h)
+{
+}
+
+void
+SetPurge(word purgeLevel, Handle h)
+{
+}
+
+/*
+ * IIgs clock seconds have no time zone, they count local wall clock time
+ * from 1904, so convert through timegm and gmtime to keep them that way.
+ */
+TimeRec
+ReadTimeHex(void)
+{
+	TimeRec tr;
+	time_t now;
+	struct tm *tm;
+
+	now = time(NULL);
+	tm = localtime(&now);
+
+	tr.second = tm->tm_sec;
+	tr.minute = tm->tm_min;
+	tr.hour = tm->tm_hour;
+	tr.year = tm->tm_year;
+	tr.day = tm->tm_mday - 1;
+	tr.month = tm->tm_mon;
+	tr.extra = 0;
+	tr.weekDay = tm->tm_wday + 1;
+
+	return tr;
+}
+
+longword
+ConvSeconds(word convVerb, long secs, Pointer datePtr)
+{
+	TimeRec *tr = (TimeRec *)datePtr;
+	struct tm tm;
+	time_t t;
+
+	switch (convVerb) {
+	case TimeRec2Secs:
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_sec = tr->second;
+		tm.tm_min = tr->minute;
+		tm.tm_hour = tr->hour;
+		tm.tm_year = tr->year;
+		tm.tm_mday = tr->day + 1;
+		tm.tm_mon = tr->month;
+		return (longword)(timegm(&tm) + HOST_EPOCH_1904);
+	case secs2TimeRec:
+		t = (time_t)(unsigned long)secs - HOST_EPOCH_1904;
+		gmtime_r(&t, &tm);
+		tr->second = tm.tm_sec;
+		tr->minute = tm.tm_min;
+		tr->hour = tm.tm_hour;
+		tr->year = tm.tm_year;
+		tr->day = tm.tm_mday - 1;
+		tr->month = tm.tm_mon;
+		tr->extra = 0;
+		tr->weekDay = tm.tm_wday + 1;
+		return secs;
+	}
+
+	return 0;
+}
+
+/* 60ths of a second, like the IIgs tick count */
+longword
+GetTick(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (longword)ts.tv_sec * 60 + ts.tv_nsec / (1000000000L / 60);
+}
+
+char *
+p2cstr(char *str)
+{
+	size_t len = (unsigned char)str[0];
+
+	memmove(str, str + 1, len);
+	str[len] = '\0';
+	return str;
+}
+
+char *
+c2pstr(char *str)
+{
+	size_t len = strlen(str);
+
+	if (len > 255)
+		len = 255;
+	memmove(str + 1, str, len);
+	str[0] = len;
+	return str;
+}
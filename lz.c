@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <types.h>
+#include <string.h>
+
+#include "lz.h"
+#include "util.h"
+
+segment "bile";
+
+#define LZ_HASH(p, bits) \
+    (((((unsigned long)(p)[0] << 10) ^ ((unsigned long)(p)[1] << 5) ^ \
+      (p)[2]) * 2654435761UL >> 12) & ((1UL << (bits)) - 1))
+
+/*
+ * Greedy matching against the last position each 3-byte hash was seen at,
+ * which is one probe per byte and finds most of what a source file or
+ * diff repeats.  Returns the compressed length, or 0 if it would not fit
+ * in size bytes.
+ */
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst,
+                   size_t size, word bits) {
+    unsigned long *table;
+    unsigned long h, token;
+    size_t pos, out, flag_pos, cand, dist, max, m, best, n;
+    word nitems;
+
+    if (bits < LZ_MIN_WINDOW_BITS || bits > LZ_MAX_WINDOW_BITS) {
+        panic("lz_compress: bad window bits %d", bits);
+    }
+
+    table = xcalloc(1UL << bits, sizeof(unsigned long), "lz_compress");
+
+    pos = out = flag_pos = 0;
+    nitems = 0;
+    while (pos < len) {
+        if (nitems == 0) {
+            if (out >= size) {
+                goto too_big;
+            }
+            flag_pos = out++;
+            dst[flag_pos] = 0;
+        }
+
+        best = 0;
+        dist = 0;
+        if (pos + LZ_MIN_MATCH <= len) {
+            h = LZ_HASH(src + pos, bits);
+            /* positions are stored + 1 so 0 is an empty slot */
+            cand = table[h];
+            table[h] = pos + 1;
+            if (cand != 0 && pos - (cand - 1) <= (1UL << bits)) {
+                cand--;
+                max = MIN((size_t)LZ_MAX_MATCH(bits), len - pos);
+                for (m = 0; m < max && src[cand + m] == src[pos + m]; m++)
+                    ;
+                if (m >= LZ_MIN_MATCH) {
+                    best = m;
+                    dist = pos - cand;
+                }
+            }
+        }
+
+        if (best) {
+            if (out + 2 > size) {
+                goto too_big;
+            }
+            token = ((dist - 1) << (16 - bits)) | (best - LZ_MIN_MATCH);
+            dst[out++] = (token >> 8) & 0xff;
+            dst[out++] = token & 0xff;
+
+            /* let later matches start inside this one */
+            for (n = 1; n < best && pos + n + LZ_MIN_MATCH <= len; n++) {
+                table[LZ_HASH(src + pos + n, bits)] = pos + n + 1;
+            }
+            pos += best;
+        } else {
+            if (out >= size) {
+                goto too_big;
+            }
+            dst[flag_pos] |= (1 << nitems);
+            dst[out++] = src[pos++];
+        }
+
+        if (++nitems == 8) {
+            nitems = 0;
+        }
+    }
+
+    xfree(&table);
+    return out;
+
+too_big:
+    xfree(&table);
+    return 0;
+}
+
+/*
+ * Fill exactly size bytes of dst, which may be less than src holds.
+ * Returns size, or 0 if src runs out first or points back before the
+ * start of dst.
+ */
+size_t lz_decompress(const unsigned char *src, size_t len, unsigned char *dst,
+                     size_t size, word bits) {
+    size_t in, out, dist, mlen;
+    unsigned long token;
+    word flags, n;
+
+    if (bits < LZ_MIN_WINDOW_BITS || bits > LZ_MAX_WINDOW_BITS) {
+        return 0;
+    }
+
+    in = out = 0;
+    while (out < size) {
+        if (in >= len) {
+            return 0;
+        }
+        flags = src[in++];
+
+        for (n = 0; n < 8 && out < size; n++) {
+            if (flags & (1 << n)) {
+                if (in >= len) {
+                    return 0;
+                }
+                dst[out++] = src[in++];
+                continue;
+            }
+
+            if (in + 2 > len) {
+                return 0;
+            }
+            token = ((unsigned long)src[in] << 8) | src[in + 1];
+            in += 2;
+            dist = (token >> (16 - bits)) + 1;
+            mlen = (token & ((1UL << (16 - bits)) - 1)) + LZ_MIN_MATCH;
+            if (dist > out) {
+                return 0;
+            }
+            if (mlen > size - out) {
+                mlen = size - out;
+            }
+
+            /* byte at a time, the match may overlap what it's copying */
+            while (mlen-- > 0) {
+                dst[out] = dst[out - dist];
+                out++;
+            }
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __LZ_H__
+#define __LZ_H__
+
+#include <types.h>
+#include <stddef.h>
+
+/*
+ * LZSS over a sliding window of 1 << bits bytes.  Each group of eight
+ * items starts with a flag byte, a set bit is a literal byte and a clear
+ * one a big-endian word of (distance - 1) in the top bits and
+ * (length - LZ_MIN_MATCH) in the rest, so a smaller window allows longer
+ * matches.  Decompressing needs no memory besides the output, compressing
+ * needs a (1 << bits) long hash table, so the small windows are for when
+ * memory is tight.
+ */
+#define LZ_MIN_MATCH		3
+#define LZ_MIN_WINDOW_BITS	8
+#define LZ_MAX_WINDOW_BITS	13
+#define LZ_WINDOW_BITS		12
+
+#define LZ_MAX_MATCH(bits)	(LZ_MIN_MATCH + (1L << (16 - (bits))) - 1)
+
+/* these return 0 if dst isn't big enough, or (decompress) src is junk */
+size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst,
+  size_t size, word bits);
+size_t lz_decompress(const unsigned char *src, size_t len, unsigned char *dst,
+  size_t size, word bits);
+
+#endif
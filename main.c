@@ -36,6 +36,7 @@
 
 #include "NiftySpell.h"
 #include "AmendGS.h"
+#include "bile.h"
 #include "repo.h"
 #include "browser.h"
 #include "focusable.h"
@@ -98,6 +99,7 @@ void about_update_menu(void) {
     DisableMItem(REPO_MENU_ADD_FILE_ID);
     DisableMItem(REPO_MENU_DISCARD_CHANGES_ID);
     DisableMItem(REPO_MENU_APPLY_PATCH_ID);
+    DisableMItem(REPO_MENU_STATS_ID);
 
     DisableMItem(AMENDMENT_MENU_EDIT_ID);
     DisableMItem(AMENDMENT_MENU_EXPORT_ID);
@@ -481,9 +483,16 @@ int main(void) {
          initialize();
          menuDefaults();
          InitCursor();
+#ifdef BILE_TRACE
+         /* every repo opened this session, for host/bile_replay */
+         bile_trace_open((StringPtr)"\pAmendGS.trace");
+#endif
          CheckMessages();
 
          mainEventLoop();
+#ifdef BILE_TRACE
+         bile_trace_close();
+#endif
 
          CloseAllNDAs();
 
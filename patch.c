@@ -21,16 +21,15 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <gsos.h>
-#include <resources.h>
 #include <memory.h>
 #include <misctool.h>
-#include <appleshare.h>
 #include <orca.h>
 
 #include "AmendGS.h"
 #include "repo.h"
 #include "bile.h"
 #include "patch.h"
+#include "stats.h"
 #include "util.h"
 
 static word patch_state;
@@ -82,24 +81,17 @@ int patch_open_source_file(struct repo *repo, StringPtr filename) {
 int patch_open_temp_dest_file(struct repo *repo, StringPtr tmpFile) {
     word error, ret = 0;
     FileInfoRecGS fileRec;
-    ResultBuf255 judgeName = { 255, { 0, { 0 } } };
-    JudgeNameRecGS judgeRec = { 6, 0, 3, NULL, 255, &judgeName, 0 };
+    GSString255 tmpPath;
     word tmpCount = 0;
 
     memset(tmpFile, 0, sizeof(Str255));
-    judgeRec.fileSysID = FGetFSTId(repo->bile->frefnum);
 
     do {
-        do {
-            //check to see if the file exists as we dont want to overwrite an existing file
-            sprintf(tmpFile->text, "tmp.%u", tmpCount++);
-            tmpFile->textLength = strlen(tmpFile->text);
-            getpath(repo->bile->frefnum, tmpFile, &judgeName.bufString, true);
-        } while (FStat(&judgeName.bufString, &fileRec) != fileNotFound);
-        //not sure we need this...in fact I know we dont as what do I expect it to do?
-        //I was going to go down a different path and just left it in.
-        JudgeNameGS(&judgeRec);
-    } while (judgeRec.nameFlags & 0x4000);
+        //check to see if the file exists as we dont want to overwrite an existing file
+        sprintf(tmpFile->text, "tmp.%u", tmpCount++);
+        tmpFile->textLength = strlen(tmpFile->text);
+        getpath(repo->bile->frefnum, tmpFile, &tmpPath, true);
+    } while (FStat(&tmpPath, &fileRec) != fileNotFound);
 
     error = FCreate(repo->bile->frefnum, tmpFile, 0x04, 0, 0);
     if (error && error != dupPathname) {
@@ -133,9 +125,10 @@ void doRename(struct repo *repo, StringPtr srcfile, StringPtr tmpFile, GSString2
     //rename to tmp file as the original file
     FRename(&source, &dest);
 
-    //set the stats upto the creation time
+    //set the stats upto the creation time on the file now at the original name
     fileRec.pCount = 6;
-    SetFileInfoGS(&fileRec);
+    fileRec.pathname = &dest;
+    FSetInfo(&fileRec);
 }
 
 word patch_process(struct repo *repo, StringPtr filename) {
@@ -152,16 +145,18 @@ word patch_process(struct repo *repo, StringPtr filename) {
     long fromLine = 0;
     TimeRec now;
     long secs;
-    CreateRecGS createRec = { 5, &backupPath, 0x00E3, 0x000F, 0, 0x000D };
     bool partial = false;
 
+    STAT_START(STAT_TIME_PATCH);
+
     now = ReadTimeHex();
     getpath(repo->bile->frefnum, NULL, &backupPath, false);
     secs = ConvSeconds(TimeRec2Secs, 0, (Pointer)&now);
-    backupPath.length += sprintf(backupPath.text + backupPath.length, "bck%lX:", secs);
+    backupPath.length += sprintf(backupPath.text + backupPath.length,
+                                 "bck%lX" PATH_SEP_STR, secs);
 
     //create the backup dir
-    CreateGS(&createRec);
+    FMkdir(&backupPath);
 
     patch_err[0] = 0;
 
@@ -186,10 +181,10 @@ word patch_process(struct repo *repo, StringPtr filename) {
 
         switch (patch_state) {
         case PATCH_STATE_HEADER_FROM:
-            if (strncmp(line, "--- ", 4) != 0) {
+            if (strncmp(line, "--- ", 4) == 0) {
+                patch_state = PATCH_STATE_TO;
                 break;
             }
-            patch_state = PATCH_STATE_TO;
             if ((strncmp(line, "@@ ", 3) != 0) || (tofilename.textLength == 0)) {
                 break;
             }
@@ -212,8 +207,10 @@ word patch_process(struct repo *repo, StringPtr filename) {
                 ret = -1;
                 goto patch_done;
             }
+            STAT_COUNT(STAT_PATCH_HUNKS);
             source_line = abs(source_line);
-            if (fromLine < source_line) {
+            /* copy the source_line - 1 lines before the chunk */
+            if (fromLine + 1 < source_line) {
                 patch_state = PATCH_STATE_SETUP_CHUNK;
             } else  {
                 patch_state = PATCH_STATE_CONTEXT;
@@ -256,7 +253,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
                         if (sourceLen >= 0) {
                             sourceBuf[sourceLen] = '\0';
                             if (sourceLen < 1023) {
-                                strcat(sourceBuf, "\r");
+                                strcat(sourceBuf, EOL_STR);
                                 sourceLen++;
                             }
                             FWrite(dest_frefnum, sourceBuf, (longword *)&sourceLen);
@@ -275,6 +272,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
                 ret = -1;
                 goto patch_done;
             }
+            STAT_COUNT(STAT_PATCH_FILES);
             memcpy(&prevFile, &tofilename, sizeof(Str255));
 
             progress("Patching %s", tofilename.text);
@@ -295,7 +293,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
             }
             sourceBuf[sourceLen] = '\0';
             if (sourceLen < 1023) {
-                strcat(sourceBuf, "\r");
+                strcat(sourceBuf, EOL_STR);
                 sourceLen++;
             }
             FWrite(dest_frefnum, sourceBuf, (longword *)&sourceLen);
@@ -306,7 +304,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
         case PATCH_STATE_CONTEXT:
             if (line[0] == '+') {
                 longword len = linelen;
-                strcat(line, "\r");
+                strcat(line, EOL_STR);
                 FWrite(dest_frefnum, line + 1, &len);
                 dest_delta--;
             }
@@ -324,7 +322,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
                     goto patch_done;
                 }
                 if (sourceLen < 1023) {
-                    strcat(sourceBuf, "\r");
+                    strcat(sourceBuf, EOL_STR);
                     sourceLen++;
                 }
                 FWrite(dest_frefnum, sourceBuf, (longword *)&sourceLen);
@@ -344,7 +342,7 @@ word patch_process(struct repo *repo, StringPtr filename) {
             if (sourceLen >= 0) {
                 sourceBuf[sourceLen] = '\0';
                 if (sourceLen < 1023) {
-                    strcat(sourceBuf, "\r");
+                    strcat(sourceBuf, EOL_STR);
                     sourceLen++;
                 }
                 FWrite(dest_frefnum, sourceBuf, (longword *)&sourceLen);
@@ -376,5 +374,6 @@ patch_done:
         }
     }
 
+    STAT_STOP(STAT_TIME_PATCH);
     return ret;
 }
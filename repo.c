@@ -19,21 +19,19 @@
 
 #include <types.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <gsos.h>
-#include <stdfile.h>
-#include <resources.h>
-#include <appleshare.h>
-#include <string.h>
 #include <orca.h>
-#include <qdaux.h>
 #include <misctool.h>
 
 #include "AmendGS.h"
 #include "bile.h"
 #include "diff.h"
 #include "repo.h"
+#include "revcache.h"
+#include "stats.h"
 #include "strnatcmp.h"
 #include "util.h"
 
@@ -42,55 +40,54 @@ segment "repo";
 struct repo* repo_init(struct bile *bile, word is_new);
 void repo_sort_files(struct repo *repo);
 void repo_sort_amendments(struct repo *repo);
+int repo_file_cmp(const void *a, const void *b);
+void repo_file_sort_key(struct repo *repo, struct repo_file *file);
+int repo_amendment_cmp(const void *a, const void *b);
+void repo_insert_file(struct repo *repo, struct repo_file *file);
+void repo_insert_amendment(struct repo *repo,
+                           struct repo_amendment *amendment);
 word repo_get_file_attrs(struct repo *repo, StringPtr filename,
                          struct repo_file_attrs *attrs);
 word repo_file_update(struct repo *repo, struct repo_file *file);
-word repo_diff_header(struct repo *repo,
-                      struct repo_amendment *amendment, char **ret);
 word repo_migrate(struct repo *repo, word is_new);
-bool repo_add_file_filter(struct FileParam *pbp);
-
-struct repo* repo_open(const StringPtr file) {
-    SFReplyRec2 reply;
-    SFTypeList2 types;
-    char prompt[] = "\pOpen Repo:";
-    ResultBuf255Hndl path;
-    ResultBuf255Hndl name;
-    Str255 bilePath = { 0, { 0 } };
-
+void repo_store_hunks(struct repo *repo, word amendment_id,
+                      struct diffed_file *diffed_files, word nfiles);
+size_t repo_log_offset(const unsigned char *data, size_t size);
+bool repo_load_authors(struct repo *repo);
+void repo_write_authors(struct repo *repo);
+bool repo_load_summary(struct repo *repo);
+void repo_rebuild_summary(struct repo *repo);
+void repo_free_amendments(struct repo *repo);
+void repo_write_postings(struct repo *repo, struct repo_file *file);
+void repo_delete_postings(struct repo *repo);
+void repo_load_stats(struct repo *repo);
+void repo_write_stats(struct repo *repo);
+struct repo_stat *repo_find_stat(struct repo *repo, word file_id,
+                                 bool create);
+void repo_remove_stat(struct repo *repo, word file_id);
+word repo_hash_file(struct repo *repo, struct repo_file *file,
+                    unsigned long *hash);
+bool repo_hash_text(struct repo *repo, struct repo_stat *stat);
+struct repo_stat *repo_seed_stat(struct repo *repo, struct repo_file *file);
+
+/* repo_open in repo_ui.c asks for a path, the host CLI already has one */
+struct repo *repo_open_path(const StringPtr path) {
     struct bile *bile;
+    struct repo *repo;
+    char name[256];
 
-    if (file) {
-        bile = bile_open(file);
-    } else {
-        types.numEntries = 1;
-        types.fileTypeEntries[0].flags = 0;
-        types.fileTypeEntries[0].fileType = REPO_TYPE;
-        types.fileTypeEntries[0].auxType = BILE_AUX_TYPE;
-
-        memset(&reply, 0, sizeof(SFReplyRec2));
-        reply.nameRefDesc = refIsNewHandle;
-        reply.pathRefDesc = refIsNewHandle;
-
-        SFGetFile2(0x15, 0x15, refIsPointer, (Ref)prompt, NULL, &types, &reply);
-        if (!reply.good) {
-            return NULL;
-        }
-        path = (ResultBuf255Hndl)reply.pathRef;
-        name = (ResultBuf255Hndl)reply.nameRef;
-        strncpy(bilePath.text, (*path)->bufString.text, (*path)->bufString.length);
-        bilePath.textLength = (*path)->bufString.length;
-        bile = bile_open(&bilePath);
-    }
+    STAT_START(STAT_TIME_REPO_OPEN);
 
+    bile = bile_open(path);
     if (bile == NULL) {
+        memcpy(name, path->text, path->textLength);
+        name[path->textLength] = '\0';
         if (bile_error(NULL) == BILE_ERR_NEED_UPGRADE_1) {
-            warn("File %s is a version 1 repo and must be upgraded",
-                 (*name)->bufString.text);
+            warn("File %s is a version 1 repo and must be upgraded", name);
         } else {
-            warn("Opening repo %s failed: %d", (*name)->bufString.text,
-                 bile_error(NULL));
+            warn("Opening repo %s failed: %d", name, bile_error(NULL));
         }
+        STAT_STOP(STAT_TIME_REPO_OPEN);
         return NULL;
     }
 
@@ -98,123 +95,125 @@ struct repo* repo_open(const StringPtr file) {
     bile_verify(bile);
 
     progress("Reading repository...");
-    return repo_init(bile, 0);
+    repo = repo_init(bile, 0);
 
-    if (reply.good) {
-        DisposeHandle((Handle)reply.pathRef);
-        DisposeHandle((Handle)reply.nameRef);
-    }
+    STAT_STOP(STAT_TIME_REPO_OPEN);
+    return repo;
 }
 
-struct repo* repo_create(void) {
-    SFReplyRec reply;
+/* create a new repo at path, replacing whatever file is there */
+struct repo *repo_create_path(const StringPtr path) {
     struct bile *bile;
-    word error;
-    char prompt[] = "\pCreate new repository:";
-    GSString255 fullPath = { 0 };
-
-    SFPutFile(0x15, 0x15, prompt, NULL, 254, &reply);
-
-    if (!reply.good) {
-        return NULL;
-    }
+    GSString255 fullPath;
+    char name[256];
 
-    strcpy(fullPath.text, reply.fullPathname + 1);
-    fullPath.length = reply.fullPathname[0];
-    bile = bile_create((StringPtr)&reply.fullPathname, AMEND_CREATOR, REPO_TYPE);
+    bile = bile_create(path, AMEND_CREATOR, REPO_TYPE);
     if (bile == NULL && bile_error(NULL) == dupPathname) {
-        error = FSDelete(&fullPath);
+        s2gstr(fullPath, (*path));
+        FSDelete(&fullPath);
 
-        bile = bile_create((StringPtr)&reply.fullPathname, AMEND_CREATOR, REPO_TYPE);
+        bile = bile_create(path, AMEND_CREATOR, REPO_TYPE);
     }
     if (bile == NULL) {
-        panic("Failed to create %s: %d", p2cstr(reply.filename), error);
+        memcpy(name, path->text, path->textLength);
+        name[path->textLength] = '\0';
+        warn("Failed to create %s: %d", name, bile_error(NULL));
+        return NULL;
     }
+    revcache_delete(bile);
+    revcache_stamp_repo(bile);
 
     return repo_init(bile, 1);
 }
 
 struct repo* repo_init(struct bile *bile, word is_new) {
-    struct bile_object *bob;
+    struct bile_object *bob, *objects;
     struct repo *repo;
-    size_t size;
+    struct repo_file *file;
+    const unsigned char *view;
     char *data;
-    unsigned long i;
+    unsigned long i, nfiles;
 
-    repo = xmalloczero(sizeof(struct repo), "repo");
-    repo->bile = bile;
-    repo->next_file_id = 1;
-    repo->next_amendment_id = 1;
+    repo = repo_alloc(bile);
 
     if (repo_migrate(repo, is_new) != 0) {
+        repo_free_records(repo);
         xfree(&repo);
         return NULL;
     }
 
-    /* fill in file info */
-    repo->nfiles = bile_count_by_type(bile, REPO_FILE_RTYPE);
-    if (repo->nfiles) {
-        repo->files = xcalloc(repo->nfiles, sizeof(Ptr), "repo files");
-        for (i = 0; i < repo->nfiles; i++) {
-            bob = bile_get_nth_of_type(bile, i, REPO_FILE_RTYPE);
-            if (bob == NULL) panic("no %ld file, but count said it should be there", i);
-            size = bile_read_alloc(bile, REPO_FILE_RTYPE, bob->id, &data);
-            if (size == 0) panic("failed fetching file %ld", bob->id);
-            repo->files[i] = xmalloczero(sizeof(struct repo_file),
-                                         "repo file");
-            repo->files[i] = repo_parse_file(bob->id, (unsigned char *)data,
-                                             size);
-            if (repo->files[i]->id >= repo->next_file_id) repo->next_file_id = repo->files[i]->id + 1;
-            xfree(&data);
+    /* fill in file info, leaving out any that are damaged */
+    nfiles = bile_objects_by_type(bile, REPO_FILE_RTYPE, &objects);
+    if (nfiles) {
+        repo->files = xcalloc(nfiles, sizeof(Ptr), "repo files");
+        for (i = 0; i < nfiles; i++) {
+            bob = &objects[i];
+            view = bile_object_data(bile, bob, &data);
+            if (view == NULL) {
+                warn("Failed fetching file %ld: %d", bob->id,
+                     bile_error(bile));
+                continue;
+            }
+            file = repo_parse_file(repo, bob->id, view,
+                                   bile_object_size(bile, bob));
+            if (data != NULL) {
+                xfree(&data);
+            }
+            if (file == NULL) {
+                continue;
+            }
+            repo->files[repo->nfiles++] = file;
+            if (file->id >= repo->next_file_id) repo->next_file_id = file->id + 1;
         }
+        xfree(&objects);
     }
     repo_sort_files(repo);
 
-    /* fill in amendment info */
-    repo->namendments = bile_count_by_type(bile, REPO_AMENDMENT_RTYPE);
-    if (repo->namendments) {
-        repo->amendments = xcalloc(repo->namendments, sizeof(Ptr),
-                                   "repo amendments");
-        for (i = 0; i < repo->namendments; i++) {
-            bob = bile_get_nth_of_type(bile, i, REPO_AMENDMENT_RTYPE);
-            if (bob == NULL) panic("no %ld amendment, but count said it should be there",
-                                   i);
-            size = bile_read_alloc(bile, REPO_AMENDMENT_RTYPE, bob->id,
-                                   &data);
-            if (size == 0) panic("failed fetching amendment %ld", bob->id);
-            repo->amendments[i] = repo_parse_amendment(bob->id,
-                                                       (unsigned char *)data, size);
-            if (repo->amendments[i]->id >= repo->next_amendment_id) repo->next_amendment_id = repo->amendments[i]->id + 1;
-            xfree(&data);
-        }
+    /* fill in amendment info, logs are read when they're needed */
+    if (!repo_load_summary(repo)) {
+        progress("Indexing amendments...");
+        repo_rebuild_summary(repo);
+        progress(NULL);
     }
     repo_sort_amendments(repo);
 
     return repo;
 }
 
-void repo_close(struct repo *repo) {
-    struct repo_file *file;
-    struct repo_amendment *amendment;
-    word i;
+/*
+ * An empty repo over bile, with nothing read from it yet.  The parsers
+ * need no more than this, so host tools make one over a bile that was
+ * never opened.
+ */
+struct repo *repo_alloc(struct bile *bile) {
+    struct repo *repo;
 
-    for (i = 0; i < repo->namendments; i++) {
-        amendment = repo->amendments[i];
-        if (amendment == NULL) {
-            continue;
-        }
+    repo = xmalloczero(sizeof(struct repo), "repo");
+    repo->bile = bile;
+    repo->next_file_id = 1;
+    repo->next_amendment_id = 1;
+    pool_init(&repo->file_pool, sizeof(struct repo_file), 32, "repo files");
+    pool_init(&repo->amendment_pool, sizeof(struct repo_amendment), 256,
+              "repo amendments");
+    arena_init(&repo->arena, 4096, "repo arena");
 
-        if (amendment->log != NULL) {
-            DisposeHandle(amendment->log);
-        }
+    return repo;
+}
 
-        if (amendment->file_ids != NULL) {
-            xfree(&amendment->file_ids);
-        }
+/* everything repo_close frees but the bile and the repo itself */
+void repo_free_records(struct repo *repo) {
+    struct repo_file *file;
+    word i;
+
+    repo_free_amendments(repo);
 
-        xfree(&amendment);
+    for (i = 0; i < repo->nauthors; i++) {
+        xfree(&repo->authors[i]);
     }
-    xfree(&repo->amendments);
+    if (repo->authors != NULL) {
+        xfree(&repo->authors);
+    }
+    repo->nauthors = 0;
 
     for (i = 0; i < repo->nfiles; i++) {
         file = repo->files[i];
@@ -222,28 +221,69 @@ void repo_close(struct repo *repo) {
             continue;
         }
 
-        xfree(&file);
+        if (file->postings != NULL) {
+            xfree(&file->postings);
+        }
+    }
+    if (repo->files != NULL) {
+        xfree(&repo->files);
+    }
+    repo->nfiles = 0;
+    pool_destroy(&repo->file_pool);
+
+    if (repo->revcache != NULL) {
+        revcache_close(repo->revcache);
+        repo->revcache = NULL;
+    }
+
+    if (repo->stats != NULL) {
+        xfree(&repo->stats);
     }
-    xfree(&repo->files);
+    repo->nstats = 0;
+
+    pool_destroy(&repo->amendment_pool);
+    arena_free(&repo->arena);
+}
+
+void repo_close(struct repo *repo) {
+    repo_free_records(repo);
 
     bile_close(repo->bile);
+    xfree(&repo->bile);
     xfree(&repo);
 }
 
-struct repo_file* repo_parse_file(unsigned long id, unsigned char *data,
-                                  size_t size) {
+/*
+ * The parsers take an object's data straight off the disk, so nothing is
+ * read past size and an object that doesn't add up is refused with NULL
+ * and the bile's error set to BILE_ERR_BOGUS_OBJECT.
+ */
+struct repo_file* repo_parse_file(struct repo *repo, unsigned long id,
+                                  const unsigned char *data, size_t size) {
     struct repo_file *file;
     word len, datapos;
 
+    /* filename pstr, type, auxtype, ctime, mtime, flags */
+    if (size < 1 || data[0] > sizeof(file->filename.text) - 1 ||
+        size != 1 + data[0] + 4 + 4 + 4 + 4 + 1) {
+        warn("repo_parse_file: file %lu: object size %lu doesn't fit it",
+             id, size);
+        repo->bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        return NULL;
+    }
+
     datapos = 0;
 
-    file = xmalloczero(sizeof(struct repo_file), "repo_parse_file");
+    file = pool_alloc(&repo->file_pool);
     file->id = id;
 
     /* filename, pstr */
     len = data[0];
     memcpy(file->filename.text, data + 1, len);
-    file->filename.text[len] = '\0';
+    /* Str255.text has no room for a NUL after 255 characters */
+    if (len < sizeof(file->filename.text)) {
+        file->filename.text[len] = '\0';
+    }
     file->filename.textLength = len;
     datapos += (len + 1);
 
@@ -253,38 +293,48 @@ struct repo_file* repo_parse_file(unsigned long id, unsigned char *data,
     memcpy(&file->auxType, data + datapos, 4);
     datapos += 4;
 
-    /* creation date, long */
-    file->ctime = ((unsigned long)data[datapos] << 24) |
-        ((unsigned long)data[datapos + 1] << 16) |
-        ((unsigned long)data[datapos + 2] << 8) |
-        ((unsigned long)data[datapos + 3]);
-    //memcpy(&file->ctime, data + datapos, 4);
+    /* creation date, long, little-endian as repo_file_update stores it */
+    file->ctime = ((unsigned long)data[datapos + 3] << 24) |
+        ((unsigned long)data[datapos + 2] << 16) |
+        ((unsigned long)data[datapos + 1] << 8) |
+        ((unsigned long)data[datapos]);
     datapos += 4;
 
     /* modification date, long */
-    file->mtime = ((unsigned long)data[datapos] << 24) |
-        ((unsigned long)data[datapos + 1] << 16) |
-        ((unsigned long)data[datapos + 2] << 8) |
-        ((unsigned long)data[datapos + 3]);
+    file->mtime = ((unsigned long)data[datapos + 3] << 24) |
+        ((unsigned long)data[datapos + 2] << 16) |
+        ((unsigned long)data[datapos + 1] << 8) |
+        ((unsigned long)data[datapos]);
     datapos += 4;
 
     /* flags, unsigned char */
     file->flags = data[datapos];
-    datapos += 1;
 
-    if (datapos != size) panic("repo_parse_file object size %lu, data position %d", size,
-                               datapos);
+    repo_file_sort_key(repo, file);
 
     return file;
 }
 
-struct repo_amendment* repo_parse_amendment(unsigned long id,
-                                            unsigned char *data, size_t size) {
+struct repo_amendment* repo_parse_amendment(struct repo *repo,
+                                            unsigned long id,
+                                            const unsigned char *data,
+                                            size_t size) {
     struct repo_amendment *amendment;
+    char author[REPO_AUTHOR_SIZE];
+    size_t datapos;
     word len, i;
 
-    amendment = xmalloczero(sizeof(struct repo_amendment),
-                            "repo_parse_amendment");
+    /* everything up to the log, then the log itself */
+    datapos = repo_log_offset(data, size);
+    if (datapos == 0 ||
+        ((data[datapos] << 8) | data[datapos + 1]) > size - datapos - 2) {
+        warn("repo_parse_amendment: amendment %lu: object size %lu doesn't "
+             "fit it", id, size);
+        repo->bile->last_error = BILE_ERR_BOGUS_OBJECT;
+        return NULL;
+    }
+
+    amendment = pool_alloc(&repo->amendment_pool);
     amendment->id = id;
 
     /* date */
@@ -296,9 +346,10 @@ struct repo_amendment* repo_parse_amendment(unsigned long id,
 
     /* author, pstr */
     len = data[0];
-    if (len > sizeof(amendment->author) - 1) len = sizeof(amendment->author) - 1;
-    memcpy(amendment->author, data + 1, len);
-    amendment->author[len] = '\0';
+    if (len > sizeof(author) - 1) len = sizeof(author) - 1;
+    memcpy(author, data + 1, len);
+    author[len] = '\0';
+    amendment->author = repo_intern_author(repo, author);
     data += (data[0] + 1);
 
     /* files, word */
@@ -306,8 +357,8 @@ struct repo_amendment* repo_parse_amendment(unsigned long id,
     data += 2;
 
     if (amendment->nfiles) {
-        amendment->file_ids = xcalloc(amendment->nfiles, sizeof(word),
-                                      "amendment file_ids");
+        amendment->file_ids = arena_calloc(&repo->arena, amendment->nfiles,
+                                           sizeof(word));
         for (i = 0; i < amendment->nfiles; i++) {
             amendment->file_ids[i] = (data[0] << 8) | data[1];
             data += 2;
@@ -322,264 +373,590 @@ struct repo_amendment* repo_parse_amendment(unsigned long id,
     amendment->subs = (data[0] << 8) | data[1];
     data += 2;
 
-    /* log message, word-length */
-    len = (data[0] << 8) | data[1];
-    data += 2;
-    amendment->log = xNewHandle(len + 1);
-    amendment->log_len = len;
-    HLock(amendment->log);
-    memcpy(*(amendment->log), data, len);
-    (*(amendment->log))[len] = '\0';
-    HUnlock(amendment->log);
-    data += len;
-
-    /* TODO: use datapos and check against size like repo_parse_file */
+    /* log message, word-length, left for repo_amendment_log */
+    amendment->log_len = (data[0] << 8) | data[1];
 
     return amendment;
 }
 
-struct repo_file* repo_file_with_id(struct repo *repo, word id) {
-    word i;
+/* where the word-length log message starts in an AMND object, 0 if bogus */
+size_t repo_log_offset(const unsigned char *data, size_t size) {
+    size_t pos, nfiles;
 
-    for (i = 0; i < repo->nfiles; i++) {
-        if (repo->files[i]->id == id) {
-            return repo->files[i];
-        }
+    /* date, author pstr */
+    pos = 4;
+    if (pos + 1 > size) {
+        return 0;
     }
+    pos += data[pos] + 1;
 
-    return NULL;
-}
+    /* files, adds, subs */
+    if (pos + 2 > size) {
+        return 0;
+    }
+    nfiles = (data[pos] << 8) | data[pos + 1];
+    pos += 2 + (nfiles * 2) + 2 + 2;
 
-word repo_diff_header(struct repo *repo, struct repo_amendment *amendment,
-                      char **ret) {
-    word header_len;
-    word i;
+    /* and the log's length */
+    if (pos + 2 > size) {
+        return 0;
+    }
 
-    *ret = xmalloc(128 + amendment->log_len, "repo_diff_header");
-    header_len = sprintf(*ret,
-                         "Author:\t%s\r"
-                         "Date:\t%s\r"
-                         "\r  ",
-                         amendment->author,
-                         timeString(amendment->date));
+    return pos;
+}
 
-    /* copy log, indenting each line */
-    HLock(amendment->log);
-    for (i = 0; i < amendment->log_len; i++) {
-        *(*ret + header_len++) = (*(amendment->log))[i];
+/*
+ * Logs aren't kept in memory for every amendment, read this one's from
+ * its AMND object if it hasn't been yet or the memory manager purged it.
+ * The handle is purgeable, lock it while using it.
+ */
+Handle repo_amendment_log(struct repo *repo, struct repo_amendment *amendment) {
+    unsigned char *data;
+    size_t size, pos;
+    word len = 0;
 
-        if ((*(amendment->log))[i] == '\r' && i < amendment->log_len - 1) {
-            *(*ret + header_len++) = ' ';
-            *(*ret + header_len++) = ' ';
+    if (amendment->log != NULL) {
+        if (*(amendment->log) != NULL) {
+            return amendment->log;
         }
+        DisposeHandle(amendment->log);
+        amendment->log = NULL;
+    }
+
+    size = bile_read_alloc(repo->bile, REPO_AMENDMENT_RTYPE, amendment->id,
+                           &data);
+
+    /* a damaged AMND shows up as an empty log rather than taking us down */
+    pos = size ? repo_log_offset(data, size) : 0;
+    if (pos != 0) {
+        len = (data[pos] << 8) | data[pos + 1];
+        pos += 2;
+    }
+    if (pos == 0 || len > size - pos) {
+        warn("Amendment %d is damaged, its log can't be read",
+             amendment->id);
+        len = 0;
+    }
+
+    amendment->log = xNewHandle(len + 1);
+    amendment->log_len = len;
+    HLock(amendment->log);
+    if (len > 0) {
+        memcpy(*(amendment->log), data + pos, len);
     }
+    (*(amendment->log))[len] = '\0';
     HUnlock(amendment->log);
-    *(*ret + header_len++) = '\r';
-    *(*ret + header_len++) = '\r';
+    SetPurge(1, amendment->log);
+    if (data != NULL) {
+        xfree(&data);
+    }
 
-    return header_len;
+    return amendment->log;
 }
 
-void repo_show_diff_text(struct repo *repo, struct repo_amendment *amendment,
-                         Handle te) {
-    char truncbuf[64];
-    struct bile_object *bob;
-    size_t size;
-    char *dtext;
-    char *buf = NULL;
-    unsigned long diff_len, all_len;
-    word header_len, blen, trunc = 0;
-    word warn_off;
-    TERecordHndl teRec = (TERecordHndl)te;
+char *repo_intern_author(struct repo *repo, const char *author) {
+    char *copy;
+    size_t len;
+    word i;
 
+    len = strlen(author);
+    if (len > REPO_AUTHOR_SIZE - 1) len = REPO_AUTHOR_SIZE - 1;
 
-    bob = bile_find(repo->bile, REPO_DIFF_RTYPE, amendment->id);
-    if (bob == NULL) {
-        warn("Failed finding DIFF %d, corrupted repo?", amendment->id);
-        return;
+    for (i = 0; i < repo->nauthors; i++) {
+        if (strlen(repo->authors[i]) == len &&
+            strncmp(repo->authors[i], author, len) == 0) {
+            return repo->authors[i];
+        }
     }
 
-    diff_len = bob->size;
-    if (diff_len == 0) {
-        panic("diff zero bytes");
-    }
+    copy = xmalloc(len + 1, "repo author");
+    memcpy(copy, author, len);
+    copy[len] = '\0';
 
-    header_len = repo_diff_header(repo, amendment, &buf);
+    repo->authors = xreallocarray(repo->authors, repo->nauthors + 1,
+                                  sizeof(char *));
+    repo->authors[repo->nauthors++] = copy;
+    repo->authors_dirty = true;
 
-    all_len = header_len + diff_len;
-    if (all_len >= MAX_TEXTEDIT_SIZE) {
-        all_len = MAX_TEXTEDIT_SIZE;
-        trunc = 1;
-    }
+    return copy;
+}
 
-    dtext = xmalloc(all_len, "repo_show_diff_text");
-    memcpy(dtext, buf, header_len);
-    xfree(&buf);
+bool repo_load_authors(struct repo *repo) {
+    unsigned char *data;
+    size_t size, pos;
+    word count, len, i;
+    char author[REPO_AUTHOR_SIZE];
 
-    size = bile_read_object(repo->bile, bob, dtext + header_len,
-                            all_len - header_len);
-    if (size == 0) {
-        panic("failed reading diff %lu: %d", amendment->id,
-              bile_error(repo->bile));
+    size = bile_read_alloc(repo->bile, REPO_AUTHORS_RTYPE, 1, &data);
+    if (size < sizeof(word)) {
+        if (data != NULL) {
+            xfree(&data);
+        }
+        return false;
     }
 
-    if (trunc) {
-        warn_off = MAX_TEXTEDIT_SIZE - header_len -
-            strlen(REPO_DIFF_TOO_BIG);
-        blen = snprintf(truncbuf, sizeof(truncbuf), REPO_DIFF_TOO_BIG,
-                        diff_len - warn_off);
-        memcpy(dtext + MAX_TEXTEDIT_SIZE - blen, truncbuf, blen);
+    memcpy(&count, data, sizeof(word));
+    pos = sizeof(word);
+    for (i = 0; i < count; i++) {
+        if (pos >= size || pos + data[pos] + 1 > size) {
+            xfree(&data);
+            return false;
+        }
+        len = data[pos];
+        if (len > sizeof(author) - 1) len = sizeof(author) - 1;
+        memcpy(author, data + pos + 1, len);
+        author[len] = '\0';
+        pos += data[pos] + 1;
+        repo_intern_author(repo, author);
     }
+    xfree(&data);
 
-    /* manually reset scroll without TESetSelect(0, 0, te) which redraws */
-    (*teRec)->textFlags &= ~fReadOnly;
-    TEInsert(0x0005, (Ref)dtext, all_len, 0, 0, te);
-    (*teRec)->textFlags |= fReadOnly;
-    xfree(&dtext);
-}
+    /* interning them all again changes nothing on disk */
+    repo->authors_dirty = false;
 
+    return (repo->nauthors == count);
+}
 
-struct repo_file* repo_add_file(struct repo *repo) {
-    SFReplyRec2 reply;
-    SFTypeList2 types;
-    GSString255 pathname;
-    PrefixRecGS prefixRec = { 2, 8 };
-    char prompt[] = { "\pSelect File to Add" };
-    ResultBuf255Hndl filePath, fileName;
-    struct repo_file *file;
+void repo_write_authors(struct repo *repo) {
+    char *data;
+    size_t size, pos;
     word i;
 
-    /* start SFGetFile2 from this dir */
-    getpath(repo->bile->frefnum, NULL, &pathname, false);
+    size = sizeof(word);
+    for (i = 0; i < repo->nauthors; i++) {
+        size += 1 + strlen(repo->authors[i]);
+    }
 
-    prefixRec.buffer.setPrefix = &pathname;
-    SetPrefixGS(&prefixRec);
+    data = xmalloc(size, "repo_write_authors");
+    memcpy(data, &repo->nauthors, sizeof(word));
+    pos = sizeof(word);
+    for (i = 0; i < repo->nauthors; i++) {
+        data[pos] = strlen(repo->authors[i]);
+        memcpy(data + pos + 1, repo->authors[i], data[pos]);
+        pos += data[pos] + 1;
+    }
 
-    types.numEntries = 0;
-    types.fileTypeEntries[0].flags = 0;
-    types.fileTypeEntries[0].fileType = 0x04;
-    types.fileTypeEntries[0].auxType = 0;
+    if (bile_write(repo->bile, REPO_AUTHORS_RTYPE, 1, data, size) != size) {
+        panic("Failed storing authors in repo file: %d",
+              bile_error(repo->bile));
+    }
+    xfree(&data);
+    repo->authors_dirty = false;
+}
 
-    reply.nameRefDesc = refIsNewHandle;
-    reply.pathRefDesc = refIsNewHandle;
+bool repo_load_summary(struct repo *repo) {
+    struct bile_object *objects;
+    struct repo_summary rec;
+    struct repo_amendment *amendment;
+    const unsigned char *data;
+    char *copy;
+    size_t npages, n, size, pos;
+    word namendments, count, i;
 
-    SFGetFile2(0x15, 0x15, refIsPointer, (Ref)prompt, NULL, &types, &reply);
-    if (!reply.good) {
-        return NULL;
+    namendments = bile_count_by_type(repo->bile, REPO_AMENDMENT_RTYPE);
+    if (namendments == 0) {
+        repo_load_authors(repo);
+        return true;
     }
 
-    filePath = (ResultBuf255Hndl)reply.pathRef;
-    fileName = (ResultBuf255Hndl)reply.nameRef;
+    if (!repo_load_authors(repo)) {
+        return false;
+    }
 
-    /* if the file is not in the same dir as the repo, bail */
-    if (strncmp((*filePath)->bufString.text, pathname.text, pathname.length) != 0) {
-        warn("Can't add files from a directory other than the repo's");
-        return NULL;
+    npages = bile_objects_by_type(repo->bile, REPO_SUMMARY_RTYPE, &objects);
+    if (npages == 0) {
+        return false;
     }
 
-    /* make sure the file isn't already in the repo */
+    repo->amendments = xcalloc(namendments, sizeof(Ptr), "repo amendments");
 
-    for (i = 0; i < repo->nfiles; i++) {
-        file = repo->files[i];
-        if ((file->filename.textLength == (*fileName)->bufString.length) &&
-            (strncmp(repo->files[i]->filename.text, (*fileName)->bufString.text, (*fileName)->bufString.length) == 0)) {
-            char tmp[32];
-            g2cstr(tmp, (*fileName)->bufString);
-            warn("%s already exists in this repo", tmp);
-            DisposeHandle((Handle)filePath);
-            DisposeHandle((Handle)fileName);
-            return NULL;
+    for (n = 0; n < npages; n++) {
+        /* the length it decompresses to, not size with its flag bit */
+        size = bile_object_size(repo->bile, &objects[n]);
+        if (size < sizeof(word)) {
+            goto summary_bail;
+        }
+        data = bile_object_data(repo->bile, &objects[n], &copy);
+        if (data == NULL) {
+            goto summary_bail;
         }
-    }
 
-    WaitCursor();
+        memcpy(&count, data, sizeof(word));
+        pos = sizeof(word);
+        for (i = 0; i < count; i++) {
+            if (pos + sizeof(rec) > size) {
+                break;
+            }
+            memcpy(&rec, data + pos, sizeof(rec));
+            pos += sizeof(rec);
+            if (pos + (rec.nfiles * sizeof(word)) > size ||
+                rec.author >= repo->nauthors ||
+                repo->namendments == namendments) {
+                break;
+            }
 
-    repo->nfiles++;
-    repo->files = xrealloc(repo->files, repo->nfiles * sizeof(Ptr));
-    file = repo->files[repo->nfiles - 1] =
-        xmalloczero(sizeof(struct repo_file), "repo_add_file");
+            amendment = pool_alloc(&repo->amendment_pool);
+            amendment->id = rec.id;
+            amendment->date = rec.date;
+            amendment->author = repo->authors[rec.author];
+            amendment->adds = rec.adds;
+            amendment->subs = rec.subs;
+            amendment->log_len = rec.log_len;
+            amendment->nfiles = rec.nfiles;
+            if (rec.nfiles) {
+                amendment->file_ids = arena_calloc(&repo->arena, rec.nfiles,
+                                                   sizeof(word));
+                memcpy(amendment->file_ids, data + pos,
+                       rec.nfiles * sizeof(word));
+                pos += rec.nfiles * sizeof(word);
+            }
+            repo->amendments[repo->namendments++] = amendment;
+            if (amendment->id >= repo->next_amendment_id) {
+                repo->next_amendment_id = amendment->id + 1;
+            }
+        }
+        if (copy != NULL) {
+            xfree(&copy);
+        }
 
-    file->id = repo->next_file_id;
-    repo->next_file_id++;
-    g2sstr(file->filename, (*fileName)->bufString);
+        if (i != count) {
+            goto summary_bail;
+        }
+    }
+    xfree(&objects);
 
-    repo_file_update(repo, file);
+    /* written by something that doesn't know about SUMMs since */
+    if (repo->namendments != namendments) {
+        repo_free_amendments(repo);
+        return false;
+    }
 
-    repo_sort_files(repo);
+    return true;
 
-    InitCursor();
+summary_bail:
+    xfree(&objects);
+    repo_free_amendments(repo);
+    return false;
+}
 
-    DisposeHandle((Handle)filePath);
-    DisposeHandle((Handle)fileName);
+/* read every AMND to build the amendment list and its SUMM objects */
+void repo_rebuild_summary(struct repo *repo) {
+    struct bile_object *objects;
+    struct repo_amendment *amendment;
+    const unsigned char *data;
+    char *copy;
+    size_t n, nobjects;
+    word page, last_page;
 
-    return file;
-}
+    repo->next_amendment_id = 1;
 
-word repo_file_update(struct repo *repo, struct repo_file *file) {
-    struct repo_file_attrs attrs;
-    size_t size, datapos;
-    word error, len;
-    unsigned char *data;
+    /* anything that didn't keep SUMMs current didn't keep POSTs either */
+    repo_delete_postings(repo);
 
-    error = repo_get_file_attrs(repo, &file->filename, &attrs);
-    if (error && error != fileNotFound) {
-        warn("Failed to get info for %s", file->filename);
-        return -1;
+    n = bile_objects_by_type(repo->bile, REPO_SUMMARY_RTYPE, &objects);
+    while (n > 0) {
+        bile_delete(repo->bile, REPO_SUMMARY_RTYPE, objects[--n].id);
+    }
+    if (objects != NULL) {
+        xfree(&objects);
     }
 
-    if (error == fileNotFound) {
-        file->flags |= REPO_FILE_DELETED;
-    } else {
-        file->flags &= ~REPO_FILE_DELETED;
+    /* damaged amendments are left out, and out of the summary */
+    repo->namendments = 0;
+    nobjects = bile_objects_by_type(repo->bile, REPO_AMENDMENT_RTYPE,
+                                    &objects);
+    if (nobjects == 0) {
+        return;
+    }
 
-        file->type = attrs.type;
-        file->auxType = attrs.auxType;
-        file->ctime = attrs.ctime;
-        file->mtime = attrs.mtime;
+    repo->amendments = xcalloc(nobjects, sizeof(Ptr), "repo amendments");
+    for (n = 0; n < nobjects; n++) {
+        data = bile_object_data(repo->bile, &objects[n], &copy);
+        if (data == NULL) {
+            warn("Failed fetching amendment %ld: %d", objects[n].id,
+                 bile_error(repo->bile));
+            continue;
+        }
+        amendment = repo_parse_amendment(repo, objects[n].id, data,
+                                         bile_object_size(repo->bile,
+                                                          &objects[n]));
+        if (copy != NULL) {
+            xfree(&copy);
+        }
+        if (amendment == NULL) {
+            continue;
+        }
+        repo->amendments[repo->namendments++] = amendment;
+        if (amendment->id >= repo->next_amendment_id) {
+            repo->next_amendment_id = amendment->id + 1;
+        }
     }
+    xfree(&objects);
 
-    /* filename len, filename, type, creator, ctime, mtime, flags */
-    len = 1 + file->filename.textLength + 4 + 4 + 4 + 4 + 1;
+    repo_sort_amendments(repo);
 
-    data = xmalloczero(len, "repo_file_update");
-    datapos = 0;
+    /* newest first, so pages come out in descending order */
+    last_page = 0;
+    for (n = 0; n < repo->namendments; n++) {
+        page = (repo->amendments[n]->id / REPO_SUMMARY_PAGE) + 1;
+        if (page != last_page) {
+            repo_write_summary(repo, repo->amendments[n]->id);
+            last_page = page;
+        }
+    }
+}
 
-    /* copy filename as pstr */
-    memcpy(data, &file->filename, file->filename.textLength + 1);
-    datapos += file->filename.textLength + 1;
+/*
+ * Rewrite the SUMM object holding amendment_id, which must be in the
+ * (sorted) amendment list
+ */
+void repo_write_summary(struct repo *repo, word amendment_id) {
+    struct repo_summary rec;
+    struct repo_amendment *amendment;
+    char *data;
+    size_t size, pos;
+    word page, lo, hi, mid, first, i, j, count;
 
-    /* file type, creator, and dates */
-    memcpy(data + datapos, &file->type, 4);
-    datapos += 4;
-    memcpy(data + datapos, &file->auxType, 4);
-    datapos += 4;
-    memcpy(data + datapos, &file->ctime, 4);
-    datapos += 4;
-    memcpy(data + datapos, &file->mtime, 4);
-    datapos += 4;
-    memcpy(data + datapos, &file->flags, 1);
-    datapos += 1;
+    if (repo->authors_dirty) {
+        repo_write_authors(repo);
+    }
 
-    if (datapos != len) {
-        panic("repo_file_update: datapos %lu, expected %d", datapos, len);
+    page = (amendment_id / REPO_SUMMARY_PAGE) + 1;
+
+    /* amendments are sorted newest first, find the first one on this page */
+    lo = 0;
+    hi = repo->namendments;
+    while (lo < hi) {
+        mid = lo + ((hi - lo) / 2);
+        if ((repo->amendments[mid]->id / REPO_SUMMARY_PAGE) + 1 > page) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
+    first = lo;
 
-    size = bile_write(repo->bile, REPO_FILE_RTYPE, file->id, data, datapos);
-    if (size != datapos) {
-        panic("repo_file_update: failed writing file data: %d",
-              bile_error(repo->bile));
+    size = sizeof(word);
+    count = 0;
+    for (i = first; i < repo->namendments; i++) {
+        amendment = repo->amendments[i];
+        if ((amendment->id / REPO_SUMMARY_PAGE) + 1 != page) {
+            break;
+        }
+        size += sizeof(rec) + (amendment->nfiles * sizeof(word));
+        count++;
+    }
+    if (count == 0) {
+        bile_delete(repo->bile, REPO_SUMMARY_RTYPE, page);
+        return;
     }
 
-    xfree(&data);
-    return 0;
-}
+    data = xmalloc(size, "repo_write_summary");
+    memcpy(data, &count, sizeof(word));
+    pos = sizeof(word);
+    for (i = first; i < first + count; i++) {
+        amendment = repo->amendments[i];
+        rec.id = amendment->id;
+        rec.date = amendment->date;
+        for (j = 0; j < repo->nauthors; j++) {
+            if (repo->authors[j] == amendment->author) {
+                break;
+            }
+        }
+        if (j == repo->nauthors) {
+            panic("amendment %d author not interned", amendment->id);
+        }
+        rec.author = j;
+        rec.nfiles = amendment->nfiles;
+        rec.adds = amendment->adds;
+        rec.subs = amendment->subs;
+        rec.log_len = amendment->log_len;
+        memcpy(data + pos, &rec, sizeof(rec));
+        pos += sizeof(rec);
+        memcpy(data + pos, amendment->file_ids, amendment->nfiles * sizeof(word));
+        pos += amendment->nfiles * sizeof(word);
+    }
+
+    if (bile_write(repo->bile, REPO_SUMMARY_RTYPE, page, data, size) != size) {
+        panic("Failed storing amendment summary in repo file: %d",
+              bile_error(repo->bile));
+    }
+    xfree(&data);
+}
+
+void repo_free_amendments(struct repo *repo) {
+    struct repo_amendment *amendment;
+    word i;
+
+    for (i = 0; i < repo->namendments; i++) {
+        amendment = repo->amendments[i];
+        if (amendment == NULL) {
+            continue;
+        }
+
+        if (amendment->log != NULL) {
+            DisposeHandle(amendment->log);
+        }
+    }
+    if (repo->amendments != NULL) {
+        xfree(&repo->amendments);
+    }
+    repo->namendments = 0;
+
+    /* their file_ids are left in the arena until repo_close */
+    pool_reset(&repo->amendment_pool);
+}
+
+struct repo_file* repo_file_with_id(struct repo *repo, word id) {
+    word i;
+
+    for (i = 0; i < repo->nfiles; i++) {
+        if (repo->files[i]->id == id) {
+            return repo->files[i];
+        }
+    }
+
+    return NULL;
+}
+
+word repo_diff_header(struct repo *repo, struct repo_amendment *amendment,
+                      char **ret) {
+    word header_len;
+    word i, nlines = 0;
+
+    /* purgeable, and the xmalloc below could take it */
+    repo_amendment_log(repo, amendment);
+    HLock(amendment->log);
+
+    /* each line of the log gets indented */
+    for (i = 0; i < amendment->log_len; i++) {
+        if ((*(amendment->log))[i] == EOL_CHAR) {
+            nlines++;
+        }
+    }
+
+    *ret = xmalloc(128 + amendment->log_len + (nlines * 2),
+                   "repo_diff_header");
+    header_len = sprintf(*ret,
+                         "Author:\t%s" EOL_STR
+                         "Date:\t%s" EOL_STR
+                         EOL_STR "  ",
+                         amendment->author,
+                         timeString(amendment->date));
+
+    /* copy log, indenting each line */
+    for (i = 0; i < amendment->log_len; i++) {
+        *(*ret + header_len++) = (*(amendment->log))[i];
+
+        if ((*(amendment->log))[i] == EOL_CHAR && i < amendment->log_len - 1) {
+            *(*ret + header_len++) = ' ';
+            *(*ret + header_len++) = ' ';
+        }
+    }
+    HUnlock(amendment->log);
+    *(*ret + header_len++) = EOL_CHAR;
+    *(*ret + header_len++) = EOL_CHAR;
+
+    return header_len;
+}
+
+/* start tracking name, a file in the repo's directory */
+struct repo_file *repo_add_file_named(struct repo *repo,
+                                      const StringPtr name) {
+    struct repo_file *file;
+    char tmp[256];
+    word i;
+
+    /* make sure the file isn't already in the repo */
+    for (i = 0; i < repo->nfiles; i++) {
+        file = repo->files[i];
+        if ((file->filename.textLength == name->textLength) &&
+            (strncmp(file->filename.text, name->text, name->textLength) == 0)) {
+            memcpy(tmp, name->text, name->textLength);
+            tmp[name->textLength] = '\0';
+            warn("%s already exists in this repo", tmp);
+            return NULL;
+        }
+    }
+
+    file = pool_alloc(&repo->file_pool);
+
+    file->id = repo->next_file_id;
+    repo->next_file_id++;
+    memcpy(&file->filename, name, name->textLength + 1);
+
+    repo_file_update(repo, file);
+
+    repo_file_sort_key(repo, file);
+    repo_insert_file(repo, file);
+
+    return file;
+}
+
+word repo_file_update(struct repo *repo, struct repo_file *file) {
+    struct repo_file_attrs attrs;
+    size_t size, datapos;
+    word error, len;
+    unsigned char *data;
+
+    error = repo_get_file_attrs(repo, &file->filename, &attrs);
+    if (error && error != fileNotFound) {
+        warn("Failed to get info for %s", file->filename);
+        return -1;
+    }
+
+    if (error == fileNotFound) {
+        file->flags |= REPO_FILE_DELETED;
+    } else {
+        file->flags &= ~REPO_FILE_DELETED;
+
+        file->type = attrs.type;
+        file->auxType = attrs.auxType;
+        file->ctime = attrs.ctime;
+        file->mtime = attrs.mtime;
+    }
+
+    /* filename len, filename, type, creator, ctime, mtime, flags */
+    len = 1 + file->filename.textLength + 4 + 4 + 4 + 4 + 1;
+
+    data = xmalloczero(len, "repo_file_update");
+    datapos = 0;
+
+    /* copy filename as pstr */
+    memcpy(data, &file->filename, file->filename.textLength + 1);
+    datapos += file->filename.textLength + 1;
+
+    /* file type, creator, and dates */
+    memcpy(data + datapos, &file->type, 4);
+    datapos += 4;
+    memcpy(data + datapos, &file->auxType, 4);
+    datapos += 4;
+    memcpy(data + datapos, &file->ctime, 4);
+    datapos += 4;
+    memcpy(data + datapos, &file->mtime, 4);
+    datapos += 4;
+    memcpy(data + datapos, &file->flags, 1);
+    datapos += 1;
+
+    if (datapos != len) {
+        panic("repo_file_update: datapos %lu, expected %d", datapos, len);
+    }
+
+    size = bile_write(repo->bile, REPO_FILE_RTYPE, file->id, data, datapos);
+    if (size != datapos) {
+        panic("repo_file_update: failed writing file data: %d",
+              bile_error(repo->bile));
+    }
+
+    xfree(&data);
+    return 0;
+}
 
 word repo_get_file_attrs(struct repo *repo, StringPtr filename,
                          struct repo_file_attrs *attrs) {
     GSString255 path;
     FileInfoRecGS fiRec;
     word error;
-    struct tm ts;
 
     /* lookup file type and creator */
     error = getpath(repo->bile->frefnum, filename, &path, true);
@@ -594,22 +971,7 @@ word repo_get_file_attrs(struct repo *repo, StringPtr filename,
 
     attrs->type = fiRec.fileType;
     attrs->auxType = fiRec.auxType;
-    ts.tm_sec = fiRec.createDateTime.second;
-    ts.tm_min = fiRec.createDateTime.minute;
-    ts.tm_hour = fiRec.createDateTime.hour;
-    ts.tm_year = fiRec.createDateTime.year;
-    ts.tm_mon = fiRec.createDateTime.month;
-    ts.tm_mday = fiRec.createDateTime.day;
-    ts.tm_wday = fiRec.createDateTime.weekDay;
     attrs->ctime = ConvSeconds(TimeRec2Secs, 0, (Pointer)&fiRec.createDateTime);
-
-    ts.tm_sec = fiRec.modDateTime.second;
-    ts.tm_min = fiRec.modDateTime.minute;
-    ts.tm_hour = fiRec.modDateTime.hour;
-    ts.tm_year = fiRec.modDateTime.year;
-    ts.tm_mon = fiRec.modDateTime.month;
-    ts.tm_mday = fiRec.modDateTime.day;
-    ts.tm_wday = fiRec.modDateTime.weekDay;
     attrs->mtime = ConvSeconds(TimeRec2Secs, 0, (Pointer)&fiRec.modDateTime);
 
     return 0;
@@ -618,9 +980,8 @@ word repo_get_file_attrs(struct repo *repo, StringPtr filename,
 word repo_checkout_file(struct repo *repo, struct repo_file *file,
                         StringPtr filename) {
     GSString255 newPath, filePath = { 0 };
-    ChangePathRecGS changeRec = { 2, &filePath, &newPath };
     struct bile_object *textob;
-    size_t size;
+    size_t size, tsize;
     word error, frefnum;
     char *text;
 
@@ -633,8 +994,7 @@ word repo_checkout_file(struct repo *repo, struct repo_file *file,
         return -1;
     }
 
-    ChangePathGS(&changeRec);
-
+    FRename(&filePath, &newPath);
 
     textob = bile_find(repo->bile, REPO_TEXT_RTYPE, file->id);
     if (textob == NULL) {
@@ -661,9 +1021,10 @@ word repo_checkout_file(struct repo *repo, struct repo_file *file,
     }
 
     /* TODO: add offset to bile_read to read in chunks */
-    text = xmalloc(textob->size, "repo_checkout_file");
-    size = bile_read_object(repo->bile, textob, text, textob->size);
-    if (size != textob->size) {
+    tsize = bile_object_size(repo->bile, textob);
+    text = xmalloc(tsize, "repo_checkout_file");
+    size = bile_read_object(repo->bile, textob, text, tsize);
+    if (size != tsize) {
         panic("Failed to read text object %ld: %d", textob->id,
               bile_error(repo->bile));
     }
@@ -681,41 +1042,105 @@ word repo_checkout_file(struct repo *repo, struct repo_file *file,
 }
 
 void repo_sort_files(struct repo *repo) {
-    struct repo_file *file;
-    word i, j;
-
-    for (i = 0; i < repo->nfiles; i++) {
-        for (j = 0; j < repo->nfiles - i - 1; j++) {
-            if (strnatcmp(repo->files[j]->filename.text,
-                          repo->files[j + 1]->filename.text) == 1) {
-                file = repo->files[j];
-                repo->files[j] = repo->files[j + 1];
-                repo->files[j + 1] = file;
-            }
-        }
+    if (repo->nfiles > 1) {
+        qsort(repo->files, repo->nfiles, sizeof(Ptr), repo_file_cmp);
     }
 }
 
 void repo_sort_amendments(struct repo *repo) {
-    struct repo_amendment *amendment;
-    word i, j;
+    word i;
+
+    /* summaries usually come back in order, don't qsort a sorted list */
+    for (i = 1; i < repo->namendments; i++) {
+        if (repo->amendments[i - 1]->id < repo->amendments[i]->id) {
+            break;
+        }
+    }
+    if (i >= repo->namendments) {
+        return;
+    }
 
     /* reverse order, newest amendment first */
-    for (i = 0; i < repo->namendments; i++) {
-        for (j = 0; j < repo->namendments - i - 1; j++) {
-            if (repo->amendments[j]->id < repo->amendments[j + 1]->id) {
-                amendment = repo->amendments[j];
-                repo->amendments[j] = repo->amendments[j + 1];
-                repo->amendments[j + 1] = amendment;
-            }
+    qsort(repo->amendments, repo->namendments, sizeof(Ptr),
+          repo_amendment_cmp);
+}
+
+int repo_file_cmp(const void *a, const void *b) {
+    struct repo_file *fa = *(struct repo_file **)a;
+    struct repo_file *fb = *(struct repo_file **)b;
+
+    return strnat_keycmp(fa->sort_key, fa->sort_key_len, fb->sort_key,
+                         fb->sort_key_len);
+}
+
+/* key the filename once so sorting doesn't re-parse it on every compare */
+void repo_file_sort_key(struct repo *repo, struct repo_file *file) {
+    size_t size;
+
+    size = STRNAT_KEY_SIZE(file->filename.textLength);
+    file->sort_key = arena_alloc(&repo->arena, size);
+    file->sort_key_len = strnat_key(file->filename.text,
+                                    file->filename.textLength,
+                                    file->sort_key, size);
+}
+
+int repo_amendment_cmp(const void *a, const void *b) {
+    struct repo_amendment *aa = *(struct repo_amendment **)a;
+    struct repo_amendment *ab = *(struct repo_amendment **)b;
+
+    if (aa->id > ab->id) {
+        return -1;
+    }
+    return (aa->id < ab->id);
+}
+
+/* add a file to the already-sorted file list */
+void repo_insert_file(struct repo *repo, struct repo_file *file) {
+    word lo = 0, hi = repo->nfiles, mid;
+
+    while (lo < hi) {
+        mid = lo + ((hi - lo) / 2);
+        if (repo_file_cmp(&repo->files[mid], &file) <= 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+
+    repo->files = xreallocarray(repo->files, repo->nfiles + 1, sizeof(Ptr));
+    memmove(repo->files + lo + 1, repo->files + lo,
+            (repo->nfiles - lo) * sizeof(Ptr));
+    repo->files[lo] = file;
+    repo->nfiles++;
+}
+
+/* add an amendment to the already-sorted amendment list */
+void repo_insert_amendment(struct repo *repo,
+                           struct repo_amendment *amendment) {
+    word lo = 0, hi = repo->namendments, mid;
+
+    while (lo < hi) {
+        mid = lo + ((hi - lo) / 2);
+        if (repo->amendments[mid]->id > amendment->id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    repo->amendments = xreallocarray(repo->amendments,
+                                     repo->namendments + 1, sizeof(Ptr));
+    memmove(repo->amendments + lo + 1, repo->amendments + lo,
+            (repo->namendments - lo) * sizeof(Ptr));
+    repo->amendments[lo] = amendment;
+    repo->namendments++;
 }
 
 word repo_diff_file(struct repo *repo, struct repo_file *file) {
     Str255 fromfilename, tofilename;
     GSString255 fromfilepath, tofilepath;
-    Str255 label0, label1;
+    /* a filename, a tab and a timeString */
+    char label0[sizeof(Str255) + 32], label1[sizeof(Str255) + 32];
     struct repo_file_attrs attrs;
     size_t size;
     char *text;
@@ -788,16 +1213,14 @@ word repo_diff_file(struct repo *repo, struct repo_file *file) {
     }
     /* specify diff header labels to avoid printing tmp filename */
     /* (TODO: use paths relative to repo) */
-    snprintf((char *)label0.text, sizeof(label0.text), "%s\t%s", file->filename.text,
+    snprintf(label0, sizeof(label0), "%s\t%s", file->filename.text,
              timeString(file->mtime ? file->mtime : attrs.mtime));
 
-    snprintf((char *)label1.text, sizeof(label1.text), "%s\t%s", file->filename.text,
+    snprintf(label1, sizeof(label1), "%s\t%s", file->filename.text,
              timeString(attrs.mtime));
-    label0.textLength = strlen(label0.text);
-    label1.textLength = strlen(label1.text);
 
-    label[0] = label0.text;
-    label[1] = label1.text;
+    label[0] = label0;
+    label[1] = label1;
 
     strcpy(fromfilename.text, fromfilepath.text);
     fromfilename.textLength = fromfilepath.length;
@@ -829,53 +1252,9 @@ word repo_diff_file(struct repo *repo, struct repo_file *file) {
 }
 
 word repo_file_changed(struct repo *repo, struct repo_file *file) {
-    GSString255 path = { 0 };
-    FileInfoRecGS fiRec;
-    struct bile_object *bob;
-    long fsize;
-    word error;
-
-    /* if there's no existing TEXT resource, it's a new file */
-    bob = bile_find(repo->bile, REPO_TEXT_RTYPE, file->id);
-    if (bob == NULL) {
-        return 1;
-    }
-    fsize = bob->size;
-    xfree(&bob);
-
-    /* lookup file type and creator */
-    error = getpath(repo->bile->frefnum, &file->filename, &path, true);
-    if (error != 0) {
-        return error;
-    }
-
-    error = FStat(&path, &fiRec);
-    if (error) {
-        return error;
-    }
-
-    if (!error) {
-        if (file->flags & REPO_FILE_DELETED) {
-            return 1;
-        }
-    } else {
-        if (file->flags & REPO_FILE_DELETED) {
-            return 0;
-        }
-        return 1;
-    }
-
-    if (fiRec.eof != fsize) {
-        return 1;
-    }
-    if (ConvSeconds(TimeRec2Secs, 0, (Pointer)&fiRec.createDateTime) != file->ctime) {
-        return 1;
-    }
-    if (ConvSeconds(TimeRec2Secs, 0, (Pointer)&fiRec.modDateTime) != file->mtime) {
-        return 1;
-    }
+    word changed;
 
-    return 0;
+    return repo_status(repo, &file->id, 1, &changed);
 }
 
 void repo_export_patch(struct repo *repo, struct repo_amendment *amendment,
@@ -920,8 +1299,9 @@ void repo_export_patch(struct repo *repo, struct repo_amendment *amendment,
     }
     xfree(&buf);
 
-    buf = xmalloc(bob->size, "repo_export_patch");
-    size = bile_read_object(repo->bile, bob, buf, bob->size);
+    size = bile_object_size(repo->bile, bob);
+    buf = xmalloc(size, "repo_export_patch");
+    size = bile_read_object(repo->bile, bob, buf, size);
     error = FWrite(frefnum, buf, &size);
     if (error) {
         panic("Failed to write diff to %s: %d", p2cstr((char *)filename), error);
@@ -940,6 +1320,8 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
 
     Str255 tfilename;
     struct repo_amendment *amendment;
+    struct repo_file *file;
+    struct repo_stat *stat;
     unsigned long datalen, fsize;
     unsigned char *tdata;
     char *amendment_data;
@@ -949,16 +1331,16 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
     word i, error, frefnum;
     TimeRec tm;
 
-    amendment = xmalloczero(sizeof(struct repo_amendment),
-                            "repo_amend amendment");
+    STAT_START(STAT_TIME_REPO_AMEND);
+
+    amendment = pool_alloc(&repo->amendment_pool);
     amendment->id = repo->next_amendment_id;
     tm = ReadTimeHex();
     amendment->date = ConvSeconds(TimeRec2Secs, 0, (Pointer)&tm);
 
     /* find files with actual data changes */
     amendment->nfiles = 0;
-    amendment->file_ids = xcalloc(sizeof(word), nfiles,
-                                  "repo_amend file_ids");
+    amendment->file_ids = arena_calloc(&repo->arena, nfiles, sizeof(word));
     for (i = 0; i < nfiles; i++) {
         if (diffed_files[i].flags & DIFFED_FILE_TEXT) {
             amendment->file_ids[amendment->nfiles] =
@@ -971,7 +1353,7 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
               nfiles);
     }
 
-    strlcpy(amendment->author, author, sizeof(amendment->author));
+    amendment->author = repo_intern_author(repo, author);
     amendment->adds = adds;
     amendment->subs = subs;
 
@@ -989,14 +1371,17 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
     /* store diff */
     HLock(diff);
     progress("Storing diff...");
-    size = bile_write(repo->bile, REPO_DIFF_RTYPE, amendment->id, *diff,
-                      difflen);
+    size = bile_write_compressed(repo->bile, REPO_DIFF_RTYPE, amendment->id,
+                                 *diff, difflen);
     if (size != difflen) {
         panic("Failed storing diff in repo file: %d",
               bile_error(repo->bile));
     }
     HUnlock(diff);
 
+    /* store the structured hunks alongside it for the visualizer */
+    repo_store_hunks(repo, amendment->id, diffed_files, nfiles);
+
     /* store amendment */
     progress("Storing amendment metadata...");
     size = bile_write(repo->bile, REPO_AMENDMENT_RTYPE, amendment->id,
@@ -1012,7 +1397,8 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
         if (diffed_files[i].flags & DIFFED_FILE_TEXT) {
             memcpy(&tfilename, &diffed_files[i].file->filename,
                    sizeof(tfilename));
-            progress("Storing updated %s...", p2cstr((char *) &tfilename));
+            /* filename.text is kept NUL terminated, tfilename stays a pstr */
+            progress("Storing updated %s...", tfilename.text);
 
             /* update file contents if file wasn't deleted */
             error = getpath(repo->bile->frefnum, &tfilename, &path, true);
@@ -1040,13 +1426,26 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
 
                 FClose(frefnum);
 
-                size = bile_write(repo->bile, REPO_TEXT_RTYPE,
-                                  diffed_files[i].file->id, tdata, fsize);
+                size = bile_write_compressed(repo->bile, REPO_TEXT_RTYPE,
+                                             diffed_files[i].file->id, tdata,
+                                             fsize);
                 if (size != fsize) {
                     panic("Failed to write new text file at %s: %d",
                           p2cstr((char *) &tfilename), bile_error(repo->bile));
                 }
+
+                /* what repo_status will compare the file against */
+                stat = repo_find_stat(repo, diffed_files[i].file->id, true);
+                stat->size = fsize;
+                stat->ctime = fiRec.createDateTime;
+                stat->mtime = fiRec.modDateTime;
+                stat->hash = crc32_update(0, tdata, fsize);
+                stat->flags |= REPO_STAT_HASHED;
+                repo->stats_dirty = true;
+
                 xfree(&tdata);
+            } else {
+                repo_remove_stat(repo, diffed_files[i].file->id);
             }
         }
 
@@ -1055,18 +1454,65 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
         }
     }
 
+    repo_write_stats(repo);
+
+    /* repos from before the revcache had stamps get one here */
+    revcache_stamp_repo(repo->bile);
+
     /* flush volume */
     bile_flush(repo->bile, 1);
 
     repo->next_amendment_id = amendment->id + 1;
 
     /* update amendment list */
-    repo->namendments++;
-    repo->amendments = xreallocarray(repo->amendments, repo->namendments,
-                                     sizeof(Ptr));
-    repo->amendments[repo->namendments - 1] = amendment;
+    repo_insert_amendment(repo, amendment);
+    repo_write_summary(repo, amendment->id);
 
-    repo_sort_amendments(repo);
+    /* newest amendment goes at the head of each file's posting list */
+    for (i = 0; i < amendment->nfiles; i++) {
+        file = repo_file_with_id(repo, amendment->file_ids[i]);
+        if (file == NULL) {
+            continue;
+        }
+        /* a list built just now already has it */
+        if (repo_file_postings(repo, file) > 0 &&
+            file->postings[0] == amendment->id) {
+            continue;
+        }
+        file->postings = xreallocarray(file->postings, file->npostings + 1,
+                                       sizeof(word));
+        memmove(file->postings + 1, file->postings,
+                file->npostings * sizeof(word));
+        file->postings[0] = amendment->id;
+        file->npostings++;
+        repo_write_postings(repo, file);
+    }
+
+    STAT_STOP(STAT_TIME_REPO_AMEND);
+}
+
+/*
+ * What the repo holds and what stats_format has counted so far, as
+ * text for the browser or amend stats.  Returns the length like
+ * snprintf, so a NULL buf sizes it.
+ */
+size_t repo_stats(struct repo *repo, char *buf, size_t size) {
+    size_t len;
+
+    len = snprintf(buf, size,
+                   "%s" EOL_STR
+                   "%-24s %10u" EOL_STR
+                   "%-24s %10u" EOL_STR
+                   "%-24s %10lu" EOL_STR
+                   "%-24s %10lu" EOL_STR EOL_STR,
+                   repo->bile->filename.text,
+                   "files", repo->nfiles,
+                   "amendments", repo->namendments,
+                   "bile objects", (unsigned long)repo->bile->nobjects,
+                   "bile file size", (unsigned long)repo->bile->file_size);
+
+    return len + stats_format(buf == NULL ? NULL : buf + MIN(len, size),
+                              size - MIN(len, size));
 }
 
 void repo_marshall_amendment(struct repo_amendment *amendment, char **retdata,
@@ -1076,8 +1522,8 @@ void repo_marshall_amendment(struct repo_amendment *amendment, char **retdata,
     word i;
     char clen;
 
-    /* date (long) */
-    len = sizeof(long);
+    /* date (long, 4 bytes on disk) */
+    len = 4;
 
     /* author (pstr) */
     len += 1 + strlen(amendment->author);
@@ -1173,6 +1619,7 @@ word repo_migrate(struct repo *repo, word is_new) {
     /* 1 had no version number :( */
     /* 1->2 added a version */
     /* 2->3 was switching from resource forks to bile */
+    /* 3->4 allowed compressed TEXT and DIFF objects, nothing to convert */
 
     /* store new version */
     ver = REPO_CUR_VERS;
@@ -1246,4 +1693,582 @@ void repo_backup(struct repo *repo) {
     }
 }
 
+void repo_store_hunks(struct repo *repo, word amendment_id,
+                      struct diffed_file *diffed_files, word nfiles) {
+    struct repo_hunks header;
+    char *data;
+    size_t datalen = 0, pos = 0, size;
+    word i;
+
+    for (i = 0; i < nfiles; i++) {
+        if (diffed_files[i].flags & DIFFED_FILE_TEXT) {
+            datalen += sizeof(struct repo_hunks) +
+              (diffed_files[i].nhunks * sizeof(struct diff_hunk));
+        }
+    }
+    if (datalen == 0) {
+        return;
+    }
+
+    data = xmalloc(datalen, "repo_store_hunks");
+    for (i = 0; i < nfiles; i++) {
+        if (!(diffed_files[i].flags & DIFFED_FILE_TEXT)) {
+            continue;
+        }
+        header.file_id = diffed_files[i].file->id;
+        header.nhunks = diffed_files[i].nhunks;
+        memcpy(data + pos, &header, sizeof(header));
+        pos += sizeof(header);
+        if (header.nhunks) {
+            memcpy(data + pos, diffed_files[i].hunks,
+                   header.nhunks * sizeof(struct diff_hunk));
+            pos += header.nhunks * sizeof(struct diff_hunk);
+        }
+    }
+
+    progress("Storing diff hunks...");
+    size = bile_write(repo->bile, REPO_HUNK_RTYPE, amendment_id, data,
+                      datalen);
+    if (size != datalen) {
+        panic("Failed storing hunks in repo file: %d",
+              bile_error(repo->bile));
+    }
+    xfree(&data);
+}
+
+/*
+ * Fetch the hunks stored for a file in an amendment.  Returns false if
+ * there are none, such as for amendments made before they were stored.
+ */
+bool repo_file_hunks(struct repo *repo, word amendment_id, word file_id,
+                     struct diff_hunk **hunks, word *nhunks) {
+    struct repo_hunks header;
+    char *data;
+    size_t size, pos = 0, hsize;
+
+    *hunks = NULL;
+    *nhunks = 0;
+
+    size = bile_read_alloc(repo->bile, REPO_HUNK_RTYPE, amendment_id, &data);
+    if (size == 0) {
+        return false;
+    }
+
+    while (pos + sizeof(header) <= size) {
+        memcpy(&header, data + pos, sizeof(header));
+        pos += sizeof(header);
+        hsize = header.nhunks * sizeof(struct diff_hunk);
+        if (pos + hsize > size) {
+            break;
+        }
+        if (header.file_id != file_id) {
+            pos += hsize;
+            continue;
+        }
+        if (header.nhunks == 0) {
+            break;
+        }
+        *hunks = xmalloc(hsize, "repo_file_hunks");
+        memcpy(*hunks, data + pos, hsize);
+        *nhunks = header.nhunks;
+        xfree(&data);
+        return true;
+    }
+
+    xfree(&data);
+    return false;
+}
+
+/*
+ * Load the list of amendment ids touching a file, newest first, into
+ * file->postings and return how many there are.  Repos without a POST
+ * object for the file get one built from the amendment list.
+ */
+word repo_file_postings(struct repo *repo, struct repo_file *file) {
+    unsigned char *data;
+    size_t size;
+    word count, i, id;
+    bool valid;
+
+    if (file->postings_loaded) {
+        return file->npostings;
+    }
+
+    size = bile_read_alloc(repo->bile, REPO_POSTING_RTYPE, file->id, &data);
+    if (size >= sizeof(word)) {
+        memcpy(&count, data, sizeof(word));
+        valid = (size == sizeof(word) + (count * sizeof(word)));
+        if (valid && count) {
+            file->postings = xcalloc(count, sizeof(word),
+                                     "repo_file_postings");
+            memcpy(file->postings, data + sizeof(word),
+                   count * sizeof(word));
+            for (i = 0; i < count; i++) {
+                if (file->postings[i] >= repo->next_amendment_id ||
+                    (i > 0 && file->postings[i] >= file->postings[i - 1])) {
+                    valid = false;
+                    break;
+                }
+            }
+            if (!valid) {
+                xfree(&file->postings);
+            }
+        }
+        xfree(&data);
+
+        if (valid) {
+            file->npostings = count;
+            file->postings_loaded = true;
+            return count;
+        }
+    } else if (data != NULL) {
+        xfree(&data);
+    }
+
+    /* amendments are already newest first */
+    file->npostings = 0;
+    file->postings = xcalloc(repo->namendments + 1, sizeof(word),
+                             "repo_file_postings");
+    for (i = 0; i < repo->namendments; i++) {
+        for (id = 0; id < repo->amendments[i]->nfiles; id++) {
+            if (repo->amendments[i]->file_ids[id] == file->id) {
+                file->postings[file->npostings++] = repo->amendments[i]->id;
+                break;
+            }
+        }
+    }
+    file->postings_loaded = true;
+    repo_write_postings(repo, file);
+
+    return file->npostings;
+}
+
+void repo_write_postings(struct repo *repo, struct repo_file *file) {
+    char *data;
+    size_t size;
+
+    size = sizeof(word) + (file->npostings * sizeof(word));
+    data = xmalloc(size, "repo_write_postings");
+    memcpy(data, &file->npostings, sizeof(word));
+    if (file->npostings) {
+        memcpy(data + sizeof(word), file->postings,
+               file->npostings * sizeof(word));
+    }
+
+    if (bile_write(repo->bile, REPO_POSTING_RTYPE, file->id, data,
+                   size) != size) {
+        panic("Failed storing amendment list for file %d: %d", file->id,
+              bile_error(repo->bile));
+    }
+    xfree(&data);
+}
+
+void repo_delete_postings(struct repo *repo) {
+    struct bile_object *objects;
+    size_t n;
+    word i;
+
+    n = bile_objects_by_type(repo->bile, REPO_POSTING_RTYPE, &objects);
+    while (n > 0) {
+        bile_delete(repo->bile, REPO_POSTING_RTYPE, objects[--n].id);
+    }
+    if (objects != NULL) {
+        xfree(&objects);
+    }
+
+    for (i = 0; i < repo->nfiles; i++) {
+        if (repo->files[i]->postings != NULL) {
+            xfree(&repo->files[i]->postings);
+        }
+        repo->files[i]->npostings = 0;
+        repo->files[i]->postings_loaded = false;
+    }
+}
+
+struct repo_posting_cursor {
+    word *ids;
+    word left;
+};
+
+/* restore the max-heap below pos, keyed on each cursor's next id */
+static void repo_posting_sift(struct repo_posting_cursor *heap, word nheap,
+                              word pos) {
+    struct repo_posting_cursor tmp;
+    word child;
+
+    for (;;) {
+        child = (pos * 2) + 1;
+        if (child >= nheap) {
+            break;
+        }
+        if (child + 1 < nheap && heap[child + 1].ids[0] > heap[child].ids[0]) {
+            child++;
+        }
+        if (heap[pos].ids[0] >= heap[child].ids[0]) {
+            break;
+        }
+        tmp = heap[pos];
+        heap[pos] = heap[child];
+        heap[child] = tmp;
+        pos = child;
+    }
+}
+
+/*
+ * Fill ret (which must have room for repo->namendments) with every
+ * amendment touching any of file_ids, newest first, by merging their
+ * posting lists.  Returns the number of amendments.
+ */
+word repo_amendments_for_files(struct repo *repo, word *file_ids,
+                               word nfile_ids, struct repo_amendment **ret) {
+    struct repo_posting_cursor *heap;
+    struct repo_file *file;
+    word nheap = 0, n = 0, a = 0, i, id;
+
+    if (nfile_ids == 0 || repo->namendments == 0) {
+        return 0;
+    }
+
+    heap = xcalloc(nfile_ids, sizeof(struct repo_posting_cursor),
+                   "repo_amendments_for_files");
+    for (i = 0; i < nfile_ids; i++) {
+        file = repo_file_with_id(repo, file_ids[i]);
+        if (file == NULL || repo_file_postings(repo, file) == 0) {
+            continue;
+        }
+        heap[nheap].ids = file->postings;
+        heap[nheap].left = file->npostings;
+        nheap++;
+    }
+    for (i = nheap / 2; i > 0; i--) {
+        repo_posting_sift(heap, nheap, i - 1);
+    }
 
+    while (nheap > 0) {
+        id = heap[0].ids[0];
+
+        heap[0].ids++;
+        if (--heap[0].left == 0) {
+            heap[0] = heap[--nheap];
+        }
+        repo_posting_sift(heap, nheap, 0);
+
+        /* same amendment through another file */
+        if (n > 0 && ret[n - 1]->id == id) {
+            continue;
+        }
+
+        /* both are newest first, so the amendment list is walked once */
+        while (a < repo->namendments && repo->amendments[a]->id > id) {
+            a++;
+        }
+        if (a < repo->namendments && repo->amendments[a]->id == id) {
+            ret[n++] = repo->amendments[a];
+        }
+    }
+
+    xfree(&heap);
+
+    return n;
+}
+
+/*
+ * Find which of file_ids differ from their last stored TEXT and put them
+ * in changed (which must hold nfile_ids), returning how many there are.
+ * Each file is compared by size and dates from the STAT index, and is
+ * only read and hashed if its dates moved but its size didn't.
+ */
+word repo_status(struct repo *repo, word *file_ids, word nfile_ids,
+                 word *changed) {
+    GSString255 path = { 0 };
+    FileInfoRecGS fiRec;
+    struct repo_file *file;
+    struct repo_stat *stat;
+    unsigned long hash;
+    word i, nchanged = 0, error;
+
+    repo_load_stats(repo);
+
+    for (i = 0; i < nfile_ids; i++) {
+        file = repo_file_with_id(repo, file_ids[i]);
+        if (file == NULL) {
+            continue;
+        }
+
+        error = getpath(repo->bile->frefnum, &file->filename, &path, true);
+        if (error == 0) {
+            error = FStat(&path, &fiRec);
+        }
+        if (error) {
+            if (error == fileNotFound && (file->flags & REPO_FILE_DELETED)) {
+                continue;
+            }
+            changed[nchanged++] = file->id;
+            continue;
+        }
+        if (file->flags & REPO_FILE_DELETED) {
+            changed[nchanged++] = file->id;
+            continue;
+        }
+
+        stat = repo_seed_stat(repo, file);
+        if (stat == NULL) {
+            /* if there's no existing TEXT resource, it's a new file */
+            changed[nchanged++] = file->id;
+            continue;
+        }
+
+        if (fiRec.eof != stat->size) {
+            changed[nchanged++] = file->id;
+            continue;
+        }
+        if (memcmp(&fiRec.createDateTime, &stat->ctime,
+                   sizeof(TimeRec)) == 0 &&
+            memcmp(&fiRec.modDateTime, &stat->mtime, sizeof(TimeRec)) == 0) {
+            continue;
+        }
+
+        /* dates moved but size didn't, only the contents can tell */
+        if (repo_hash_file(repo, file, &hash) != 0 ||
+            !repo_hash_text(repo, stat) || hash != stat->hash) {
+            changed[nchanged++] = file->id;
+            continue;
+        }
+
+        /* just touched, remember the new dates so it isn't hashed again */
+        repo_file_update(repo, file);
+        stat->ctime = fiRec.createDateTime;
+        stat->mtime = fiRec.modDateTime;
+        repo->stats_dirty = true;
+    }
+
+    repo_write_stats(repo);
+
+    return nchanged;
+}
+
+/*
+ * If the working file has the same contents as its stored TEXT, such as
+ * when it was only touched, bring its metadata up to date and return
+ * true so the caller can skip diffing it.
+ */
+bool repo_file_touched(struct repo *repo, struct repo_file *file) {
+    GSString255 path = { 0 };
+    FileInfoRecGS fiRec;
+    struct repo_stat *stat;
+    unsigned long hash;
+
+    if (file->flags & REPO_FILE_DELETED) {
+        return false;
+    }
+
+    stat = repo_seed_stat(repo, file);
+    if (stat == NULL) {
+        return false;
+    }
+
+    if (getpath(repo->bile->frefnum, &file->filename, &path, true) != 0 ||
+        FStat(&path, &fiRec) != 0 || fiRec.eof != stat->size) {
+        return false;
+    }
+
+    if (repo_hash_file(repo, file, &hash) != 0 ||
+        !repo_hash_text(repo, stat) || hash != stat->hash) {
+        return false;
+    }
+
+    repo_file_update(repo, file);
+
+    stat->ctime = fiRec.createDateTime;
+    stat->mtime = fiRec.modDateTime;
+    repo->stats_dirty = true;
+    repo_write_stats(repo);
+
+    return true;
+}
+
+/* a file's STAT entry, seeded from its TEXT object for older repos */
+struct repo_stat *repo_seed_stat(struct repo *repo, struct repo_file *file) {
+    struct repo_stat *stat;
+    struct bile_object *bob;
+
+    stat = repo_find_stat(repo, file->id, false);
+    if (stat != NULL) {
+        return stat;
+    }
+
+    bob = bile_find(repo->bile, REPO_TEXT_RTYPE, file->id);
+    if (bob == NULL) {
+        return NULL;
+    }
+    stat = repo_find_stat(repo, file->id, true);
+    stat->size = bile_object_size(repo->bile, bob);
+    xfree(&bob);
+
+    return stat;
+}
+
+void repo_load_stats(struct repo *repo) {
+    char *data;
+    size_t size;
+    word count;
+
+    if (repo->stats_loaded) {
+        return;
+    }
+    repo->stats_loaded = true;
+    repo->nstats = 0;
+
+    size = bile_read_alloc(repo->bile, REPO_STAT_RTYPE, 1, &data);
+    if (data == NULL) {
+        return;
+    }
+    if (size >= sizeof(word)) {
+        memcpy(&count, data, sizeof(word));
+        if (count > 0 &&
+            size == sizeof(word) + (count * sizeof(struct repo_stat))) {
+            repo->stats = xcalloc(count, sizeof(struct repo_stat),
+                                  "repo_load_stats");
+            memcpy(repo->stats, data + sizeof(word),
+                   count * sizeof(struct repo_stat));
+            repo->nstats = count;
+        }
+    }
+    xfree(&data);
+}
+
+void repo_write_stats(struct repo *repo) {
+    char *data;
+    size_t size;
+
+    if (!repo->stats_dirty) {
+        return;
+    }
+
+    size = sizeof(word) + (repo->nstats * sizeof(struct repo_stat));
+    data = xmalloc(size, "repo_write_stats");
+    memcpy(data, &repo->nstats, sizeof(word));
+    if (repo->nstats) {
+        memcpy(data + sizeof(word), repo->stats,
+               repo->nstats * sizeof(struct repo_stat));
+    }
+
+    if (bile_write(repo->bile, REPO_STAT_RTYPE, 1, data, size) != size) {
+        panic("Failed storing file status in repo file: %d",
+              bile_error(repo->bile));
+    }
+    xfree(&data);
+    repo->stats_dirty = false;
+}
+
+/* binary search the id-sorted index, adding a zeroed entry if create */
+struct repo_stat *repo_find_stat(struct repo *repo, word file_id,
+                                 bool create) {
+    word lo = 0, hi, mid;
+
+    repo_load_stats(repo);
+
+    hi = repo->nstats;
+    while (lo < hi) {
+        mid = lo + ((hi - lo) / 2);
+        if (repo->stats[mid].file_id < file_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < repo->nstats && repo->stats[lo].file_id == file_id) {
+        return &repo->stats[lo];
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    repo->stats = xreallocarray(repo->stats, repo->nstats + 1,
+                                sizeof(struct repo_stat));
+    memmove(&repo->stats[lo + 1], &repo->stats[lo],
+            (repo->nstats - lo) * sizeof(struct repo_stat));
+    memset(&repo->stats[lo], 0, sizeof(struct repo_stat));
+    repo->stats[lo].file_id = file_id;
+    repo->nstats++;
+    repo->stats_dirty = true;
+
+    return &repo->stats[lo];
+}
+
+void repo_remove_stat(struct repo *repo, word file_id) {
+    struct repo_stat *stat;
+    word n;
+
+    stat = repo_find_stat(repo, file_id, false);
+    if (stat == NULL) {
+        return;
+    }
+
+    n = stat - repo->stats;
+    memmove(stat, stat + 1, (repo->nstats - n - 1) * sizeof(struct repo_stat));
+    repo->nstats--;
+    repo->stats_dirty = true;
+}
+
+/* hash the working copy of a file in one streaming read */
+word repo_hash_file(struct repo *repo, struct repo_file *file,
+                    unsigned long *hash) {
+    char *buf;
+    longword fsize, count;
+    word error, frefnum;
+
+    *hash = 0;
+
+    error = FOpen(repo->bile->frefnum, &file->filename, readEnable,
+                  &frefnum, &fsize);
+    if (error) {
+        return error;
+    }
+
+    buf = xmalloc(REPO_HASH_CHUNK, "repo_hash_file");
+    while (fsize > 0) {
+        count = MIN(fsize, REPO_HASH_CHUNK);
+        error = FRead(frefnum, buf, &count);
+        if (error || count == 0) {
+            break;
+        }
+        *hash = crc32_update(*hash, buf, count);
+        fsize -= count;
+    }
+    xfree(&buf);
+    FClose(frefnum);
+
+    return error;
+}
+
+/* hash the stored TEXT if the entry doesn't have one yet */
+bool repo_hash_text(struct repo *repo, struct repo_stat *stat) {
+    char *data;
+    size_t size;
+
+    if (stat->flags & REPO_STAT_HASHED) {
+        return true;
+    }
+    if (stat->size == 0) {
+        /* bile_read_alloc can't allocate nothing */
+        stat->hash = 0;
+    } else {
+        size = bile_read_alloc(repo->bile, REPO_TEXT_RTYPE, stat->file_id,
+                               &data);
+        if (data == NULL) {
+            return false;
+        }
+        if (size != stat->size) {
+            xfree(&data);
+            return false;
+        }
+        stat->hash = crc32_update(0, data, size);
+        xfree(&data);
+    }
+    stat->flags |= REPO_STAT_HASHED;
+    repo->stats_dirty = true;
+
+    return true;
+}
@@ -19,9 +19,11 @@
 #define __REPO_H__
 
 #include <time.h>
+#include <stdbool.h>
+#include <stdint.h>
 //#include "bile.h"
 #include <memory.h>
-#include <textedit.h>
+#include "util.h"
 
 #define AMEND_CREATOR		'AMND'
 
@@ -32,6 +34,11 @@
 #define REPO_DIFF_RTYPE		0x46464944L
 #define REPO_TEXT_RTYPE	    0x54584554L
 #define REPO_VERS_RTYPE		0x53524556L
+#define REPO_HUNK_RTYPE		0x4B4E5548L
+#define REPO_SUMMARY_RTYPE	0x4D4D5553L
+#define REPO_AUTHORS_RTYPE	0x48545541L
+#define REPO_POSTING_RTYPE	0x54534F50L
+#define REPO_STAT_RTYPE		0x54415453L
 //#define REPO_TMPL_RTYPE     0xDEAD
 
 #define DIFF_FILE_TYPE		0x04
@@ -39,7 +46,15 @@
 
 #define REPO_DIFF_TOO_BIG	"\r[ Diff too large to view, %lu bytes not shown ]"
 
-#define REPO_CUR_VERS		3
+#define REPO_CUR_VERS		4
+
+#define REPO_AUTHOR_SIZE	32
+
+/* how much of a working file repo_hash_file reads at a time */
+#define REPO_HASH_CHUNK		4096
+
+/* amendments per SUMM object, amendment n is in SUMM n / this + 1 */
+#define REPO_SUMMARY_PAGE	256
 
 struct repo_file {
 	word id;
@@ -50,6 +65,13 @@ struct repo_file {
 	unsigned long mtime;
 	unsigned char flags;
 #define REPO_FILE_DELETED			(1 << 0)
+	/* not stored in FILE, strnat_key of filename for sorting */
+	unsigned char *sort_key;
+	word sort_key_len;
+	/* not stored in FILE, see repo_file_postings */
+	bool postings_loaded;
+	word npostings;
+	word *postings;
 };
 
 struct repo_file_attrs {
@@ -64,18 +86,69 @@ struct diffed_file {
 	word flags;
 #define DIFFED_FILE_TEXT		(1 << 0)
 #define DIFFED_FILE_METADATA	(1 << 1)
+	struct diff_hunk *hunks;
+	word nhunks;
+	word hunks_size;
+};
+
+/*
+ * HUNK objects hold one of these per changed file in the amendment, each
+ * followed by nhunks struct diff_hunks
+ */
+struct repo_hunks {
+	word file_id;
+	word nhunks;
 };
 
 struct repo_amendment {
 	word id;
 	time_t date;
-	char author[32];
+	char *author; /* one of repo->authors */
 	word nfiles;
 	word *file_ids;
 	word adds;
 	word subs;
 	word log_len;
-	Handle log;
+	Handle log; /* NULL or purgeable until repo_amendment_log */
+};
+
+/*
+ * POST objects are keyed by file id and hold a word count followed by
+ * the ids of every amendment touching that file, newest first.
+ */
+
+/*
+ * The STAT object (id 1) is a word count followed by these, sorted by
+ * file_id, describing each file as it was when its TEXT was last stored
+ * so repo_status can find changed files from one FStat each.  Times are
+ * the raw GS/OS ones so they compare without ConvSeconds.  Like the other
+ * structs stored as-is, fields are fixed width and naturally aligned so
+ * a host build lays them out the same as ORCA/C.
+ */
+struct repo_stat {
+	word file_id;
+	word flags;
+#define REPO_STAT_HASHED	(1 << 0)
+	uint32_t size;
+	TimeRec ctime;
+	TimeRec mtime;
+	uint32_t hash; /* crc32_update of TEXT, if REPO_STAT_HASHED */
+};
+
+/*
+ * SUMM objects hold everything about an amendment but its log, so the
+ * list can be built without reading every AMND.  Each is a word count
+ * followed by that many of these, each followed by nfiles word file ids.
+ * author is an index into the AUTH object, a word count of pstrs.
+ */
+struct repo_summary {
+	uint32_t date;
+	word id;
+	word author;
+	word nfiles;
+	word adds;
+	word subs;
+	word log_len;
 };
 
 struct repo {
@@ -86,22 +159,51 @@ struct repo {
 	word namendments;
 	struct repo_amendment **amendments;
 	word next_amendment_id;
+	word nauthors;
+	char **authors;
+	bool authors_dirty;
+	struct revcache *revcache;
+	bool stats_loaded;
+	bool stats_dirty;
+	word nstats;
+	struct repo_stat *stats;
+	/*
+	 * files and amendments come from these, along with every file's
+	 * sort_key and amendment's file_ids, and all go at repo_close
+	 */
+	struct pool file_pool;
+	struct pool amendment_pool;
+	struct arena arena;
 };
 
 struct repo *repo_open(const StringPtr file);
 struct repo *repo_create(void);
+struct repo *repo_open_path(const StringPtr path);
+struct repo *repo_create_path(const StringPtr path);
 void repo_close(struct repo *repo);
-struct repo_amendment *repo_parse_amendment(unsigned long id, unsigned char *data,
-  size_t size);
-struct repo_file * repo_parse_file(unsigned long id, unsigned char *data,
-  size_t size);
+struct repo *repo_alloc(struct bile *bile);
+void repo_free_records(struct repo *repo);
+struct repo_amendment *repo_parse_amendment(struct repo *repo,
+  unsigned long id, const unsigned char *data, size_t size);
+Handle repo_amendment_log(struct repo *repo, struct repo_amendment *amendment);
+char *repo_intern_author(struct repo *repo, const char *author);
+void repo_write_summary(struct repo *repo, word amendment_id);
+struct repo_file * repo_parse_file(struct repo *repo, unsigned long id,
+  const unsigned char *data, size_t size);
 struct repo_file *repo_file_with_id(struct repo *repo, word id);
 void repo_show_diff_text(struct repo *repo, struct repo_amendment *amendment,
   Handle te);
+word repo_diff_header(struct repo *repo, struct repo_amendment *amendment,
+  char **ret);
 struct repo_file *repo_add_file(struct repo *repo);
+struct repo_file *repo_add_file_named(struct repo *repo,
+  const StringPtr name);
 void repo_file_mark_for_deletion(struct repo *repo, struct repo_file *file);
 word repo_diff_file(struct repo *repo, struct repo_file *file);
 word repo_file_changed(struct repo *repo, struct repo_file *file);
+word repo_status(struct repo *repo, word *file_ids, word nfile_ids,
+  word *changed);
+bool repo_file_touched(struct repo *repo, struct repo_file *file);
 word repo_checkout_file(struct repo *repo, struct repo_file *file,
   Str255 *filename);
 void repo_export_patch(struct repo *repo, struct repo_amendment *amendment,
@@ -111,6 +213,12 @@ void repo_amend(struct repo *repo, struct diffed_file *diffed_files,
   word loglen, Handle diff, unsigned long difflen);
 void repo_marshall_amendment(struct repo_amendment *amendment,
   char **retdata, unsigned long *retlen);
+size_t repo_stats(struct repo *repo, char *buf, size_t size);
 void repo_backup(struct repo *repo);
+bool repo_file_hunks(struct repo *repo, word amendment_id, word file_id,
+  struct diff_hunk **hunks, word *nhunks);
+word repo_file_postings(struct repo *repo, struct repo_file *file);
+word repo_amendments_for_files(struct repo *repo, word *file_ids,
+  word nfile_ids, struct repo_amendment **ret);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ * Copyright (c) 2021-2022 joshua stein <jcs@jcs.org>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The parts of the repo API that need the Toolbox: Standard File dialogs
+ * to pick a repo or a file to add, and loading a diff into a TextEdit
+ * record.  They are thin wrappers over repo.c, which has no UI.
+ */
+
+#include <types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <gsos.h>
+#include <stdfile.h>
+#include <qdaux.h>
+#include <textedit.h>
+
+#include "AmendGS.h"
+#include "bile.h"
+#include "repo.h"
+#include "util.h"
+
+segment "repo";
+
+struct repo *repo_open(const StringPtr file) {
+    SFReplyRec2 reply;
+    SFTypeList2 types;
+    char prompt[] = "\pOpen Repo:";
+    ResultBuf255Hndl path;
+    Str255 bilePath = { 0, { 0 } };
+
+    if (file) {
+        return repo_open_path(file);
+    }
+
+    types.numEntries = 1;
+    types.fileTypeEntries[0].flags = 0;
+    types.fileTypeEntries[0].fileType = REPO_TYPE;
+    types.fileTypeEntries[0].auxType = BILE_AUX_TYPE;
+
+    memset(&reply, 0, sizeof(SFReplyRec2));
+    reply.nameRefDesc = refIsNewHandle;
+    reply.pathRefDesc = refIsNewHandle;
+
+    SFGetFile2(0x15, 0x15, refIsPointer, (Ref)prompt, NULL, &types, &reply);
+    if (!reply.good) {
+        return NULL;
+    }
+    path = (ResultBuf255Hndl)reply.pathRef;
+    strncpy(bilePath.text, (*path)->bufString.text, (*path)->bufString.length);
+    bilePath.textLength = (*path)->bufString.length;
+    DisposeHandle((Handle)reply.pathRef);
+    DisposeHandle((Handle)reply.nameRef);
+
+    return repo_open_path(&bilePath);
+}
+
+struct repo *repo_create(void) {
+    SFReplyRec reply;
+    char prompt[] = "\pCreate new repository:";
+
+    SFPutFile(0x15, 0x15, prompt, NULL, 254, &reply);
+
+    if (!reply.good) {
+        return NULL;
+    }
+
+    return repo_create_path((StringPtr)&reply.fullPathname);
+}
+
+void repo_show_diff_text(struct repo *repo, struct repo_amendment *amendment,
+                         Handle te) {
+    char truncbuf[64];
+    struct bile_object *bob;
+    size_t size;
+    char *dtext;
+    char *buf = NULL;
+    unsigned long diff_len, all_len;
+    word header_len, blen, trunc = 0;
+    word warn_off;
+    TERecordHndl teRec = (TERecordHndl)te;
+
+
+    bob = bile_find(repo->bile, REPO_DIFF_RTYPE, amendment->id);
+    if (bob == NULL) {
+        warn("Failed finding DIFF %d, corrupted repo?", amendment->id);
+        return;
+    }
+
+    diff_len = bile_object_size(repo->bile, bob);
+    if (diff_len == 0) {
+        panic("diff zero bytes");
+    }
+
+    header_len = repo_diff_header(repo, amendment, &buf);
+
+    all_len = header_len + diff_len;
+    if (all_len >= MAX_TEXTEDIT_SIZE) {
+        all_len = MAX_TEXTEDIT_SIZE;
+        trunc = 1;
+    }
+
+    dtext = xmalloc(all_len, "repo_show_diff_text");
+    memcpy(dtext, buf, header_len);
+    xfree(&buf);
+
+    size = bile_read_object(repo->bile, bob, dtext + header_len,
+                            all_len - header_len);
+    if (size == 0) {
+        panic("failed reading diff %lu: %d", amendment->id,
+              bile_error(repo->bile));
+    }
+
+    if (trunc) {
+        warn_off = MAX_TEXTEDIT_SIZE - header_len -
+            strlen(REPO_DIFF_TOO_BIG);
+        blen = snprintf(truncbuf, sizeof(truncbuf), REPO_DIFF_TOO_BIG,
+                        diff_len - warn_off);
+        memcpy(dtext + MAX_TEXTEDIT_SIZE - blen, truncbuf, blen);
+    }
+
+    /* manually reset scroll without TESetSelect(0, 0, te) which redraws */
+    (*teRec)->textFlags &= ~fReadOnly;
+    TEInsert(0x0005, (Ref)dtext, all_len, 0, 0, te);
+    (*teRec)->textFlags |= fReadOnly;
+    xfree(&dtext);
+}
+
+
+struct repo_file *repo_add_file(struct repo *repo) {
+    SFReplyRec2 reply;
+    SFTypeList2 types;
+    GSString255 pathname;
+    PrefixRecGS prefixRec = { 2, 8 };
+    char prompt[] = { "\pSelect File to Add" };
+    ResultBuf255Hndl filePath, fileName;
+    struct repo_file *file = NULL;
+    Str255 name;
+
+    /* start SFGetFile2 from this dir */
+    getpath(repo->bile->frefnum, NULL, &pathname, false);
+
+    prefixRec.buffer.setPrefix = &pathname;
+    SetPrefixGS(&prefixRec);
+
+    types.numEntries = 0;
+    types.fileTypeEntries[0].flags = 0;
+    types.fileTypeEntries[0].fileType = 0x04;
+    types.fileTypeEntries[0].auxType = 0;
+
+    reply.nameRefDesc = refIsNewHandle;
+    reply.pathRefDesc = refIsNewHandle;
+
+    SFGetFile2(0x15, 0x15, refIsPointer, (Ref)prompt, NULL, &types, &reply);
+    if (!reply.good) {
+        return NULL;
+    }
+
+    filePath = (ResultBuf255Hndl)reply.pathRef;
+    fileName = (ResultBuf255Hndl)reply.nameRef;
+
+    /* if the file is not in the same dir as the repo, bail */
+    if (strncmp((*filePath)->bufString.text, pathname.text, pathname.length) != 0) {
+        warn("Can't add files from a directory other than the repo's");
+    } else {
+        g2sstr(name, (*fileName)->bufString);
+
+        WaitCursor();
+        file = repo_add_file_named(repo, (StringPtr)&name);
+        InitCursor();
+    }
+
+    DisposeHandle((Handle)filePath);
+    DisposeHandle((Handle)fileName);
+
+    return file;
+}
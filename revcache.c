@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <types.h>
+#include <stdio.h>
+#include <string.h>
+#include <memory.h>
+#include <gsos.h>
+#include <misctool.h>
+
+#include "bile.h"
+#include "repo.h"
+#include "revcache.h"
+#include "util.h"
+
+segment "visualize";
+
+struct revcache_entry *revcache_find(struct revcache *cache,
+                                     unsigned long key);
+struct revcache_entry *revcache_slot(struct revcache *cache, size_t size);
+void revcache_evict(struct revcache *cache, struct revcache_entry *e);
+bool revcache_filename(struct bile *bile, Str255 *filename);
+uint32_t revcache_stamp(struct bile *bile);
+bool revcache_load_spilled(struct revcache *cache, uint32_t stamp);
+void revcache_write_order(struct revcache *cache);
+void revcache_trim_spill(struct revcache *cache, size_t size);
+
+struct revcache *revcache_open(struct repo *repo) {
+    struct revcache *cache;
+    Str255 filename;
+    uint32_t stamp;
+
+    cache = xmalloczero(sizeof(struct revcache), "revcache");
+
+    if (!revcache_filename(repo->bile, &filename)) {
+        return cache;
+    }
+    /* not stamped until it's next written, see revcache_stamp_repo */
+    if ((stamp = revcache_stamp(repo->bile)) == 0) {
+        return cache;
+    }
+
+    cache->spill = bile_open((StringPtr)&filename);
+    if (cache->spill != NULL) {
+        if (revcache_load_spilled(cache, stamp)) {
+            return cache;
+        }
+        /* another repo's that was here under this name, start over */
+        bile_close(cache->spill);
+        xfree(&cache->spill);
+        FDelete((StringPtr)&filename);
+    } else if (bile_error(NULL) != fileNotFound) {
+        return cache;
+    }
+
+    cache->spill = bile_create((StringPtr)&filename, AMEND_CREATOR,
+                               REVCACHE_FILE_TYPE);
+    if (cache->spill != NULL &&
+        bile_write(cache->spill, REVCACHE_STAMP_RTYPE, 1, &stamp,
+                   sizeof(stamp)) != sizeof(stamp)) {
+        bile_close(cache->spill);
+        xfree(&cache->spill);
+    }
+
+    /* no sidecar (read-only volume, name too long), just stay in memory */
+    return cache;
+}
+
+/* a new repo must not pick up the cache of an old one with the same name */
+void revcache_delete(struct bile *bile) {
+    Str255 filename;
+
+    if (revcache_filename(bile, &filename)) {
+        FDelete((StringPtr)&filename);
+    }
+}
+
+void revcache_close(struct revcache *cache) {
+    struct revcache_entry *e;
+    word n;
+
+    for (n = 0; n < REVCACHE_ENTRIES; n++) {
+        e = &cache->entries[n];
+        if (e->text != NULL) {
+            revcache_evict(cache, e);
+        }
+    }
+
+    if (cache->spill != NULL) {
+        revcache_write_order(cache);
+        bile_close(cache->spill);
+        xfree(&cache->spill);
+    }
+
+    xfree(&cache);
+}
+
+/*
+ * Return the cached text of the file as it was after the amendment, or
+ * NULL.  The handle is owned by the cache and is only valid until the
+ * next revcache_put.
+ */
+Handle revcache_get(struct revcache *cache, word file_id, word amendment_id) {
+    struct revcache_entry *e;
+    struct bile_object *bob;
+    unsigned long key;
+    size_t size, len;
+    Handle text;
+
+    key = REVCACHE_KEY(file_id, amendment_id);
+
+    e = revcache_find(cache, key);
+    if (e != NULL) {
+        e->used = ++cache->tick;
+        return e->text;
+    }
+
+    if (cache->spill == NULL) {
+        return NULL;
+    }
+
+    bob = bile_find(cache->spill, REVCACHE_RTYPE, key);
+    if (bob == NULL) {
+        return NULL;
+    }
+
+    /* a bad cache entry is just a miss */
+    len = bile_object_size(cache->spill, bob);
+    if (len == 0) {
+        xfree(&bob);
+        return NULL;
+    }
+    text = xNewHandle(len);
+    HLock(text);
+    size = bile_read_object(cache->spill, bob, *text, len);
+    HUnlock(text);
+    if (size != len) {
+        DisposeHandle(text);
+        xfree(&bob);
+        return NULL;
+    }
+
+    e = revcache_slot(cache, size);
+    xfree(&bob);
+
+    e->key = key;
+    e->used = ++cache->tick;
+    e->spilled = true;
+    e->text = text;
+    cache->bytes += size;
+
+    return text;
+}
+
+/*
+ * Add the text of the file as it was after the amendment.  The cache
+ * takes ownership of the handle.
+ */
+void revcache_put(struct revcache *cache, word file_id, word amendment_id,
+                  Handle text) {
+    struct revcache_entry *e;
+    unsigned long key;
+    size_t size;
+
+    key = REVCACHE_KEY(file_id, amendment_id);
+    size = GetHandleSize(text);
+
+    e = revcache_find(cache, key);
+    if (e != NULL) {
+        /* revisions never change, keep what we have */
+        DisposeHandle(text);
+        e->used = ++cache->tick;
+        return;
+    }
+
+    e = revcache_slot(cache, size);
+    e->key = key;
+    e->used = ++cache->tick;
+    e->spilled = false;
+    e->text = text;
+    cache->bytes += size;
+}
+
+/* Private API */
+
+struct revcache_entry *revcache_find(struct revcache *cache,
+                                     unsigned long key) {
+    word n;
+
+    for (n = 0; n < REVCACHE_ENTRIES; n++) {
+        if (cache->entries[n].text != NULL && cache->entries[n].key == key) {
+            return &cache->entries[n];
+        }
+    }
+
+    return NULL;
+}
+
+/* find a free entry for size more bytes, evicting the oldest as needed */
+struct revcache_entry *revcache_slot(struct revcache *cache, size_t size) {
+    struct revcache_entry *e, *lru;
+    word n;
+
+    for (;;) {
+        lru = NULL;
+        e = NULL;
+        for (n = 0; n < REVCACHE_ENTRIES; n++) {
+            if (cache->entries[n].text == NULL) {
+                if (e == NULL) {
+                    e = &cache->entries[n];
+                }
+                continue;
+            }
+            if (lru == NULL || cache->entries[n].used < lru->used) {
+                lru = &cache->entries[n];
+            }
+        }
+
+        if (lru == NULL) {
+            /* cache is empty, take it even if it's over budget */
+            return e;
+        }
+        if (e != NULL && cache->bytes + size <= REVCACHE_MAX_BYTES) {
+            return e;
+        }
+
+        revcache_evict(cache, lru);
+    }
+}
+
+void revcache_evict(struct revcache *cache, struct revcache_entry *e) {
+    size_t size;
+
+    size = GetHandleSize(e->text);
+
+    if (cache->spill != NULL && !e->spilled && size > 0 &&
+        size <= REVCACHE_SPILL_MAX_BYTES) {
+        revcache_trim_spill(cache, size);
+        HLock(e->text);
+        if (bile_write(cache->spill, REVCACHE_RTYPE, e->key, *(e->text),
+                       size) != size) {
+            /* sidecar is full or broken, stop using it */
+            bile_close(cache->spill);
+            xfree(&cache->spill);
+        } else {
+            cache->spilled[cache->nspilled].key = e->key;
+            cache->spilled[cache->nspilled].size = size;
+            cache->nspilled++;
+            cache->spill_bytes += size;
+        }
+        HUnlock(e->text);
+    }
+
+    DisposeHandle(e->text);
+    cache->bytes -= size;
+    memset(e, 0, sizeof(struct revcache_entry));
+}
+
+/* sidecar lives next to the repo as "<repo>.cache" */
+bool revcache_filename(struct bile *bile, Str255 *filename) {
+    size_t len;
+
+    len = bile->filename.textLength;
+    if (len + strlen(REVCACHE_SUFFIX) > sizeof(filename->text) - 1) {
+        return false;
+    }
+    memcpy(filename->text, bile->filename.text, len);
+    memcpy(filename->text + len, REVCACHE_SUFFIX, strlen(REVCACHE_SUFFIX));
+    filename->textLength = len + strlen(REVCACHE_SUFFIX);
+    filename->text[filename->textLength] = '\0';
+
+    return true;
+}
+
+/*
+ * Give the repo a stamp if it doesn't have one.  Only called where the
+ * repo is being written anyway (repo_create_path, repo_amend), so just
+ * viewing history never changes the repo file.
+ */
+void revcache_stamp_repo(struct bile *bile) {
+    TimeRec tm;
+    uint32_t stamp;
+
+    if (revcache_stamp(bile) != 0) {
+        return;
+    }
+
+    /* a repo made in the same second under the same name mustn't match */
+    tm = ReadTimeHex();
+    stamp = ConvSeconds(TimeRec2Secs, 0, (Pointer)&tm) ^ xorshift32();
+    if (stamp == 0) {
+        stamp = 1;
+    }
+    /* without it the cache just stays in memory */
+    bile_write(bile, REVCACHE_STAMP_RTYPE, 1, &stamp, sizeof(stamp));
+}
+
+/* the repo's stamp, or 0 if it hasn't been given one yet */
+uint32_t revcache_stamp(struct bile *bile) {
+    uint32_t stamp;
+
+    if (bile_read(bile, REVCACHE_STAMP_RTYPE, 1, &stamp,
+                  sizeof(stamp)) != sizeof(stamp)) {
+        return 0;
+    }
+
+    return stamp;
+}
+
+/*
+ * Take up the sidecar if it has the repo's stamp, in the order it was
+ * spilled in.  Anything spilled that the order doesn't list, such as
+ * when the last revcache_close never came, is deleted.
+ */
+bool revcache_load_spilled(struct revcache *cache, uint32_t stamp) {
+    struct bile_object *objects;
+    uint32_t have, *keys;
+    size_t size, n, nobjects;
+    word i, nkeys;
+
+    if (bile_read(cache->spill, REVCACHE_STAMP_RTYPE, 1, &have,
+                  sizeof(have)) != sizeof(have) || have != stamp) {
+        return false;
+    }
+
+    size = bile_read_alloc(cache->spill, REVCACHE_ORDER_RTYPE, 1, &keys);
+    if (size % sizeof(uint32_t) != 0 ||
+        size > REVCACHE_SPILL_ENTRIES * sizeof(uint32_t)) {
+        size = 0;
+    }
+    nkeys = size / sizeof(uint32_t);
+
+    nobjects = bile_objects_by_type(cache->spill, REVCACHE_RTYPE, &objects);
+    for (i = 0; i < nkeys; i++) {
+        for (n = 0; n < nobjects; n++) {
+            if (objects[n].id == keys[i] && objects[n].type != 0) {
+                break;
+            }
+        }
+        if (n == nobjects) {
+            continue;
+        }
+        cache->spilled[cache->nspilled].key = keys[i];
+        cache->spilled[cache->nspilled].size = BILE_OBJECT_LEN(&objects[n]);
+        cache->spill_bytes += cache->spilled[cache->nspilled].size;
+        cache->nspilled++;
+        /* taken, and not deleted below */
+        objects[n].type = 0;
+    }
+    if (keys != NULL) {
+        xfree(&keys);
+    }
+
+    for (n = 0; n < nobjects; n++) {
+        if (objects[n].type != 0) {
+            bile_delete(cache->spill, REVCACHE_RTYPE, objects[n].id);
+        }
+    }
+    if (objects != NULL) {
+        xfree(&objects);
+    }
+
+    return true;
+}
+
+void revcache_write_order(struct revcache *cache) {
+    uint32_t keys[REVCACHE_SPILL_ENTRIES];
+    word n;
+
+    if (cache->nspilled == 0) {
+        bile_delete(cache->spill, REVCACHE_ORDER_RTYPE, 1);
+        return;
+    }
+
+    for (n = 0; n < cache->nspilled; n++) {
+        keys[n] = cache->spilled[n].key;
+    }
+    /* if this doesn't make it, the next open just drops what's spilled */
+    bile_write(cache->spill, REVCACHE_ORDER_RTYPE, 1, keys,
+               cache->nspilled * sizeof(uint32_t));
+}
+
+/* delete the oldest spilled entries until size more bytes will fit */
+void revcache_trim_spill(struct revcache *cache, size_t size) {
+    struct revcache_entry *e;
+    word n = 0;
+
+    while (n < cache->nspilled &&
+           (cache->nspilled - n >= REVCACHE_SPILL_ENTRIES ||
+            cache->spill_bytes + size > REVCACHE_SPILL_MAX_BYTES)) {
+        bile_delete(cache->spill, REVCACHE_RTYPE, cache->spilled[n].key);
+        /* still in memory, it can go back out when it's evicted */
+        if ((e = revcache_find(cache, cache->spilled[n].key)) != NULL) {
+            e->spilled = false;
+        }
+        cache->spill_bytes -= cache->spilled[n].size;
+        n++;
+    }
+    if (n == 0) {
+        return;
+    }
+
+    cache->nspilled -= n;
+    memmove(&cache->spilled[0], &cache->spilled[n],
+            cache->nspilled * sizeof(struct revcache_spilled));
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __REVCACHE_H__
+#define __REVCACHE_H__
+
+#include <stdbool.h>
+#include <memory.h>
+#include "repo.h"
+
+/*
+ * Cache of file contents as they were right after a given amendment,
+ * so visualize_rollback doesn't have to replay every diff from the first
+ * amendment each time.  Entries live in memory (LRU) and are spilled to
+ * a sidecar bile next to the repo when evicted or when the repo closes.
+ * The sidecar is only used by the repo with the same stamp, and keeps
+ * the order things were spilled in so the oldest can go first.  A repo
+ * gets its stamp when it's created or next amended, never from opening
+ * the cache, so a repo from before stamps caches in memory until then.
+ */
+
+/* in-memory limits, whichever is hit first causes an eviction */
+#define REVCACHE_ENTRIES	16
+#define REVCACHE_MAX_BYTES	(128L * 1024L)
+
+/* sidecar limits, likewise */
+#define REVCACHE_SPILL_ENTRIES		64
+#define REVCACHE_SPILL_MAX_BYTES	(512L * 1024L)
+
+//'RVCH'
+#define REVCACHE_RTYPE		0x48435652L
+//'RVID', id 1 in both the repo and its sidecar, a uint32_t
+#define REVCACHE_STAMP_RTYPE	0x44495652L
+//'RVOR', id 1 in the sidecar, the uint32_t keys spilled, oldest first
+#define REVCACHE_ORDER_RTYPE	0x524F5652L
+#define REVCACHE_FILE_TYPE	0xF1
+#define REVCACHE_SUFFIX		".cache"
+
+#define REVCACHE_KEY(file_id, amendment_id) \
+	(((unsigned long)(file_id) << 16) | (unsigned long)(amendment_id))
+
+struct revcache_entry {
+	unsigned long key;
+	unsigned long used;
+	bool spilled;
+	Handle text;
+};
+
+struct revcache_spilled {
+	unsigned long key;
+	size_t size;
+};
+
+struct revcache {
+	struct revcache_entry entries[REVCACHE_ENTRIES];
+	unsigned long tick;
+	size_t bytes;
+	struct bile *spill;
+	/* what's in spill, oldest first */
+	struct revcache_spilled spilled[REVCACHE_SPILL_ENTRIES];
+	word nspilled;
+	size_t spill_bytes;
+};
+
+struct revcache *revcache_open(struct repo *repo);
+void revcache_close(struct revcache *cache);
+void revcache_delete(struct bile *bile);
+void revcache_stamp_repo(struct bile *bile);
+Handle revcache_get(struct revcache *cache, word file_id, word amendment_id);
+void revcache_put(struct revcache *cache, word file_id, word amendment_id,
+  Handle text);
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <types.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <misctool.h>
+#ifdef AMEND_HOST
+#include <time.h>
+#endif
+
+#include "fileio.h"
+#include "stats.h"
+#include "util.h"
+
+segment "util";
+
+unsigned long stat_counters[STAT_NCOUNTERS];
+struct stat_timer stat_timers[STAT_NTIMERS];
+static unsigned long stat_lap_mark;
+
+static const char *counter_names[STAT_NCOUNTERS] = {
+    "bile reads",
+    "bile bytes read",
+    "bile writes",
+    "bile bytes written",
+    "bile file reads",
+    "bile file bytes read",
+    "bile file writes",
+    "bile file bytes written",
+    "bile cache hits",
+    "bile cache misses",
+    "bile map writes",
+    "bile file grows",
+    "bile flushes",
+    "FGetc calls",
+    "diffs",
+    "diff lines",
+    "patch files",
+    "patch hunks",
+    "visualize lines",
+    "visualize bytes",
+};
+
+static const char *timer_names[STAT_NTIMERS] = {
+    "bile map write",
+    "repo open",
+    "repo amend",
+    "diff open",
+    "diff prepare",
+    "diff prune",
+    "diff sort",
+    "diff equiv",
+    "diff unsort",
+    "diff stone",
+    "diff unravel",
+    "diff check",
+    "diff output",
+    "diff dump_unified_vec",
+    "patch",
+    "visualize",
+};
+
+/* microseconds on a host, ticks on the IIgs; only differences matter */
+unsigned long stats_clock(void) {
+#ifdef AMEND_HOST
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long)ts.tv_sec * STATS_CLOCK_HZ + ts.tv_nsec / 1000;
+#else
+    return GetTick();
+#endif
+}
+
+void stats_start(word timer) {
+    stat_timers[timer].started = stats_clock();
+}
+
+void stats_stop(word timer) {
+    stat_timers[timer].total += stats_clock() - stat_timers[timer].started;
+    stat_timers[timer].calls++;
+}
+
+void stats_mark(void) {
+    stat_lap_mark = stats_clock();
+}
+
+void stats_lap(word timer) {
+    unsigned long now;
+
+    now = stats_clock();
+    stat_timers[timer].total += now - stat_lap_mark;
+    stat_timers[timer].calls++;
+    stat_lap_mark = now;
+}
+
+void stats_reset(void) {
+    memset(stat_counters, 0, sizeof(stat_counters));
+    memset(stat_timers, 0, sizeof(stat_timers));
+}
+
+const char *stats_counter_name(word counter) {
+    return counter < STAT_NCOUNTERS ? counter_names[counter] : "?";
+}
+
+const char *stats_timer_name(word timer) {
+    return timer < STAT_NTIMERS ? timer_names[timer] : "?";
+}
+
+double stats_timer_ms(word timer) {
+    return stat_timers[timer].total * 1000.0 / STATS_CLOCK_HZ;
+}
+
+/* like snprintf at buf + len, which may already be past size */
+static size_t stats_append(char *buf, size_t size, size_t len,
+                           const char *format, ...) {
+    va_list ap;
+    int ret;
+
+    va_start(ap, format);
+    ret = vsnprintf(buf + MIN(len, size), size - MIN(len, size), format, ap);
+    va_end(ap);
+
+    return len + (ret > 0 ? ret : 0);
+}
+
+/*
+ * Everything counted so far as lines of text, for the browser or the
+ * host's amend stats.  Returns the length, which like snprintf may be
+ * more than fit.
+ */
+size_t stats_format(char *buf, size_t size) {
+    size_t len = 0;
+    word n;
+
+#ifndef AMEND_STATS
+    len = stats_append(buf, size, len,
+                       "(built without AMEND_STATS, nothing is counted)"
+                       EOL_STR EOL_STR);
+#endif
+    for (n = 0; n < STAT_NCOUNTERS; n++) {
+        len = stats_append(buf, size, len, "%-24s %10lu" EOL_STR,
+                           counter_names[n], stat_counters[n]);
+    }
+    len = stats_append(buf, size, len, EOL_STR "%-24s %10s %12s" EOL_STR,
+                       "timer", "calls", "ms");
+    for (n = 0; n < STAT_NTIMERS; n++) {
+        len = stats_append(buf, size, len, "%-24s %10lu %12.1f" EOL_STR,
+                           timer_names[n], stat_timers[n].calls,
+                           stats_timer_ms(n));
+    }
+
+    return len;
+}
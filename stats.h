@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2023 chris vavruska <chris@vavruska.com> (Apple //gs verison)
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <types.h>
+#include <stddef.h>
+
+/*
+ * Counters and timers for the hot paths.  The STAT_ macros only do
+ * anything when built with AMEND_STATS, otherwise they compile away and
+ * stats_format has nothing but zeros to show.
+ *
+ * STAT_START and STAT_STOP bracket one scope and can't nest for the same
+ * timer.  STAT_LAP charges everything since the last STAT_MARK or
+ * STAT_LAP to its timer, for code that runs in steps like diffreg.  On
+ * the IIgs the clock is the 60Hz tick count, so timers are only good for
+ * things that add up to a good part of a second.
+ */
+enum {
+    STAT_BILE_READS,
+    STAT_BILE_READ_BYTES,
+    STAT_BILE_WRITES,
+    STAT_BILE_WRITE_BYTES,
+    STAT_BILE_FILE_READS,
+    STAT_BILE_FILE_READ_BYTES,
+    STAT_BILE_FILE_WRITES,
+    STAT_BILE_FILE_WRITE_BYTES,
+    STAT_BILE_CACHE_HITS,
+    STAT_BILE_CACHE_MISSES,
+    STAT_BILE_MAP_WRITES,
+    STAT_BILE_GROWS,
+    STAT_BILE_FLUSHES,
+    STAT_FGETC,
+    STAT_DIFFS,
+    STAT_DIFF_LINES,
+    STAT_PATCH_FILES,
+    STAT_PATCH_HUNKS,
+    STAT_VISUALIZE_LINES,
+    STAT_VISUALIZE_BYTES,
+    STAT_NCOUNTERS
+};
+
+enum {
+    STAT_TIME_BILE_MAP_WRITE,
+    STAT_TIME_REPO_OPEN,
+    STAT_TIME_REPO_AMEND,
+    STAT_TIME_DIFF_OPEN,
+    STAT_TIME_DIFF_PREPARE,
+    STAT_TIME_DIFF_PRUNE,
+    STAT_TIME_DIFF_SORT,
+    STAT_TIME_DIFF_EQUIV,
+    STAT_TIME_DIFF_UNSORT,
+    STAT_TIME_DIFF_STONE,
+    STAT_TIME_DIFF_UNRAVEL,
+    STAT_TIME_DIFF_CHECK,
+    STAT_TIME_DIFF_OUTPUT,
+    STAT_TIME_DIFF_DUMP,
+    STAT_TIME_PATCH,
+    STAT_TIME_VISUALIZE,
+    STAT_NTIMERS
+};
+
+/* stats_clock's units: microseconds on a host, ticks on the IIgs */
+#ifdef AMEND_HOST
+#define STATS_CLOCK_HZ	1000000L
+#else
+#define STATS_CLOCK_HZ	60L
+#endif
+
+struct stat_timer {
+    unsigned long calls;
+    unsigned long total;
+    unsigned long started;
+};
+
+extern unsigned long stat_counters[STAT_NCOUNTERS];
+extern struct stat_timer stat_timers[STAT_NTIMERS];
+
+#ifdef AMEND_STATS
+#define STAT_COUNT(counter)		(stat_counters[(counter)]++)
+#define STAT_ADD(counter, n)	(stat_counters[(counter)] += (n))
+#define STAT_START(timer)		stats_start(timer)
+#define STAT_STOP(timer)		stats_stop(timer)
+#define STAT_MARK()				stats_mark()
+#define STAT_LAP(timer)			stats_lap(timer)
+#else
+#define STAT_COUNT(counter)
+#define STAT_ADD(counter, n)
+#define STAT_START(timer)
+#define STAT_STOP(timer)
+#define STAT_MARK()
+#define STAT_LAP(timer)
+#endif
+
+unsigned long stats_clock(void);
+void stats_start(word timer);
+void stats_stop(word timer);
+void stats_mark(void);
+void stats_lap(word timer);
+void stats_reset(void);
+const char *stats_counter_name(word counter);
+const char *stats_timer_name(word timer);
+double stats_timer_ms(word timer);
+size_t stats_format(char *buf, size_t size);
+
+#endif
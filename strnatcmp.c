@@ -30,10 +30,13 @@
  * negative chars in their default char type.
  *
  * 2021-10-13 jcs: Modified to compile in THINK C 5
+ *
+ * Added strnat_key/strnat_keycmp for comparing precomputed keys.
  */
 
 #include <stddef.h>	/* size_t */
 #include <ctype.h>
+#include <string.h>
 
 #include "strnatcmp.h"
 
@@ -150,3 +153,73 @@ int strnatcasecmp(char const *a, char const *b) {
      return strnatcmp0(a, b, 1);
 }
 
+
+/*
+ * Build a key for the SLEN bytes at S that memcmp's in natural order, S
+ * needn't be NUL terminated.  Whitespace is
+ * dropped like strnatcmp does.  A run of digits becomes '0', so it sorts
+ * against other characters like a digit would, followed by:
+ *
+ *  - for a run with a leading zero, which strnatcmp compares left-aligned
+ *    like a fraction, 0 then the digits then 0, so it sorts before any
+ *    whole number and shorter runs sort before longer ones;
+ *  - otherwise the number of digits then the digits, so longer numbers
+ *    sort after shorter ones and equal lengths compare digit by digit.
+ *
+ * KEY should hold STRNAT_KEY_SIZE(slen) bytes, the key length is
+ * returned.
+ */
+size_t strnat_key(char const *s, size_t slen, unsigned char *key,
+		  size_t size) {
+     char const *end = s + slen;
+     size_t len = 0, ndigits;
+     char const *digits;
+     int fractional;
+
+     while (s < end && len < size) {
+	  if (isspace((unsigned char)*s)) {
+	       s++;
+	       continue;
+	  }
+
+	  if (!isdigit((unsigned char)*s)) {
+	       key[len++] = (unsigned char)*s++;
+	       continue;
+	  }
+
+	  fractional = (*s == '0');
+	  digits = s;
+	  while (s < end && isdigit((unsigned char)*s))
+	       s++;
+	  ndigits = s - digits;
+	  if (ndigits > 255)
+	       ndigits = 255;
+
+	  if (len + 3 + ndigits > size)
+	       break;
+	  key[len++] = '0';
+	  key[len++] = fractional ? 0 : (unsigned char)ndigits;
+	  memcpy(key + len, digits, ndigits);
+	  len += ndigits;
+	  if (fractional)
+	       key[len++] = 0;
+     }
+
+     return len;
+}
+
+
+int strnat_keycmp(unsigned char const *a, size_t alen,
+		  unsigned char const *b, size_t blen) {
+     int result;
+
+     result = memcmp(a, b, alen < blen ? alen : blen);
+     if (result != 0)
+	  return result < 0 ? -1 : +1;
+
+     if (alen < blen)
+	  return -1;
+     if (alen > blen)
+	  return +1;
+     return 0;
+}
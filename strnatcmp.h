@@ -1,7 +1,21 @@
 #ifndef __STRNATCMP_H__
 #define __STRNATCMP_H__
 
+#include <stddef.h>
+
 int strnatcmp(char const *a, char const *b);
 int strnatcasecmp(char const *a, char const *b);
 
+/*
+ * Keys built by strnat_key sort the same as strnatcmp when compared with
+ * strnat_keycmp (a memcmp), so a list can be keyed once and sorted or
+ * searched without re-parsing digit runs on every comparison.
+ */
+#define STRNAT_KEY_SIZE(len)	(((len) * 3) + 2)
+
+size_t strnat_key(char const *s, size_t slen, unsigned char *key,
+  size_t size);
+int strnat_keycmp(unsigned char const *a, size_t alen,
+  unsigned char const *b, size_t blen);
+
 #endif
\ No newline at end of file
@@ -27,12 +27,14 @@
 #include <string.h>
 #include <memory.h>
 #include <misctool.h>
-#include <resources.h>
-#include <window.h>
 #include <orca.h>
 #include <gsos.h>
+#ifndef AMEND_HOST
+#include <resources.h>
+#include <window.h>
 #include <appleshare.h>
 #include <qdaux.h>
+#endif
 
 #include "AmendGS.h"
 #include "util.h"
@@ -42,43 +44,63 @@ segment "util";
 /* ALRT resources */
 #define ASK_ALERT_ID 130
 
+extern word programID;
+
+#ifndef AMEND_HOST
 #define ERROR_STRING_SIZE	1024
 static char err_str[ERROR_STRING_SIZE];
 
-extern word programID;
 static CtlRecHndl progress_static = NULL;
 static WindowPtr progress_dialog = NULL;
-
-enum {
-	STOP_ALERT,
-	CAUTION_ALERT,
-	NOTE_ALERT,
-	APPICON_ALERT
-};
+#endif
 
 /*
  * Define to audit each malloc and free and verify that a pointer isn't
- * double-freed.  The list of outstanding allocations can be checked by
- * looking through malloc_map.
+ * double-freed.  xfree_verify reports what is still outstanding and
+ * xmalloc_report the high-water marks, both by allocation note.
  */
 //#define MALLOC_DEBUG
 
 #ifdef MALLOC_DEBUG
 /*
- * List of allocations, updated at xmalloc() and xfree().  If an address
- * passed to xfree() isn't in the list, it indicates a double-free.
+ * Outstanding allocations, hashed by address with linear probing so
+ * xmalloc and xfree stay O(1).  Each one points at a per-note tally of
+ * what that allocation site has outstanding and at most had.  Both tables
+ * come from plain malloc so they don't track themselves.
  */
-#define MALLOC_MAP_CHUNK_SIZE	1024
+#define MALLOC_MAP_INITIAL	1024	/* slots, a power of 2 */
+#define MALLOC_SITES		256		/* a power of 2 */
+
+struct malloc_site {
+	char note[MALLOC_NOTE_SIZE];
+	unsigned long count, bytes;
+	unsigned long peak_count, peak_bytes;
+	unsigned long total_count;
+};
+
 struct malloc_map_e {
 	unsigned long addr;
 	unsigned long size;
-	char note[MALLOC_NOTE_SIZE];
-} *malloc_map = NULL;
-unsigned long malloc_map_size = 0;
-static bool malloc_map_compact = false;
-#endif
+	struct malloc_site *site;
+};
 
-void vwarn(word alert_func, const char *format, va_list ap);
+static struct malloc_map_e *malloc_map = NULL;
+static unsigned long malloc_map_size = 0, malloc_map_used = 0;
+static struct malloc_site *malloc_sites = NULL;
+static word malloc_nsites = 0;
+static unsigned long malloc_bytes = 0, malloc_peak_bytes = 0;
+static unsigned long malloc_peak_count = 0;
+
+static void malloc_map_init(void);
+static struct malloc_site *malloc_site(const char *note);
+static unsigned long malloc_map_find(unsigned long addr);
+static void malloc_map_add(unsigned long addr, unsigned long size,
+  struct malloc_site *site);
+static void malloc_map_remove(unsigned long slot);
+
+#define MALLOC_MAP_HASH(addr) \
+	((((addr) >> 3) * 2654435761UL) & (malloc_map_size - 1))
+#endif
 
 /*
  * Util helper needed to be called at program startup, to pre-allocate
@@ -88,13 +110,7 @@ void vwarn(word alert_func, const char *format, va_list ap);
 void util_init(void)
 {	
 #ifdef MALLOC_DEBUG
-	malloc_map_size = MALLOC_MAP_CHUNK_SIZE;
-	malloc_map = (struct malloc_map_e *)NewPtr(malloc_map_size *
-	  sizeof(struct malloc_map_e));
-    if (malloc_map == NULL) {
-		panic("NewPtr(%lu) failed", MALLOC_MAP_CHUNK_SIZE);
-    }
-	memset(malloc_map, 0, malloc_map_size);
+	malloc_map_init();
 #endif
 }
 
@@ -107,10 +123,6 @@ void util_init(void)
 void *xmalloc(size_t size, char *note)
 {
 	void *ptr;
-#ifdef MALLOC_DEBUG
-	struct malloc_map_e *new_malloc_map;
-	word n, j;
-#endif
 	
 	if (size == 0)
 		panic("xmalloc: zero size");
@@ -121,50 +133,7 @@ void *xmalloc(size_t size, char *note)
     }
 
 #ifdef MALLOC_DEBUG
-	if (malloc_map_compact) {
-		for (n = 0; n < malloc_map_size; n++) {
-            if (malloc_map[n].addr != 0) {
-				continue;
-            }
-				
-			for (j = n + 1; j < malloc_map_size; j++) {
-                if (malloc_map[j].addr == 0) {
-					continue;
-                }
-					
-				malloc_map[n] = malloc_map[j];
-				memset(&malloc_map[j], 0, sizeof(struct malloc_map_e));
-				break;
-			}
-		}
-		
-		malloc_map_compact = false;
-	}
-	
-	for (n = 0; n <= malloc_map_size; n++) {
-		if (n == malloc_map_size) {
-			malloc_map_size += MALLOC_MAP_CHUNK_SIZE;
-			warn("xmalloc(%lu): out of malloc map entries, maybe a "
-			  "memory leak, resizing to %ld", size, malloc_map_size);
-			new_malloc_map = (struct malloc_map_e *)NewPtr(
-			  malloc_map_size * sizeof(struct malloc_map_e));
-            if (new_malloc_map == NULL) {
-				panic("out of memory resizing malloc map");
-            }
-			memcpy(new_malloc_map, malloc_map,
-			  (malloc_map_size - MALLOC_MAP_CHUNK_SIZE) *
-			  sizeof(struct malloc_map_e));
-			DisposePtr(malloc_map);
-			malloc_map = new_malloc_map;
-		}
-		if (malloc_map[n].addr == 0) {
-			malloc_map[n].addr = (unsigned long)ptr;
-			malloc_map[n].size = size;
-			strlcpy(malloc_map[n].note, note, sizeof(malloc_map[n].note));
-			break;
-		}
-		n = n;
-	}
+	malloc_map_add((unsigned long)ptr, size, malloc_site(note));
 #endif
 
 	return ptr;
@@ -177,17 +146,11 @@ void xfree(void *ptrptr)
 #ifdef MALLOC_DEBUG
 	unsigned long n;
 
-	for (n = 0; n <= malloc_map_size; n++) {
-        if (n == malloc_map_size) {
+	if (ptr != NULL) {
+		if ((n = malloc_map_find(*addr)) == malloc_map_size)
 			panic("xfree(0x%lx): can't find in alloc map, likely "
-              "double free()", *addr);
-        }
-		if (malloc_map[n].addr == *addr) {
-			malloc_map[n].addr = 0;
-			malloc_map[n].size = 0;
-			malloc_map[n].note[0] = '\0';
-			break;
-		}
+			  "double free()", *addr);
+		malloc_map_remove(n);
 	}
 #endif
 
@@ -222,33 +185,38 @@ void *xcalloc(size_t nmemb, size_t size, char *note)
 	return ptr;
 }
 
+/*
+ * realloc keeps the block where it is when there's room after it, and
+ * when it has to move it only copies what the old block held.
+ */
 void *xrealloc(void *src, size_t size)
 {
-	void *ptr, *tsrc;
-	char note[MALLOC_NOTE_SIZE] = "realloc from null";
-	
+	void *ptr;
 #ifdef MALLOC_DEBUG
-	if (src != NULL) {
-		for (n = 0; n <= malloc_map_size; n++) {
-			if (n == malloc_map_size) {
-				panic("xrealloc(%lu): can't find in alloc map, likely "
-				  "double free()", (unsigned long)src);
-				return NULL;
-			}
-			if (malloc_map[n].addr == (unsigned long)src) {
-				strlcpy(note, malloc_map[n].note, sizeof(note));
-				break;
-			}
-		}
-	}
+	struct malloc_site *site;
+	unsigned long n;
 #endif
 
-	ptr = xmalloc(size, note);
-	if (src != NULL) {
-		memcpy(ptr, src, size);
-		tsrc = src;
-		xfree(&tsrc);
-	}
+	if (src == NULL)
+		return xmalloc(size, "realloc from null");
+	if (size == 0)
+		panic("xrealloc: zero size");
+
+#ifdef MALLOC_DEBUG
+	if ((n = malloc_map_find((unsigned long)src)) == malloc_map_size)
+		panic("xrealloc(0x%lx): can't find in alloc map, likely "
+		  "double free()", (unsigned long)src);
+	site = malloc_map[n].site;
+	malloc_map_remove(n);
+#endif
+
+	ptr = realloc(src, size);
+	if (ptr == NULL)
+		panic("xrealloc(%lu) failed", size);
+
+#ifdef MALLOC_DEBUG
+	malloc_map_add((unsigned long)ptr, size, site);
+#endif
 
 	return ptr;
 }
@@ -261,6 +229,21 @@ void *xreallocarray(void *optr, size_t nmemb, size_t size)
 	return xrealloc(optr, size * nmemb);
 }
 
+/*
+ * The capacity to grow an array of cur to hold need: half again as much,
+ * but at least min_grow more, so n appends cost O(n) copying rather than
+ * O(n^2) with a fixed increment.
+ */
+size_t grow_capacity(size_t cur, size_t need, size_t min_grow)
+{
+	size_t step;
+
+	step = MAX(cur / 2, min_grow);
+	if (cur > SIZE_MAX - step)
+		panic("grow_capacity(%lu, %lu) overflow", cur, need);
+	return MAX(cur + step, need);
+}
+
 char *xstrdup(const char *str, char *note)
 {
 	char *cp;
@@ -292,6 +275,420 @@ char *xstrndup(const char *str, size_t maxlen, char *note)
 	return copy;
 }
 
+#ifdef MALLOC_DEBUG
+static void malloc_map_init(void)
+{
+	if (malloc_map != NULL)
+		return;
+
+	malloc_map_size = MALLOC_MAP_INITIAL;
+	malloc_map = calloc(malloc_map_size, sizeof(struct malloc_map_e));
+	malloc_sites = calloc(MALLOC_SITES, sizeof(struct malloc_site));
+	if (malloc_map == NULL || malloc_sites == NULL)
+		panic("malloc_map_init: out of memory");
+}
+
+/* notes past the last site we have room for all get lumped together */
+static struct malloc_site malloc_other_site = { "(other notes)" };
+
+static struct malloc_site *malloc_site(const char *note)
+{
+	struct malloc_site *site;
+	unsigned long h = 5381;
+	const char *c;
+	word n;
+
+	malloc_map_init();
+
+	if (note == NULL)
+		note = "";
+	for (c = note; *c != '\0' && c - note < MALLOC_NOTE_SIZE - 1; c++)
+		h = (h * 33) ^ (unsigned char)*c;
+
+	for (n = h & (MALLOC_SITES - 1); ; n = (n + 1) & (MALLOC_SITES - 1)) {
+		site = &malloc_sites[n];
+		if (site->total_count == 0)
+			break;
+		if (strncmp(site->note, note, MALLOC_NOTE_SIZE - 1) == 0)
+			return site;
+	}
+
+	if (malloc_nsites >= MALLOC_SITES / 4 * 3)
+		return &malloc_other_site;
+	malloc_nsites++;
+	strlcpy(site->note, note, sizeof(site->note));
+	return site;
+}
+
+/* the slot holding addr, or malloc_map_size */
+static unsigned long malloc_map_find(unsigned long addr)
+{
+	unsigned long n;
+
+	if (malloc_map == NULL)
+		return malloc_map_size;
+
+	for (n = MALLOC_MAP_HASH(addr); malloc_map[n].addr != 0;
+	  n = (n + 1) & (malloc_map_size - 1)) {
+		if (malloc_map[n].addr == addr)
+			return n;
+	}
+	return malloc_map_size;
+}
+
+static void malloc_map_add(unsigned long addr, unsigned long size,
+  struct malloc_site *site)
+{
+	struct malloc_map_e *old_map;
+	unsigned long old_size, n, j;
+
+	/* keep it at most 3/4 full so probes stay short */
+	if ((malloc_map_used + 1) * 4 > malloc_map_size * 3) {
+		old_map = malloc_map;
+		old_size = malloc_map_size;
+		malloc_map_size *= 2;
+		malloc_map = calloc(malloc_map_size, sizeof(struct malloc_map_e));
+		if (malloc_map == NULL)
+			panic("out of memory resizing malloc map");
+		for (n = 0; n < old_size; n++) {
+			if (old_map[n].addr == 0)
+				continue;
+			for (j = MALLOC_MAP_HASH(old_map[n].addr);
+			  malloc_map[j].addr != 0; j = (j + 1) & (malloc_map_size - 1))
+				;
+			malloc_map[j] = old_map[n];
+		}
+		free(old_map);
+	}
+
+	for (n = MALLOC_MAP_HASH(addr); malloc_map[n].addr != 0;
+	  n = (n + 1) & (malloc_map_size - 1))
+		;
+	malloc_map[n].addr = addr;
+	malloc_map[n].size = size;
+	malloc_map[n].site = site;
+	malloc_map_used++;
+
+	site->count++;
+	site->bytes += size;
+	site->total_count++;
+	if (site->bytes > site->peak_bytes)
+		site->peak_bytes = site->bytes;
+	if (site->count > site->peak_count)
+		site->peak_count = site->count;
+
+	malloc_bytes += size;
+	if (malloc_bytes > malloc_peak_bytes)
+		malloc_peak_bytes = malloc_bytes;
+	if (malloc_map_used > malloc_peak_count)
+		malloc_peak_count = malloc_map_used;
+}
+
+static void malloc_map_remove(unsigned long slot)
+{
+	struct malloc_site *site = malloc_map[slot].site;
+	unsigned long mask = malloc_map_size - 1, i, j, k;
+
+	site->count--;
+	site->bytes -= malloc_map[slot].size;
+	malloc_bytes -= malloc_map[slot].size;
+	malloc_map_used--;
+
+	/*
+	 * Rather than leave a tombstone, pull back any entry after the hole
+	 * that would no longer be reachable from its home slot.
+	 */
+	for (i = slot; ; i = j) {
+		malloc_map[i].addr = 0;
+		for (j = (i + 1) & mask; ; j = (j + 1) & mask) {
+			if (malloc_map[j].addr == 0)
+				return;
+			k = MALLOC_MAP_HASH(malloc_map[j].addr);
+			if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+				continue;
+			break;
+		}
+		malloc_map[i] = malloc_map[j];
+	}
+}
+
+static int malloc_leak_cmp(const void *a, const void *b)
+{
+	const struct malloc_site *sa = *(const struct malloc_site **)a;
+	const struct malloc_site *sb = *(const struct malloc_site **)b;
+
+	if (sa->bytes != sb->bytes)
+		return sa->bytes < sb->bytes ? 1 : -1;
+	return strcmp(sa->note, sb->note);
+}
+
+static int malloc_peak_cmp(const void *a, const void *b)
+{
+	const struct malloc_site *sa = *(const struct malloc_site **)a;
+	const struct malloc_site *sb = *(const struct malloc_site **)b;
+
+	if (sa->peak_bytes != sb->peak_bytes)
+		return sa->peak_bytes < sb->peak_bytes ? 1 : -1;
+	return strcmp(sa->note, sb->note);
+}
+
+/* every site that has allocated anything, sorted by cmp */
+static word malloc_sorted_sites(struct malloc_site ***ret,
+  int (*cmp)(const void *, const void *))
+{
+	struct malloc_site **sites;
+	word n, nsites = 0;
+
+	sites = calloc(MALLOC_SITES + 1, sizeof(struct malloc_site *));
+	if (sites == NULL)
+		panic("malloc_sorted_sites: out of memory");
+	for (n = 0; malloc_sites != NULL && n < MALLOC_SITES; n++) {
+		if (malloc_sites[n].total_count != 0)
+			sites[nsites++] = &malloc_sites[n];
+	}
+	if (malloc_other_site.total_count != 0)
+		sites[nsites++] = &malloc_other_site;
+	qsort(sites, nsites, sizeof(struct malloc_site *), cmp);
+
+	*ret = sites;
+	return nsites;
+}
+#endif
+
+/*
+ * Report what's still allocated, by note, to stderr.  Called when
+ * everything should have been freed, anything listed is a leak.
+ */
+void xfree_verify(void)
+{
+#ifdef MALLOC_DEBUG
+	struct malloc_site **sites;
+	word n, nsites;
+
+	nsites = malloc_sorted_sites(&sites, malloc_leak_cmp);
+	for (n = 0; n < nsites && sites[n]->count != 0; n++)
+		fprintf(stderr, "leaked %8lu bytes in %6lu allocations: %s\n",
+		  sites[n]->bytes, sites[n]->count, sites[n]->note);
+	fprintf(stderr, "%lu bytes in %lu allocations outstanding\n",
+	  malloc_bytes, malloc_map_used);
+	free(sites);
+#endif
+}
+
+/* the most each note (and everything) had allocated at once, to stderr */
+void xmalloc_report(void)
+{
+#ifdef MALLOC_DEBUG
+	struct malloc_site **sites;
+	word n, nsites;
+
+	nsites = malloc_sorted_sites(&sites, malloc_peak_cmp);
+	fprintf(stderr, "%10s %8s %10s %8s  %s\n", "peak bytes", "peak",
+	  "bytes", "allocs", "note");
+	for (n = 0; n < nsites; n++)
+		fprintf(stderr, "%10lu %8lu %10lu %8lu  %s\n",
+		  sites[n]->peak_bytes, sites[n]->peak_count, sites[n]->bytes,
+		  sites[n]->total_count, sites[n]->note);
+	fprintf(stderr, "peak %lu bytes in %lu allocations\n",
+	  malloc_peak_bytes, malloc_peak_count);
+	free(sites);
+#endif
+}
+
+/*
+ * Arena functions
+ *
+ * Each allocation is preceded by its size so arena_reallocarray knows how
+ * much to copy, and the newest one can grow in place.
+ */
+
+#define ARENA_ALIGN sizeof(long)
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define ARENA_CHUNK_HEADER ARENA_ROUND(sizeof(struct arena_chunk))
+
+void arena_init(struct arena *arena, size_t chunk_size, char *note)
+{
+	memset(arena, 0, sizeof(struct arena));
+	arena->chunk_size = chunk_size;
+	strlcpy(arena->note, note, sizeof(arena->note));
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+	struct arena_chunk *chunk;
+	size_t need;
+	char *ptr;
+
+	if (size == 0)
+		panic("arena_alloc: zero size");
+	need = ARENA_ALIGN + ARENA_ROUND(size);
+	if (need < size)
+		panic("arena_alloc(%lu) overflow", size);
+
+	/* chunks past cur are empty since the last reset */
+	while (arena->cur == NULL ||
+	  arena->cur->used + need > arena->cur->size) {
+		if (arena->cur != NULL && arena->cur->next != NULL) {
+			arena->cur = arena->cur->next;
+			continue;
+		}
+		chunk = xmalloc(ARENA_CHUNK_HEADER + MAX(need, arena->chunk_size),
+		  arena->note);
+		chunk->next = NULL;
+		chunk->size = MAX(need, arena->chunk_size);
+		chunk->used = 0;
+		if (arena->cur == NULL)
+			arena->chunks = chunk;
+		else
+			arena->cur->next = chunk;
+		arena->cur = chunk;
+	}
+
+	ptr = (char *)arena->cur + ARENA_CHUNK_HEADER + arena->cur->used;
+	*(size_t *)ptr = size;
+	arena->cur->used += need;
+	arena->used += need;
+	if (arena->used > arena->high)
+		arena->high = arena->used;
+
+	arena->last = ptr + ARENA_ALIGN;
+	return arena->last;
+}
+
+void *arena_calloc(struct arena *arena, size_t nmemb, size_t size)
+{
+	void *ptr;
+
+	if ((nmemb >= MUL_NO_OVERFLOW || size >= MUL_NO_OVERFLOW) &&
+	  nmemb > 0 && SIZE_MAX / nmemb < size)
+		panic("arena_calloc(%lu, %lu) overflow", nmemb, size);
+	ptr = arena_alloc(arena, nmemb * size);
+	memset(ptr, 0, nmemb * size);
+
+	return ptr;
+}
+
+void *arena_reallocarray(struct arena *arena, void *ptr, size_t nmemb,
+  size_t size)
+{
+	size_t *hdr, old, grow;
+	void *nptr;
+
+	if ((nmemb >= MUL_NO_OVERFLOW || size >= MUL_NO_OVERFLOW) &&
+	  nmemb > 0 && SIZE_MAX / nmemb < size)
+		panic("arena_reallocarray(%lu, %lu) overflow", nmemb, size);
+	size *= nmemb;
+
+	if (ptr == NULL)
+		return arena_alloc(arena, size);
+
+	hdr = (size_t *)((char *)ptr - ARENA_ALIGN);
+	old = *hdr;
+	if (size <= old) {
+		/* shrinking gives nothing back, but keep the size honest */
+		*hdr = size;
+		return ptr;
+	}
+
+	grow = ARENA_ROUND(size) - ARENA_ROUND(old);
+	if (ptr == arena->last &&
+	  arena->cur->used + grow <= arena->cur->size) {
+		*hdr = size;
+		arena->cur->used += grow;
+		arena->used += grow;
+		if (arena->used > arena->high)
+			arena->high = arena->used;
+		return ptr;
+	}
+
+	nptr = arena_alloc(arena, size);
+	memcpy(nptr, ptr, old);
+
+	return nptr;
+}
+
+void arena_reset(struct arena *arena)
+{
+	struct arena_chunk *chunk;
+
+	for (chunk = arena->chunks; chunk != NULL; chunk = chunk->next)
+		chunk->used = 0;
+	arena->cur = arena->chunks;
+	arena->last = NULL;
+	arena->used = 0;
+}
+
+void arena_free(struct arena *arena)
+{
+	struct arena_chunk *chunk;
+
+	while (arena->chunks != NULL) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		xfree(&chunk);
+	}
+	arena->cur = NULL;
+	arena->last = NULL;
+	arena->used = 0;
+}
+
+/*
+ * Pool functions
+ *
+ * Records come out of the pool's arena, a freed one goes on a list that
+ * pool_alloc takes from first.
+ */
+
+void pool_init(struct pool *pool, size_t size, size_t per_chunk, char *note)
+{
+	if (size < sizeof(void *))
+		size = sizeof(void *);
+	arena_init(&pool->arena, (ARENA_ALIGN + ARENA_ROUND(size)) * per_chunk,
+	  note);
+	pool->size = size;
+	pool->free_list = NULL;
+	pool->count = 0;
+}
+
+void *pool_alloc(struct pool *pool)
+{
+	void *ptr;
+
+	if (pool->free_list != NULL) {
+		ptr = pool->free_list;
+		pool->free_list = *(void **)ptr;
+	} else
+		ptr = arena_alloc(&pool->arena, pool->size);
+	memset(ptr, 0, pool->size);
+	pool->count++;
+
+	return ptr;
+}
+
+void pool_free(struct pool *pool, void *ptrptr)
+{
+	void **addr = (void **)ptrptr;
+
+	*(void **)*addr = pool->free_list;
+	pool->free_list = *addr;
+	pool->count--;
+	*addr = NULL;
+}
+
+void pool_reset(struct pool *pool)
+{
+	arena_reset(&pool->arena);
+	pool->free_list = NULL;
+	pool->count = 0;
+}
+
+void pool_destroy(struct pool *pool)
+{
+	arena_free(&pool->arena);
+	pool->free_list = NULL;
+	pool->count = 0;
+}
+
 
 /*
  * String functions
@@ -401,6 +798,7 @@ char *OSTypeToString(OSType type)
 /*
  * BSD err(3) and warn(3) functions
  */
+#ifndef AMEND_HOST
 void vwarn(word alert_func, const char *format, va_list ap)
 {
     extern char err_str[ERROR_STRING_SIZE];
@@ -450,6 +848,7 @@ void ExitToShell(void) {
     QuitRecGS quit = { 1, 0 };
     QuitGS(&quit);
 }
+#endif
 
 void panic(const char *format, ...)
 {
@@ -509,6 +908,7 @@ void appicon_note(const char *format, ...)
 	va_end(ap);
 }
 
+#ifndef AMEND_HOST
 word ask(const char *format, ...)
 {
     char alertStr[ERROR_STRING_SIZE];
@@ -562,6 +962,7 @@ void progress(char *format, ...)
     (*progress_static)->ctlValue = strlen(progress_s);
     DrawOneCtl(progress_static);
 }
+#endif
 
 
 /*
@@ -580,6 +981,36 @@ unsigned long xorshift32(void)
 	return _xorshift_state = x;
 }
 
+/*
+ * CRC-32 (IEEE), pass 0 to start and the previous return value to
+ * continue over more data
+ */
+unsigned long crc32_update(unsigned long crc, const void *data, size_t len)
+{
+	static unsigned long table[256];
+	static bool table_built = false;
+	const unsigned char *p = data;
+	unsigned long c;
+	word n, k;
+
+	if (!table_built) {
+		for (n = 0; n < 256; n++) {
+			c = n;
+			for (k = 0; k < 8; k++)
+				c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+			table[n] = c;
+		}
+		table_built = true;
+	}
+
+	/* masked, so a host with 64-bit longs gets the same 32-bit crc */
+	crc = ~crc & 0xFFFFFFFFUL;
+	while (len--)
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc & 0xFFFFFFFFUL;
+}
+
  
 Handle xNewHandle(size_t size)
 {
@@ -599,6 +1030,7 @@ Handle xNewHandle(size_t size)
 }
 
 
+#ifndef AMEND_HOST
 Handle xGetResource(ResType type, long id) {
 	Handle h;
 	
@@ -652,6 +1084,7 @@ long xGetStringAsLong(long id)
 	xfree(&c);
 	return r;
 }
+#endif
 
 void xSetHandleSize(Handle h, Size s)
 {
@@ -661,411 +1094,6 @@ void xSetHandleSize(Handle h, Size s)
     }
 }
 
-word getpath(word vRefNum, StringPtr fileName, GSString255Ptr ret, bool include_file) {
-    ResultBuf255 prefix = { 255, { 0 }};
-    RefInfoRecGS refRec = { 3, vRefNum, 0, &prefix };
-    char *pos;
-    word error;
-
-    memset(ret, 0, sizeof(GSString255));
-    GetRefInfoGS(&refRec);
-    error = toolerror();
-    if (!error) {
-        pos = strrchr(prefix.bufString.text, ':');
-        if (pos) {
-            pos++;
-            *pos = 0;
-            prefix.bufString.length = strlen(prefix.bufString.text);
-        }
-        memcpy(ret, &prefix.bufString, prefix.bufString.length + sizeof(word));
-        if (include_file) {
-            strncat(ret->text, fileName->text, fileName->textLength);
-            ret->length = strlen(ret->text);
-        }
-    }
-    
-    return error;
-}
-
-word FSDelete(GSString255Ptr path) {
-    NameRecGS destroyRec = { 1, path };
-    DestroyGS(&destroyRec);
-    return toolerror();
-}
-
-word FDelete(StringPtr path) {
-    GSString255 gpath;
-    s2gstr(gpath, (*path));
-    return FSDelete(&gpath);
-}
-
-word FRename(GSString255Ptr source, GSString255Ptr dest) {
-    ChangePathRecGS changeRec = { 2, source, dest };
-    ChangePathGS(&changeRec);
-
-    return toolerror();
-}
-
-word FStat(GSString255Ptr path, FileInfoRecPtrGS sb) {
-    static ResultBuf255 optionList = { 255, { 0 } };
-
-    sb->pCount = 11;
-    sb->pathname = path;
-    sb->optionList = &optionList;
-    GetFileInfoGS(sb);
-    
-    return toolerror();
-}
-
-word copy_file(GSString255Ptr source, GSString255Ptr dest, bool overwrite) {
-    word error, source_ref, dest_ref;
-    FileInfoRecGS infoRec;
-    CreateRecGS createRec = {7, dest, 0};
-    OpenRecGS sOpenRec = { 4, 0, source, readEnable, dataForkNum };
-    OpenRecGS dOpenRec = { 4, 0, dest, writeEnable, dataForkNum };
-    RefNumRecGS closeRec = { 1 };
-
-	/* copy data fork */
-    error = FStat(source, &infoRec);
-    if (error) {
-		return error;
-    }
-	
-    createRec.access = infoRec.access;
-    createRec.fileType = infoRec.fileType;
-    createRec.auxType = infoRec.auxType;
-    createRec.storageType = infoRec.storageType;
-    createRec.eof = infoRec.eof;
-    createRec.resourceEOF = infoRec.resourceEOF;
-    CreateGS(&createRec);
-    error = toolerror();
-	if (error == dupPathname && overwrite) {
-        error = FSDelete(dest);
-        if (error) {
-			return error;
-        }
-        CreateGS(&createRec);
-        error = toolerror();
-	}
-    if (error) {
-		return error;
-    }
-	
-    OpenGS(&sOpenRec);
-    error = toolerror();
-    if (error) {
-		return error;
-    }
-    source_ref = sOpenRec.refNum;
-	
-    OpenGS(&dOpenRec);
-    error = toolerror();
-	if (error) {
-        closeRec.refNum = source_ref;
-        CloseGS(&closeRec);
-		return error;
-	}
-    dest_ref = dOpenRec.refNum;
-
-	error = copy_file_contents(source_ref, dest_ref);
-	
-    closeRec.refNum = source_ref;
-    CloseGS(&closeRec);
-    closeRec.refNum = dest_ref;
-    CloseGS(&closeRec);
-	
-    if (error) {
-		return error;
-    }
-	
-	/*
-	 * Copy resource fork, open source as shared read/write in case it's
-	 * an open resource file.
-	 */
-    if (infoRec.resourceEOF) {
-    }
-    sOpenRec.resourceNumber =  resourceForkNum;
-    OpenGS(&sOpenRec);
-    error = toolerror();
-	if (error) {
-		/* no resource fork */
-		return 0;
-	}
-    source_ref = sOpenRec.refNum;
-	
-    dOpenRec.resourceNumber = resourceForkNum;
-    OpenGS(&dOpenRec);
-    error = toolerror();
-
-	if (error) {
-        closeRec.refNum = source_ref;
-        CloseGS(&closeRec);
-		return error;
-	}
-	
-	error = copy_file_contents(source_ref, dest_ref);
-	
-    closeRec.refNum = source_ref;
-    CloseGS(&closeRec);
-    closeRec.refNum = dest_ref;
-    CloseGS(&closeRec);
-	
-    return error;
-}
-
-word FSeek(word vRefNum, long displacement) {
-    SetPositionRecGS posRec = { 3, vRefNum, startPlus, displacement };
-    SetMarkGS(&posRec);
-
-    return toolerror();
-}
-
-word FCreate(word vRefNum, StringPtr filename, word fileType, long auxType, longword preAlloc) {
-    GSString255 path;
-    CreateRecGS createRec = { 6, &path, 0x00E3, fileType, auxType, 1, preAlloc};
-    if (vRefNum) {
-        getpath(vRefNum, filename, &path, true);
-    } else {
-        strncpy(path.text, filename->text, filename->textLength);
-        path.length = filename->textLength;
-    }
-
-    CreateGS(&createRec);
-
-    return toolerror();
-}
-
-word FOpen(word vRefNum, StringPtr filename, word access, word *frefnum, longword *eof) {
-    GSString255 path;
-    OpenRecGS openRec = { 12, 0, &path, access, dataForkNum };
-
-    if (vRefNum) {
-        getpath(vRefNum, filename, &path, true);
-    } else {
-        strncpy(path.text, filename->text, filename->textLength);
-        path.length = filename->textLength;
-    }
-
-    OpenGS(&openRec);
-
-    if (toolerror() == 0) {
-        if (frefnum) {
-            *frefnum = openRec.refNum;
-        }
-        if (eof) {
-            *eof = openRec.eof;
-        }
-    }
-    return toolerror();
-}
-
-word FWrite(word fRefNum, void *buf, longword *count) {
-    IORecGS writeRec = { 4, fRefNum, (Pointer) buf, *count, 0 };
-
-    WriteGS(&writeRec);
-    *count = writeRec.transferCount;
-
-    return toolerror();
-}
-
-word FRead(word fRefNum, void *buf, longword *count) {
-    IORecGS readRec = { 4, fRefNum, (Pointer) buf, *count, 0 };
-
-    ReadGS(&readRec);
-    *count = readRec.transferCount;
-
-    return toolerror();
-}
-
-word FClose(word fRefNum) {
-    RefNumRecGS closeRec = { 1, fRefNum };
-
-    CloseGS(&closeRec);
-
-    return toolerror();
-}
-
-word FSetEOF(word fRefNum, longword displacement) {
-    SetPositionRecGS eofRec = { 3, fRefNum, 0, displacement };
-
-    SetEOFGS(&eofRec);
-
-    return toolerror();
-}
-
-word FGetEOF(word fRefNum, longword *eof) {
-    EOFRecGS eofRec = { 2, fRefNum, 0 };
-
-    GetEOFGS(&eofRec);
-    if (eof) {
-        *eof = eofRec.eof;
-    }
-
-    return toolerror();
-}
-
-word FFlush(word fRefNum) {
-    RefNumRecGS flushRec = { 1, fRefNum };
-
-    FlushGS(&flushRec);
-
-    return toolerror();
-}
-
-word FRewind(word fRefNum) {
-    return FSeek(fRefNum, 0);
-}
-
-int FGetc(word fRefNum) {
-    char c = 0;
-    IORecGS readRec = { 4, fRefNum, &c, 1, 0 };
-    ReadGS(&readRec);
-    if (toolerror()) {
-        return -1;
-    }
-    return c;
-}
-
-long FGetMark(word fRefNum) {
-    PositionRecGS markRec = { 2, fRefNum, 0 };
-
-    GetMarkGS(&markRec);
-
-    return markRec.position;
-}
-
-word copy_file_contents(word source_ref, word dest_ref)
-{
-	char *buf;
-	word error;
-    long count, source_size;
-    EOFRecGS eofRec = { 2, source_ref };
-    IORecGS ioRec = { 4, 0, 0, 0, 0 };
-
-    GetEOFGS(&eofRec);
-    source_size = eofRec.eof;
-
-    error = FSeek(source_ref, 0);
-    if (error) {
-		return error;
-    }
-    eofRec.refNum = dest_ref;
-    error = FSeek(dest_ref, 0);
-    if (error) {
-		return error;
-    }
-		
-	buf = xmalloc(1024, "copy_file_contents");
-	
-	while (source_size > 0) {
-		count = 1024;
-        if (count > source_size) {
-			count = source_size;
-        }
-        ioRec.refNum = source_ref;
-        ioRec.dataBuffer = buf;
-        ioRec.requestCount = count;
-        ReadGS(&ioRec);
-        error = toolerror();
-        if (error && error != eofEncountered) {
-			break;
-        }
-		source_size -= count;
-        ioRec.refNum = dest_ref;
-        WriteGS(&ioRec);
-        error = toolerror();
-		if (error && error != eofEncountered)
-			break;
-	}
-	
-	xfree(&buf);
-	
-    if (error && error != eofEncountered) {
-		return error;
-    }
-	
-	return 0;
-}
-
-/* read a \r-terminated line or the final non-line bytes of an open file */
-size_t FSReadLine(word frefnum, char *buf, size_t buflen)
-{
-    size_t pos, fsize, total_read = 0;
-	char tbuf = 0;
-	word error;
-    EOFRecGS eofRec = { 2, frefnum };
-    PositionRecGS markRec = { 2, frefnum, 0 };
-    IORecGS ioRec = { 4, frefnum, &tbuf, 1, 0 };
-
-    GetMarkGS(&markRec);
-    pos = markRec.position;
-    GetEOFGS(&eofRec);
-    fsize = eofRec.eof;
-	
-	
-	for (; pos <= fsize; pos++) {
-        if (total_read > buflen) {
-			return -1;
-        }
-        ReadGS(&ioRec);
-        error = toolerror();
-        if (error) {
-			return -1;
-        }
-		
-        if (tbuf == '\r') {
-			return total_read;
-        }
-
-		buf[total_read++] = tbuf;
-	}
-	
-	/* nothing found until the end of the file */
-	return total_read;
-}
-
-word FGetFSTId(word refNum) {
-    ResultBuf255 volume = { 255, { 0 }};
-    RefInfoRecGS refRec = { 3, refNum, 0, &volume };
-    char *pos;
-    int sysID = 0;
-    VolumeRecGS volumeRec = {0};
-    DInfoRecGS dInfoRec;
-    ResultBuf32 devName = { 32, { 0 }};
-    ResultBuf255 volName = { 255, { 0 }};
-    word devCount = 0;
-
-    GetRefInfoGS(&refRec);
-    pos = strchr(volume.bufString.text, ':');
-    if (!pos) {
-        return 0;
-    }
-
-    *pos = 0;
-    do {
-        dInfoRec.pCount = 2;
-        dInfoRec.devNum = devCount++;
-        dInfoRec.devName = &devName;
-        DInfoGS(&dInfoRec);
-        if (toolerror() == 0) {
-            memset(&volName, 0, sizeof(ResultBuf255));
-            volumeRec.pCount = 5;
-            volumeRec.devName = &(devName.bufString);
-            volumeRec.volName = &volName;
-            VolumeGS(&volumeRec);
-            if (toolerror() == 0 &&
-                strcmp(volume.bufString.text, volName.bufString.text) == 0) {
-                sysID = volumeRec.fileSysID;
-                break;
-            }
-        } else {
-            break;
-        }
-    } while (toolerror() != paramRangeErr);
-
-    return sysID;
-}
-
 /*
  * Appends src to string dst of size dsize (unlike strncat, dsize is the
  * full size of dst, not space left).  At most dsize-1 characters
@@ -1199,9 +1227,10 @@ char* timeString(time_t tim) {
     ConvSeconds(secs2TimeRec, tim, (Pointer) &tm);
     memset(timeStr, 0, sizeof(timeStr));
 
+    /* weekDay is 1 for Sunday and day is 0 based */
     sprintf(timeStr, "%s %s %d %02d:%02d:%02d %d",
-            days[tm.weekDay], months[tm.month], tm.day, tm.hour, tm.minute,
-            tm.second, 1900+(int)tm.year);
+            days[(tm.weekDay + 6) % 7], months[tm.month], tm.day + 1,
+            tm.hour, tm.minute, tm.second, 1900+(int)tm.year);
 
     return timeStr;
 }
@@ -19,19 +19,24 @@
 #define __UTIL_H__
 
 #include <stdlib.h>
+#include <stdarg.h>
 #include <limits.h>
 #include <time.h>
 #include <stdbool.h>
+#ifndef AMEND_HOST
 #include <window.h>
 #include <textedit.h>
 #include <quickdraw.h>
 #include <control.h>
-#include <dialog.h> 
+#include <dialog.h>
+#endif
+#include "fileio.h"
+
 #ifndef SIZE_MAX
 #define SIZE_MAX ULONG_MAX
 #endif
 
-#ifdef __ORCAC__
+#if defined(__ORCAC__) || defined(AMEND_HOST)
 #define OSType long
 #define Size size_t
 #endif 
@@ -44,11 +49,11 @@
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define BOUND(a, min, max) ((a) > (max) ? (max) : ((a) < (min) ? (min) : (a)))
 
+/* grows var by half again (at least grow_amount) so appends stay linear */
 #define EXPAND_TO_FIT(var, var_size, used_size, add, grow_amount) { \
 	if ((used_size) + (add) >= (var_size)) { \
-		while ((used_size) + (add) >= (var_size)) { \
-			(var_size) += (grow_amount); \
-		} \
+		(var_size) = grow_capacity((var_size), (used_size) + (add) + 1, \
+		  (grow_amount)); \
 		(var) = xrealloc((var), (var_size)); \
 	} \
 }
@@ -102,13 +107,62 @@ void util_init(void);
 void * xmalloc(size_t, char *note);
 void xfree(void *ptrptr);
 void xfree_verify(void);
+void xmalloc_report(void);
 void * xmalloczero(size_t, char *note);
 void * xcalloc(size_t, size_t, char *note);
 void * xrealloc(void *src, size_t size);
 void * xreallocarray(void *, size_t, size_t);
+size_t grow_capacity(size_t cur, size_t need, size_t min_grow);
 char * xstrdup(const char *, char *note);
 char * xstrndup(const char *str, size_t maxlen, char *note);
 
+/*
+ * Bump allocator for scratch memory that all goes away at once: nothing
+ * is freed on its own, arena_reset makes every chunk reusable and
+ * arena_free gives them back.
+ */
+struct arena_chunk {
+	struct arena_chunk *next;
+	size_t size;
+	size_t used;
+};
+
+struct arena {
+	struct arena_chunk *chunks;
+	struct arena_chunk *cur;
+	size_t chunk_size;
+	void *last;
+	size_t used;
+	size_t high;
+	char note[MALLOC_NOTE_SIZE];
+};
+
+void arena_init(struct arena *arena, size_t chunk_size, char *note);
+void * arena_alloc(struct arena *arena, size_t size);
+void * arena_calloc(struct arena *arena, size_t nmemb, size_t size);
+void * arena_reallocarray(struct arena *arena, void *ptr, size_t nmemb,
+  size_t size);
+void arena_reset(struct arena *arena);
+void arena_free(struct arena *arena);
+
+/*
+ * Fixed-size records for things allocated by the thousand, like a repo's
+ * files and amendments: a few arena chunks instead of a malloc each, and
+ * pool_reset or pool_destroy instead of a free each.
+ */
+struct pool {
+	struct arena arena;
+	size_t size;
+	void *free_list;
+	size_t count;
+};
+
+void pool_init(struct pool *pool, size_t size, size_t per_chunk, char *note);
+void * pool_alloc(struct pool *pool);
+void pool_free(struct pool *pool, void *ptrptr);
+void pool_reset(struct pool *pool);
+void pool_destroy(struct pool *pool);
+
 word getline(char *str, size_t len, char **ret);
 const char * ordinal(word n);
 size_t rtrim(char *str, char *chars);
@@ -116,7 +170,21 @@ long strpos_quoted(char *str, char c);
 char * OSTypeToString(OSType type);
 
 unsigned long xorshift32(void);
+unsigned long crc32_update(unsigned long crc, const void *data, size_t len);
 
+enum {
+	STOP_ALERT,
+	CAUTION_ALERT,
+	NOTE_ALERT,
+	APPICON_ALERT
+};
+
+/*
+ * vwarn, ask and progress are the only ways the core talks to the user,
+ * a host build (AMEND_HOST) provides its own instead of the alert windows
+ */
+void vwarn(word alert_func, const char *format, va_list ap);
+void ExitToShell(void);
 void panic(const char *format, ...);
 void err(word ret, const char *format, ...);
 void warnx(const char *format, ...);
@@ -126,47 +194,29 @@ void appicon_note(const char *format, ...);
 word ask(const char *format, ...);
 #define ASK_YES 1
 #define ASK_NO  2
-void about(char *program_name);
 void progress(char *format, ...);
+
+Handle xNewHandle(size_t size);
+void xSetHandleSize(Handle h, Size s);
+
+#ifndef AMEND_HOST
+void about(char *program_name);
 void window_rect(WindowPtr win, Rect *ret);
 void center_in_screen(word width, word height, bool titlebar, Rect *b);
 Point centered_sfget_dialog(void);
 Point centered_sfput_dialog(void);
 
-Handle xNewHandle(size_t size);
 Handle xGetResource(ResType type, long id);
 Handle xGetString(long id);
 char * xGetStringAsChar(long id);
 long xGetStringAsLong(long id);
-void xSetHandleSize(Handle h, Size s);
-
-word getpath(word vRefNum, StringPtr fileName, GSString255Ptr ret, bool include_file);
-word FSDelete(GSString255Ptr path);
-word FDelete(StringPtr path);
-word FRename(GSString255Ptr source, GSString255Ptr dest);
-word FStat(GSString255Ptr path, FileInfoRecPtrGS sb);
-word FSeek(word vRefNum, long displacement);
-word FCreate(word vRefNum, StringPtr filename, word fileType, long auxType, longword prealloc);
-word FOpen(word vRefNum, StringPtr filename, word access, word *frefnum, longword *eof);
-word FClose(word fRefNum);
-word FWrite(word fRefNum, void *buf, longword *count);
-word FRead(word fRefNum, void *buf, longword *count);
-word FSetEOF(word fRefNum, longword displacement);
-word FGetEOF(word fRefNum, longword *eof);
-word FFlush(word fRefNum);
-word FRewind(word fRefNum);
-int FGetc(word fRefNum); 
-long FGetMark(word fRefNum);
-word copy_file(GSString255Ptr source, GSString255Ptr dest, bool overwrite);
-word copy_file_contents(word source_ref, word dest_ref);
-size_t FSReadLine(word frefnum, char *buf, size_t buflen);
-word FGetFSTId(word refNum);
 
 word FontHeight(word font_id, word size);
 void PasswordDialogFieldFinish(void);
 pascal void NullCaretHook(void);
 void HideMenuBar(void);
 void RestoreHiddenMenuBar(void);
+#endif
 
 size_t strlcat(char *dst, const char *src, size_t dsize);
 size_t strlcpy(char *dst, const char *src, size_t dsize);
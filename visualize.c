@@ -36,9 +36,12 @@ segment "visualize";
 
 #include "AmendGS.h"
 #include "committer.h"
+#include "diff.h"
 #include "repo.h"
+#include "revcache.h"
 #include "bile.h"
 #include "browser.h"
+#include "stats.h"
 #include "util.h"
 #include "visualize.h"
 #include "patch.h"
@@ -49,6 +52,17 @@ struct buffer {
     long position;
     word column;
     word maxLineLength;
+    Handle offsets; //longword offset of each line in buffer
+    word nlines;
+    word topLine;
+    Handle rows; //struct rendered_row[ROW_CACHE_SIZE]
+};
+
+struct rendered_row {
+    word line;
+    word column;
+    word charsPerLine;
+    word data[8][VISUALIZE_ROW_CHARS];
 };
 
 struct visualize {
@@ -66,6 +80,14 @@ struct visualize {
     struct buffer rightBuffer;
 };
 
+/* offsets[n - 1] to offsets[n] is line n of text, CR included */
+struct line_table {
+    char *text;
+    size_t len;
+    longword *offsets;
+    longword nlines;
+};
+
 enum {
     VISUALIZE_STATE_HEADER_FROM,
     VISUALIZE_STATE_TO,
@@ -84,7 +106,30 @@ void visualize_fixScrollbars(struct visualize *visualize);
 void handleVertScrollbar(struct visualize *visualize, EventRecord *event);
 void handleHorizontalScrollbar(EventRecord *event, CtlRecHndl ctl, Rect *rect, struct buffer *buffer, word maxLine);
 void DrawBuffer(Rect *rectRect, struct buffer *buffer);
-void visualize_writeBuffer(struct repo *repo, struct buffer *buffer, StringPtr tmpFilename);
+Handle visualize_bufferText(struct buffer *buffer);
+void visualize_writeText(struct repo *repo, Handle text, StringPtr tmpFilename);
+void freeBuffer(struct buffer *buffer);
+void addLineToBuffer(struct buffer *buffer, word lineNum, char *line, word lineLen);
+void addTableLine(struct buffer *buffer, word lineNum, char type,
+                  struct line_table *table, longword line);
+longword nextDiffLine(char *diff, size_t diffLen, longword pos);
+bool visualize_touchesFile(struct repo_amendment *amendment, word file_id);
+int visualize_readDiff(struct repo *repo, struct repo_amendment *amendment,
+                       char **dtext, size_t *dSize);
+size_t visualize_readText(struct repo *repo, word file_id, char **text);
+Handle visualize_newText(size_t size);
+Handle visualize_replay(struct visualize *visualize, struct repo *repo,
+                        struct repo_amendment *amendment, struct repo_file *file,
+                        Handle base, bool display);
+int visualize_commitBuffers(struct visualize *visualize,
+                            struct committer *committer, word n);
+void visualize_initBuffers(struct visualize *visualize);
+void visualize_lineTable(struct line_table *table, char *text, size_t len);
+void visualize_mergeBuffers(struct visualize *visualize, struct line_table *old,
+                            struct line_table *new, struct diff_hunk *hunks,
+                            word nhunks);
+long visualize_applyHunks(struct line_table *old, struct diff_hunk *hunks,
+                          word nhunks, char *diff, size_t diffLen, char *out);
 
 static char visualizer_err[128];
 extern word programID;
@@ -117,21 +162,22 @@ void visualize_commit(struct committer *committer) {
     word ctlId;
     MemRecHndl listHand;
     word x;
+    int built;
 
     memset(&visualize, 0, sizeof(struct visualize));
-    visualize.diffLen = TEGetText(0x1D, (Ref) &(visualize.diffText), 0L, 
-                                  refIsNewHandle, (Ref) NULL, 
-                                  (Handle) committer->diff_te);
 
     if (committer->ndiffed_files == 1) {
         progress("Building display...");
-        if (visualize_buildBuffers(&visualize, committer->browser->repo->bile->frefnum,
-                                   &committer->diffed_files[0].file->filename,
-                                   &committer->diffed_files[0].file->filename,
-                                   true) == 0) {
+        STAT_START(STAT_TIME_VISUALIZE);
+        built = visualize_commitBuffers(&visualize, committer, 0);
+        STAT_STOP(STAT_TIME_VISUALIZE);
+        if (built == 0) {
             progress(NULL);
             visualize_file(&visualize, committer->browser->repo->bile->frefnum,
                            &committer->diffed_files[0].file->filename);
+        } else {
+            freeBuffer(&visualize.leftBuffer);
+            freeBuffer(&visualize.rightBuffer);
         }
     } else if (committer->ndiffed_files > 1) {
         currentEvent.wmTaskMask = 0x001FFFFFL;
@@ -155,13 +201,16 @@ void visualize_commit(struct committer *committer) {
             case  VISUALIZE_SELECT_VISUALIZE_BUTTON_ID:
                 x = NextMember2(0, (Handle) GetCtlHandleFromID(win, VISUALIZE_SELECT_LIST_ID));
                 progress("Building display...");
-                if (visualize_buildBuffers(&visualize, committer->browser->repo->bile->frefnum, 
-                                           &committer->diffed_files[x - 1].file->filename, 
-                                           &committer->diffed_files[x - 1].file->filename,
-                                           true) == 0) {
+                STAT_START(STAT_TIME_VISUALIZE);
+                built = visualize_commitBuffers(&visualize, committer, x - 1);
+                STAT_STOP(STAT_TIME_VISUALIZE);
+                if (built == 0) {
                     progress(NULL);
                     visualize_file(&visualize, committer->browser->repo->bile->frefnum,
                                    &committer->diffed_files[x - 1].file->filename);
+                } else {
+                    freeBuffer(&visualize.leftBuffer);
+                    freeBuffer(&visualize.rightBuffer);
                 }
                 progress(NULL);
                 break;
@@ -177,7 +226,9 @@ void visualize_commit(struct committer *committer) {
     } else {
         warnx("No files to visualize");
     }
-    DisposeHandle(visualize.diffText);
+    if (visualize.diffText != NULL) {
+        DisposeHandle(visualize.diffText);
+    }
 }
 
 void visualize_amendment(struct browser *browser, struct repo_amendment *amendment, 
@@ -191,9 +242,6 @@ void visualize_amendment(struct browser *browser, struct repo_amendment *amendme
     word x;
 
     memset(&visualize, 0, sizeof(struct visualize));
-    visualize.diffLen = TEGetText(0x1D, (Ref) &(visualize.diffText), 0L, 
-                                  refIsNewHandle, (Ref) NULL, 
-                                  (Handle) browser->diff_te);
 
     if (diff_files == 1) {
         visualize_rollback(&visualize, browser->repo, amendment, repo_files[0]);
@@ -230,90 +278,439 @@ void visualize_amendment(struct browser *browser, struct repo_amendment *amendme
     } else {
         warnx("No files to visualize");
     }
-    DisposeHandle(visualize.diffText);
+    if (visualize.diffText != NULL) {
+        DisposeHandle(visualize.diffText);
+    }
 }
 
 int visualize_rollback(struct visualize *visualize, struct repo *repo,
                         struct repo_amendment *amendment, struct repo_file *file) {
-    struct bile_object *textob, *diffob;
-    size_t dSize, size;
-    char *dtext = NULL, *text;
-    Str255 tmpFilename;
-    int tmpFd, i, j;
+    struct bile_object *textob;
+    Handle diffText, base, text;
+    longword diffLen;
+    Str255 filename;
+    bool ownBase = true;
+    int i, t, start;
     struct repo_amendment *a;
-    struct bile_object *aob;
-    size_t aSize;
-    char *atext = NULL;
 
     textob = bile_find(repo->bile, REPO_TEXT_RTYPE, file->id);
     if (textob == NULL) {
         warn("No copy of file %s exists in repo", file->filename);
         return -1;
     }
+    xfree(&textob);
 
-    text = xmalloc(textob->size, "visualize_rollback");
-    size = bile_read_object(repo->bile, textob, text, textob->size);
-    if (size != textob->size) {
-        panic("Failed to read text object %ld: %d", textob->id,
-              bile_error(repo->bile));
+    for (t = 0; t < repo->namendments; t++) {
+        if (repo->amendments[t]->id == amendment->id) {
+            break;
+        }
+    }
+    if (t == repo->namendments) {
+        warn("Amendment %d not found in repo", amendment->id);
+        return -1;
     }
 
-    diffob = bile_find(repo->bile, REPO_DIFF_RTYPE, amendment->id);
-    dtext = xmalloc(diffob->size, "repo_show_diff_text");
-    dSize = bile_read_object(repo->bile, diffob, dtext, diffob->size);
-    if (dSize != diffob->size) {
-        panic("Failed to read text object %ld: %d", diffob->id,
-              bile_error(repo->bile));
+    if (repo->revcache == NULL) {
+        repo->revcache = revcache_open(repo);
     }
 
-    tmpFd = patch_open_temp_dest_file(repo, &tmpFilename);
-    FSetEOF(tmpFd, 0);
-    //FWrite(tmpFd, text, &size);
-    FClose(tmpFd);
-    xfree(&text);
+    /* the caller's diff handle, put back before returning */
+    diffText = visualize->diffText;
+    diffLen = visualize->diffLen;
+
+    /*
+     * amendments are sorted newest first, so anything after t is older.
+     * Start from the newest older revision of this file we've already
+     * built, or from an empty file if there isn't one.  Cached handles
+     * belong to the cache and stay valid until the next revcache_put.
+     */
+    base = NULL;
+    start = repo->namendments - 1;
+    for (i = t + 1; i < repo->namendments; i++) {
+        a = repo->amendments[i];
+        if (!visualize_touchesFile(a, file->id)) {
+            continue;
+        }
+        base = revcache_get(repo->revcache, file->id, a->id);
+        if (base != NULL) {
+            ownBase = false;
+            start = i - 1;
+            break;
+        }
+    }
+    if (base == NULL) {
+        base = visualize_newText(0);
+    }
 
     progress("Building display...");
+    STAT_START(STAT_TIME_VISUALIZE);
     //walk the amendments backwards to undo amends 1 and a time until
     //we get to this amendment.
-    for (i = repo->namendments - 1; i >= 0; i--) {
+    for (i = start; i >= t; i--) {
         a = repo->amendments[i];
-        if (a->id == amendment->id) {
-            break;
+        if (i != t && !visualize_touchesFile(a, file->id)) {
+            continue;
         }
-        for (j = 0; j < a->nfiles; j++) {
-            if (a->file_ids[j] == file->id) {
-                aob = bile_find(repo->bile, REPO_DIFF_RTYPE, a->id);
-                atext = xmalloc(aob->size, "repo_show_diff_text");
-                aSize = bile_read_object(repo->bile, aob, atext, aob->size);
-                if (aSize != aob->size) {
-                    panic("Failed to read text object %ld: %d", aob->id,
-                          bile_error(repo->bile));
-                }
-                visualize->diffText = &atext;
-                visualize->diffLen = aSize;
-                visualize_buildBuffers(visualize, repo->bile->frefnum, &tmpFilename, &file->filename, false);
-                xfree(&atext);
-                FDelete(&tmpFilename);
-                visualize_writeBuffer(repo, &visualize->rightBuffer, &tmpFilename);
-                DisposeHandle(visualize->leftBuffer.buffer);
-                DisposeHandle(visualize->rightBuffer.buffer);
-                break;
+        text = visualize_replay(visualize, repo, a, file, base, (i == t));
+        if (ownBase) {
+            DisposeHandle(base);
+            ownBase = false;
+        }
+        if (text == NULL) {
+            STAT_STOP(STAT_TIME_VISUALIZE);
+            progress(NULL);
+            visualize->diffText = diffText;
+            visualize->diffLen = diffLen;
+            return -1;
+        }
+        /* the cache owns it from here on */
+        revcache_put(repo->revcache, file->id, a->id, text);
+        base = text;
+    }
+    STAT_STOP(STAT_TIME_VISUALIZE);
+    progress(NULL);
+
+    /* visualize_file disposes of the buffers, and p2cstr's the name */
+    memcpy(&filename, &file->filename, sizeof(filename));
+    visualize_file(visualize, repo->bile->frefnum, &filename);
+
+    visualize->diffText = diffText;
+    visualize->diffLen = diffLen;
+    return 1;
+}
+
+/*
+ * Apply one amendment's changes to base, returning the new text of the
+ * file.  Amendments with stored hunks are applied directly from the
+ * hunks and the added lines in the diff, older ones go through the
+ * unified diff parser.  If display is set the visualize buffers are left
+ * built for the change.
+ */
+Handle visualize_replay(struct visualize *visualize, struct repo *repo,
+                        struct repo_amendment *amendment, struct repo_file *file,
+                        Handle base, bool display) {
+    struct line_table old, new;
+    struct diff_hunk *hunks;
+    word nhunks;
+    Str255 tmpFilename;
+    char *dtext = NULL;
+    size_t dSize;
+    long size;
+    Handle text = NULL;
+
+    if (visualize_readDiff(repo, amendment, &dtext, &dSize) != 0) {
+        return NULL;
+    }
+
+    if (repo_file_hunks(repo, amendment->id, file->id, &hunks, &nhunks)) {
+        HLock(base);
+        visualize_lineTable(&old, *base, GetHandleSize(base));
+        size = visualize_applyHunks(&old, hunks, nhunks, dtext, dSize, NULL);
+        if (size >= 0) {
+            text = visualize_newText(size);
+            HLock(text);
+            visualize_applyHunks(&old, hunks, nhunks, dtext, dSize, *text);
+            if (display) {
+                visualize_lineTable(&new, *text, size);
+                visualize_mergeBuffers(visualize, &old, &new, hunks, nhunks);
+                xfree(&new.offsets);
             }
+            HUnlock(text);
+        }
+        xfree(&old.offsets);
+        HUnlock(base);
+        xfree(&hunks);
+
+        if (text != NULL) {
+            xfree(&dtext);
+            return text;
         }
+        /* hunks don't line up with the diff, fall back to parsing it */
     }
+
+    visualize_writeText(repo, base, &tmpFilename);
     visualize->diffText = &dtext;
     visualize->diffLen = dSize;
     visualize_buildBuffers(visualize, repo->bile->frefnum, &tmpFilename, &file->filename, false);
-    progress(NULL);
+    FDelete(&tmpFilename);
+    xfree(&dtext);
 
-    visualize_file(visualize, repo->bile->frefnum, &tmpFilename);
+    text = visualize_bufferText(&visualize->rightBuffer);
+    if (!display) {
+        freeBuffer(&visualize->leftBuffer);
+        freeBuffer(&visualize->rightBuffer);
+    }
 
-    xfree(&dtext);
-    xfree(&text);
-    DisposeHandle(visualize->leftBuffer.buffer);
-    DisposeHandle(visualize->rightBuffer.buffer);
-    FDelete(&tmpFilename);
-    return 1;
+    return text;
+}
+
+/*
+ * Build the buffers for a file about to be committed straight from the
+ * hunks the diff engine recorded, the stored text and the file on disk.
+ */
+int visualize_commitBuffers(struct visualize *visualize,
+                            struct committer *committer, word n) {
+    struct repo *repo = committer->browser->repo;
+    struct diffed_file *diffed = &committer->diffed_files[n];
+    struct line_table old, new;
+    char *oldText = NULL, *newText = NULL;
+    size_t oldLen = 0, newLen = 0;
+    longword eof;
+    word fd, error;
+
+    if (diffed->nhunks == 0) {
+        if (visualize->diffText == NULL) {
+            visualize->diffLen = TEGetText(0x1D, (Ref) &(visualize->diffText), 0L,
+                                           refIsNewHandle, (Ref) NULL,
+                                           (Handle) committer->diff_te);
+        }
+        return visualize_buildBuffers(visualize, repo->bile->frefnum,
+                                      &diffed->file->filename,
+                                      &diffed->file->filename, true);
+    }
+
+    if (!(diffed->file->flags & REPO_FILE_DELETED)) {
+        oldLen = visualize_readText(repo, diffed->file->id, &oldText);
+    }
+
+    error = FOpen(repo->bile->frefnum, &diffed->file->filename, readEnable,
+                  &fd, &eof);
+    if (error == 0) {
+        if (eof > 0) {
+            newLen = eof;
+            newText = xmalloc(newLen, "visualize_commitBuffers");
+            error = FRead(fd, newText, &newLen);
+        }
+        FClose(fd);
+    }
+    if (error && error != fileNotFound) {
+        warn("Failed to read %s: %d", p2cstr((char *)&diffed->file->filename), error);
+        if (oldText != NULL) {
+            xfree(&oldText);
+        }
+        if (newText != NULL) {
+            xfree(&newText);
+        }
+        return -1;
+    }
+
+    visualize_lineTable(&old, oldText, oldLen);
+    visualize_lineTable(&new, newText, newLen);
+    visualize_mergeBuffers(visualize, &old, &new, diffed->hunks, diffed->nhunks);
+    xfree(&old.offsets);
+    xfree(&new.offsets);
+    if (oldText != NULL) {
+        xfree(&oldText);
+    }
+    if (newText != NULL) {
+        xfree(&newText);
+    }
+
+    return 0;
+}
+
+void visualize_lineTable(struct line_table *table, char *text, size_t len) {
+    longword n = 0, i;
+
+    for (i = 0; i < len; i++) {
+        if (text[i] == '\r') {
+            n++;
+        }
+    }
+    if (len && text[len - 1] != '\r') {
+        n++;
+    }
+
+    table->text = text;
+    table->len = len;
+    table->offsets = xcalloc(n + 1, sizeof(longword), "visualize_lineTable");
+    table->nlines = 0;
+    for (i = 0; i < len; i++) {
+        if (text[i] == '\r') {
+            table->offsets[++table->nlines] = i + 1;
+        }
+    }
+    if (table->nlines < n) {
+        table->offsets[++table->nlines] = len;
+    }
+}
+
+void addTableLine(struct buffer *buffer, word lineNum, char type,
+                  struct line_table *table, longword line) {
+    char buf[BUFSIZ];
+    size_t len;
+
+    len = table->offsets[line] - table->offsets[line - 1];
+    if (len > sizeof(buf) - 3) {
+        len = sizeof(buf) - 3;
+    }
+    buf[0] = type;
+    memcpy(buf + 1, table->text + table->offsets[line - 1], len);
+    len++;
+    if (buf[len - 1] != '\r') {
+        buf[len++] = '\r';
+    }
+    buf[len] = '\0';
+    addLineToBuffer(buffer, lineNum, buf, len);
+}
+
+/*
+ * Lay the old and new text out side by side: lines outside the hunks go
+ * on both sides, removed lines only on the left and added lines only on
+ * the right, with placeholders on the other side.
+ */
+void visualize_mergeBuffers(struct visualize *visualize, struct line_table *old,
+                            struct line_table *new, struct diff_hunk *hunks,
+                            word nhunks) {
+    longword o = 1, n = 1, k, end;
+    word h;
+
+    visualize_initBuffers(visualize);
+
+    for (h = 0; h <= nhunks; h++) {
+        end = (h < nhunks) ? hunks[h].old_line : old->nlines + 1;
+        for (; (o < end) && (o <= old->nlines); o++, n++) {
+            addTableLine(&visualize->leftBuffer, o, ' ', old, o);
+            addTableLine(&visualize->rightBuffer, n, ' ', old, o);
+        }
+        if (h == nhunks) {
+            break;
+        }
+
+        for (k = 0; (k < hunks[h].old_len) && (o <= old->nlines); k++, o++) {
+            addTableLine(&visualize->leftBuffer, o, '-', old, o);
+            addLineToBuffer(&visualize->rightBuffer, n, "X\r", 2);
+        }
+        for (k = 0; (k < hunks[h].new_len) && (n <= new->nlines); k++, n++) {
+            addLineToBuffer(&visualize->leftBuffer, o, "X\r", 2);
+            addTableLine(&visualize->rightBuffer, n, '+', new, n);
+        }
+    }
+
+    visualize->lines = visualize->rightBuffer.nlines;
+}
+
+longword nextDiffLine(char *diff, size_t diffLen, longword pos) {
+    while ((pos < diffLen) && (diff[pos] != '\r')) {
+        pos++;
+    }
+    return (pos < diffLen) ? pos + 1 : pos;
+}
+
+/*
+ * Produce the text after the hunks are applied to old into out, taking
+ * added lines from the diff.  Returns the size of the new text, or -1 if
+ * the hunks don't match old or the diff.  With a NULL out it only sizes.
+ */
+long visualize_applyHunks(struct line_table *old, struct diff_hunk *hunks,
+                          word nhunks, char *diff, size_t diffLen, char *out) {
+    longword o = 1, k, pos, next, end, len;
+    long size = 0;
+    word h;
+
+    for (h = 0; h <= nhunks; h++) {
+        end = (h < nhunks) ? hunks[h].old_line : old->nlines + 1;
+        if ((end < o) || (end > old->nlines + 1)) {
+            return -1;
+        }
+        len = old->offsets[end - 1] - old->offsets[o - 1];
+        if (out != NULL) {
+            memcpy(out + size, old->text + old->offsets[o - 1], len);
+        }
+        size += len;
+        o = end;
+        if (h == nhunks) {
+            break;
+        }
+
+        if (o + hunks[h].old_len > old->nlines + 1) {
+            return -1;
+        }
+        pos = hunks[h].diff_pos;
+        for (k = 0; k < hunks[h].old_len; k++) {
+            if ((pos >= diffLen) || (diff[pos] != '-')) {
+                return -1;
+            }
+            pos = nextDiffLine(diff, diffLen, pos);
+        }
+        o += hunks[h].old_len;
+
+        for (k = 0; k < hunks[h].new_len; k++) {
+            if ((pos >= diffLen) || (diff[pos] != '+')) {
+                return -1;
+            }
+            next = nextDiffLine(diff, diffLen, pos);
+            len = next - pos - 1;
+            if (out != NULL) {
+                memcpy(out + size, diff + pos + 1, len);
+            }
+            size += len;
+            pos = next;
+        }
+    }
+
+    return size;
+}
+
+bool visualize_touchesFile(struct repo_amendment *amendment, word file_id) {
+    word j;
+
+    for (j = 0; j < amendment->nfiles; j++) {
+        if (amendment->file_ids[j] == file_id) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int visualize_readDiff(struct repo *repo, struct repo_amendment *amendment,
+                       char **dtext, size_t *dSize) {
+    struct bile_object *diffob;
+    size_t size;
+
+    diffob = bile_find(repo->bile, REPO_DIFF_RTYPE, amendment->id);
+    if (diffob == NULL) {
+        warn("No diff for amendment %d exists in repo", amendment->id);
+        return -1;
+    }
+
+    size = bile_object_size(repo->bile, diffob);
+    *dtext = xmalloc(size, "visualize_readDiff");
+    *dSize = bile_read_object(repo->bile, diffob, *dtext, size);
+    if (*dSize != size) {
+        panic("Failed to read text object %ld: %d", diffob->id,
+              bile_error(repo->bile));
+    }
+    xfree(&diffob);
+
+    return 0;
+}
+
+size_t visualize_readText(struct repo *repo, word file_id, char **text) {
+    struct bile_object *textob;
+    size_t size, tsize;
+
+    *text = NULL;
+    textob = bile_find(repo->bile, REPO_TEXT_RTYPE, file_id);
+    if (textob == NULL) {
+        return 0;
+    }
+    tsize = bile_object_size(repo->bile, textob);
+    if (tsize == 0) {
+        xfree(&textob);
+        return 0;
+    }
+
+    *text = xmalloc(tsize, "visualize_readText");
+    size = bile_read_object(repo->bile, textob, *text, tsize);
+    if (size != tsize) {
+        panic("Failed to read text object %ld: %d", textob->id,
+              bile_error(repo->bile));
+    }
+    xfree(&textob);
+
+    return size;
 }
 
 int visualize_file(struct visualize *visualize, word vrefnum, StringPtr filename) {
@@ -399,8 +796,8 @@ int visualize_file(struct visualize *visualize, word vrefnum, StringPtr filename
 
     CloseWindow(visualize->win);
     SetPort(port);
-    DisposeHandle(visualize->leftBuffer.buffer);
-    DisposeHandle(visualize->rightBuffer.buffer);
+    freeBuffer(&visualize->leftBuffer);
+    freeBuffer(&visualize->rightBuffer);
 }
 
 long parseDiff(char *diff, longword diffLen, longword *pos, char *buf, long bufLen) { 
@@ -441,91 +838,46 @@ void visualize_fixScrollbars(struct visualize *visualize) {
     SetCtlParams(newDataSize, newViewSize, visualize->rightScroll);
 }
 
+/* how far we can scroll down, at most one page */
 word fullLinesRemain(struct buffer *buffer) {
-    char *buf = *(buffer->buffer);
-    long pos = buffer->position;
-    word count = 0;
-    word col = 0;
-
-    pos += 2;
-    while (pos < buffer->bufSize) {
-        if ((buf[pos] == 0xff) && (buf[pos+1] == 0xff)) {
-            count++;
-            col = 0;
-            if (count > 38) {
-                break;
-            }
-            pos += 2;
-        } else {
-            pos++;
-            col++;
-        }
-    }
-    if (col) {
-        count++;
+    long remain = (long)buffer->nlines - (long)buffer->topLine - 19;
+
+    if (remain < 0) {
+        return 0;
     }
-    return count > 38 ? 19 : count - 19;
+    return remain > 19 ? 19 : remain;
 }
 
 bool scrollBuffer(struct buffer *buffer, int pos) {
-    int direction = 1;
-    char *curr;
+    long line;
 
-    if (pos < 0) {
-        direction = -1;
-    }
-    if (direction == -1 && buffer->position == 0) {
+    if (pos < 0 && buffer->topLine == 0) {
         return false;
     }
 
-    if (direction == 1) {
-        buffer->position += (2 * direction); //skip over the line marker
-    } else {
-        buffer->position--; //skip over the line marker
-    }
-    curr = *(buffer->buffer) + buffer->position;
-    while (pos) {
-        if ((curr[0] == 0xff ) && (curr[direction] == 0xff)) {
-            if (direction < 0) {
-                curr--;
-                buffer->position--;
-            }
-            pos += -direction;
-            if (pos) {
-                curr += direction;
-                buffer->position += direction;
-            }
-        } else {
-            curr += direction;
-            if ((buffer->position + direction > buffer->bufSize) ||
-                (buffer->position + direction < 0)) {
-                break;
-            }
-            buffer->position += direction;
-        }
+    line = (long)buffer->topLine + pos;
+    if (line > (long)buffer->nlines - 1) {
+        line = buffer->nlines - 1;
+    }
+    if (line < 0) {
+        line = 0;
     }
+    buffer->topLine = line;
+    buffer->position = buffer->nlines ? ((longword *)*(buffer->offsets))[line] : 0;
     return true;
 }
 
 void gotoLine(struct buffer *buffer, word line) {
-    size_t pos = 0;
-    char *buf = *(buffer->buffer);
-
-    while ((pos < buffer->bufSize) && line) {
-        if ((buf[pos] == 0xff) && (buf[pos+1] == 0xff)) {
-            line--;
-            if (!line) {
-                break;
-            }
-        }
-        pos++;
+    //line is 1 based
+    if (line > buffer->nlines) {
+        line = buffer->nlines;
     }
-    buffer->position = pos;
+    buffer->topLine = line ? line - 1 : 0;
+    buffer->position = buffer->nlines ? ((longword *)*(buffer->offsets))[buffer->topLine] : 0;
 }
 
 void handleVertScrollbar(struct visualize *visualize, EventRecord *event) {
     word part;
-    int offset;
     int lineDiff = 0;
     bool updateScreen = false;
     CtlRecHndl control;
@@ -551,8 +903,6 @@ void handleVertScrollbar(struct visualize *visualize, EventRecord *event) {
     if (lineDiff) {
         if (scrollBuffer(&visualize->leftBuffer, lineDiff)) {
             scrollBuffer(&visualize->rightBuffer, lineDiff);
-            visualize->leftBuffer.position =  visualize->leftBuffer.position < 0 ? 0 : visualize->leftBuffer.position;
-            visualize->rightBuffer.position =  visualize->rightBuffer.position < 0 ? 0 : visualize->rightBuffer.position;
             updateScreen = true;
         }
     }
@@ -560,12 +910,8 @@ void handleVertScrollbar(struct visualize *visualize, EventRecord *event) {
             DrawBuffer(&(*visualize->leftRect)->ctlRect, &visualize->leftBuffer);
             DrawBuffer(&(*visualize->rightRect)->ctlRect, &visualize->rightBuffer);
     }
-    offset = GetCtlValue(visualize->vertScroll);
-    offset += lineDiff;
-    if (offset < 0) {
-        offset = 0;
-    }
-    SetCtlValue(offset, visualize->vertScroll);
+    //both sides always have the same number of lines
+    SetCtlValue(visualize->rightBuffer.topLine, visualize->vertScroll);
 
 }
 
@@ -604,9 +950,17 @@ void addLineToBuffer(struct buffer *buffer, word lineNum, char *line, word lineL
     char *bufData;
     word *l;
 
+    STAT_COUNT(STAT_VISUALIZE_LINES);
+    STAT_ADD(STAT_VISUALIZE_BYTES, lineLen);
     if ((buffer->bufSize + sizeof(word) + sizeof(word) + lineLen + 1) > bufSize) {
         SetHandleSize(bufSize + BUFFER_INCREMENT, buffer->buffer);
     }
+    bufSize = GetHandleSize(buffer->offsets);
+    if ((buffer->nlines + 1) * sizeof(longword) > bufSize) {
+        SetHandleSize(bufSize + (LINE_INCREMENT * sizeof(longword)), buffer->offsets);
+    }
+    ((longword *)*(buffer->offsets))[buffer->nlines++] = buffer->bufSize;
+    buffer->maxLineLength = MAX(buffer->maxLineLength, lineLen);
 
     HLock(buffer->buffer);
     bufData = *(buffer->buffer) + buffer->bufSize;
@@ -621,6 +975,31 @@ void addLineToBuffer(struct buffer *buffer, word lineNum, char *line, word lineL
     HUnlock(buffer->buffer);
 }
 
+void visualize_initBuffers(struct visualize *visualize) {
+    memset(&visualize->leftBuffer, 0, sizeof(struct buffer));
+    memset(&visualize->rightBuffer, 0, sizeof(struct buffer));
+    visualize->leftBuffer.buffer = xNewHandle(BUFFER_INCREMENT);
+    visualize->rightBuffer.buffer = xNewHandle(BUFFER_INCREMENT);
+    visualize->leftBuffer.offsets = xNewHandle(LINE_INCREMENT * sizeof(longword));
+    visualize->rightBuffer.offsets = xNewHandle(LINE_INCREMENT * sizeof(longword));
+}
+
+void freeBuffer(struct buffer *buffer) {
+    if (buffer->buffer != NULL) {
+        DisposeHandle(buffer->buffer);
+        buffer->buffer = NULL;
+    }
+    if (buffer->offsets != NULL) {
+        DisposeHandle(buffer->offsets);
+        buffer->offsets = NULL;
+    }
+    if (buffer->rows != NULL) {
+        DisposeHandle(buffer->rows);
+        buffer->rows = NULL;
+    }
+    buffer->nlines = 0;
+}
+
 int visualize_buildBuffers(struct visualize *visualize, word vrefNum, 
                            StringPtr readFilename, StringPtr filename,
                            bool isCommit) {
@@ -639,10 +1018,7 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
     visualState = VISUALIZE_STATE_HEADER_FROM;
     visualizer_err[0] = 0;
 
-    memset(&visualize->leftBuffer, 0, sizeof(struct buffer));
-    memset(&visualize->rightBuffer, 0, sizeof(struct buffer));
-    visualize->leftBuffer.buffer = xNewHandle(BUFFER_INCREMENT);
-    visualize->rightBuffer.buffer = xNewHandle(BUFFER_INCREMENT);
+    visualize_initBuffers(visualize);
 
     FOpen(vrefNum,
           readFilename,
@@ -752,8 +1128,6 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
                 addLineToBuffer(&visualize->rightBuffer, rightLineNum, sourceBuf, sourceLen);
                 leftLineNum++;
                 rightLineNum++;
-                visualize->leftBuffer.maxLineLength = MAX(visualize->leftBuffer.maxLineLength, sourceLen);
-                visualize->rightBuffer.maxLineLength = MAX(visualize->rightBuffer.maxLineLength, sourceLen);
             }
             break;
         case VISUALIZE_STATE_CONTEXT:
@@ -768,7 +1142,6 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
                 dest_delta--;
                 fromLine++;
                 rightLineNum++;
-                visualize->rightBuffer.maxLineLength = MAX(visualize->rightBuffer.maxLineLength, linelen);
             } else if (diffBuf[0] == '-') {
                 strcat(diffBuf, "\r");
                 addLineToBuffer(&visualize->leftBuffer, leftLineNum, diffBuf, linelen + 1);
@@ -777,7 +1150,6 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
                     FSReadLine(fd, sourceBuf, sizeof(sourceBuf) - 2);
                 }
                 leftLineNum++;
-                visualize->leftBuffer.maxLineLength = MAX(visualize->leftBuffer.maxLineLength, linelen);
             } else if (diffBuf[0] == ' ') {
 
                 fromLine++;
@@ -798,8 +1170,6 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
                 addLineToBuffer(&visualize->rightBuffer, rightLineNum, sourceBuf, sourceLen);
                 leftLineNum++;
                 rightLineNum++;
-                visualize->leftBuffer.maxLineLength = MAX(visualize->leftBuffer.maxLineLength, sourceLen);
-                visualize->rightBuffer.maxLineLength = MAX(visualize->rightBuffer.maxLineLength, sourceLen);
                 dest_delta--;
             }
             if (dest_delta <= 0) {
@@ -824,8 +1194,6 @@ int visualize_buildBuffers(struct visualize *visualize, word vrefNum,
             addLineToBuffer(&visualize->rightBuffer, rightLineNum, sourceBuf, sourceLen);
             leftLineNum++;
             rightLineNum++;
-            visualize->leftBuffer.maxLineLength = MAX(visualize->leftBuffer.maxLineLength, sourceLen);
-            visualize->rightBuffer.maxLineLength = MAX(visualize->rightBuffer.maxLineLength, sourceLen);
         }
     } while (sourceLen >= 0);
 visualize_done:
@@ -839,17 +1207,15 @@ visualize_done:
     return ret;
 }
 
-void DrawOneLineFast(Rect *lineRect, word charsPerLine, char *data, word start) {
+void RenderLine(word lineData[8][VISUALIZE_ROW_CHARS], word charsPerLine, char *data, word start) {
     extern word Characters[256][8];
     extern word redSpace[8], greenSpace[8];
     word x, y;
     char lineStr[7];
     byte type, theChar;
     char *line = data;
-    word lineData[8][37];
     word linePos = 0;
     bool done = false;
-    LocInfo loc = { 0x80, (Pointer)&lineData, charsPerLine * 2, { 0, 0, 8, 296 }};
     word lineNum;
 
     line += 2; //skip over start of line marker
@@ -958,57 +1324,136 @@ void DrawOneLineFast(Rect *lineRect, word charsPerLine, char *data, word start)
             linePos++;
         }
     }
+}
+
+void DrawOneLineFast(Rect *lineRect, word charsPerLine, word lineData[8][VISUALIZE_ROW_CHARS]) {
+    LocInfo loc = { 0x80, (Pointer)lineData, VISUALIZE_ROW_CHARS * 2, { 0, 0, 8, 296 }};
+
+    loc.boundsRect.h2 = charsPerLine * 8;
     PPToPort(&loc, &loc.boundsRect, lineRect->h1, lineRect->v1, modeCopy);
 }
 
+/*
+ * Rows are rendered into a small direct mapped cache so scrolling only
+ * has to build the rows that came into view, the rest are just blitted.
+ */
 void DrawBuffer(Rect *rectRect, struct buffer *buffer) {
-    word x;
+    static char emptyLine[] = "\xff\xff\0\0X\r";
+    word x, line;
     Rect bufRect;
-    char *line;
-    char *end;
+    longword *offsets;
+    struct rendered_row *row;
     word charsPerLine = ((rectRect->h2 - rectRect->h1) / 8) - 1;
 
+    if (charsPerLine > VISUALIZE_ROW_CHARS) {
+        charsPerLine = VISUALIZE_ROW_CHARS;
+    }
+
+    if (buffer->rows == NULL) {
+        buffer->rows = xNewHandle(ROW_CACHE_SIZE * sizeof(struct rendered_row));
+        for (x = 0; x < ROW_CACHE_SIZE; x++) {
+            ((struct rendered_row *)*(buffer->rows))[x].line = ROW_CACHE_EMPTY;
+        }
+    }
+
     memcpy(&bufRect, rectRect, sizeof(Rect));
     bufRect.v1 += 2;
     bufRect.h1 += 3;
     HLock(buffer->buffer);
-    line = (*buffer->buffer) + buffer->position;
-    end = (*buffer->buffer) + buffer->bufSize;
+    HLock(buffer->offsets);
+    HLock(buffer->rows);
+    offsets = (longword *)*(buffer->offsets);
 
     for (x = 0; x < 19;x ++) {
-        DrawOneLineFast(&bufRect, charsPerLine, line, buffer->column);
-        line += 2; //skip over the line marker
-        line += 2; //skip over the line number
-        //Search of EOL marker
-        while ((*line != 13) && (line < end)) {
-            line++;
-        }
-        line++; //skip over EOL marker (CR);
+        line = buffer->topLine + x;
+        row = &((struct rendered_row *)*(buffer->rows))[line % ROW_CACHE_SIZE];
+        if ((row->line != line) || (row->column != buffer->column) ||
+            (row->charsPerLine != charsPerLine)) {
+            if (line < buffer->nlines) {
+                RenderLine(row->data, charsPerLine, *(buffer->buffer) + offsets[line], buffer->column);
+            } else {
+                RenderLine(row->data, charsPerLine, emptyLine, buffer->column);
+            }
+            row->line = line;
+            row->column = buffer->column;
+            row->charsPerLine = charsPerLine;
+        }
+        DrawOneLineFast(&bufRect, charsPerLine, row->data);
         bufRect.v1 += 8;
     }
+    HUnlock(buffer->rows);
+    HUnlock(buffer->offsets);
     HUnlock(buffer->buffer);
 }
 
 
-void visualize_writeBuffer(struct repo *repo, struct buffer *buffer, StringPtr tmpFilename) {
-    char *cur, *end, *line;
-    int fd;
-    size_t size;
+/*
+ * Turn a visualize buffer back into plain file text.  Placeholder lines
+ * ('X') only exist to line the two sides up, so they are dropped.
+ */
+Handle visualize_bufferText(struct buffer *buffer) {
+    char *cur, *end, *line, *out;
+    size_t size = 0, len;
+    byte type;
+    Handle text;
 
-    cur = *(buffer->buffer);
-    end = cur + buffer->bufSize;
-    fd = patch_open_temp_dest_file(repo, tmpFilename);
+    HLock(buffer->buffer);
+    end = *(buffer->buffer) + buffer->bufSize;
+    for (cur = *(buffer->buffer); cur < end; cur += len) {
+        cur += 4; //skip marker and number
+        type = *cur++;
+        line = cur;
+        while ((cur < end) && (*cur != 13)) {
+            cur++;
+        }
+        len = (cur < end) ? 1 : 0; //include the CR
+        if (type != 'X') {
+            size += (cur - line) + len;
+        }
+    }
 
-    while (cur < end) {
-        cur += 5; //skip marker and number, type add/remove/common
+    text = visualize_newText(size);
+    HLock(text);
+    out = *text;
+    for (cur = *(buffer->buffer); cur < end; cur += len) {
+        cur += 4;
+        type = *cur++;
         line = cur;
-        while ((*cur != 13) && (cur < end)) {
+        while ((cur < end) && (*cur != 13)) {
             cur++;
         }
-        cur++; //include the CR
-        size = cur - line;
-        FWrite(fd, line, &size);
+        len = (cur < end) ? 1 : 0;
+        if (type != 'X') {
+            memcpy(out, line, (cur - line) + len);
+            out += (cur - line) + len;
+        }
     }
-    FClose(fd);
+    HUnlock(text);
+    HUnlock(buffer->buffer);
+
+    return text;
+}
+
+/* an empty revision is legitimate, so no xNewHandle */
+Handle visualize_newText(size_t size) {
+    Handle text;
+
+    text = NewHandle(size, programID, 0, NULL);
+    if (text == NULL) {
+        panic("Failed to NewHandle(%lu)", size);
+    }
+
+    return text;
 }
 
+void visualize_writeText(struct repo *repo, Handle text, StringPtr tmpFilename) {
+    int fd;
+    size_t size;
+
+    fd = patch_open_temp_dest_file(repo, tmpFilename);
+    size = GetHandleSize(text);
+    HLock(text);
+    FWrite(fd, *text, &size);
+    HUnlock(text);
+    FClose(fd);
+}
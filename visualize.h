@@ -16,6 +16,12 @@
  */
 
 #define BUFFER_INCREMENT 4096
+#define LINE_INCREMENT 256
+
+/* characters per visualize row, and rendered rows kept per side */
+#define VISUALIZE_ROW_CHARS 37
+#define ROW_CACHE_SIZE 32
+#define ROW_CACHE_EMPTY 0xFFFF
 
 void visualize_commit(struct committer *committer);
 void visualize_amendment(struct browser *browser, struct repo_amendment *amendment, word files, struct repo_file **repo_files);